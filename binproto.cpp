@@ -0,0 +1,368 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Binary framed protocol: frames, CRC, payloads
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * Alternative for the text protocol, on the same serial link or TCP
+ * port: a frame starts with BIN_SYNC1, which never starts a text line,
+ * so both can be mixed and xtrack keeps working with text.
+ * Values are fixed point integers (out of range: clamped), so no
+ * atof()/dtostrf() at all; parse + format is > 10x cheaper than text,
+ * see host/bench_proto.cpp. Kepler decay_rate and bstar span too many
+ * decades for that: IEEE float.
+ * Frame layout and payloads: see binproto.h.
+ * The link side (feeding bytes, replies) is in command_binary.ino.
+ *
+ * public functions:
+ *   uint16_t bin_crc(uint16_t crc,const uint8_t *buf,int len)
+ *   int bin_rx_byte(BIN_RX *rx,uint8_t c)
+ *   int bin_rx(BIN_RX *rx,const uint8_t *buf,int n,int *used)
+ *   int bin_make(uint8_t *frm,int id,const uint8_t *payload,int len)
+ *   int bin_put_goto(uint8_t *frm,GOTO_VAL *gv)
+ *   int bin_get_goto(BIN_FRAME *f,GOTO_VAL *gv)
+ *   int bin_put_status(uint8_t *frm,ROTOR *AX_rot,ROTOR *EY_rot,boolean run_calc,boolean run_sched)
+ *   int bin_put_rotdata(uint8_t *frm,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv,long t)
+ *   int bin_get_rotdata(BIN_FRAME *f,float *pos,float *req,int *spd,GOTO_VAL *gv,long *t)
+ *   int bin_put_kepler(uint8_t *frm,KEPLER *k)
+ *   int bin_get_kepler(BIN_FRAME *f,KEPLER *k)
+ *   + little endian put/get of 16/32 bits and float, bin_fix()
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+#include <string.h>
+#include <math.h>
+
+#if USE_BINPROTO || USE_PERSIST
+
+// CRC-16/CCITT, byte at a time without table (also fine for AVR);
+// also for the records in flash, see persist.ino
+uint16_t bin_crc(uint16_t crc,const uint8_t *buf,int len)
+{
+  while (len--)
+  {
+    uint8_t x=(crc>>8)^*buf++;
+    x^=x>>4;
+    crc=(crc<<8)^((uint16_t)x<<12)^((uint16_t)x<<5)^x;
+  }
+  return crc;
+}
+#endif
+
+#if USE_BINPROTO
+
+void bin_put32(uint8_t *p,int32_t v)
+{
+  p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24;
+}
+
+int32_t bin_get32(const uint8_t *p)
+{
+  return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24));
+}
+
+void bin_put16(uint8_t *p,int16_t v)
+{
+  p[0]=v; p[1]=v>>8;
+}
+
+int16_t bin_get16(const uint8_t *p)
+{
+  return (int16_t)(p[0] | (p[1]<<8));
+}
+
+// IEEE float, same byte order as bin_put32()
+void bin_putf(uint8_t *p,float v)
+{
+  uint32_t u;
+  memcpy(&u,&v,4);
+  bin_put32(p,(int32_t)u);
+}
+
+float bin_getf(const uint8_t *p)
+{
+  uint32_t u=(uint32_t)bin_get32(p);
+  float v;
+  memcpy(&v,&u,4);
+  return v;
+}
+
+// float to fixed point, rounded, clamped to int32 (float: no double emulation on ESP32)
+int32_t bin_fix(float val,float scale)
+{
+  val*=scale;
+  if (isnan(val)) return 0;
+  if (val>=2147483648.f) return INT32_MAX;
+  if (val<=-2147483648.f) return INT32_MIN;
+  return (int32_t)(val<0.? val-0.5 : val+0.5);
+}
+
+/*********************************************************************
+ * Feed 1 received byte to the frame receiver.
+ * return: 0: not part of a frame (text)
+ *         1: taken by the receiver
+ *         2: taken, frame complete in rx->f
+ *********************************************************************/
+int bin_rx_byte(BIN_RX *rx,uint8_t c)
+{
+  switch(rx->state)
+  {
+    case 0:                                // text
+      if (c!=BIN_SYNC1) return 0;
+      rx->state=1;
+      return 1;
+    case 1:
+      if (c!=BIN_SYNC2) { rx->state=0; return 0; }
+      rx->state=2;
+      return 1;
+    case 2:                                // LEN
+      if (c>BIN_MAXPAYLOAD) { rx->nr_len_err++; rx->state=0; return 1; }
+      rx->f.len=c;
+      rx->crc=bin_crc(0xffff,&c,1);
+      rx->state=3;
+      return 1;
+    case 3:                                // ID
+      rx->f.id=c;
+      rx->crc=bin_crc(rx->crc,&c,1);
+      rx->n=0;
+      rx->state=(rx->f.len? 4 : 5);
+      return 1;
+    case 4:                                // payload
+      rx->f.payload[rx->n++]=c;
+      if (rx->n==rx->f.len)
+      {
+        rx->crc=bin_crc(rx->crc,rx->f.payload,rx->f.len);
+        rx->state=5;
+      }
+      return 1;
+    case 5:
+      rx->crc_lo=c;
+      rx->state=6;
+      return 1;
+    default:
+      rx->state=0;
+      if ((rx->crc_lo | (c<<8))!=rx->crc) { rx->nr_crc_err++; return 1; }
+      rx->nr_frames++;
+      return 2;
+  }
+}
+
+/*********************************************************************
+ * As bin_rx_byte(), for a buffer: the payload is taken at once.
+ * buf, n: received bytes; *used: nr. of bytes taken
+ * return: 0: buf[0] is not part of a frame (text), *used=0
+ *         1: *used bytes taken, no frame complete
+ *         2: frame complete in rx->f with the last byte taken
+ *********************************************************************/
+int bin_rx(BIN_RX *rx,const uint8_t *buf,int n,int *used)
+{
+  int i=0,r=1;
+  while (i<n)
+  {
+    if (rx->state==4)                      // payload
+    {
+      int m=MIN(n-i,rx->f.len-rx->n);
+      memcpy(rx->f.payload+rx->n,buf+i,m);
+      rx->n+=m;
+      i+=m;
+      if (rx->n==rx->f.len)
+      {
+        rx->crc=bin_crc(rx->crc,rx->f.payload,rx->f.len);
+        rx->state=5;
+      }
+      continue;
+    }
+    if (!(r=bin_rx_byte(rx,buf[i]))) break;   // text
+    i++;
+    if (r==2) break;
+  }
+  *used=i;
+  if (!i) return 0;
+  return (r==2? 2 : 1);
+}
+
+/*********************************************************************
+ * Make frame in 'frm' (min. BIN_OVERHEAD+len bytes)
+ * return: length frame
+ *********************************************************************/
+int bin_make(uint8_t *frm,int id,const uint8_t *payload,int len)
+{
+  uint16_t crc;
+  frm[0]=BIN_SYNC1;
+  frm[1]=BIN_SYNC2;
+  frm[2]=len;
+  frm[3]=id;
+  if ((payload) && (payload!=frm+4)) memmove(frm+4,payload,len);
+  crc=bin_crc(0xffff,frm+2,len+2);
+  frm[len+4]=crc;
+  frm[len+5]=crc>>8;
+  return len+BIN_OVERHEAD;
+}
+
+// payloads are built in place, after the header
+#define PL(frm) ((frm)+4)
+
+// goto (PC side; for host tools and tests)
+int bin_put_goto(uint8_t *frm,GOTO_VAL *gv)
+{
+  uint8_t *p=PL(frm);
+  bin_put32(p,   bin_fix(gv->ax,BIN_DEGR));
+  bin_put32(p+4, bin_fix(gv->ey,BIN_DEGR));
+  bin_put32(p+8, bin_fix(gv->vax,BIN_DEGR));
+  bin_put32(p+12,bin_fix(gv->vey,BIN_DEGR));
+  p[16]=gv->east_pass;
+  return bin_make(frm,BIN_GOTO,p,17);
+}
+
+int bin_get_goto(BIN_FRAME *f,GOTO_VAL *gv)
+{
+  uint8_t *p=f->payload;
+  if (f->len!=17) return 0;
+  gv->ax =bin_get32(p)   *(1.f/BIN_DEGR);
+  gv->ey =bin_get32(p+4) *(1.f/BIN_DEGR);
+  gv->vax=bin_get32(p+8) *(1.f/BIN_DEGR);
+  gv->vey=bin_get32(p+12)*(1.f/BIN_DEGR);
+  gv->east_pass=p[16];
+  return 1;
+}
+
+int bin_put_status(uint8_t *frm,ROTOR *AX_rot,ROTOR *EY_rot,boolean run_calc,boolean run_sched)
+{
+  uint8_t *p=PL(frm);
+  p[0]=(AX_rot? AX_rot->cal_status : -1);
+  p[1]=(EY_rot? EY_rot->cal_status : -1);
+  p[2]=run_calc;
+  p[3]=run_sched;
+  return bin_make(frm,BIN_STATUS|BIN_REPLY,p,4);
+}
+
+/*********************************************************************
+ * Rotor data, as send_ctrldata():
+ *   pos, req (ax, ey), speed (i16 ax, ey),
+ *   x, y, a, e, lat, lon, height (m), east_pass (u8), time (s)
+ *********************************************************************/
+#define ROTDATA_LEN 53
+int bin_put_rotdata(uint8_t *frm,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv,long t)
+{
+  uint8_t *p=PL(frm);
+  int swap=(SWAP_DIR? -1 : 1);
+  bin_put32(p,   AX_rot? bin_fix(AX_rot->degr*swap,BIN_DEGR) : 0);
+  bin_put32(p+4, EY_rot? bin_fix(EY_rot->degr*swap,BIN_DEGR) : 0);
+  bin_put32(p+8, AX_rot? bin_fix(AX_rot->req_degr,BIN_DEGR) : 0);
+  bin_put32(p+12,EY_rot? bin_fix(EY_rot->req_degr,BIN_DEGR) : 0);
+  bin_put16(p+16,AX_rot? AX_rot->speed : 0);
+  bin_put16(p+18,EY_rot? EY_rot->speed : 0);
+  bin_put32(p+20,bin_fix(gv->x,BIN_DEGR));
+  bin_put32(p+24,bin_fix(gv->y,BIN_DEGR));
+  bin_put32(p+28,bin_fix(gv->a,BIN_DEGR));
+  bin_put32(p+32,bin_fix(gv->e,BIN_DEGR));
+  bin_put32(p+36,bin_fix(gv->lat,BIN_DEGR));
+  bin_put32(p+40,bin_fix(gv->lon,BIN_DEGR));
+  bin_put32(p+44,bin_fix(gv->height,1.));
+  p[48]=gv->east_pass;
+  bin_put32(p+49,t);
+  return bin_make(frm,BIN_ROTDATA|BIN_REPLY,p,ROTDATA_LEN);
+}
+
+// PC side of bin_put_rotdata(); pos, req, spd: ax, ey
+int bin_get_rotdata(BIN_FRAME *f,float *pos,float *req,int *spd,GOTO_VAL *gv,long *t)
+{
+  uint8_t *p=f->payload;
+  int i;
+  if (f->len!=ROTDATA_LEN) return 0;
+  for (i=0; i<2; i++)
+  {
+    pos[i]=bin_get32(p+i*4)*(1.f/BIN_DEGR);
+    req[i]=bin_get32(p+8+i*4)*(1.f/BIN_DEGR);
+    spd[i]=bin_get16(p+16+i*2);
+  }
+  gv->x  =bin_get32(p+20)*(1.f/BIN_DEGR);
+  gv->y  =bin_get32(p+24)*(1.f/BIN_DEGR);
+  gv->a  =bin_get32(p+28)*(1.f/BIN_DEGR);
+  gv->e  =bin_get32(p+32)*(1.f/BIN_DEGR);
+  gv->lat=bin_get32(p+36)*(1.f/BIN_DEGR);
+  gv->lon=bin_get32(p+40)*(1.f/BIN_DEGR);
+  gv->height=bin_get32(p+44);
+  gv->east_pass=p[48];
+  *t=bin_get32(p+49);
+  return 1;
+}
+
+#if USE_SGP4
+/*********************************************************************
+ * Keplers: name (20 chars), epoch_year (i16), epoch_day (i32),
+ *   decay_rate, bstar (float), then i32: inclination, raan,
+ *   eccentricity, perigee, anomaly, motion
+ * Angles in degrees, as the text protocol (kepler_in_degrees).
+ * Received decay_rate, bstar not finite: rejected.
+ *********************************************************************/
+#define KEPLER_LEN 58
+int bin_put_kepler(uint8_t *frm,KEPLER *k)
+{
+  uint8_t *p=PL(frm);
+  memset(p,0,20);
+  memcpy(p,k->name,strnlen(k->name,19));
+  bin_put16(p+20,k->epoch_year);
+  bin_put32(p+22,bin_fix(k->epoch_day,BIN_KEP_DAY));
+  bin_putf(p+26,k->decay_rate);
+  bin_putf(p+30,k->bstar);
+  bin_put32(p+34,bin_fix(k->d_inclination,BIN_KEP_ANGLE));
+  bin_put32(p+38,bin_fix(k->d_raan,BIN_KEP_ANGLE));
+  bin_put32(p+42,bin_fix(k->eccentricity,BIN_KEP_ECC));
+  bin_put32(p+46,bin_fix(k->d_perigee,BIN_KEP_ANGLE));
+  bin_put32(p+50,bin_fix(k->d_anomaly,BIN_KEP_ANGLE));
+  bin_put32(p+54,bin_fix(k->motion,BIN_KEP_MOTION));
+  return bin_make(frm,BIN_KEPLER,p,KEPLER_LEN);
+}
+
+int bin_get_kepler(BIN_FRAME *f,KEPLER *k)
+{
+  uint8_t *p=f->payload;
+  float decay,bstar;
+  if (f->len!=KEPLER_LEN) return 0;
+  decay=bin_getf(p+26);
+  bstar=bin_getf(p+30);
+  if ((!isfinite(decay)) || (!isfinite(bstar))) return 0;   // 'k' unchanged
+  memcpy(k->name,p,19);
+  k->name[19]=0;
+  k->epoch_year   =bin_get16(p+20);
+  k->epoch_day    =bin_get32(p+22)*(1.f/BIN_KEP_DAY);
+  k->decay_rate   =decay;
+  k->bstar        =bstar;
+  k->d_inclination=bin_get32(p+34)*(1.f/BIN_KEP_ANGLE);
+  k->d_raan       =bin_get32(p+38)*(1.f/BIN_KEP_ANGLE);
+  k->eccentricity =bin_get32(p+42)*(1.f/BIN_KEP_ECC);
+  k->d_perigee    =bin_get32(p+46)*(1.f/BIN_KEP_ANGLE);
+  k->d_anomaly    =bin_get32(p+50)*(1.f/BIN_KEP_ANGLE);
+  k->motion       =bin_get32(p+54)*(1.f/BIN_KEP_MOTION);
+  k->inclination  =D2R(k->d_inclination);
+  k->raan         =D2R(k->d_raan);
+  k->perigee      =D2R(k->d_perigee);
+  k->anomaly      =D2R(k->d_anomaly);
+  k->from_tle     =false;
+  return 1;
+}
+#endif
+
+#endif
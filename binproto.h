@@ -0,0 +1,91 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   binary framed protocol, see binproto.cpp
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#ifndef BINPROTO_HDR
+#define BINPROTO_HDR
+#include <stdint.h>
+
+// frame: SYNC1 SYNC2 LEN ID payload[LEN] CRC16 (LSB first)
+//   CRC-16/CCITT (0x1021, init 0xffff) over LEN, ID, payload
+//   Multi-byte values little endian.
+// Text commands are 7-bit ASCII, so SYNC1 can't be the start of a text line.
+#define BIN_SYNC1 0xa5
+#define BIN_SYNC2 0x5a
+#define BIN_MAXPAYLOAD 64
+#define BIN_OVERHEAD 6           // sync (2), len, id, crc (2)
+#define BIN_MAXFRAME (BIN_MAXPAYLOAD+BIN_OVERHEAD)
+
+// fixed point
+#define BIN_DEGR 1000.           // angles: 0.001 degr, rates 0.001 degr/s
+#define BIN_KEP_ANGLE 1e6        // kepler angles: 1e-6 degr
+#define BIN_KEP_DAY 1e6          // epoch day
+#define BIN_KEP_ECC 1e9
+#define BIN_KEP_MOTION 1e8       // rev/day
+                                 // decay_rate, bstar: IEEE float
+
+// command id's; reply id = command id | BIN_REPLY
+#define BIN_GOTO    0x01         // PC->: ax, ey, vax, vey (i32), east_pass (u8); no reply
+#define BIN_STATUS  0x02         // PC->: -; reply: cal. status ax, ey (i8), run_calc, run_sched (u8)
+#define BIN_ROTDATA 0x03         // PC->: -; reply: see bin_put_rotdata()
+#define BIN_KEPLER  0x04         // PC->: see bin_put_kepler(); reply: result (u8)
+#define BIN_NAK     0x7f         // reply on unknown/bad frame: id (u8)
+#define BIN_REPLY   0x80
+
+// link a frame came from, replies go back the same way
+#define BIN_LINK_NONE 0
+#define BIN_LINK_SERIAL 1
+#define BIN_LINK_TCP 2
+
+typedef struct bin_frame
+{
+  uint8_t id;
+  uint8_t len;
+  uint8_t payload[BIN_MAXPAYLOAD];
+} BIN_FRAME;
+
+// receiver state, 1 per link
+typedef struct bin_rx
+{
+  int state;                     // 0: no frame (text), else next byte expected
+  int n;                         // payload bytes received
+  uint16_t crc;
+  uint8_t crc_lo;
+  BIN_FRAME f;
+  unsigned long nr_frames;       // good frames
+  unsigned long nr_crc_err;      // frames dropped: bad CRC
+  unsigned long nr_len_err;      // frames dropped: LEN > BIN_MAXPAYLOAD
+} BIN_RX;
+
+uint16_t bin_crc(uint16_t crc,const uint8_t *buf,int len);
+int bin_rx_byte(BIN_RX *rx,uint8_t c);
+int bin_rx(BIN_RX *rx,const uint8_t *buf,int n,int *used);
+int bin_make(uint8_t *frm,int id,const uint8_t *payload,int len);
+int32_t bin_fix(float val,float scale);
+void bin_put32(uint8_t *p,int32_t v);
+int32_t bin_get32(const uint8_t *p);
+void bin_put16(uint8_t *p,int16_t v);
+int16_t bin_get16(const uint8_t *p);
+void bin_putf(uint8_t *p,float v);
+float bin_getf(const uint8_t *p);
+
+int bin_put_goto(uint8_t *frm,GOTO_VAL *gv);
+int bin_get_goto(BIN_FRAME *f,GOTO_VAL *gv);
+int bin_put_status(uint8_t *frm,ROTOR *AX_rot,ROTOR *EY_rot,boolean run_calc,boolean run_sched);
+int bin_put_rotdata(uint8_t *frm,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv,long t);
+int bin_get_rotdata(BIN_FRAME *f,float *pos,float *req,int *spd,GOTO_VAL *gv,long *t);
+#if USE_SGP4
+int bin_put_kepler(uint8_t *frm,KEPLER *k);
+int bin_get_kepler(BIN_FRAME *f,KEPLER *k);
+#endif
+
+#endif
@@ -69,6 +69,7 @@ extern ROTOR AX_rot,EY_rot;
  * AX_rot or EY_rot may be NULL to calibrate a single rotor
  *********************************************************************/
 
+#if !CAL_ZENITH
 static int run_to_cal_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_calpos,float ey_calpos)
 {
   int err=0;
@@ -92,6 +93,10 @@ static int run_to_cal_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_calpos,float ey_
   if (AX_rot) AX_rot->rotated=from_degr(AX_rot);
   if (EY_rot) EY_rot->degr=EY_REFPOS;
   if (EY_rot) EY_rot->rotated=from_degr(EY_rot);
+  #if MOTORTYPE == MOT_STEPPER                // stepper counts itself
+    if (AX_rot) CMDP(AX_rot,setCurrentPosition(AX_rot->rotated));
+    if (EY_rot) CMDP(EY_rot,setCurrentPosition(EY_rot->rotated));
+  #endif
   return 0;
 }
 
@@ -119,10 +124,12 @@ static void check_run(ROTOR *rot)
     xprintf((char *)"MES: rotor not running, at endstop?\n");
   }
 }
+#endif
 
+#if CAL_ZENITH
 static int get_zenpos(ROTOR *rot)
 {
-  int zen;
+  int zen=0;
   if (!rot) return -1;
   if (rot->id==AX_ID)
   {
@@ -143,124 +150,293 @@ static int get_zenpos(ROTOR *rot)
   return zen;
 }
 
-// set speed soft to go to zenith
-static int set_zspeed(ROTOR *rot,int speed,int dir)
+/*********************************************************************
+ * Zenith calibration: per rotor a state machine (CAL_AXIS); both are
+ * stepped in one loop, so a rotor doesn't wait for the other.
+ *   cz_search: fast (spd_cal1) to the sensor edge, from either side;
+ *              skipped if calibrated before: edge expected at REFPOS
+ *   cz_clear:  fast to CAL_CLEAR_DEGR above the edge, braking in time
+ *   cz_final:  slow (spd_cal2) down to the edge, always from above:
+ *              same sensor side and delay each time; the pulse count
+ *              at this edge becomes REFPOS
+ *   cz_stop:   ramp down, then count corrected
+ *   cz_rest:   stop until at rest, then 'next': at the start and
+ *              before turning to the final approach, so pulses while
+ *              coasting are counted in the right direction (no
+ *              quadrature) and the count drift is a true one
+ * No fixed waits: each state ends on the sensor, the pulse count or
+ * the pulses stopping.
+ * Error: a state takes longer than ROT_TIMEOUT, or no pulses for
+ * PLS_TIMEOUT while driven.
+ *********************************************************************/
+static CAL_STAT cal_stat[2];     // AX, EY
+
+// pulse count at REFPOS, as end of run_to_cal_pos()
+static long zen_cnt(ROTOR *rot)
 {
-  int zen;
-  if (!rot) return 0;
-  if (dir) speed=speed*-1;
-  zen=get_zenpos(rot);
-  if (zen!=dir) speed=0;
-  speed=run_motor_soft(rot,speed);
-  return speed;
+  rot->degr=(rot->id==AX_ID? AX_REFPOS : EY_REFPOS);
+  return from_degr(rot);
 }
 
-// goto zenith from either side
-static int goto_zenit(ROTOR *AX_rot,ROTOR *EY_rot,int speed)
+static void cz_set(CAL_AXIS *c,CZ_STATE state)
 {
-  int err=0;
-  int ax_direct,ey_direct,ax_busy=1,ey_busy=1;
-  unsigned long start_time=millis();
-  if (AX_rot) ax_direct=get_zenpos(AX_rot);
-  if (EY_rot) ey_direct=get_zenpos(EY_rot);
-  do
+  c->state=state;
+  c->t_state=millis();
+}
+
+static void cz_start(CAL_AXIS *c,ROTOR *rot,int spd_cal1,int spd_cal2)
+{
+  boolean led_ena=true;
+  memset(c,0,sizeof(*c));
+  c->rot=rot;
+  if (!rot) { c->state=cz_done; return; }
+  c->spd_fast=spd_cal1;
+  c->spd_slow=MAX(spd_cal2,rot->minspeed);
+  c->clear=MAX((long)(CAL_CLEAR_DEGR*rot->steps_degr/360.),2);
+  c->framed=(rot->cal_status==cal_ready);
+  c->t_start=c->t_cnt=millis();
+  c->cnt=rot->rotated;
+  if (c->framed)
   {
-    if (millis()-start_time > ROT_TIMEOUT) { xprintf("TIMEOUT!\n"); break; }
+    c->edge=zen_cnt(rot);              // edge expected here
+    c->next=cz_clear;
+  }
+  else
+  {
+    c->next=cz_search;
+  }
+  cz_set(c,cz_rest);
+  set_led(rot,1,led_ena);              // set B: start cal.
+  rot->calibrated=false;
+  rot->cal_status=cal_started;
+}
 
-    ax_busy=set_zspeed(AX_rot,speed,ax_direct);
-    ey_busy=set_zspeed(EY_rot,speed,ey_direct);
-  } while ((ax_busy) || (ey_busy));
-  if (AX_rot) AX_rot->degr=AX_REFPOS;
-  if (AX_rot) AX_rot->rotated=from_degr(AX_rot);
-  if (EY_rot) EY_rot->degr=EY_REFPOS;
-  if (EY_rot) EY_rot->rotated=from_degr(EY_rot);
-  if (ax_busy) err|=1;
-  if (ey_busy) err|=2;
+// at rest: stopped and no pulse for CAL_STILL_MS
+static boolean cz_still(CAL_AXIS *c,unsigned long t)
+{
+  ROTOR *rot=c->rot;
+  if (rot->speed) return false;
+  #if MOTORTYPE == MOT_STEPPER
+    return true;                       // no coasting
+  #endif
+  if (rot->pin_plsb>=0) return true;   // quadrature: direction measured
+  return (t-c->t_cnt >= CAL_STILL_MS);
+}
 
-  return err;
+// distance (pulses) to slow down from the current rate to spd_slow
+static long cz_brake(CAL_AXIS *c)
+{
+  ROTOR *rot=c->rot;
+  float v,t;
+  #if (MOTORTYPE == MOT_STEPPER) && USE_SCURVE
+    float vs=rot->prof.vmax*c->spd_slow/100.;
+    v=fabs(rot->prof.vel);
+    if (v<=vs) return 0;
+    t=(v-vs)/rot->prof.amax+rot->prof.amax/rot->prof.jmax;  // accel. and jerk phases
+    return (long)((v+vs)/2.*t*rot->steps_degr/360.);
+  #else
+    // accellerate(): 1% per 10 ms; rate not linear in speed and motor lag: full rate
+    t=(abs(rot->speed)-c->spd_slow)*0.01;
+    if (t<=0.) return 0;
+    v=fabs(pulse_rate(rot));
+    return (long)(v*t*rot->steps_degr/360.);
+  #endif
 }
 
-// calibrate using zenith detection
-static int calibrate_zenith(ROTOR *AX_rot,ROTOR *EY_rot,int spd_cal1,int spd_cal2)
+// final approach, only from above the edge; else it's not where expected
+static void cz_final_start(CAL_AXIS *c,int zen)
 {
   boolean led_ena=true;
-  int err;
-  reset_for_cal(AX_rot);                   // led=B
-  reset_for_cal(EY_rot);                   // led=B
-  xprintf("Zenit status: %d  %d\n",get_zenpos(AX_rot),get_zenpos(EY_rot)); // 0: < 90, 1: > 90
+  if (!zen) { cz_set(c,cz_search); return; }
+  set_led(c->rot,6,led_ena);           // set RG: final approach
+  cz_set(c,cz_final);
+}
 
-  if (!spd_cal2) spd_cal2=spd_cal1;
-  // Go to zenith from either side
-  xprintf("Start calibration zenit step 1\n");
-
-  err=goto_zenit(AX_rot,EY_rot,spd_cal1);
-  set_led(AX_rot,(err&1? 4 : 7),led_ena);  // set R or RGB
-  set_led(EY_rot,(err&2? 4 : 7),led_ena);  // set R or RGB
-  if (err&1) set_status(AX_rot,cal_timeout);
-  if (err&2) set_status(AX_rot,cal_timeout);
-  if (err) return 1;
+static void cz_fail(CAL_AXIS *c,const char *mes)
+{
+  boolean led_ena=true;
+  run_motor_hard(c->rot,0);
+  set_led(c->rot,4,led_ena);           // set R
+  set_status(c->rot,cal_timeout);
+  xprintf("MES: %s %s\n",c->rot->name,mes);
+  c->t_end=millis();
+  c->state=cz_error;
+}
+
+// one step of the state machine; return: busy
+static boolean cz_step(CAL_AXIS *c)
+{
+  boolean led_ena=true;
+  ROTOR *rot=c->rot;
+  unsigned long t=millis();
+  long d;
+  int zen,speed=0;
 
-  // correct if from wrong side
+  if ((c->state==cz_done) || (c->state==cz_error)) return false;
+  if (rot->rotated!=c->cnt)
   {
-    ROTOR *AX_roti,*EY_roti;
-    if (!get_zenpos(AX_rot)) AX_roti=AX_rot; else AX_roti=NULL;
-    if (!get_zenpos(EY_rot)) EY_roti=EY_rot; else EY_roti=NULL;
-    set_led(AX_roti,5,led_ena);               // set RB: start going to cal. pos
-    set_led(EY_roti,5,led_ena);               // set RB: start going to cal. pos
-    err=goto_zenit(AX_roti,EY_roti,(int)((spd_cal1+spd_cal2)/2));
-    set_led(AX_roti,(err&1? 4 : 6),led_ena);  // set R or RG
-    set_led(EY_roti,(err&2? 4 : 6),led_ena);  // set R or RG
-    if (err&1) set_status(AX_rot,cal_timeout);
-    if (err&2) set_status(AX_rot,cal_timeout);
-    if (err) return 1;
+    c->cnt=rot->rotated;
+    c->t_cnt=t;
   }
+  if (t-c->t_state > ROT_TIMEOUT) { cz_fail(c,"calibration timeout"); return false; }
+  if ((rot->speed) && (t-c->t_cnt > PLS_TIMEOUT)) { cz_fail(c,"rotor not running"); return false; }
 
-  // actual calibration
-  xprintf("Start actual calibration to zenit\n");
-  set_led(AX_rot, 6,led_ena);  // set R or RG
-  set_led(EY_rot, 6,led_ena);  // set R or RG
-  err=goto_zenit(AX_rot,EY_rot,spd_cal2);
-  if (err&1) set_led(AX_rot,4,led_ena);    // set R
-  if (err&2) set_led(EY_rot,4,led_ena);    // set R
-
-  delay(1000);
-  // goto exact 90 degrees
-  err|=run_to_cal_pos(AX_rot,EY_rot,90.,90.);
-  set_led(AX_rot,(err&1? 4 : 2),led_ena);  // set R or G
-  set_led(EY_rot,(err&2? 4 : 2),led_ena);  // set R or G
+  zen=get_zenpos(rot);
+  switch(c->state)
+  {
+    case cz_rest:                      // stop, until at rest
+      if (cz_still(c,t)) cz_set(c,c->next);
+    break;
+    case cz_search:                    // fast to the edge
+      if (zen!=c->zen)
+      {
+        c->edge=rot->rotated;
+        c->crossed=true;
+        rot->cal_status=cal_got_pulses;
+        cz_set(c,cz_clear);
+      }
+      speed=(zen? -c->spd_fast : c->spd_fast);
+    break;
+    case cz_clear:                     // fast to above the edge, slow there
+      if (zen!=c->zen)                 // passed the edge: better estimate
+      {
+        c->edge=rot->rotated;
+        c->crossed=true;
+      }
+      d=c->edge+c->clear-rot->rotated;
+      if (d>0)
+      {
+        speed=(d>cz_brake(c)? c->spd_fast : c->spd_slow);
+      }
+      else if (rot->speed>0)           // turn: at rest first
+      {
+        c->next=cz_clear;
+        cz_set(c,cz_rest);
+      }
+      else if (-d>cz_brake(c))
+      {
+        speed=-c->spd_fast;
+      }
+      else
+      {
+        cz_final_start(c,zen);
+      }
+    break;
+    case cz_final:                     // slow down to the edge
+      if (!zen)
+      {
+        c->shift=zen_cnt(rot)-rot->rotated;
+        c->width=rot->rotated-c->edge;
+        cz_set(c,cz_stop);
+        break;
+      }
+      speed=-c->spd_slow;
+    break;
+    default:
+    break;
+  }
+
+  c->zen=zen;
 
-  if (err&1) set_status(AX_rot,cal_timeout); else set_status(AX_rot,cal_ready);
-  if (err&2) set_status(EY_rot,cal_timeout); else set_status(EY_rot,cal_ready);
+  if (run_motor_soft(rot,speed)) return true;
+  if (c->state!=cz_stop) return true;
 
-  if (err&1) xprintf("Calibration error for AX!\n");
-  else       xprintf("Calibration OK for AX.\n");
-  if (err&2) xprintf("Calibration error for EY!\n");
-  else       xprintf("Calibration OK for EY.\n");
+  // stopped after the final edge: count relative to the edge
+  #if MOTORTYPE == MOT_STEPPER                // stepper counts itself
+    CMDP(rot,setCurrentPosition(CMDP(rot,currentPosition())+c->shift));
+    rot->rotated=CMDP(rot,currentPosition());
+  #else
+    __atomic_fetch_add(&rot->rotated,c->shift,__ATOMIC_RELAXED);  // pulses may still come
+  #endif
+  rot->degr=to_degr(rot);
+  rot->calibrated=true;
+  set_status(rot,cal_ready);
+  set_led(rot,2,led_ena);              // set G
+  c->t_end=millis();
+  c->state=cz_done;
+  return false;
+}
 
-/*
-  if (AX_rot)
+// duration, count drift since the previous calibration and, apart,
+// spread of the final edge: against the edge passed just before, in
+// this calibration, so without count drift
+static void cz_report(CAL_AXIS *c)
+{
+  CAL_STAT *s;
+  long d;
+  if (!c->rot) return;
+  if (c->state!=cz_done)
+  {
+    xprintf("Calibration error for %s!\n",c->rot->name);
+    return;
+  }
+  xprintf("Calibration OK for %s.\n",c->rot->name);
+  s=&cal_stat[c->rot->id==AX_ID? 0 : 1];
+  if (c->framed)
   {
-    char pm;
-    if (get_zenpos(AX_rot)) pm='+'; else pm='-';
-    xprintf("Calibration ready:\n  AX from: %c\n",pm); 
+    d=-c->shift;
+    if ((!s->n) || (d<s->dmin)) s->dmin=d;
+    if ((!s->n) || (d>s->dmax)) s->dmax=d;
+    s->n++;
+    xprintf("CAL: %s %lu ms, drift %+ld, %d cal.: %+ld..%+ld pulses\n",
+            c->rot->name,c->t_end-c->t_start,d,s->n,s->dmin,s->dmax);
   }
-  if (EY_rot)
+  else
   {
-    char pm;
-    if (get_zenpos(EY_rot)) pm='+'; else pm='-';
-    xprintf("Calibration ready:\n  EY from: %c\n",pm); 
+    xprintf("CAL: %s %lu ms, first edge\n",c->rot->name,c->t_end-c->t_start);
   }
-*/
+  if (!c->crossed) return;
+  d=c->width;
+  if ((!s->ne) || (d<s->emin)) s->emin=d;
+  if ((!s->ne) || (d>s->emax)) s->emax=d;
+  s->ne++;
+  xprintf("CAL: %s final edge %+ld, %d cal.: %+ld..%+ld, spread %ld pulses\n",
+          c->rot->name,d,s->ne,s->emin,s->emax,s->emax-s->emin);
+}
+
+// calibrate using zenith detection
+static int calibrate_zenith(ROTOR *AX_rot,ROTOR *EY_rot,int spd_cal1,int spd_cal2)
+{
+  CAL_AXIS cax,cey;
+  boolean busy;
+  int err=0;
+  xprintf("Zenit status: %d  %d\n",get_zenpos(AX_rot),get_zenpos(EY_rot)); // 0: < 90, 1: > 90
+
+  if (!spd_cal2) spd_cal2=spd_cal1;
+  cz_start(&cax,AX_rot,spd_cal1,spd_cal2);
+  cz_start(&cey,EY_rot,spd_cal1,spd_cal2);
+  do
+  {
+    busy=cz_step(&cax);
+    busy|=cz_step(&cey);
+  } while (busy);
+
+  if (cax.state==cz_error) err|=1;
+  if (cey.state==cz_error) err|=2;
+  cz_report(&cax);
+  cz_report(&cey);
 
   if (err) return 1;
   return 0; 
 }
 
+#else
+// wait until both rotors are at rest: no pulse for CAL_STILL_MS
+static void wait_still(ROTOR *AX_rot,ROTOR *EY_rot)
+{
+  long ax=0,ey=0;
+  unsigned long t=millis(),start_time=millis();
+  do
+  {
+    if ((AX_rot) && (AX_rot->rotated!=ax)) { ax=AX_rot->rotated; t=millis(); }
+    if ((EY_rot) && (EY_rot->rotated!=ey)) { ey=EY_rot->rotated; t=millis(); }
+  } while ((millis()-t < CAL_STILL_MS) && (millis()-start_time < ROT_TIMEOUT));
+}
+
 // calibrate using end stops
 static int calibrate_estop(ROTOR *AX_rot,ROTOR *EY_rot,int spd_cal1,int spd_cal2)
 {
   int i;
-  int n=0;
   int err=0;
   int speed[2];
   boolean led_ena=true;
@@ -288,7 +464,7 @@ static int calibrate_estop(ROTOR *AX_rot,ROTOR *EY_rot,int spd_cal1,int spd_cal2
     check_run(AX_rot);
     check_run(EY_rot);
 
-    delay(1000);
+    wait_still(AX_rot,EY_rot);
 
     //---------- Run both rotors backward, until endswitch
     set_led(AX_rot,5,led_ena);               // set RB: to endswitch
@@ -298,7 +474,7 @@ static int calibrate_estop(ROTOR *AX_rot,ROTOR *EY_rot,int spd_cal1,int spd_cal2
 
     set_led(AX_rot,6,led_ena);               // set RGB: start going to cal. pos
     set_led(EY_rot,6,led_ena);               // set RGB: start going to cal. pos
-    delay(1000);
+    wait_still(AX_rot,EY_rot);
   }
 
   //---------- Run both rotors to reference
@@ -321,11 +497,16 @@ static int calibrate_estop(ROTOR *AX_rot,ROTOR *EY_rot,int spd_cal1,int spd_cal2
 
   return 0;
 }
+#endif
 
 #define START_CALFLAG "Start calibration"
 int calibrate(ROTOR *AX_rot,ROTOR *EY_rot)
 {
   int err=1;
+  control_hold(true);               // rotors driven from here
+  #if USE_PERSIST
+    persist_moving(AX_rot,EY_rot);  // stored positions invalid from now
+  #endif
   run_motor_hard(AX_rot,0);
   run_motor_hard(EY_rot,0);
   xprintf("%s\n",START_CALFLAG);
@@ -334,16 +515,18 @@ int calibrate(ROTOR *AX_rot,ROTOR *EY_rot)
   #else
     err=calibrate_estop(AX_rot,EY_rot,SPD_CAL1,SPD_CAL2);
   #endif
+  control_hold(false);
 
   if (err)
   {
     run_motor_hard(AX_rot, 0); // stop motors (just in case, should already be stopped)
     run_motor_hard(EY_rot, 0);
     xprintf((char *)"Calibration error!\n");
-    blink(20, 100);       // Note: causes pin LED_BUILTIN to pulse!
+    blink(20, 100);       // Note: causes pin LED_BUILTIN to pulse! (from loop())
     return err;
   }
   xprintf((char *)"Calibration done\n");
+  blink(0, 0);                       // no blinking of an earlier error
   digitalWrite(LED_BUILTIN, HIGH);   // LED on; calibration done
 
   return err;
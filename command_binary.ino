@@ -0,0 +1,147 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Binary framed commands from serial or wifi, see binproto.cpp
+ *   Received bytes go through bin_filter() first: frame bytes are
+ *   taken out and handled, the rest is left for the text parser.
+ *
+ * public functions:
+ *   int bin_filter(BIN_RX *rx,char *buf,int n,int link)
+ *   int parse_frame(BIN_FRAME *f,int link)
+ *   void bin_execute()
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+
+#if USE_BINPROTO
+#if USE_SGP4
+  extern KEPLER kepler;
+#endif
+extern COMMANDS command;
+
+// queued as a whole, see output.ino
+static void bin_send(int link,uint8_t *frm,int n)
+{
+  if (link==BIN_LINK_TCP)
+    out_tcp(frm,n);                        // to client of the command
+  else
+    out_write(OUT_UART,frm,n);
+}
+
+// unknown id or bad payload
+static void bin_nak(int link,int id)
+{
+  uint8_t frm[BIN_OVERHEAD+1];
+  frm[4]=id;
+  bin_send(link,frm,bin_make(frm,BIN_NAK|BIN_REPLY,frm+4,1));
+}
+
+/*********************************************************************
+ * Translate frame into global 'command', as parse_cmd()
+ * return: 1 if command was processed
+ *********************************************************************/
+int parse_frame(BIN_FRAME *f,int link)
+{
+  command.bin_link=link;
+  command.contrunning=false;
+  switch(f->id)
+  {
+    case BIN_GOTO:
+      if (!bin_get_goto(f,&command.gotoval)) return 0;
+      command.gotoval.t_ms=millis();       // rates vax, vey from now
+      command.cmd=do_gotoval;
+      return 1;
+    case BIN_STATUS:
+      command.cmd=status;
+      return 1;
+  #if USE_SGP4
+    case BIN_ROTDATA:
+      command.cmd=send_rotdata;
+      return 1;
+    case BIN_KEPLER:                       // as get_kepler_item(), all at once
+      if (!bin_get_kepler(f,&kepler)) return 0;
+      command.cmd=get_kep;
+      return 1;
+  #endif
+  }
+  return 0;
+}
+
+// Reply to a frame command; called from execute_cmd()
+void bin_execute()
+{
+  uint8_t frm[BIN_MAXFRAME];
+  int n=0;
+  if (command.cmd==status)
+    n=bin_put_status(frm,SAX_rot,SEY_rot,command.run_calc,command.run_sched);
+  #if USE_SGP4
+    if (command.cmd==send_rotdata)
+      n=bin_put_rotdata(frm,SAX_rot,SEY_rot,&command.gotoval,time(NULL));
+    if (command.cmd==get_kep)
+    {
+      frm[4]=1;                            // ok
+      n=bin_make(frm,BIN_KEPLER|BIN_REPLY,frm+4,1);
+    }
+  #endif
+  if (n)
+  {
+    bin_send(command.bin_link,frm,n);
+    command.cmd=none;                      // done, no text reply
+  }
+}
+
+/*********************************************************************
+ * Take frames out of received bytes 'buf' (n bytes) and execute them.
+ * A frame may be split over several calls.
+ * return: nr. of bytes left in buf (text)
+ *********************************************************************/
+int bin_filter(BIN_RX *rx,char *buf,int n,int link)
+{
+  int i=0,m=0,used;
+  while (i<n)
+  {
+    switch(bin_rx(rx,(uint8_t *)buf+i,n-i,&used))
+    {
+      case 0:                              // text
+        buf[m++]=buf[i++];
+      break;
+      case 2:
+        i+=used;
+        if (parse_frame(&rx->f,link))
+          execute_cmd();
+        else
+          bin_nak(link,rx->f.id);
+        command.bin_link=BIN_LINK_NONE;
+      break;
+      default:
+        i+=used;
+      break;
+    }
+  }
+  return m;
+}
+#endif
@@ -44,62 +44,39 @@
 #include <stdlib.h>
 #include "rotorctrl.h"
 
-#define LENBUF 50
-static int get_serdata(boolean newdat,char *obuf)
-{
-  static int more;
-  int Received;
-  static char buf2[LENBUF+1];
-  char buf1[LENBUF+1],buf3[LENBUF+1],*p;
-
-  if (newdat)
-  {
-    more=0;
-    *buf2=0;
-  }  
-  if (!more)
-  {
-    int i=0;
-    int ch;
-    if (!Serial.available()) return 0;
-    while ((i<LENBUF) && ((ch=Serial.read())>=0)) buf1[i++]=ch;
-    buf1[i]=0;
-    strncat(buf2,buf1,LENBUF);
-  }
-  *obuf=0;
-  if ((p=strchr(buf2,'\n')))
-  {
-    *p=0;
-    strcpy(buf3,p+1);
-    strcpy(obuf,buf2);
-    strcpy(buf2,buf3);
-    more=1;
-  }
-  else
-  {
-    more=0;
-  }
-  return 1;
-}
+#if USE_BINPROTO
+  static BIN_RX bin_rx_ser;
+#endif
+static LINE_BUF lb_ser;
 
 void readCommand_serial()
 {
-  if (Serial.available())
+  static unsigned long nr_ovf;
+  char *p,*line;
+  int n,i,ch;
+  while (Serial.available())
   {
-    char obuf[LENBUF];
-    boolean newdat=true;
-    *obuf=0;
-    while (get_serdata(newdat,obuf))
+    p=lb_space(&lb_ser,&n);
+    for (i=0; (i<n) && ((ch=Serial.read())>=0); i++) p[i]=ch;
+  #if USE_BINPROTO
+    i=bin_filter(&bin_rx_ser,p,i,BIN_LINK_SERIAL);  // frames out
+  #endif
+    lb_commit(&lb_ser,i);
+    while ((line=lb_getline(&lb_ser)))
     {
-      newdat=false;
-      if (parse_cmd(obuf))
+      if (parse_cmd(line))
       {
         execute_cmd();
       }
       else
       {
-        if (*obuf) xprintf("serial: Wrong command: %s\n",obuf);
+        if (*line) xprintf("serial: Wrong command: %s\n",line);
       }
     }
+    if (lb_ser.nr_overflow!=nr_ovf)
+    {
+      nr_ovf=lb_ser.nr_overflow;
+      xprintf("serial: line too long, dropped (%lu)\n",nr_ovf);
+    }
   }
 }
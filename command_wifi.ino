@@ -5,7 +5,7 @@
  * Author: R. Alblas
  *
  * content: 
- *   Read commands from Wifi
+ *   Read commands from Wifi, all connected clients
  *
  * public functions:
  *   void readCommand_wifi()
@@ -43,64 +43,62 @@
 #include "rotorctrl_sgp4.h"
 #endif
 
-#define LENBUF 50
-#define LENBUF2 100
-static int get_tcpdata(boolean newdat,char *obuf)
-{
-  static int more;
-  int Received;
-  static char buf2[LENBUF2+1];
-  char buf1[LENBUF+1],buf3[LENBUF+1],*p;
-
-  if (newdat)
-  {
-    more=0;
-    *buf2=0;
-  }  
-  if (!more)
-  {
-    if (!RemoteClient.available()) return 0;
-    Received = RemoteClient.read((uint8_t *)buf1, LENBUF);
-    if (Received<0) return 0;
-    buf1[Received]=0;
-    strncat(buf2,buf1,LENBUF2);
-  }
-  *obuf=0;
-  if ((p=strchr(buf2,'\n')))
-  {
-    *p=0;
-    strcpy(buf3,p+1);
-    strcpy(obuf,buf2);
-    strcpy(buf2,buf3);
-    more=1;
-  }
-  else
-    more=0;
-  return 1;
-}
+extern COMMANDS command;
 
+#if USE_BINPROTO
+  static BIN_RX bin_rx_tcp[NR_CLIENTS];
+#endif
+static LINE_BUF lb_tcp[NR_CLIENTS];
 
-void readCommand_wifi()
+// read and execute commands from client i; replies go to this client
+static void read_client(int i)
 {
-  char obuf[LENBUF+1];
-  boolean newdat=true;
-  int key=0;
+  static unsigned long nr_ovf[NR_CLIENTS];
+  LINE_BUF *lb=&lb_tcp[i];
+  char *p,*line;
+  int n;
 
-  CheckForConnections();
-  if (RemoteClient.connected())
+  if (!out_client_ready(i))                // gone, or not yet handed over
+  {
+    lb_reset(lb);                          // no half line/frame for next client
+  #if USE_BINPROTO
+    bin_rx_tcp[i].state=0;
+  #endif
+    return;
+  }
+  command.client=i+1;
+  while (Clients[i].available())
   {
-    while (get_tcpdata(newdat,obuf))
+    p=lb_space(lb,&n);
+    if ((n=Clients[i].read((uint8_t *)p,n))<=0) break;
+  #if USE_BINPROTO
+    n=bin_filter(&bin_rx_tcp[i],p,n,BIN_LINK_TCP);  // frames out
+  #endif
+    lb_commit(lb,n);
+    while ((line=lb_getline(lb)))
     {
-      newdat=false;
-      if (parse_cmd(obuf))
+      if (parse_cmd(line))
       {
         execute_cmd();
       }
       else
       {
-        if (*obuf) xprintf("wifi: Wrong command: %s\n",obuf);
+        if (*line) xprintf("wifi: Wrong command: %s\n",line);
       }
     }
+    if (lb->nr_overflow!=nr_ovf[i])
+    {
+      nr_ovf[i]=lb->nr_overflow;
+      xprintf("wifi: line too long, dropped (%lu)\n",nr_ovf[i]);
+    }
   }
+  command.client=0;
+}
+
+void readCommand_wifi()
+{
+  int i;
+  CheckForConnections();
+  for (i=0; i<NR_CLIENTS; i++) read_client(i);
 }
 #endif
@@ -0,0 +1,236 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   fixed-rate rotor control (ESP)
+ *   An esp_timer wakes a high-priority task every CTRL_PERIOD_US,
+ *   which runs rotors_track() (or the manual speeds) for both rotors.
+ *   loop() keeps command handling and orbit calculation at low priority.
+ *   The task only sees a copy of the setpoint, published by loop() as a
+ *   whole; rotor settings (gains etc.) are changed by the task itself.
+ *
+ * public functions:
+ *   void start_control(void)
+ *   boolean control_active(void)
+ *   void control_hold(boolean hold)
+ *   void control_publish(void)
+ *   void control_apply(void (*fn)(void))
+ *   void send_jitter(boolean reset)
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+
+#if USE_CTRL_TASK
+#include "esp_timer.h"
+
+extern COMMANDS command;
+
+// jitter histogram: |period - CTRL_PERIOD_US|, upper bounds of bins in us
+#define NR_JITBINS 8
+static const long jit_bound[NR_JITBINS]={10,20,50,100,200,500,1000,0}; // 0: rest
+
+// setpoint of the control task
+typedef struct
+{
+  GOTO_VAL gotoval;
+  boolean contrunning;
+  int a_spd,b_spd;
+} CTRL_SETP;
+
+static portMUX_TYPE ctrl_mux=portMUX_INITIALIZER_UNLOCKED;
+
+static struct
+{
+  TaskHandle_t task;
+  esp_timer_handle_t timer;
+  volatile int hold;             // >0: control suspended (calibration etc.)
+  CTRL_SETP sp;                  // guarded by ctrl_mux
+  void (*volatile apply)(void);  // settings change, run by the task
+  int64_t prev_t;
+  unsigned long bin[NR_JITBINS];
+  unsigned long nr;
+  unsigned long overrun;         // period > 2*CTRL_PERIOD_US
+  long max_jit;
+} ctrl;
+
+static void measure_jitter(void)
+{
+  int64_t t=esp_timer_get_time();
+  long jit;
+  int i;
+  if (ctrl.prev_t)
+  {
+    jit=(long)(t-ctrl.prev_t)-CTRL_PERIOD_US;
+    if (jit>CTRL_PERIOD_US) ctrl.overrun++;
+    jit=abs(jit);
+    for (i=0; (i<NR_JITBINS-1) && (jit>=jit_bound[i]); i++);
+    ctrl.bin[i]++;
+    ctrl.max_jit=MAX(ctrl.max_jit,jit);
+    ctrl.nr++;
+  }
+  ctrl.prev_t=t;
+}
+
+// one control step for both rotors
+static void control_step(void)
+{
+  CTRL_SETP sp;
+  measure_jitter();
+  if (ctrl.hold) return;
+
+  if (ctrl.apply)
+  {
+    ctrl.apply();
+    ctrl.apply=NULL;
+  }
+
+  portENTER_CRITICAL(&ctrl_mux);
+  sp=ctrl.sp;
+  portEXIT_CRITICAL(&ctrl_mux);
+
+  if (sp.contrunning)
+  {
+    run_motor_hard(SAX_rot, sp.a_spd);
+    run_motor_hard(SEY_rot, sp.b_spd);
+  }
+  else
+  {
+    rotors_track(SAX_rot, SEY_rot, &sp.gotoval);
+  }
+}
+
+static void control_task(void *arg)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    control_step();
+  }
+}
+
+// timer callback: only wake the control task
+static void control_tick(void *arg)
+{
+  xTaskNotifyGive(ctrl.task);
+}
+
+void start_control(void)
+{
+  esp_timer_create_args_t args;
+  if (ctrl.task) return;         // already running (setup() again)
+
+  control_publish();
+  xTaskCreatePinnedToCore(control_task, "control", 4096, NULL, CTRL_TASK_PRIO, &ctrl.task, 1);
+
+  memset(&args,0,sizeof(args));
+  args.callback=control_tick;
+  args.dispatch_method=ESP_TIMER_TASK;
+  args.name="control";
+  esp_timer_create(&args,&ctrl.timer);
+  esp_timer_start_periodic(ctrl.timer,CTRL_PERIOD_US);
+}
+
+// true if rotors are driven by the control task
+boolean control_active(void)
+{
+  return ((ctrl.task) && (!ctrl.hold));
+}
+
+// suspend control while rotors are driven directly (calibration)
+void control_hold(boolean hold)
+{
+  if (hold) ctrl.hold++; else if (ctrl.hold) ctrl.hold--;
+  ctrl.prev_t=0;                 // don't count this gap as jitter
+}
+
+// setpoint from command to the control task, copied as a whole
+// (called by loop(), the only writer of command)
+void control_publish(void)
+{
+  portENTER_CRITICAL(&ctrl_mux);
+  ctrl.sp.gotoval=command.gotoval;
+  ctrl.sp.contrunning=command.contrunning;
+  ctrl.sp.a_spd=command.a_spd;
+  ctrl.sp.b_spd=command.b_spd;
+  portEXIT_CRITICAL(&ctrl_mux);
+}
+
+// change rotor settings (gains, mode): fn is run by the control task
+// between two steps; wait until done
+void control_apply(void (*fn)(void))
+{
+  if (!control_active())
+  {
+    fn();
+    return;
+  }
+  ctrl.apply=fn;
+  while (ctrl.apply) delay(1);
+}
+
+// Send jitter histogram of control period
+void send_jitter(boolean reset)
+{
+  int i;
+  xprintf("JIT: period=%ld us  n=%lu  max=%ld us  overrun=%lu\n",
+          (long)CTRL_PERIOD_US,ctrl.nr,ctrl.max_jit,ctrl.overrun);
+  for (i=0; i<NR_JITBINS; i++)
+  {
+    if (jit_bound[i])
+      xprintf("JIT: <%5ld us: %lu\n",jit_bound[i],ctrl.bin[i]);
+    else
+      xprintf("JIT: >=%4ld us: %lu\n",jit_bound[i-1],ctrl.bin[i]);
+  }
+  if (reset)
+  {
+    memset(ctrl.bin,0,sizeof(ctrl.bin));
+    ctrl.nr=0;
+    ctrl.overrun=0;
+    ctrl.max_jit=0;
+  }
+}
+
+#else
+
+boolean control_active(void)
+{
+  return false;
+}
+
+void control_hold(boolean hold)
+{
+}
+
+void control_publish(void)
+{
+}
+
+void control_apply(void (*fn)(void))
+{
+  fn();
+}
+
+#endif
@@ -0,0 +1,512 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Deep-space perturbations for SDP4
+ * Project: rotordrive
+ * Author: R. Alblas
+ * Content:
+ *   double FMod2p()
+ *   void Deep_dpinit()
+ *   void Deep_dpsec()
+ *   void Deep_dpper()
+ *
+ * Lunar-solar terms and the resonance of 12 h and 24 h orbits, as
+ * Deep() of Spacetrack Report #3 (Kelso, Project Pluto).
+ * deep_arg lives in the (const) SDP4 params, SDP4() works on a copy,
+ * so nothing is kept between calls: the resonance integrator always
+ * starts at epoch (1 step per 12 h from epoch) and the periodics are
+ * calculated every call.
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/* Copyright (C) 2018, Project Pluto
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA. */
+
+#include <math.h>
+#include "norad.h"
+#include "norad_in.h"
+
+double ThetaG_JD(double jd);      /* sgp4_calcsat.cpp */
+
+#define zns           1.19459E-5
+#define c1ss          2.9864797E-6
+#define zes           0.01675
+#define znl           1.5835218E-4
+#define c1l           4.7968065E-7
+#define zel           0.05490
+#define zcosis        0.91744867
+#define zsinis        0.39785416
+#define zsings       -0.98088458
+#define zcosgs        0.1945905
+#define q22           1.7891679E-6
+#define q31           2.1460748E-6
+#define q33           2.2123015E-7
+#define g22           5.7686396
+#define g32           0.95240898
+#define g44           1.8014998
+#define g52           1.0508330
+#define g54           4.4108898
+#define root22        1.7891679E-6
+#define root32        3.7393792E-7
+#define root44        7.3636953E-9
+#define root52        1.1428639E-7
+#define root54        2.1765803E-9
+#define thdt          4.3752691E-3
+#define fasx2         0.13130908
+#define fasx4         2.8843198
+#define fasx6         0.37448087
+#define step          720.          /* integrator step, minutes */
+#define step2         (step*step/2.)
+#define MIN_SINIO     1.e-12        /* equatorial: no node terms */
+
+double FMod2p( const double x)
+{
+   double rval = fmod( x, twopi);
+
+   if( rval < 0.)
+      rval += twopi;
+   return( rval);
+}
+
+void Deep_dpinit( const tle_t *tle, deep_arg_t *deep_arg)
+{
+   const double sinq = sin( tle->xnodeo);
+   const double cosq = cos( tle->xnodeo);
+   const double aqnv = 1. / deep_arg->aodp;
+   const double day = tle->epoch - 2415020.;      /* days from 1900 Jan 0.5 */
+   const double xnodce = 4.5236020 - 9.2422029E-4 * day;
+   const double stem = sin( xnodce);
+   const double ctem = cos( xnodce);
+   const double zcosil = 0.91375164 - 0.03568096 * ctem;
+   const double zsinil = sqrt( 1. - zcosil * zcosil);
+   const double zsinhl = 0.089683511 * stem / zsinil;
+   const double zcoshl = sqrt( 1. - zsinhl * zsinhl);
+   const double c = 4.7199672 + 0.22997150 * day;
+   const double gam = 5.8351514 + 0.0019443680 * day;
+   const double eq = tle->eo;
+   const double eosq = deep_arg->eosq;
+   const double cosio = deep_arg->cosio;
+   const double sinio = deep_arg->sinio;
+   double zx, zy, zcosgl, zsingl;
+   double zcosg, zsing, zcosi, zsini, zcosh, zsinh, zn, ze, cc, xnoi;
+   double se = 0., si = 0., sl = 0., sgh = 0., sh = 0., bfact;
+   int lunar;
+
+   deep_arg->thgr = ThetaG_JD( tle->epoch);
+   deep_arg->xnq = deep_arg->xnodp;
+   deep_arg->omegaq = tle->omegao;
+   deep_arg->zmol = FMod2p( c - gam);
+   zx = 0.39785416 * stem / zsinil;
+   zy = zcoshl * ctem + 0.91744867 * zsinhl * stem;
+   zx = atan2( zx, zy) + gam - xnodce;
+   zcosgl = cos( zx);
+   zsingl = sin( zx);
+   deep_arg->zmos = FMod2p( 6.2565837 + 0.017201977 * day);
+
+   /* Solar terms first,  then lunar */
+   zcosg = zcosgs;
+   zsing = zsings;
+   zcosi = zcosis;
+   zsini = zsinis;
+   zcosh = cosq;
+   zsinh = sinq;
+   cc = c1ss;
+   zn = zns;
+   ze = zes;
+   xnoi = 1. / deep_arg->xnq;
+   for( lunar = 0; lunar < 2; lunar++)
+      {
+      const double a1 = zcosg * zcosh + zsing * zcosi * zsinh;
+      const double a3 = -zsing * zcosh + zcosg * zcosi * zsinh;
+      const double a7 = -zcosg * zsinh + zsing * zcosi * zcosh;
+      const double a8 = zsing * zsini;
+      const double a9 = zsing * zsinh + zcosg * zcosi * zcosh;
+      const double a10 = zcosg * zsini;
+      const double a2 = cosio * a7 + sinio * a8;
+      const double a4 = cosio * a9 + sinio * a10;
+      const double a5 = -sinio * a7 + cosio * a8;
+      const double a6 = -sinio * a9 + cosio * a10;
+      const double x1 = a1 * deep_arg->cosg + a2 * deep_arg->sing;
+      const double x2 = a3 * deep_arg->cosg + a4 * deep_arg->sing;
+      const double x3 = -a1 * deep_arg->sing + a2 * deep_arg->cosg;
+      const double x4 = -a3 * deep_arg->sing + a4 * deep_arg->cosg;
+      const double x5 = a5 * deep_arg->sing;
+      const double x6 = a6 * deep_arg->sing;
+      const double x7 = a5 * deep_arg->cosg;
+      const double x8 = a6 * deep_arg->cosg;
+      const double z31 = 12. * x1 * x1 - 3. * x3 * x3;
+      const double z32 = 24. * x1 * x2 - 6. * x3 * x4;
+      const double z33 = 12. * x2 * x2 - 3. * x4 * x4;
+      const double z11 = -6. * a1 * a5 + eosq * (-24. * x1 * x7 - 6. * x3 * x5);
+      const double z12 = -6. * (a1 * a6 + a3 * a5) +
+                  eosq * (-24. * (x2 * x7 + x1 * x8) - 6. * (x3 * x6 + x4 * x5));
+      const double z13 = -6. * a3 * a6 + eosq * (-24. * x2 * x8 - 6. * x4 * x6);
+      const double z21 = 6. * a2 * a5 + eosq * (24. * x1 * x5 - 6. * x3 * x7);
+      const double z22 = 6. * (a4 * a5 + a2 * a6) +
+                  eosq * (24. * (x2 * x5 + x1 * x6) - 6. * (x4 * x7 + x3 * x8));
+      const double z23 = 6. * a4 * a6 + eosq * (24. * x2 * x6 - 6. * x4 * x8);
+      const double s3 = cc * xnoi;
+      const double s2 = -0.5 * s3 / deep_arg->betao;
+      const double s4 = s3 * deep_arg->betao;
+      const double s1 = -15. * eq * s4;
+      const double s5 = x1 * x3 + x2 * x4;
+      const double s6 = x2 * x3 + x1 * x4;
+      const double s7 = x2 * x4 - x1 * x3;
+      double z1 = 3. * (a1 * a1 + a2 * a2) + z31 * eosq;
+      double z2 = 6. * (a1 * a3 + a2 * a4) + z32 * eosq;
+      double z3 = 3. * (a3 * a3 + a4 * a4) + z33 * eosq;
+
+      z1 = z1 + z1 + deep_arg->betao2 * z31;
+      z2 = z2 + z2 + deep_arg->betao2 * z32;
+      z3 = z3 + z3 + deep_arg->betao2 * z33;
+      se = s1 * zn * s5;
+      si = s2 * zn * (z11 + z13);
+      sl = -zn * s3 * (z1 + z3 - 14. - 6. * eosq);
+      sgh = s4 * zn * (z31 + z33 - 6.);
+      sh = -zn * s2 * (z21 + z23);
+      if( tle->xincl < 5.2359877E-2)     /* < 3 degr: node undefined */
+         sh = 0.;
+      deep_arg->ee2 = 2. * s1 * s6;
+      deep_arg->e3 = 2. * s1 * s7;
+      deep_arg->xi2 = 2. * s2 * z12;
+      deep_arg->xi3 = 2. * s2 * (z13 - z11);
+      deep_arg->xl2 = -2. * s3 * z2;
+      deep_arg->xl3 = -2. * s3 * (z3 - z1);
+      deep_arg->xl4 = -2. * s3 * (-21. - 9. * eosq) * ze;
+      deep_arg->xgh2 = 2. * s4 * z32;
+      deep_arg->xgh3 = 2. * s4 * (z33 - z31);
+      deep_arg->xgh4 = -18. * s4 * ze;
+      deep_arg->xh2 = -2. * s2 * z22;
+      deep_arg->xh3 = -2. * s2 * (z23 - z21);
+      if( lunar)
+         break;
+      /* Keep the solar terms,  set up for the lunar ones */
+      deep_arg->sse = se;
+      deep_arg->ssi = si;
+      deep_arg->ssl = sl;
+      deep_arg->ssh = (sinio > MIN_SINIO ? sh / sinio : 0.);
+      deep_arg->ssg = sgh - cosio * deep_arg->ssh;
+      deep_arg->se2 = deep_arg->ee2;
+      deep_arg->si2 = deep_arg->xi2;
+      deep_arg->sl2 = deep_arg->xl2;
+      deep_arg->sgh2 = deep_arg->xgh2;
+      deep_arg->sh2 = deep_arg->xh2;
+      deep_arg->se3 = deep_arg->e3;
+      deep_arg->si3 = deep_arg->xi3;
+      deep_arg->sl3 = deep_arg->xl3;
+      deep_arg->sgh3 = deep_arg->xgh3;
+      deep_arg->sh3 = deep_arg->xh3;
+      deep_arg->sl4 = deep_arg->xl4;
+      deep_arg->sgh4 = deep_arg->xgh4;
+      zcosg = zcosgl;
+      zsing = zsingl;
+      zcosi = zcosil;
+      zsini = zsinil;
+      zcosh = zcoshl * cosq + zsinhl * sinq;
+      zsinh = sinq * zcoshl - cosq * zsinhl;
+      zn = znl;
+      cc = c1l;
+      ze = zel;
+      }
+   deep_arg->sse += se;
+   deep_arg->ssi += si;
+   deep_arg->ssl += sl;
+   if( sinio > MIN_SINIO)
+      {
+      deep_arg->ssg += sgh - cosio / sinio * sh;
+      deep_arg->ssh += sh / sinio;
+      }
+   else
+      deep_arg->ssg += sgh;
+
+   /* Geopotential resonance for 12 h (e >= 0.5) and 24 h orbits */
+   deep_arg->resonance_flag = deep_arg->synchronous_flag = 0;
+   deep_arg->del1 = deep_arg->del2 = deep_arg->del3 = 0.;
+   if( deep_arg->xnq < 0.0052359877 && deep_arg->xnq > 0.0034906585)
+      {
+      const double g200 = 1. + eosq * (-2.5 + 0.8125 * eosq);
+      const double g310 = 1. + 2. * eosq;
+      const double g300 = 1. + eosq * (-6. + 6.60937 * eosq);
+      const double f220 = 0.75 * (1. + cosio) * (1. + cosio);
+      const double f311 = 0.9375 * sinio * sinio * (1. + 3. * cosio) - 0.75 * (1. + cosio);
+      double f330 = 1. + cosio;
+      double del1;
+
+      deep_arg->resonance_flag = deep_arg->synchronous_flag = 1;
+      f330 = 1.875 * f330 * f330 * f330;
+      del1 = 3. * deep_arg->xnq * deep_arg->xnq * aqnv * aqnv;
+      deep_arg->del2 = 2. * del1 * f220 * g200 * q22;
+      deep_arg->del3 = 3. * del1 * f330 * g300 * q33 * aqnv;
+      deep_arg->del1 = del1 * f311 * g310 * q31 * aqnv;
+      deep_arg->xlamo = tle->xmo + tle->xnodeo + tle->omegao - deep_arg->thgr;
+      bfact = deep_arg->xmdot + deep_arg->omgdot + deep_arg->xnodot - thdt;
+      bfact += deep_arg->ssl + deep_arg->ssg + deep_arg->ssh;
+      }
+   else if( deep_arg->xnq >= 0.00826 && deep_arg->xnq <= 0.00924 && eq >= 0.5)
+      {
+      const double eoc = eq * eosq;
+      const double sini2 = sinio * sinio;
+      const double theta2 = deep_arg->cosio2;
+      const double g201 = -0.306 - (eq - 0.64) * 0.440;
+      double g211, g310, g322, g410, g422, g520, g521, g532, g533;
+      double f220, f221, f321, f322, f441, f442, f522, f523, f542, f543;
+      double xno2, ainv2, temp1, temp;
+
+      deep_arg->resonance_flag = 1;
+      if( eq <= 0.65)
+         {
+         g211 = 3.616 - 13.247 * eq + 16.290 * eosq;
+         g310 = -19.302 + 117.390 * eq - 228.419 * eosq + 156.591 * eoc;
+         g322 = -18.9068 + 109.7927 * eq - 214.6334 * eosq + 146.5816 * eoc;
+         g410 = -41.122 + 242.694 * eq - 471.094 * eosq + 313.953 * eoc;
+         g422 = -146.407 + 841.880 * eq - 1629.014 * eosq + 1083.435 * eoc;
+         g520 = -532.114 + 3017.977 * eq - 5740. * eosq + 3708.276 * eoc;
+         }
+      else
+         {
+         g211 = -72.099 + 331.819 * eq - 508.738 * eosq + 266.724 * eoc;
+         g310 = -346.844 + 1582.851 * eq - 2415.925 * eosq + 1246.113 * eoc;
+         g322 = -342.585 + 1554.908 * eq - 2366.899 * eosq + 1215.972 * eoc;
+         g410 = -1052.797 + 4758.686 * eq - 7193.992 * eosq + 3651.957 * eoc;
+         g422 = -3581.69 + 16178.11 * eq - 24462.77 * eosq + 12422.52 * eoc;
+         if( eq <= 0.715)
+            g520 = 1464.74 - 4664.75 * eq + 3763.64 * eosq;
+         else
+            g520 = -5149.66 + 29936.92 * eq - 54087.36 * eosq + 31324.56 * eoc;
+         }
+      if( eq < 0.7)
+         {
+         g533 = -919.2277 + 4988.61 * eq - 9064.77 * eosq + 5542.21 * eoc;
+         g521 = -822.71072 + 4568.6173 * eq - 8491.4146 * eosq + 5337.524 * eoc;
+         g532 = -853.666 + 4690.25 * eq - 8624.77 * eosq + 5341.4 * eoc;
+         }
+      else
+         {
+         g533 = -37995.78 + 161616.52 * eq - 229838.2 * eosq + 109377.94 * eoc;
+         g521 = -51752.104 + 218913.95 * eq - 309468.16 * eosq + 146349.42 * eoc;
+         g532 = -40023.88 + 170470.89 * eq - 242699.48 * eosq + 115605.82 * eoc;
+         }
+      f220 = 0.75 * (1. + 2. * cosio + theta2);
+      f221 = 1.5 * sini2;
+      f321 = 1.875 * sinio * (1. - 2. * cosio - 3. * theta2);
+      f322 = -1.875 * sinio * (1. + 2. * cosio - 3. * theta2);
+      f441 = 35. * sini2 * f220;
+      f442 = 39.3750 * sini2 * sini2;
+      f522 = 9.84375 * sinio * (sini2 * (1. - 2. * cosio - 5. * theta2) +
+                  0.33333333 * (-2. + 4. * cosio + 6. * theta2));
+      f523 = sinio * (4.92187512 * sini2 * (-2. - 4. * cosio + 10. * theta2) +
+                  6.56250012 * (1. + 2. * cosio - 3. * theta2));
+      f542 = 29.53125 * sinio * (2. - 8. * cosio + theta2 *
+                  (-12. + 8. * cosio + 10. * theta2));
+      f543 = 29.53125 * sinio * (-2. - 8. * cosio + theta2 *
+                  (12. + 8. * cosio - 10. * theta2));
+      xno2 = deep_arg->xnq * deep_arg->xnq;
+      ainv2 = aqnv * aqnv;
+      temp1 = 3. * xno2 * ainv2;
+      temp = temp1 * root22;
+      deep_arg->d2201 = temp * f220 * g201;
+      deep_arg->d2211 = temp * f221 * g211;
+      temp1 *= aqnv;
+      temp = temp1 * root32;
+      deep_arg->d3210 = temp * f321 * g310;
+      deep_arg->d3222 = temp * f322 * g322;
+      temp1 *= aqnv;
+      temp = 2. * temp1 * root44;
+      deep_arg->d4410 = temp * f441 * g410;
+      deep_arg->d4422 = temp * f442 * g422;
+      temp1 *= aqnv;
+      temp = temp1 * root52;
+      deep_arg->d5220 = temp * f522 * g520;
+      deep_arg->d5232 = temp * f523 * g532;
+      temp = 2. * temp1 * root54;
+      deep_arg->d5421 = temp * f542 * g521;
+      deep_arg->d5433 = temp * f543 * g533;
+      deep_arg->xlamo = tle->xmo + tle->xnodeo + tle->xnodeo - deep_arg->thgr - deep_arg->thgr;
+      bfact = deep_arg->xmdot + deep_arg->xnodot + deep_arg->xnodot - thdt - thdt;
+      bfact += deep_arg->ssl + deep_arg->ssh + deep_arg->ssh;
+      }
+   else
+      return;
+   deep_arg->xfact = bfact - deep_arg->xnq;
+   deep_arg->xli = deep_arg->xlamo;
+   deep_arg->xni = deep_arg->xnq;
+   deep_arg->atime = 0.;
+}
+
+/* Resonance rates at the integrator state xli, xni, atime */
+static void dot_terms( const deep_arg_t *deep_arg, const double xli,
+                       const double atime, double *xndot, double *xnddt)
+{
+   if( deep_arg->synchronous_flag)
+      {
+      *xndot = deep_arg->del1 * sin( xli - fasx2)
+             + deep_arg->del2 * sin( 2. * (xli - fasx4))
+             + deep_arg->del3 * sin( 3. * (xli - fasx6));
+      *xnddt = deep_arg->del1 * cos( xli - fasx2)
+             + 2. * deep_arg->del2 * cos( 2. * (xli - fasx4))
+             + 3. * deep_arg->del3 * cos( 3. * (xli - fasx6));
+      }
+   else
+      {
+      const double xomi = deep_arg->omegaq + deep_arg->omgdot * atime;
+      const double x2omi = xomi + xomi;
+      const double x2li = xli + xli;
+
+      *xndot = deep_arg->d2201 * sin( x2omi + xli - g22)
+             + deep_arg->d2211 * sin( xli - g22)
+             + deep_arg->d3210 * sin( xomi + xli - g32)
+             + deep_arg->d3222 * sin( -xomi + xli - g32)
+             + deep_arg->d4410 * sin( x2omi + x2li - g44)
+             + deep_arg->d4422 * sin( x2li - g44)
+             + deep_arg->d5220 * sin( xomi + xli - g52)
+             + deep_arg->d5232 * sin( -xomi + xli - g52)
+             + deep_arg->d5421 * sin( xomi + x2li - g54)
+             + deep_arg->d5433 * sin( -xomi + x2li - g54);
+      *xnddt = deep_arg->d2201 * cos( x2omi + xli - g22)
+             + deep_arg->d2211 * cos( xli - g22)
+             + deep_arg->d3210 * cos( xomi + xli - g32)
+             + deep_arg->d3222 * cos( -xomi + xli - g32)
+             + deep_arg->d5220 * cos( xomi + xli - g52)
+             + deep_arg->d5232 * cos( -xomi + xli - g52)
+             + 2. * (deep_arg->d4410 * cos( x2omi + x2li - g44)
+             + deep_arg->d4422 * cos( x2li - g44)
+             + deep_arg->d5421 * cos( xomi + x2li - g54)
+             + deep_arg->d5433 * cos( -xomi + x2li - g54));
+      }
+}
+
+/* Secular effects at deep_arg->t;  in: xll, omgadf, xnode, xn */
+void Deep_dpsec( const tle_t *tle, deep_arg_t *deep_arg)
+{
+   const double t = deep_arg->t;
+   const double delt = (t < 0. ? -step : step);
+   double xli, xni, atime, xndot, xnddt, xldot, ft, xl, temp;
+
+   deep_arg->xll += deep_arg->ssl * t;
+   deep_arg->omgadf += deep_arg->ssg * t;
+   deep_arg->xnode += deep_arg->ssh * t;
+   deep_arg->em = tle->eo + deep_arg->sse * t;
+   deep_arg->xinc = tle->xincl + deep_arg->ssi * t;
+   if( deep_arg->xinc < 0.)
+      {
+      deep_arg->xinc = -deep_arg->xinc;
+      deep_arg->xnode += pi;
+      deep_arg->omgadf -= pi;
+      }
+   if( !deep_arg->resonance_flag)
+      return;
+
+   /* Integrate from epoch in steps of 'step' minutes,  then Taylor */
+   xli = deep_arg->xlamo;
+   xni = deep_arg->xnq;
+   atime = 0.;
+   for( ;;)
+      {
+      dot_terms( deep_arg, xli, atime, &xndot, &xnddt);
+      xldot = xni + deep_arg->xfact;
+      xnddt *= xldot;
+      if( fabs( t - atime) < step)
+         break;
+      xli += xldot * delt + xndot * step2;
+      xni += xndot * delt + xnddt * step2;
+      atime += delt;
+      }
+   ft = t - atime;
+   deep_arg->xn = xni + xndot * ft + xnddt * ft * ft * 0.5;
+   xl = xli + xldot * ft + xndot * ft * ft * 0.5;
+   temp = -deep_arg->xnode + deep_arg->thgr + t * thdt;
+   if( deep_arg->synchronous_flag)
+      deep_arg->xll = xl - deep_arg->omgadf + temp;
+   else
+      deep_arg->xll = xl + temp + temp;
+}
+
+/* Lunar-solar periodics at deep_arg->t;  in: xinc, em, omgadf, xnode, xll */
+void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
+{
+   const double t = deep_arg->t;
+   double zm, zf, sinzf, f2, f3;
+   double ses, sis, sls, sghs, shs, sel, sil, sll, sghl, shl;
+   double pe, pinc, pl, pgh, ph, sinis, cosis;
+
+   zm = deep_arg->zmos + zns * t;
+   zf = zm + 2. * zes * sin( zm);
+   sinzf = sin( zf);
+   f2 = 0.5 * sinzf * sinzf - 0.25;
+   f3 = -0.5 * sinzf * cos( zf);
+   ses = deep_arg->se2 * f2 + deep_arg->se3 * f3;
+   sis = deep_arg->si2 * f2 + deep_arg->si3 * f3;
+   sls = deep_arg->sl2 * f2 + deep_arg->sl3 * f3 + deep_arg->sl4 * sinzf;
+   sghs = deep_arg->sgh2 * f2 + deep_arg->sgh3 * f3 + deep_arg->sgh4 * sinzf;
+   shs = deep_arg->sh2 * f2 + deep_arg->sh3 * f3;
+   zm = deep_arg->zmol + znl * t;
+   zf = zm + 2. * zel * sin( zm);
+   sinzf = sin( zf);
+   f2 = 0.5 * sinzf * sinzf - 0.25;
+   f3 = -0.5 * sinzf * cos( zf);
+   sel = deep_arg->ee2 * f2 + deep_arg->e3 * f3;
+   sil = deep_arg->xi2 * f2 + deep_arg->xi3 * f3;
+   sll = deep_arg->xl2 * f2 + deep_arg->xl3 * f3 + deep_arg->xl4 * sinzf;
+   sghl = deep_arg->xgh2 * f2 + deep_arg->xgh3 * f3 + deep_arg->xgh4 * sinzf;
+   shl = deep_arg->xh2 * f2 + deep_arg->xh3 * f3;
+   pe = ses + sel;
+   pinc = sis + sil;
+   pl = sls + sll;
+   pgh = sghs + sghl;
+   ph = shs + shl;
+
+   deep_arg->xinc += pinc;
+   deep_arg->em += pe;
+   sinis = sin( deep_arg->xinc);
+   cosis = cos( deep_arg->xinc);
+   if( deep_arg->xinc >= 0.2)
+      {
+      /* Apply periodics directly */
+      ph /= sinis;
+      pgh -= cosis * ph;
+      deep_arg->omgadf += pgh;
+      deep_arg->xnode += ph;
+      deep_arg->xll += pl;
+      }
+   else
+      {
+      /* Low inclination: Lyddane modification */
+      const double sinok = sin( deep_arg->xnode);
+      const double cosok = cos( deep_arg->xnode);
+      const double alfdp = sinis * sinok + ph * cosok + pinc * cosis * sinok;
+      const double betdp = sinis * cosok - ph * sinok + pinc * cosis * cosok;
+      double xls, xnoh;
+
+      deep_arg->xnode = FMod2p( deep_arg->xnode);
+      xls = deep_arg->xll + deep_arg->omgadf + cosis * deep_arg->xnode;
+      xls += pl + pgh - pinc * deep_arg->xnode * sinis;
+      xnoh = deep_arg->xnode;
+      deep_arg->xnode = atan2( alfdp, betdp);
+      /* Patch by Rob Matson: keep the node on the same turn */
+      if( fabs( xnoh - deep_arg->xnode) > pi)
+         {
+         if( deep_arg->xnode < xnoh)
+            deep_arg->xnode += twopi;
+         else
+            deep_arg->xnode -= twopi;
+         }
+      deep_arg->xll += pl;
+      deep_arg->omgadf = xls - deep_arg->xll - cos( deep_arg->xinc) * deep_arg->xnode;
+      }
+}
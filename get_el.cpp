@@ -0,0 +1,155 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Two-line elements: parse and checksum
+ * Project: rotordrive
+ * Author: R. Alblas
+ * Content:
+ *   int DLL_FUNC tle_checksum()
+ *   int DLL_FUNC parse_elements()
+ *
+ * Fixed columns of the NORAD format; line 1:
+ *   3-7 catalogue nr., 8 classification, 10-17 int. designator,
+ *   19-32 epoch (yy, day of year), 34-43 ndot/2 (rev/day^2),
+ *   54-61 bstar (1/earth radii, exponent form), 65-68 element set nr.
+ * line 2:
+ *   9-16 inclination, 18-25 RAAN, 27-33 eccentricity (implied '0.'),
+ *   35-42 arg. of perigee, 44-51 mean anomaly (degr),
+ *   53-63 mean motion (rev/day)
+ * Column 69 of both lines: checksum (digits summed, '-' counts 1).
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/* Copyright (C) 2018, Project Pluto
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA. */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "norad.h"
+#include "norad_in.h"
+
+#define TLE_LEN      69        /* chars per line, checksum included */
+#define deg2rad      (pi / 180.)
+
+/* 0: ok,  -1: line too short or no checksum digit,  1: wrong checksum */
+int DLL_FUNC tle_checksum( const char *buff)
+{
+   int i, sum = 0;
+
+   for( i = 0; i < TLE_LEN - 1; i++)
+      {
+      if( !buff[i])
+         return( -1);
+      if( isdigit( buff[i]))
+         sum += buff[i] - '0';
+      else if( buff[i] == '-')
+         sum++;
+      }
+   if( !isdigit( buff[TLE_LEN - 1]))
+      return( -1);
+   return( sum % 10 == buff[TLE_LEN - 1] - '0' ? 0 : 1);
+}
+
+/* columns 'col' (0-based) ... col+len-1 as number */
+static double get_field( const char *line, const int col, const int len)
+{
+   char tbuff[16];
+
+   memcpy( tbuff, line + col, len);
+   tbuff[len] = '\0';
+   return( atof( tbuff));
+}
+
+/* "snnnnnsE": mantissa with implied '0.',  then exponent,  e.g. " 66816-4" */
+static double get_exp_field( const char *line, const int col)
+{
+   char tbuff[16];
+   double rval;
+
+   tbuff[0] = '.';
+   memcpy( tbuff + 1, line + col + 1, 5);
+   tbuff[6] = '\0';
+   rval = atof( tbuff) * pow( 10., get_field( line, col + 6, 2));
+   return( line[col] == '-' ? -rval : rval);
+}
+
+/* field in format "nnnnn" has to be digits or spaces */
+static int is_numeric( const char *line, const int col, const int len)
+{
+   int i;
+
+   for( i = col; i < col + len; i++)
+      if( !isdigit( line[i]) && line[i] != ' ' && line[i] != '.'
+                    && line[i] != '-' && line[i] != '+')
+         return( 0);
+   return( 1);
+}
+
+/*********************************************************************
+ * Two lines 'line1', 'line2' into 'sat' (angles in radians, motion in
+ *   radians/minute, epoch JD).
+ * return: 0: ok; -1: not a TLE ('sat' not changed);
+ *   else 'sat' filled, but a checksum is wrong: 1: line 1, 2: line 2,
+ *   3: both
+ *********************************************************************/
+int DLL_FUNC parse_elements( const char *line1, const char *line2, tle_t *sat)
+{
+   int year, i, rval = 0;
+
+   if( strlen( line1) < TLE_LEN - 1 || strlen( line2) < TLE_LEN - 1)
+      return( -1);
+   if( line1[0] != '1' || line2[0] != '2' || line1[1] != ' ' || line2[1] != ' ')
+      return( -1);
+   if( strncmp( line1 + 2, line2 + 2, 5))          /* same catalogue nr. */
+      return( -1);
+   if( !is_numeric( line1, 18, 14) || !is_numeric( line1, 33, 10)
+            || !is_numeric( line2, 8, 55))
+      return( -1);
+
+   if( tle_checksum( line1))
+      rval |= 1;
+   if( tle_checksum( line2))
+      rval |= 2;
+
+   sat->norad_number = atoi( line1 + 2);
+   sat->classification = line1[7];
+   memcpy( sat->intl_desig, line1 + 9, 8);
+   sat->intl_desig[8] = '\0';
+   for( i = 7; i >= 0 && sat->intl_desig[i] == ' '; i--)
+      sat->intl_desig[i] = '\0';
+   sat->bulletin_number = (int)get_field( line1, 64, 4);
+
+   year = (int)get_field( line1, 18, 2);
+   year += (year < 57 ? 2000 : 1900);               /* first one: 1957 */
+         /* JD of Jan 0.0: as kepler2tle(),  year counted from 1900 */
+   sat->epoch = 2415019.5 + 365. * (year - 1900) + (year - 1901) / 4
+                   + get_field( line1, 20, 12);
+   sat->xndt2o = get_field( line1, 33, 10) * twopi / (minutes_per_day * minutes_per_day);
+   sat->bstar = get_exp_field( line1, 53);
+
+   sat->xincl = get_field( line2, 8, 8) * deg2rad;
+   sat->xnodeo = get_field( line2, 17, 8) * deg2rad;
+   sat->eo = get_field( line2, 26, 7) * 1.e-7;
+   sat->omegao = get_field( line2, 34, 8) * deg2rad;
+   sat->xmo = get_field( line2, 43, 8) * deg2rad;
+   sat->xno = get_field( line2, 52, 11) * twopi / minutes_per_day;
+   return( rval);
+}
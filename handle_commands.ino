@@ -11,6 +11,7 @@
  *   int parse_cmd(char *cmd)
  *      parses command in cmd and fills global 'command'
  *      returns 1 if command was processed
+ *      Keywords: cmd_table
  *
  *   void execute_cmd()
  *      executes commands in global 'command'
@@ -49,47 +50,15 @@
 #if USE_SGP4
   extern KEPLER kepler;
   extern EPOINT refpos;
+  extern PASS_PLAN passplan;
+  #if USE_SCHEDULER
+    extern CAT_ENTRY catalogue[];
+    extern SCHEDULE schedule;
+  #endif
 #endif
 
 extern COMMANDS command;
 
-// Get arg. from command
-//   cmd: command-string:
-//     <cmd> <val(s)> or <cmd>=<val(s)>, <val(s)>=string without spaces
-//   key: command
-//   return: string with value or NULL (key doesn't match)
-//
-#define LENBUF 50
-static char *get_val(char *cmd,char *key)
-{
-  char *p;
-  static char cmdi[LENBUF];
-  strncpy(cmdi,cmd,LENBUF);
-  if ((p=strchr(cmdi,' '))) *p='=';    // for backward compatibility
-  if ((p=strchr(cmdi,'=')))            // <key>=<val>
-  {
-    if (!strncmp(cmdi,key,strlen(key))) return p+1;
-  }
-  return NULL;
-}
-
-// Get boolean from command
-//   cmd: command-string:
-//     <cmd> <bool>, <bool>=0  or 1
-//   key: command
-//   val: found boolean
-//   return: 1 or 0 (key doesn't match)
-static int get_bool(char *cmd,char *key,boolean *val)
-{
-  char *p;
-  if ((p=get_val(cmd,key)))
-  {
-    if (atoi(p)) *val=true; else *val=false;
-    return 1;
-  }
-  return 0;
-}
-
 #if USE_SGP4
 // Set if communicated keplers are in degrees or radians (communicated = what's exchanged between pc and rotorctrl)
 #define kepler_in_degrees true // temp., MUST be true with version >=2023.3! 
@@ -107,216 +76,419 @@ void convert_kep(float ival,float *roval,float *doval)
   }
 }
 
-// get Kepler from interface
-static int get_kepler_item(char *cmd,KEPLER *k)
+// get Kepler item from interface; arg: which one
+#define KEP_NAME 0
+#define KEP_YEAR 1
+#define KEP_DAY 2
+#define KEP_DECAY 3
+#define KEP_BSTAR 4
+#define KEP_INCL 5
+#define KEP_RAAN 6
+#define KEP_ECC 7
+#define KEP_PERIGEE 8
+#define KEP_ANOMALY 9
+#define KEP_MOTION 10
+static int cmd_kepler(char *p,int arg)
 {
-  char *p;
-  if      ((p=get_val(cmd,"satname=")))      strncpy(k->name,p,20);
-  else if ((p=get_val(cmd,"epoch_year=")))   k->epoch_year=atoi(p);
-  else if ((p=get_val(cmd,"epoch_day=")))    k->epoch_day=atof(p);
-  else if ((p=get_val(cmd,"decay_rate=")))   k->decay_rate=atof(p);
-  else if ((p=get_val(cmd,"bstar=")))        k->bstar=atof(p);
-  else if ((p=get_val(cmd,"inclination=")))  convert_kep(atof(p),&k->inclination,&k->d_inclination);
-  else if ((p=get_val(cmd,"raan=")))         convert_kep(atof(p),&k->raan,&k->d_raan);
-  else if ((p=get_val(cmd,"eccentricity="))) k->eccentricity=atof(p);
-  else if ((p=get_val(cmd,"perigee=")))      convert_kep(atof(p),&k->perigee,&k->d_perigee);
-  else if ((p=get_val(cmd,"anomaly=")))      convert_kep(atof(p),&k->anomaly,&k->d_anomaly);
-  else if ((p=get_val(cmd,"motion=")))       k->motion=atof(p);
-  else  return 0;
-//  calc_sgp4_const(k,false);
-//  get_ntp();                 // get fresh time
+  KEPLER *k=&kepler;
+  if (arg!=KEP_NAME) k->from_tle=false;  // tle from the fields again
+  switch(arg)
+  {
+    case KEP_NAME   : strncpy(k->name,p,20); k->name[19]=0;               break;
+    case KEP_YEAR   : k->epoch_year=atoi(p);                              break;
+    case KEP_DAY    : k->epoch_day=atof(p);                               break;
+    case KEP_DECAY  : k->decay_rate=atof(p);                              break;
+    case KEP_BSTAR  : k->bstar=atof(p);                                   break;
+    case KEP_INCL   : convert_kep(atof(p),&k->inclination,&k->d_inclination); break;
+    case KEP_RAAN   : convert_kep(atof(p),&k->raan,&k->d_raan);           break;
+    case KEP_ECC    : k->eccentricity=atof(p);                            break;
+    case KEP_PERIGEE: convert_kep(atof(p),&k->perigee,&k->d_perigee);     break;
+    case KEP_ANOMALY: convert_kep(atof(p),&k->anomaly,&k->d_anomaly);     break;
+    case KEP_MOTION : k->motion=atof(p);                                  break;
+  }
   return 1;
 }
 #endif
 
-// parsing commands from serial or wifi interface
-// format commands: (no spaces!)
-//    <command>=<val>\n
-//    <command> <val>\n (for backwards compatibility, only place with space!)
-//    <command>\n
-// !!! command MUST end with '\n'!!!
-
-
-int parse_cmd(char *cmd)
+/*********************************************************************
+ * Command handlers: p=value (NULL if none), arg from cmd_table
+ * return: 1 if command was processed
+ *********************************************************************/
+// a=<speed>, b=<speed>: run rotor continuously
+static int cmd_run(char *p,int arg)
 {
-  char *p;
-  if ((p=strchr(cmd,'\n'))) *p=0;
-  if ((p=strchr(cmd,'\r'))) *p=0;
-  if ((p=get_val(cmd,"a=")))
+  command.contrunning=true;
+  if (arg==AX_ID)
   {
-    command.contrunning=true;
     command.cmd=contrun_ax;
     command.a_spd=atoi(p);
-    return 1;
   }
-  else if ((p=get_val(cmd,"b=")))
+  else
   {
-    command.contrunning=true;
     command.cmd=contrun_ey;
     command.b_spd=atoi(p);
-    return 1;
-  }
-  else if (strlen(cmd))    // no 'a', 'b', but another command
-  {
-    command.contrunning=false;
   }
+  return 1;
+}
+
+static int cmd_pwm_freq(char *p,int arg)
+{
+  command.cmd=pwm_freq;
+  command.pwm_freq=atoi(p);
+  return 1;
+}
+
+static int cmd_pri_cmd(char *p,int arg)
+{
+  command.pri_cmd=(atoi(p)!=0);
+  return 1;
+}
+
+#if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
+// ctrl_pid=<0|1>: ramp or PID
+static int cmd_ctrl_pid(char *p,int arg)
+{
+  command.cmd=ctrl_mode;
+  command.ctrl_mode=(atoi(p)? MOTION_PID : MOTION_RAMP);
+  return 1;
+}
+
+// deadband=<degr>
+static int cmd_deadband(char *p,int arg)
+{
+  command.cmd=deadband;
+  command.deadband=atof(p);
+  return 1;
+}
 
-  if (!strcmp(cmd,"version"))
+// pid=<kp>,<ki>,<kd>,<kff>
+static int cmd_pid(char *p,int arg)
+{
+  int i;
+  for (i=0; i<4; i++)
   {
-    command.cmd=send_version;
-    return 1;
+    command.pid_gains[i]=atof(p);
+    if ((i<3) && (!(p=strchr(p,',')))) return 0;
+    p++;
   }
+  command.cmd=pid_gains;
+  return 1;
+}
+#endif
 
-  if (!strcmp(cmd,"gc"))
+#if USE_SGP4
+static int cmd_run_calc(char *p,int arg)
+{
+  command.run_calc=(atoi(p)!=0);
+  if (command.run_calc)
+    get_ntp();                           // get fresh time
+  calc_sgp4_const(&kepler,kepler_in_degrees);
+  #if USE_PERSIST
+    persist_save_kepler(&kepler);        // only written if changed
+  #endif
+  command.gotoval.vax=0.;                // no rate until next calc_pos()
+  command.gotoval.vey=0.;
+  plan_reset(&passplan);                 // keplers may be changed
+  command.run_sched=false;
+  return 1;
+}
+
+// tle=[<name>,]<line1>,<line2>: two-line elements in one go, checked and
+// used at once (SGP4 or SDP4); reply tle=<status>[,<name>,<model>]
+static int cmd_tle(char *p,int arg)
+{
+  char *name=NULL,*l1=p,*l2;
+  if (!(l2=strrchr(p,','))) return 0;
+  *l2++=0;
+  if ((l1=strrchr(p,',')))               // with name
   {
-    command.cmd=config;
-    return 1;
+    *l1++=0;
+    name=p;
   }
-  if (!strcmp(cmd,"gs"))
+  else
   {
-    command.cmd=status;
-    return 1;
+    l1=p;
   }
-  if ((p=get_val(cmd,"m=")))
+  command.tle_status=load_tle(&kepler,name,l1,l2);
+  if (!command.tle_status)
   {
-    command.cmd=monitor;
-    return 1;
+    command.gotoval.vax=0.;              // as run_calc
+    command.gotoval.vey=0.;
+    plan_reset(&passplan);
+  #if USE_PERSIST
+    persist_save_kepler(&kepler);
+  #endif
   }
-  if (!strcmp(cmd,"cal"))
+  command.cmd=get_tle;
+  return 1;
+}
+
+#if USE_SCHEDULER
+// run_sched=<0|1>: track from catalogue
+static int cmd_run_sched(char *p,int arg)
+{
+  command.run_sched=(atoi(p)!=0);
+  if (command.run_sched) get_ntp();      // get fresh time
+  command.run_calc=command.run_sched;
+  command.gotoval.vax=0.;
+  command.gotoval.vey=0.;
+  sched_reset(&schedule);
+  plan_reset(&passplan);
+  return 1;
+}
+
+// cat_store=<nr>,<prio>: keplers into catalogue
+static int cmd_cat_store(char *p,int arg)
+{
+  command.cat_nr=atoi(p);
+  if ((command.cat_nr<0) || (command.cat_nr>=CAT_SIZE)) return 0;
+  if (!(p=strchr(p,','))) return 0;
+  command.cat_prio=atoi(p+1);
+  command.cmd=cat_store;
+  return 1;
+}
+#endif
+
+// upload_time=<time>: time from PC
+static int cmd_upload_time(char *p,int arg)
+{
+  command.cmd=get_time;
+  strncpy(command.time,p,sizeof(command.time)-1);
+  command.time[sizeof(command.time)-1]=0;
+  return 1;
+}
+
+// upload_refpos=<lat>,<lon>: from PC
+static int cmd_upload_refpos(char *p,int arg)
+{
+  command.cmd=get_refpos;
+  command.ref_lat=atof(p);
+  if ((p=strchr(p,','))) command.ref_lon=atof(p+1);
+  return 1;
+}
+#endif
+
+#if USE_WIFI
+// subscribe=<mask>[,<rate>]: telemetry to this tcp client, mask TLM_*, rate Hz
+static int cmd_subscribe(char *p,int arg)
+{
+  command.cmd=subscribe;
+  command.tlm_mask=strtol(p,&p,0);
+  command.tlm_rate=(*p==','? atoi(p+1) : 1);
+  return 1;
+}
+#endif
+
+// gotopos=[<ew>,]<ax>[,<ey>]
+static int cmd_gotopos(char *p,int arg)
+{
+  char *p1;
+  int nrval=1;
+  for (p1=p; *p1; p1++) if (*p1==',') nrval++;
+  command.cmd=do_gotoval;
+  command.gotoval.vax=0.;               // fixed position
+  command.gotoval.vey=0.;
+  if (nrval==3)
   {
-    command.cmd=do_calibrate;
-    return 1;
+    command.gotoval.east_pass=atoi(p);
+    if (!(p=strchr(p,','))) return 0;
+    p++;
+    nrval--;
   }
-  if ((p=get_val(cmd,"f=")))
+  if (nrval==2)
   {
-    command.cmd=pwm_freq;
-    command.pwm_freq=atoi(p);
-    return 1;
+    command.gotoval.east_pass=1;
+    command.gotoval.ax=atof(p);
+    if (!(p=strchr(p+1,','))) return 0;
+    p++;
+    command.gotoval.ey=atof(p);
+    nrval-=2;
   }
-
-  if (!strcmp(cmd,"setup"))
+  if (nrval==1)
   {
-    command.cmd=do_setup;
-    return 1;
+    command.gotoval.east_pass=1;
+    command.gotoval.ax=atof(p);
+    command.gotoval.ey=0.;
+    nrval--;
   }
-  if (!strcmp(cmd,"restart"))
+  return 1;
+}
+
+/*********************************************************************
+ * Command table, MUST be sorted on key (strcmp order)!
+ *   key, value (CMD_NOVAL: <key>, CMD_VAL: <key>=<val>, CMD_OPTVAL: both),
+ *   command (if no handler), handler, arg for handler
+ *********************************************************************/
+static const CMD_DEF cmd_table[]=
+{
+  { "a"               ,CMD_VAL   ,none          ,cmd_run          ,AX_ID       },
+#if USE_SGP4
+  { "anomaly"         ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_ANOMALY },
+#endif
+  { "b"               ,CMD_VAL   ,none          ,cmd_run          ,EY_ID       },
+#if USE_SGP4
+  { "bstar"           ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_BSTAR   },
+#endif
+  { "cal"             ,CMD_NOVAL ,do_calibrate  ,NULL             ,0           },
+#if USE_SGP4 && USE_SCHEDULER
+  { "cat_store"       ,CMD_VAL   ,none          ,cmd_cat_store    ,0           },
+#endif
+#if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
+  { "ctrl_pid"        ,CMD_VAL   ,none          ,cmd_ctrl_pid     ,0           },
+  { "deadband"        ,CMD_VAL   ,none          ,cmd_deadband     ,0           },
+#endif
+#if USE_SGP4
+  { "decay_rate"      ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_DECAY   },
+  { "download_keplers",CMD_NOVAL ,send_kep      ,NULL             ,0           },
+  { "download_refpos" ,CMD_NOVAL ,send_refpos   ,NULL             ,0           },
+  { "download_time"   ,CMD_OPTVAL,send_time     ,NULL             ,0           },
+  { "eccentricity"    ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_ECC     },
+  { "epoch_day"       ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_DAY     },
+  { "epoch_year"      ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_YEAR    },
+#endif
+  { "f"               ,CMD_VAL   ,none          ,cmd_pwm_freq     ,0           },
+  { "gc"              ,CMD_NOVAL ,config        ,NULL             ,0           },
+#if USE_SGP4
+  { "get_ctrldata"    ,CMD_NOVAL ,send_rotdata  ,NULL             ,0           },
+#endif
+  { "get_jitter"      ,CMD_NOVAL ,jitter        ,NULL             ,0           },
+  { "get_outstat"     ,CMD_NOVAL ,outstat       ,NULL             ,0           },
+#if USE_SGP4 && USE_PASSPLAN
+  { "get_plan"        ,CMD_NOVAL ,send_passplan ,NULL             ,0           },
+#endif
+#if USE_SGP4
+  { "get_pos"         ,CMD_NOVAL ,send_satpos   ,NULL             ,0           },
+#endif
+#if USE_SGP4 && USE_SCHEDULER
+  { "get_sched"       ,CMD_NOVAL ,send_sched    ,NULL             ,0           },
+#endif
+  { "gotopos"         ,CMD_VAL   ,none          ,cmd_gotopos      ,0           },
+  { "gs"              ,CMD_NOVAL ,status        ,NULL             ,0           },
+#if USE_SGP4
+  { "inclination"     ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_INCL    },
+#endif
+  { "m"               ,CMD_VAL   ,monitor       ,NULL             ,0           },
+#if USE_SGP4
+  { "motion"          ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_MOTION  },
+  { "perigee"         ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_PERIGEE },
+#endif
+#if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
+  { "pid"             ,CMD_VAL   ,none          ,cmd_pid          ,0           },
+#endif
+  { "pri_cmd"         ,CMD_VAL   ,none          ,cmd_pri_cmd      ,0           },
+#if USE_SGP4
+  { "raan"            ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_RAAN    },
+#endif
+  { "restart"         ,CMD_NOVAL ,restart       ,NULL             ,0           },
+#if USE_SGP4
+  { "run_calc"        ,CMD_VAL   ,none          ,cmd_run_calc     ,0           },
+#endif
+#if USE_SGP4 && USE_SCHEDULER
+  { "run_sched"       ,CMD_VAL   ,none          ,cmd_run_sched    ,0           },
+#endif
+#if USE_SGP4
+  { "satname"         ,CMD_VAL   ,none          ,cmd_kepler       ,KEP_NAME    },
+#endif
+  { "setup"           ,CMD_NOVAL ,do_setup      ,NULL             ,0           },
+#if USE_WIFI
+  { "subscribe"       ,CMD_VAL   ,none          ,cmd_subscribe    ,0           },
+#endif
+#if USE_SGP4
+  { "tle"             ,CMD_VAL   ,none          ,cmd_tle          ,0           },
+#endif
+#if USE_SGP4
+  { "upload_refpos"   ,CMD_VAL   ,none          ,cmd_upload_refpos,0           },
+  { "upload_time"     ,CMD_VAL   ,none          ,cmd_upload_time  ,0           },
+#endif
+  { "version"         ,CMD_NOVAL ,send_version  ,NULL             ,0           },
+};
+#define NR_CMDS (int)(sizeof(cmd_table)/sizeof(cmd_table[0]))
+
+// find key 'key' of length 'len' (not 0-terminated); binary search
+static const CMD_DEF *find_cmd(const char *key,int len)
+{
+  int lo=0,hi=NR_CMDS-1;
+  while (lo<=hi)
   {
-    command.cmd=restart;
-    return 1;
+    int mid=(lo+hi)/2;
+    const char *k=cmd_table[mid].key;
+    int r=strncmp(key,k,len);
+    if ((!r) && (k[len])) r=-1;          // key is start of k: before k
+    if (!r) return &cmd_table[mid];
+    if (r<0) hi=mid-1; else lo=mid+1;
   }
+  return NULL;
+}
 
-  if (get_bool(cmd,"pri_cmd=",&command.pri_cmd))
+// parsing commands from serial or wifi interface
+// format commands: (no spaces!)
+//    <command>=<val>\n
+//    <command> <val>\n (for backwards compatibility, only place with space!)
+//    <command>\n
+//    <val1>,<val2>[,<val3>]\n: gotopos
+// One pass over the line: key up to the first ' ' or '=', looked up in cmd_table.
+int parse_cmd(char *cmd)
+{
+  const CMD_DEF *c;
+  char *val=NULL;
+  int len;
+  len=strcspn(cmd,"\r\n");
+  cmd[len]=0;
+  if (!len) return 0;
+
+  command.contrunning=false;           // only 'a', 'b' keep it running
+  len=strcspn(cmd," =");
+  if (cmd[len]) val=cmd+len+1;
+
+  if (!(c=find_cmd(cmd,len)))
   {
-    return 1;
+    if ((isdigit(cmd[0])) && (strchr(cmd,',')))  // <val1>,<val2>[,<val3>]
+      return cmd_gotopos(cmd,0);
+    return 0;
   }
-  #if USE_SGP4
-    if (get_bool(cmd,"run_calc=",&command.run_calc))
-    {
-      if (command.run_calc)
-        get_ntp();                         // get fresh time
-        calc_sgp4_const(&kepler,kepler_in_degrees);
-
-      return 1;
-    }
-
-    if ((p=get_val(cmd,"download_time")))  // download time to PC
-    {
-      command.cmd=send_time;
-      return 1;
-    }
-
-    if ((p=get_val(cmd,"upload_time=")))   // upload time from PC
-    {
-      command.cmd=get_time;
-      strncpy(command.time,p,sizeof(command.time));
-      return 1;
-    }
-
-    if (!strcmp(cmd,"download_refpos"))    // download to PC
-    {
-      command.cmd=send_refpos;
-      return 1; 
-    }
-
-    if ((p=get_val(cmd,"upload_refpos="))) // upload from PC
-    {
-      command.cmd=get_refpos;
-      command.ref_lat=atof(p);
-      if (p=strchr(p,',')) command.ref_lon=atof(p+1);
-      return 1;
-    }
-
-    if (!strcmp(cmd,"download_keplers"))   // download to PC
-    {
-      command.cmd=send_kep;
-      return 1; 
-    }
-
-    if (!strcmp(cmd,"get_ctrldata"))
-    {
-      command.cmd=send_rotdata;
-      return 1; 
-    }
-
-    if (!strcmp(cmd,"get_pos"))
-    {
-      command.cmd=send_satpos;
-      return 1; 
-    }
-
-    if (get_kepler_item(cmd,&kepler))
-    {
-      return 1; // get one kepler-item
-    }
+  if ((c->val==CMD_NOVAL) && (val)) return 0;
+  if ((c->val==CMD_VAL) && (!val)) return 0;
+  if (c->func) return c->func(val,c->arg);
+  command.cmd=c->cmd;
+  return 1;
+}
 
-  #endif
+#if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
+// rotor settings from command; run by the control task, see control_apply()
+static void apply_ctrl_mode(void)
+{
+  set_motion(SAX_rot, command.ctrl_mode);
+  set_motion(SEY_rot, command.ctrl_mode);
+}
 
-  // last to check!
-  if ((isdigit(cmd[0])) && (strchr(cmd,','))) // command <val1>,<val2>[,<val3>]
-  {
-    char cmd2[30];
-    strncpy(cmd2,cmd,30);
-    sprintf(cmd,"gotopos=%s",cmd2);
-  }
+static void apply_deadband(void)
+{
+  if (SAX_rot) SAX_rot->deadband=command.deadband;
+  if (SEY_rot) SEY_rot->deadband=command.deadband;
+}
 
-  // gotopos=<ew>,<lat>,<lon>
-  if ((p=get_val(cmd,"gotopos=")))
+static void apply_pid_gains(void)
+{
+  ROTOR *rot[2]={SAX_rot,SEY_rot};
+  int i;
+  for (i=0; i<2; i++)
   {
-    char *p1;
-    int nrval=1;
-    for (p1=p; *p1; p1++) if (*p1==',') nrval++;
-    if (nrval>0) command.cmd=do_gotoval;
-    if (nrval==3)
-    {
-      command.gotoval.east_pass=atoi(p);
-      if (!(p=strchr(p,','))) return 0;
-      p++;
-      nrval--;
-    }
-    if (nrval==2)
-    {
-      command.gotoval.east_pass=1;
-      command.gotoval.ax=atof(p);
-      if (!(p=strchr(p+1,','))) return 0;
-      p++;
-      command.gotoval.ey=atof(p);
-      nrval-=2;
-    }
-    if (nrval==1)
-    {
-      command.gotoval.east_pass=1;
-      command.gotoval.ax=atof(p);
-      command.gotoval.ey=0.;
-      nrval--;
-    }
-    return 1;
+    if (!rot[i]) continue;
+    rot[i]->kp=command.pid_gains[0];
+    rot[i]->ki=command.pid_gains[1];
+    rot[i]->kd=command.pid_gains[2];
+    rot[i]->kff=command.pid_gains[3];
+    rot[i]->pid_t=0;                     // restart PID
   }
-  return 0;
 }
+#endif
 
 // execute commands
 void execute_cmd()
 {
+  #if USE_BINPROTO
+    if (command.bin_link) bin_execute();   // reply in a frame
+  #endif
   #if PROCESSOR == PROC_ESP
     if (command.cmd==restart)    ESP.restart();
     if (command.cmd==do_setup)   setup();
@@ -324,8 +496,11 @@ void execute_cmd()
     if (command.cmd==restart)    setup();
     if (command.cmd==do_setup)   setup();
   #endif
-  if (command.cmd==contrun_ax)   run_motor_hard(SAX_rot, command.a_spd);
-  if (command.cmd==contrun_ey)   run_motor_hard(SEY_rot, command.b_spd);
+  if (!control_active())         // else done by control task
+  {
+    if (command.cmd==contrun_ax) run_motor_hard(SAX_rot, command.a_spd);
+    if (command.cmd==contrun_ey) run_motor_hard(SEY_rot, command.b_spd);
+  }
   if (command.cmd==send_version) xprintf("VERS: Release %s\n",RELEASE);
 
   if (command.cmd==config)       send_specs(SAX_rot, SEY_rot);
@@ -338,9 +513,29 @@ void execute_cmd()
     if (SAX_rot) command.gotoval.ax = SAX_rot->degr;
     if (SEY_rot) command.gotoval.ey = SEY_rot->degr;
   }
-  if (command.cmd==monitor)   ; 
+  #if USE_CTRL_TASK
+    if (command.cmd==jitter)     send_jitter(true);
+  #endif
+  if (command.cmd==outstat)    send_outstat();
+  #if USE_WIFI
+    if (command.cmd==subscribe)
+    {
+      if (command.client)
+      {
+        telem_subscribe(command.client-1,command.tlm_mask,command.tlm_rate);
+        xprintf("subscribe=%d,%d\n",command.tlm_mask,(command.tlm_mask? command.tlm_rate : 0));
+      }
+      else
+      {
+        xprintf("subscribe: only for wifi clients\n");
+      }
+    }
+  #endif
 
   #if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
+    if (command.cmd==ctrl_mode)  control_apply(apply_ctrl_mode);
+    if (command.cmd==deadband)   control_apply(apply_deadband);
+    if (command.cmd==pid_gains)  control_apply(apply_pid_gains);
     if (command.cmd==pwm_freq)
     {
       #if PROCESSOR == PROC_AVR
@@ -369,37 +564,67 @@ void execute_cmd()
 
     if (command.cmd==send_time)
     {
-      send_ctrltime(RemoteClient);
+      send_ctrltime();
     }
   #endif
 
   #if USE_SGP4
     if (command.cmd==send_rotdata)
     {
-      send_ctrldata(RemoteClient,SAX_rot,SEY_rot,&command.gotoval);
+      send_ctrldata(SAX_rot,SEY_rot,&command.gotoval);
     }
     if (command.cmd==send_satpos)
     {
-      send_pos(RemoteClient,&command.gotoval,kepler.name);
+      send_pos(&command.gotoval,kepler.name);
     }
 
 
 
     if (command.cmd==send_refpos)
     {
-      send_refposition(RemoteClient,&refpos);
+      send_refposition(&refpos);
     }
 
     if (command.cmd==get_refpos)
     {
       refpos.lat=D2R(command.ref_lat);
       refpos.lon=D2R(command.ref_lon);
+    #if USE_PERSIST
+      persist_save_refpos(&refpos);
+    #endif
     }
     if (command.cmd==send_kep)
     {
-      send_keplers(RemoteClient,&kepler,kepler_in_degrees);
+      send_keplers(&kepler,kepler_in_degrees);
+    }
+    if (command.cmd==get_tle)
+    {
+      if (command.tle_status)            // -1: no TLE; 1, 2, 3: checksum line 1, 2, both
+        xprintf("tle=%d\n",command.tle_status);
+      else
+        xprintf("tle=0,%s,%s\n",kepler.name,(kepler.deep? "SDP4" : "SGP4"));
+    }
+  #if USE_PASSPLAN
+    if (command.cmd==send_passplan)
+    {
+      send_plan(&passplan);
     }
   #endif
+  #if USE_SCHEDULER
+    if (command.cmd==cat_store)          // prio <= 0: remove
+    {
+      CAT_ENTRY *c=&catalogue[command.cat_nr];
+      c->kepler=kepler;
+      calc_sgp4_const(&c->kepler,kepler_in_degrees);
+      c->prio=command.cat_prio;
+      sched_reset(&schedule);
+    }
+    if (command.cmd==send_sched)
+    {
+      send_schedule(&schedule,catalogue);
+    }
+  #endif
+  #endif
 //  if (command.cmd!=none) printf("Command: %d\n",command.cmd);
   command.cmd=none;
 }
@@ -0,0 +1,161 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   Host (Linux) replacement of the Arduino/ESP32 core API.
+ *   Only what the sketch uses is emulated; all of it runs on the
+ *   virtual clock of hal_sim.cpp, so a host run is deterministic.
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#ifndef ARDUINO_HOST_HDR
+#define ARDUINO_HOST_HDR
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define IRAM_ATTR
+
+#define digitalPinToInterrupt(p) (p)
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(int pin,int mode);
+void digitalWrite(int pin,int val);
+int digitalRead(int pin);
+void attachInterrupt(int irq,void (*isr)(void),int mode);
+void detachInterrupt(int irq);
+
+// ESP32 LEDC (PWM)
+double ledcSetup(int chan,double freq,int bits);
+void ledcAttachPin(int pin,int chan);
+void ledcWrite(int chan,uint32_t duty);
+
+// ESP32 hardware timer (Arduino core 2.x), on the virtual clock
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t *timerBegin(uint8_t num,uint16_t divider,bool countUp);
+void timerAttachInterrupt(hw_timer_t *t,void (*isr)(void),bool edge);
+void timerAlarmWrite(hw_timer_t *t,uint64_t alarm,bool autoreload);
+void timerAlarmEnable(hw_timer_t *t);
+void timerAlarmDisable(hw_timer_t *t);
+
+char *dtostrf(double val,signed char width,unsigned char prec,char *s);
+
+// time
+void configTime(long gmtoffset,int dstoffset,const char *server);
+bool getLocalTime(struct tm *info,uint32_t ms=5000);
+
+// FreeRTOS (ESP32 Arduino.h includes these)
+// Tasks run cooperatively on the virtual clock: a due task runs when
+// loop() advances the clock, until it blocks (delay, notify-wait).
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct { int unused; } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(m) ((void)(m))
+#define portEXIT_CRITICAL(m) ((void)(m))
+#define portENTER_CRITICAL_ISR(m) ((void)(m))
+#define portEXIT_CRITICAL_ISR(m) ((void)(m))
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  1
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7fffffff
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,const char *name,uint32_t stack,
+                                   void *arg,UBaseType_t prio,TaskHandle_t *task,BaseType_t core);
+#define xTaskCreate(fn,name,stack,arg,prio,task) \
+  xTaskCreatePinnedToCore(fn,name,stack,arg,prio,task,tskNO_AFFINITY)
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *prev,TickType_t inc);
+TickType_t xTaskGetTickCount(void);
+uint32_t ulTaskNotifyTake(BaseType_t clear,TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task,BaseType_t *woken);
+#define portYIELD_FROM_ISR()
+int uxTaskGetStackHighWaterMark(void *task);
+
+class EspClass
+{
+ public:
+  void restart(void);
+};
+extern EspClass ESP;
+
+class IPAddress
+{
+ public:
+  IPAddress(uint8_t a=0,uint8_t b=0,uint8_t c=0,uint8_t d=0) { ip[0]=a; ip[1]=b; ip[2]=c; ip[3]=d; }
+  uint8_t operator[](int i) const { return ip[i]; }
+  uint8_t ip[4];
+};
+
+class HardwareSerial
+{
+ public:
+  void begin(unsigned long baud);
+  int available(void);
+  int read(void);
+  int availableForWrite(void);
+  size_t write(const uint8_t *buf,size_t len);
+  size_t print(const char *s);
+  size_t print(const IPAddress &ip);
+  size_t println(const char *s="");
+  size_t println(const IPAddress &ip);
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,53 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   Host (Linux) replacement of the ESP32 Preferences library (NVS).
+ *   Only the blob functions; entries are kept by the simulator,
+ *   optionally in a file, and survive sim_reset() (see hal_sim.h).
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#ifndef PREFERENCES_HOST_HDR
+#define PREFERENCES_HOST_HDR
+#include <stddef.h>
+
+class Preferences
+{
+ public:
+  Preferences(void) : open(false), readonly(false) { ns[0]=0; }
+  bool begin(const char *name,bool readOnly=false,const char *partition_label=NULL);
+  void end(void);
+  size_t putBytes(const char *key,const void *value,size_t len);
+  size_t getBytes(const char *key,void *buf,size_t maxLen);
+  size_t getBytesLength(const char *key);
+  bool remove(const char *key);
+  bool clear(void);
+ private:
+  char ns[16];           // namespace, max. 15 chars as NVS
+  bool open,readonly;
+};
+
+#endif
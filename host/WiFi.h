@@ -0,0 +1,91 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   Host (Linux) replacement of the ESP32 WiFi library.
+ *   Connections are in-memory byte queues, filled and drained
+ *   by the simulator (see hal_sim.h).
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#ifndef WIFI_HOST_HDR
+#define WIFI_HOST_HDR
+#include "Arduino.h"
+
+typedef enum
+{
+  WL_IDLE_STATUS=0,
+  WL_CONNECTED=3,
+  WL_DISCONNECTED=6
+} wl_status_t;
+
+typedef enum
+{
+  WIFI_OFF=0,
+  WIFI_STA=1,
+  WIFI_AP=2
+} wifi_mode_t;
+
+struct sim_conn;
+
+class WiFiClient
+{
+ public:
+  WiFiClient(void) : conn(-1) {}
+  WiFiClient(int c) : conn(c) {}
+  uint8_t connected(void);
+  int available(void);
+  int read(void);
+  int read(uint8_t *buf,size_t size);
+  size_t write(const uint8_t *buf,size_t size);
+  int availableForWrite(void);
+  void stop(void);
+  operator bool(void) { return connected(); }
+  int conn;              // index in simulator connection table, -1: none
+};
+
+class WiFiServer
+{
+ public:
+  WiFiServer(int port) : port(port) {}
+  void begin(void);
+  bool hasClient(void);
+  WiFiClient available(void);
+  int port;
+};
+
+class WiFiClass
+{
+ public:
+  wl_status_t status(void);
+  bool mode(wifi_mode_t m);
+  wl_status_t begin(const char *ssid,const char *pwd);
+  bool softAP(const char *ssid,const char *pwd);
+  bool disconnect(bool wifioff=false);
+  IPAddress localIP(void);
+};
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,154 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   SGP4() per call against the batch functions (sgp4batch.cpp):
+ *   - 1 satellite, 7 days in 10 s steps: SGP4_batch()
+ *   - catalogue of 'nsat' satellites (fixed pseudo-random elements,
+ *     near-earth, some "simple"), 7 days in 60 s steps: SGP4_soa()
+ *   Reports positions/s of both and the max. position difference (km).
+ *
+ * usage: bench_batch [nsat]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "Arduino.h"
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+
+#define DAYS 7
+#define STEP_1 10                // s, 1 satellite
+#define STEP_CAT 60              // s, catalogue
+#define NSAT 1000
+#define REPEAT 5                 // 1 satellite: runs, best time counts
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+// reproducible 0...1
+static double rnd(void)
+{
+  static unsigned long s=12345;
+  s=s*1103515245UL+12345UL;
+  return ((s>>8)&0xffffff)/16777216.;
+}
+
+static double max_diff(double *a,double *b,long n)
+{
+  double d,m=0.;
+  long i;
+  for (i=0; i<n; i++)
+  {
+    d=fabs(a[i]-b[i]);
+    if (d>m) m=d;
+  }
+  return m;
+}
+
+static void bench_one(KEPLER *k)
+{
+  int n=DAYS*86400/STEP_1,i,r;
+  double *ts=(double *)malloc(n*sizeof(double));
+  double *p1=(double *)malloc(3*n*sizeof(double));
+  double *pb=(double *)malloc(3*n*sizeof(double));
+  double vel[3],tm,ns_1=1e30,ns_b=1e30;
+
+  for (i=0; i<n; i++) ts[i]=i*STEP_1/60.;
+  for (r=0; r<REPEAT; r++)
+  {
+    tm=host_ns();
+    for (i=0; i<n; i++) SGP4(ts[i],&k->tle,k->sgp4_params,p1+3*i,vel);
+    ns_1=MIN(ns_1,host_ns()-tm);
+    tm=host_ns();
+    SGP4_batch(k->sgp4_params,&k->tle,ts,n,pb);
+    ns_b=MIN(ns_b,host_ns()-tm);
+  }
+  printf("%-10s SGP4() %9.0f pos/s  SGP4_batch() %9.0f pos/s  (x%.2f)  max. diff %.2g km\n",
+         k->name,n*1e9/ns_1,n*1e9/ns_b,ns_1/ns_b,max_diff(p1,pb,3L*n));
+  free(ts);
+  free(p1);
+  free(pb);
+}
+
+static void bench_cat(int nsat)
+{
+  KEPLER *k=(KEPLER *)calloc(nsat,sizeof(KEPLER));
+  double *buf=(double *)malloc(SGP4_SOA_NPAR*nsat*sizeof(double));
+  double *p1=(double *)malloc(3*nsat*sizeof(double));
+  double *ps=(double *)malloc(3*nsat*sizeof(double));
+  double vel[3],jd0,jd,tm,ns_1=0.,ns_s=0.,d,dmax=0.;
+  int nt=DAYS*86400/STEP_CAT,i,j,nsimple=0;
+  SGP4_SOA soa;
+
+  sgp4_soa_init(&soa,buf,nsat);
+  for (i=0; i<nsat; i++)
+  {
+    sprintf(k[i].name,"S%d",i);
+    k[i].epoch_year=123;
+    k[i].epoch_day=100.+rnd()*2.;
+    k[i].bstar=rnd()*5e-4;
+    k[i].d_inclination=20.+rnd()*80.;
+    k[i].d_raan=rnd()*360.;
+    k[i].eccentricity=rnd()*0.03;
+    k[i].d_perigee=rnd()*360.;
+    k[i].d_anomaly=rnd()*360.;
+    k[i].motion=12.+rnd()*4.;
+    calc_sgp4_const(&k[i],true);
+    if (*((int *)(k[i].sgp4_params+29))) nsimple++;
+    sgp4_soa_add(&soa,k[i].sgp4_params,&k[i].tle);
+  }
+  jd0=k[0].tle.epoch+2.;
+
+  for (j=0; j<nt; j++)
+  {
+    jd=jd0+j*STEP_CAT/86400.;
+    tm=host_ns();
+    for (i=0; i<nsat; i++)
+      SGP4((jd-k[i].tle.epoch)*1440.,&k[i].tle,k[i].sgp4_params,p1+3*i,vel);
+    ns_1+=host_ns()-tm;
+    tm=host_ns();
+    SGP4_soa(&soa,jd,ps);
+    ns_s+=host_ns()-tm;
+    d=max_diff(p1,ps,3L*nsat);
+    if (d>dmax) dmax=d;
+  }
+  printf("catalogue  %d satellites (%d simple), %d days in %d s steps: %.1f M positions\n",
+         nsat,nsimple,DAYS,STEP_CAT,(double)nsat*nt/1e6);
+  printf("           SGP4() %7.0f ms  SGP4_soa() %7.0f ms  (x%.2f)  max. diff %.2g km\n",
+         ns_1/1e6,ns_s/1e6,ns_1/ns_s,dmax);
+  free(k);
+  free(buf);
+  free(p1);
+  free(ps);
+}
+
+int main(int argc,char **argv)
+{
+  KEPLER k;
+  int nsat=NSAT;
+
+  if (argc>1) nsat=atoi(argv[1]);
+  if (nsat<=0) nsat=NSAT;
+  memset(&k,0,sizeof(k));
+  load_default_kepler(&k);
+  calc_sgp4_const(&k,true);
+  bench_one(&k);
+  bench_cat(nsat);
+  return 0;
+}
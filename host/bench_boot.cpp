@@ -0,0 +1,170 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Time to first track after a reset, on the simulated plant, with
+ *   the state in flash (persist.ino). Each boot is a new process
+ *   (RAM lost), the NVS is a file, the plant keeps its position:
+ *     cold:     empty flash; the PC sends run_calc=1 at once
+ *     warm:     power off while parked (rotors at rest)
+ *     tracking: power off during the pass: calibration, tracking
+ *               resumes without the PC (keplers, run_calc from flash)
+ *     by hand:  parked, elevation turned across the zenith while off
+ *   First track: run_calc on and the dish within LOCK_DEGR of the
+ *   target on both axes. Per boot also the position error of the
+ *   controller after setup() (calibration or flash) and the nr. of
+ *   flash writes until power off.
+ *
+ * usage: bench_boot [-v]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "sketch_protos.h"
+
+#define LOCK_DEGR 0.5            // on target: dish within this
+#define SAMPLE_US 100000
+#define LOOP_US 100
+#define OUTBUF 65536
+
+extern ROTOR *SAX_rot,*SEY_rot;
+extern COMMANDS command;
+
+static char nvs_path[64];
+static boolean verbose;
+
+typedef struct
+{
+  boolean warm;                  // no calibration
+  double t_setup;                // s after reset: setup() done
+  double t_track;                // s after reset: on target, <0: not
+  double err[2];                 // controller - dish after setup() (degr)
+  float motor[2];                // plant at power off
+  unsigned long writes;          // flash writes
+} BOOT_RES;
+
+// serial output since the last call, appended to 'out'
+static void drain(char *out)
+{
+  int n=strlen(out);
+  if (n<OUTBUF-1) sim_serial_output(out+n,OUTBUF-n);
+}
+
+static boolean on_target(void)
+{
+  return ((command.run_calc) &&
+          (fabs(plant_axis(PLANT_AX)->dish_degr-command.gotoval.ax)<LOCK_DEGR) &&
+          (fabs(plant_axis(PLANT_EY)->dish_degr-command.gotoval.ey)<LOCK_DEGR));
+}
+
+// child: power on at 't_on' with the plant at ax, ey; send 'cmds', run until 't_off'
+static void run_boot(time_t t_on,float ax,float ey,const char *cmds,time_t t_off,BOOT_RES *r)
+{
+  static char out[OUTBUF];
+  uint64_t nsample=0;
+  memset(r,0,sizeof(*r));
+  sim_reset();
+  sim_serial_echo(verbose);
+  sim_nvs_file(nvs_path);
+  sim_set_epoch(t_on);
+  plant_init(ax,ey);
+  setup();
+  r->t_setup=sim_now_us()/1e6;
+  r->t_track=-1.;
+  r->err[0]=to_degr(SAX_rot)-plant_axis(PLANT_AX)->dish_degr;
+  r->err[1]=to_degr(SEY_rot)-plant_axis(PLANT_EY)->dish_degr;
+  if (cmds) sim_serial_input(cmds);
+  while (time(NULL) < t_off)
+  {
+    loop();
+    sim_advance_us(LOOP_US);
+    if (sim_now_us()/SAMPLE_US > nsample)
+    {
+      nsample=sim_now_us()/SAMPLE_US;
+      drain(out);
+      if ((r->t_track<0.) && (on_target())) r->t_track=sim_now_us()/1e6;
+    }
+  }
+  drain(out);
+  r->warm=(strstr(out,"Warm boot")!=NULL);
+  r->motor[0]=plant_axis(PLANT_AX)->motor_degr;
+  r->motor[1]=plant_axis(PLANT_EY)->motor_degr;
+  r->writes=sim_nvs_writes();
+}
+
+// boot in a new process (fresh RAM); flash and plant position carry over
+static void boot(const char *name,time_t t_on,float ax,float ey,const char *cmds,
+                 time_t t_off,BOOT_RES *r)
+{
+  int fd[2];
+  pid_t pid;
+  fflush(stdout);
+  if (pipe(fd)) exit(1);
+  if (!(pid=fork()))
+  {
+    close(fd[0]);
+    run_boot(t_on,ax,ey,cmds,t_off,r);
+    if (write(fd[1],r,sizeof(*r))!=sizeof(*r)) _exit(1);
+    _exit(0);
+  }
+  close(fd[1]);
+  if (read(fd[0],r,sizeof(*r))!=sizeof(*r)) memset(r,0,sizeof(*r));
+  close(fd[0]);
+  waitpid(pid,NULL,0);
+
+  printf("%-9s %-5s %7.1f s ",name,(r->warm? "warm" : "cold"),r->t_setup);
+  if (r->t_track<0.) printf("      none ");
+  else printf("%8.1f s ",r->t_track);
+  printf("  %6.3f %6.3f deg   %3lu\n",r->err[0],r->err[1],r->writes);
+}
+
+int main(int argc,char **argv)
+{
+  KEPLER kep;
+  EPOINT ref;
+  PASS pass;
+  BOOT_RES r,rp;
+  time_t aos;
+  float ey;
+
+  if ((argc>1) && (!strcmp(argv[1],"-v"))) verbose=true;
+  snprintf(nvs_path,sizeof(nvs_path),"/tmp/bench_boot_%d.nvs",(int)getpid());
+  remove(nvs_path);
+
+  // first pass of the default keplers at least 20 min after the sim. epoch
+  sim_reset();
+  load_default_refpos(&ref);
+  load_default_kepler(&kep);
+  calc_sgp4_const(&kep,true);
+  if (!find_next_pass(&kep,&ref,time(NULL)+1200,time(NULL)+2*86400,&pass))
+  {
+    printf("no pass found\n");
+    return 1;
+  }
+  aos=(time_t)pass.aos;
+  printf("pass: AOS %s",ctime(&aos));
+  printf("power on  boot     setup  first track  err. AX     EY   writes\n");
+
+  boot("cold",aos-900,37.,120.,"run_calc=1\n",aos-420,&rp);
+  boot("warm",aos-400,rp.motor[0],rp.motor[1],NULL,aos+180,&r);
+  boot("tracking",aos+190,r.motor[0],r.motor[1],NULL,aos+400,&r);
+
+  ey=(rp.motor[1]>EY_REFPOS? EY_REFPOS-30. : EY_REFPOS+30.);
+  boot("by hand",aos-400,rp.motor[0],ey,NULL,aos-200,&r);
+
+  remove(nvs_path);
+  return 0;
+}
@@ -0,0 +1,177 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Zenith calibration on the simulated plant (sensor edge at 90 degr.
+ *   motor side):
+ *     - first calibration in setup(), from several start positions
+ *     - then calibrate() again (as after a pass, CAL_AFTER_TRACK) from
+ *       positions on both sides of the zenith
+ *   Per calibration: duration and the error of the result, pulse count
+ *   of the controller minus pulse interval of the motor (a constant
+ *   offset is harmless, its spread is the repeatability).
+ *   Lines "CAL:" are the controller's own report: per rotor duration,
+ *   count drift since the previous calibration and its range, and
+ *   apart the final edge against the one passed just before and its
+ *   spread (zenith sensor of the plant with hysteresis, jitter, delay).
+ *
+ * usage: bench_cal [-v]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "sketch_protos.h"
+
+#define LOOP_US 100
+#define MOVE_MAX_S 120.
+#define NRECAL 8
+
+extern ROTOR *SAX_rot,*SEY_rot;
+
+typedef struct
+{
+  int n;
+  double sum_t,max_t;
+  long emin[2],emax[2];
+} CAL_RES;
+
+// controller count minus pulse interval of the motor (0: exact)
+static long cal_err(ROTOR *rot,int axis)
+{
+  return rot->rotated-plant_axis(axis)->pulse_idx;
+}
+
+// controller's "CAL:" lines (output queue drained by loop())
+static void show_report(void)
+{
+  char buf[4096],*p,*q;
+  uint64_t t0=sim_now_us();
+  while (sim_now_us()-t0 < 20000)
+  {
+    loop();
+    sim_advance_us(LOOP_US);
+  }
+  sim_serial_output(buf,sizeof(buf));
+  for (p=buf; (q=strstr(p,"CAL:")); p=q+1)
+  {
+    char *e=strchr(q,'\n');
+    printf("    %.*s\n",(int)(e? e-q : strlen(q)),q);
+    if (!e) break;
+  }
+}
+
+static void result(CAL_RES *r,const char *what,double t)
+{
+  long e[2];
+  int i;
+  e[0]=cal_err(SAX_rot,PLANT_AX);
+  e[1]=cal_err(SEY_rot,PLANT_EY);
+  printf("  %-22s %6.1f s  status %d %d  err. %+3ld %+3ld pulses\n",what,t,
+         SAX_rot->cal_status,SEY_rot->cal_status,e[0],e[1]);
+  show_report();
+  for (i=0; i<2; i++)
+  {
+    if ((!r->n) || (e[i]<r->emin[i])) r->emin[i]=e[i];
+    if ((!r->n) || (e[i]>r->emax[i])) r->emax[i]=e[i];
+  }
+  r->sum_t+=t;
+  r->max_t=MAX(r->max_t,t);
+  r->n++;
+}
+
+// gotopos command, run until at rest there
+static void move_to(float ax,float ey)
+{
+  uint64_t t0=sim_now_us();
+  char cmd[40];
+  sprintf(cmd,"gotopos=%.2f,%.2f\n",ax,ey);
+  sim_serial_input(cmd);
+  while (sim_now_us()-t0 < MOVE_MAX_S*1e6)
+  {
+    loop();
+    sim_advance_us(LOOP_US);
+    if ((fabs(plant_axis(PLANT_AX)->motor_degr-ax)<0.3) &&
+        (fabs(plant_axis(PLANT_EY)->motor_degr-ey)<0.3) &&
+        (plant_axis(PLANT_AX)->vel==0.) && (plant_axis(PLANT_EY)->vel==0.)) break;
+  }
+  sim_serial_output(NULL,0);
+}
+
+// setup() in a new process (static state of the sketch as after a reset)
+static void cold_boot(CAL_RES *r,float ax,float ey,boolean verbose)
+{
+  int fd[2];
+  pid_t pid;
+  char what[40];
+  fflush(stdout);
+  if (pipe(fd)) exit(1);
+  if (!(pid=fork()))
+  {
+    close(fd[0]);
+    sim_reset();
+    sim_serial_echo(verbose);
+    plant_init(ax,ey);
+    setup();
+    sprintf(what,"from %.1f %.1f",ax,ey);
+    result(r,what,sim_now_us()/1e6);
+    fflush(stdout);
+    if (write(fd[1],r,sizeof(*r))!=sizeof(*r)) _exit(1);
+    _exit(0);
+  }
+  close(fd[1]);
+  if (read(fd[0],r,sizeof(*r))!=sizeof(*r)) exit(1);
+  close(fd[0]);
+  waitpid(pid,NULL,0);
+}
+
+int main(int argc,char **argv)
+{
+  static const float start[][2]={ {37.,120.},{120.,37.},{89.8,90.3},{5.,175.} };
+  static const float pos[][2]={ {60.,110.},{110.,60.},{91.,89.},{30.,150.} };
+  CAL_RES r0,r1;
+  boolean verbose;
+  uint64_t t;
+  int i,j;
+
+  memset(&r0,0,sizeof(r0));
+  memset(&r1,0,sizeof(r1));
+  verbose=((argc>1) && (!strcmp(argv[1],"-v")));
+
+  printf("setup() (cold):\n");
+  for (i=0; i<4; i++) cold_boot(&r0,start[i][0],start[i][1],verbose);
+
+  sim_reset();
+  sim_serial_echo(verbose);
+  plant_init(start[0][0],start[0][1]);
+  setup();
+  sim_serial_output(NULL,0);
+  printf("calibrate() again (after a pass):\n");
+  for (j=0; j<NRECAL; j++)
+  {
+    char what[40];
+    move_to(pos[j%4][0],pos[j%4][1]);
+    sprintf(what,"from %.1f %.1f",pos[j%4][0],pos[j%4][1]);
+    t=sim_now_us();
+    calibrate(SAX_rot,SEY_rot);
+    result(&r1,what,(sim_now_us()-t)/1e6);
+  }
+
+  printf("setup():     mean %5.1f s  max %5.1f s  err. AX %+ld...%+ld  EY %+ld...%+ld pulses\n",
+         r0.sum_t/r0.n,r0.max_t,r0.emin[0],r0.emax[0],r0.emin[1],r0.emax[1]);
+  printf("calibrate(): mean %5.1f s  max %5.1f s  err. AX %+ld...%+ld  EY %+ld...%+ld pulses\n",
+         r1.sum_t/r1.n,r1.max_t,r1.emin[0],r1.emax[0],r1.emin[1],r1.emax[1]);
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Command parsing: parse_cmd() speed on a (synthetic) xtrack session:
+ *   connect, keplers upload, then tracking with position commands
+ *   and monitoring requests. Lines with a heavy side effect
+ *   (run_calc: SGP4 init, NTP) are left out; all others are parsed,
+ *   not executed.
+ *   Then the keplers upload as 1 burst through readCommand_serial()
+ *   (line reader + parse + execute).
+ *
+ * usage: bench_cmd [nloop]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "sketch_protos.h"
+
+extern COMMANDS command;
+extern KEPLER kepler;
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+// start of session
+static const char *session_start[]=
+{
+  "version","gc","gs","pri_cmd=1",
+  "upload_time=2023/09/02,12:34:56","upload_refpos=52.0,5.0",
+  "satname=NOAA-19","epoch_year=23","epoch_day=245.51234567","decay_rate=0.00000123",
+  "bstar=0.000094","inclination=99.1923","raan=245.0122","eccentricity=0.0013512",
+  "perigee=231.5001","anomaly=128.4876","motion=14.12923456",
+  "download_keplers","download_refpos","download_time=",
+  NULL
+};
+
+// repeated during a pass: position from PC, monitoring
+static const char *session_track[]=
+{
+  "gotopos=123.4,45.6","get_ctrldata","get_pos",
+  "gotopos=1,123.5,45.7","get_ctrldata",
+  "123.6,45.8","get_ctrldata","gs",
+  NULL
+};
+
+// manual control at the end
+static const char *session_end[]=
+{
+  "a=50","a=0","b=-50","b=0","m=1","deadband=0.2","ctrl_pid=1",
+  "pid=8,0.5,0.2,1","cat_store=1,3","get_sched","get_jitter",
+  "no_such_command",
+  NULL
+};
+
+#define NR_TRACK 40               // track lines repeated
+#define MAXLINES 400
+
+int main(int argc,char **argv)
+{
+  static const char *lines[MAXLINES];
+  int nloop=20000;
+  int nlines=0,i,j,nok=0;
+  double t0,ns;
+  char line[60];
+
+  if (argc>1) nloop=atoi(argv[1]);
+  if (nloop<=0) nloop=1;
+
+  for (i=0; session_start[i]; i++) lines[nlines++]=session_start[i];
+  for (j=0; j<NR_TRACK; j++)
+    for (i=0; session_track[i]; i++) lines[nlines++]=session_track[i];
+  for (i=0; session_end[i]; i++) lines[nlines++]=session_end[i];
+
+  sim_reset();
+  setup();
+  sim_serial_output(NULL,0);
+
+  t0=host_ns();
+  for (j=0; j<nloop; j++)
+  {
+    for (i=0; i<nlines; i++)
+    {
+      strcpy(line,lines[i]);
+      strcat(line,"\n");
+      if (parse_cmd(line)) nok++;
+      command.cmd=none;
+    }
+  }
+  ns=host_ns()-t0;
+  printf("session of %d lines, %d times: %d accepted\n",nlines,nloop,nok/nloop);
+  printf("parse_cmd(): %.1f ns/line  %.2f M lines/s\n",ns/nloop/nlines,nloop*nlines/ns*1e3);
+  // keplers upload burst via serial
+  {
+    static char burst[1000];
+    *burst=0;
+    for (i=6; i<17; i++)
+    {
+      strcat(burst,session_start[i]);
+      strcat(burst,"\n");
+    }
+    nloop/=10;
+    if (nloop<=0) nloop=1;
+    ns=0.;
+    for (j=0; j<nloop; j++)
+    {
+      sim_serial_input(burst);
+      t0=host_ns();
+      readCommand_serial();
+      ns+=host_ns()-t0;
+    }
+    printf("keplers burst (%d bytes) via readCommand_serial(): %.2f us\n",(int)strlen(burst),ns/nloop/1e3);
+  }
+  printf("last: gotoval %.1f %.1f  kepler %s %.4f  refpos cmd %.1f,%.1f\n",
+         command.gotoval.ax,command.gotoval.ey,kepler.name,kepler.motion,command.ref_lat,command.ref_lon);
+  return 0;
+}
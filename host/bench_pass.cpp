@@ -0,0 +1,152 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   All passes of a week: find_next_pass() against a brute-force
+ *   scan of the elevation every second. Reports time and the max.
+ *   difference of AOS, LOS and max. elevation.
+ *
+ * usage: bench_pass [days]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "Arduino.h"
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+
+#define MAXPASS 200
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static void set_kepler(KEPLER *k,const char *name,float incl,float raan,float ecc,
+                       float perigee,float anom,float motion)
+{
+  load_default_kepler(k);
+  strcpy(k->name,name);
+  k->d_inclination=incl;
+  k->d_raan=raan;
+  k->eccentricity=ecc;
+  k->d_perigee=perigee;
+  k->d_anomaly=anom;
+  k->motion=motion;
+  calc_sgp4_const(k,true);
+}
+
+// every second; pass = run of seconds with elevation >= 0
+static int brute_force(KEPLER *k,EPOINT *refpos,long t0,long t1,PASS *p)
+{
+  DIR dir;
+  EPOINT ss;
+  long t;
+  int n=0;
+  boolean up=false;
+  for (t=t0; t<t1; t++)
+  {
+    float e;
+    calc_sat_dir(t,k,refpos,&dir,&ss);
+    e=R2D(dir.elev);
+    if ((e>=0.) && (!up))
+    {
+      if (n==MAXPASS) break;
+      p[n].aos=t;
+      p[n].max_elev=e;
+      up=true;
+    }
+    if (up)
+    {
+      if (e>p[n].max_elev) { p[n].max_elev=e; p[n].tca=t; }
+      if (e<0.) { p[n].los=t; n++; up=false; }
+    }
+  }
+  return n;
+}
+
+static int finder(KEPLER *k,EPOINT *refpos,long t0,long t1,PASS *p)
+{
+  double t=t0;
+  int n=0;
+  while ((n<MAXPASS) && (find_next_pass(k,refpos,t,t1,&p[n])))
+  {
+    t=p[n].los+1.;
+    n++;
+  }
+  return n;
+}
+
+static void bench(KEPLER *k,EPOINT *refpos,int days)
+{
+  static PASS pb[MAXPASS],pf[MAXPASS];
+  long t0=(long)((k->tle.epoch-J1900-YEAR1970)*86400.);
+  long t1=t0+days*86400L;
+  double ns_b,ns_f,tm;
+  double d_aos=0.,d_los=0.,d_el=0.;
+  int nb,nf,i,j,nmatch=0;
+
+  tm=host_ns();
+  nb=brute_force(k,refpos,t0,t1,pb);
+  ns_b=host_ns()-tm;
+  tm=host_ns();
+  nf=finder(k,refpos,t0,t1,pf);
+  ns_f=host_ns()-tm;
+
+  // brute force has 1 s resolution: AOS/LOS in [t-1,t]
+  for (i=0; i<nb; i++)
+  {
+    for (j=0; j<nf; j++)
+      if (fabs(pf[j].aos-pb[i].aos)<60.) break;
+    if (j==nf) { printf("  missed: aos %+.0f s  max %.2f\n",pb[i].aos-t0,pb[i].max_elev); continue; }
+    nmatch++;
+    d_aos=MAX(d_aos,fabs(pf[j].aos-(pb[i].aos-0.5)));
+    d_los=MAX(d_los,fabs(pf[j].los-(pb[i].los-0.5)));
+    d_el=MAX(d_el,pf[j].max_elev-pb[i].max_elev);
+  }
+  printf("%-10s brute force: %3d passes %8.1f ms   finder: %3d passes %6.2f ms  (x%.0f)\n",
+         k->name,nb,ns_b/1e6,nf,ns_f/1e6,ns_b/ns_f);
+  printf("%-10s matched %d; max. diff AOS %.2f s, LOS %.2f s, max. elev. %+.4f degr\n",
+         "",nmatch,d_aos,d_los,d_el);
+}
+
+int main(int argc,char **argv)
+{
+  KEPLER k;
+  EPOINT refpos;
+  int days=7;
+
+  if (argc>1) days=atoi(argv[1]);
+  if (days<=0) days=7;
+  memset(&refpos,0,sizeof(refpos));
+  load_default_refpos(&refpos);
+  printf("All passes in %d days from epoch\n",days);
+
+  memset(&k,0,sizeof(k));
+  load_default_kepler(&k);
+  calc_sgp4_const(&k,true);
+  bench(&k,&refpos,days);
+
+  set_kepler(&k,"ISS",51.64,210.3,0.0006,40.1,320.0,15.50);
+  bench(&k,&refpos,days);
+
+  set_kepler(&k,"METEOR",98.6,60.0,0.0003,120.0,240.0,14.24);
+  bench(&k,&refpos,days);
+
+  set_kepler(&k,"ECC_0.1",63.4,80.0,0.10,270.0,10.0,12.0);
+  bench(&k,&refpos,days);
+  return 0;
+}
@@ -0,0 +1,156 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Text against binary protocol, cost per message (host time):
+ *     goto:    parse_cmd()+execute_cmd() against bin_filter() of a frame
+ *     rotdata: send_ctrldata() against bin_put_rotdata()
+ *     keplers: 11 text lines against 1 frame
+ *   Also checks the fixed point round trip of the frames.
+ *
+ * usage: bench_proto [nloop]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "sketch_protos.h"
+
+extern ROTOR *SAX_rot,*SEY_rot;
+extern COMMANDS command;
+extern KEPLER kepler;
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static void report(const char *name,double ns_txt,double ns_bin,int n)
+{
+  printf("%-8s text %8.1f ns   binary %7.1f ns   (x%.0f)\n",name,ns_txt/n,ns_bin/n,ns_txt/ns_bin);
+}
+
+static const char *kep_txt[]=
+{
+  "satname=NOAA-19","epoch_year=23","epoch_day=245.51234567","decay_rate=0.00000123",
+  "bstar=0.000094","inclination=99.1923","raan=245.0122","eccentricity=0.0013512",
+  "perigee=231.5001","anomaly=128.4876","motion=14.12923456"
+};
+#define NR_KEP (int)(sizeof(kep_txt)/sizeof(kep_txt[0]))
+
+int main(int argc,char **argv)
+{
+  int nloop=100000;
+  int i,j,n;
+  double t0,ns_txt,ns_bin;
+  char line[60];
+  uint8_t frm[BIN_MAXFRAME];
+  BIN_RX rx;
+  GOTO_VAL gv,gv2;
+  KEPLER k;
+
+  if (argc>1) nloop=atoi(argv[1]);
+  if (nloop<=0) nloop=1;
+
+  sim_reset();
+  setup();
+  sim_serial_output(NULL,0);
+  sim_set_call_cost_us(0);             // millis() doesn't run the simulated control task
+  memset(&rx,0,sizeof(rx));
+  printf("%d messages each\n",nloop);
+
+  // goto: text line against frame
+  t0=host_ns();
+  for (i=0; i<nloop; i++)
+  {
+    strcpy(line,"gotopos=123.456,45.678\n");
+    if (parse_cmd(line)) execute_cmd();
+  }
+  ns_txt=host_ns()-t0;
+
+  memset(&gv,0,sizeof(gv));
+  gv.ax=123.456; gv.ey=45.678; gv.vax=0.512; gv.vey=-0.031; gv.east_pass=1;
+  n=bin_put_goto(frm,&gv);
+  t0=host_ns();
+  for (i=0; i<nloop; i++)
+  {
+    char buf[BIN_MAXFRAME];
+    memcpy(buf,frm,n);
+    bin_filter(&rx,buf,n,BIN_LINK_SERIAL);
+  }
+  ns_bin=host_ns()-t0;
+  report("goto",ns_txt,ns_bin,nloop);
+  gv2=command.gotoval;
+  printf("         frame %d bytes; ax %.3f ey %.3f vax %.3f vey %.3f; frames %lu crc err %lu\n",
+         n,gv2.ax,gv2.ey,gv2.vax,gv2.vey,rx.nr_frames,rx.nr_crc_err);
+
+  // rotor data: 5 text lines against 1 frame
+  gv=command.gotoval;
+  gv.x=12.3; gv.y=-45.6; gv.a=210.7; gv.e=33.2; gv.lat=51.9; gv.lon=4.48; gv.height=854321.;
+  t0=host_ns();
+  for (i=0; i<nloop; i++) send_ctrldata(SAX_rot,SEY_rot,&gv);
+  ns_txt=host_ns()-t0;
+  t0=host_ns();
+  for (i=0; i<nloop; i++) n=bin_put_rotdata(frm,SAX_rot,SEY_rot,&gv,time(NULL));
+  ns_bin=host_ns()-t0;
+  report("rotdata",ns_txt,ns_bin,nloop);
+  {
+    BIN_FRAME f;
+    float pos[2],req[2];
+    int spd[2];
+    long t;
+    f.len=frm[2]; f.id=frm[3];
+    memcpy(f.payload,frm+4,f.len);
+    bin_get_rotdata(&f,pos,req,&spd[0],&gv2,&t);
+    printf("         frame %d bytes; a %.3f e %.3f lat %.3f height %.0f\n",n,gv2.a,gv2.e,gv2.lat,gv2.height);
+  }
+
+  // keplers
+  nloop/=10;
+  if (nloop<=0) nloop=1;
+  t0=host_ns();
+  for (i=0; i<nloop; i++)
+  {
+    for (j=0; j<NR_KEP; j++)
+    {
+      strcpy(line,kep_txt[j]);
+      parse_cmd(line);
+    }
+  }
+  ns_txt=host_ns()-t0;
+  k=kepler;
+  n=bin_put_kepler(frm,&k);
+  t0=host_ns();
+  for (i=0; i<nloop; i++)
+  {
+    char buf[BIN_MAXFRAME];
+    memcpy(buf,frm,n);
+    bin_filter(&rx,buf,n,BIN_LINK_SERIAL);
+    if (!(i%16))                         // send and drop the queued acks
+    {
+      out_drain();
+      sim_serial_output(NULL,0);
+    }
+  }
+  ns_bin=host_ns()-t0;
+  report("keplers",ns_txt,ns_bin,nloop);
+  printf("         frame %d bytes; %s epoch %.8f incl %.6f ecc %.9f motion %.8f\n",
+         n,kepler.name,kepler.epoch_day-k.epoch_day,kepler.d_inclination-k.d_inclination,
+         kepler.eccentricity-k.eccentricity,kepler.motion-k.motion);
+  printf("         decay_rate %g bstar %g (float)\n",
+         kepler.decay_rate-k.decay_rate,kepler.bstar-k.bstar);
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   SGP4 + look angles: double path (calc_sat_earth_v2 + calceleazim_v2)
+ *   against the float path (calc_sat_f).
+ *   Per satellite: 7 days from epoch in steps of 'step' s;
+ *   reports calls/s of both and the max. angular error (degr),
+ *   all samples and above the horizon only.
+ *   Look angles only (calceleazim_v2, satellite position fixed,
+ *   1 s steps): calls/s; GMST and observer terms cached, see observer().
+ *
+ * usage: bench_sgp4 [step_s]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "Arduino.h"
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+
+#define AGE_DAYS 7
+#define LOOK_N 2000000
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static void set_kepler(KEPLER *k,const char *name,int year,float day,float bstar,
+                       float incl,float raan,float ecc,float perigee,float anom,float motion)
+{
+  memset(k,0,sizeof(*k));
+  strcpy(k->name,name);
+  k->epoch_year=year;
+  k->epoch_day=day;
+  k->bstar=bstar;
+  k->d_inclination=incl;
+  k->d_raan=raan;
+  k->eccentricity=ecc;
+  k->d_perigee=perigee;
+  k->d_anomaly=anom;
+  k->motion=motion;
+  calc_sgp4_const(k,true);
+}
+
+static double calc_sat_d(time_t t,KEPLER *kepler,EPOINT *refpos,DIR *dir)
+{
+  struct tm tm=*gmtime(&t);
+  EPOINT pos_sat,pos_subsat;
+  calc_sat_earth_v2(&tm,0,kepler,NULL,&pos_sat,&pos_subsat);
+  return calceleazim_v2(tm,0,&pos_subsat,&pos_sat,refpos,dir);
+}
+
+// angle (degr) between 2 directions
+static double ang_err(DIR *a,DIR *b)
+{
+  double de=(double)a->elev-b->elev,da=(double)a->azim-b->azim;
+  double h=sin(de/2.)*sin(de/2.)+cos((double)a->elev)*cos((double)b->elev)*sin(da/2.)*sin(da/2.);
+  return R2D(2.*asin(sqrt(h)));                   // haversine: exact for small angles
+}
+
+static void bench(KEPLER *k,EPOINT *refpos,int step)
+{
+  int n=AGE_DAYS*86400/step;
+  DIR *dd=(DIR *)malloc(n*sizeof(DIR));
+  DIR *df=(DIR *)malloc(n*sizeof(DIR));
+  time_t t0=(time_t)((k->tle.epoch-J1900-YEAR1970)*86400.);
+  double ns_d,ns_f,tm;
+  double err,max_all=0.,max_vis=0.,sum_vis=0.;
+  double hd,hf,max_h=0.;
+  int i,nvis=0,i_max=0;
+
+  tm=host_ns();
+  for (i=0; i<n; i++) calc_sat_d(t0+(time_t)i*step,k,refpos,&dd[i]);
+  ns_d=host_ns()-tm;
+
+  tm=host_ns();
+  for (i=0; i<n; i++) calc_sat_f(t0+(time_t)i*step,k,refpos,&df[i],NULL);
+  ns_f=host_ns()-tm;
+
+  for (i=0; i<n; i++)
+  {
+    err=ang_err(&dd[i],&df[i]);
+    if (err>max_all) { max_all=err; i_max=i; }
+    if (dd[i].elev>0.)
+    {
+      if (err>max_vis) max_vis=err;
+      sum_vis+=err;
+      nvis++;
+    }
+  }
+  // height, every 100th sample
+  for (i=0; i<n; i+=100)
+  {
+    DIR dir;
+    hd=calc_sat_d(t0+(time_t)i*step,k,refpos,&dir);
+    hf=calc_sat_f(t0+(time_t)i*step,k,refpos,&dir,NULL);
+    if (fabs(hd-hf)>max_h) max_h=fabs(hd-hf);
+  }
+
+  printf("%-10s double %9.0f calls/s  float %9.0f calls/s  (x%.1f)\n",
+         k->name,n*1e9/ns_d,n*1e9/ns_f,ns_d/ns_f);
+  printf("%-10s max. error %.4f degr (at day %.2f), above horizon %.4f degr (mean %.5f, %d samples), height %.0f m\n",
+         "",max_all,i_max*step/86400.,max_vis,(nvis? sum_vis/nvis : 0.),nvis,max_h);
+  free(dd);
+  free(df);
+}
+
+// look angles only, 1 s steps
+static void bench_look(EPOINT *refpos)
+{
+  int n=LOOK_N,i;
+  EPOINT pos_sat,pos_subsat;
+  DIR dir;
+  time_t t0=1681115277;
+  struct tm tm;
+  double tm_ns,ns,sum=0.;
+
+  memset(&pos_sat,0,sizeof(pos_sat));
+  pos_sat.x=3000.; pos_sat.y=1000.; pos_sat.z=6000.;         // km
+  tm_ns=host_ns();
+  for (i=0; i<n; i++)
+  {
+    tm=*gmtime(&t0);
+    tm.tm_sec+=i%3600;
+    calceleazim_v2(tm,0,&pos_subsat,&pos_sat,refpos,&dir);
+    sum+=dir.azim;
+  }
+  ns=host_ns()-tm_ns;
+  printf("look angles (double) %9.0f calls/s  (mean azim. %.2f)\n",n*1e9/ns,sum/n);
+}
+
+int main(int argc,char **argv)
+{
+  KEPLER k;
+  EPOINT refpos;
+  int step=10;
+
+  if (argc>1) step=atoi(argv[1]);
+  if (step<=0) step=10;
+  memset(&refpos,0,sizeof(refpos));
+  load_default_refpos(&refpos);
+  printf("SGP4 + look angles, %d days from epoch, step %d s\n",AGE_DAYS,step);
+
+  memset(&k,0,sizeof(k));
+  load_default_kepler(&k);
+  calc_sgp4_const(&k,true);
+  bench(&k,&refpos,step);
+
+  // ISS: low, drag
+  set_kepler(&k,"ISS",123,100.5,0.00031,51.64,210.3,0.0006,40.1,320.0,15.50);
+  bench(&k,&refpos,step);
+
+  // Meteor-M like: sun-synchronous, 820 km
+  set_kepler(&k,"METEOR",123,100.2,0.00005,98.6,60.0,0.0003,120.0,240.0,14.24);
+  bench(&k,&refpos,step);
+
+  // eccentric, still near-earth (period < 225 min): tests Kepler solve
+  set_kepler(&k,"ECC_0.1",123,100.2,0.0001,63.4,80.0,0.10,270.0,10.0,12.0);
+  bench(&k,&refpos,step);
+
+  bench_look(&refpos);
+  return 0;
+}
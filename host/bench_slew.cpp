@@ -0,0 +1,126 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Slew benchmark on the simulated plant: after calibration a series
+ *   of gotopos commands, large (as a west-pass flip) and small, both
+ *   axes at once. Per slew and axis:
+ *     settle: time until the motor side (no backlash) stays within
+ *       SETTLE_DEGR
+ *     overshoot past the target
+ *     peak acceleration and jerk of the motor (from its rate,
+ *       differences over DIFF_MS, above MIN_RATE)
+ *
+ * usage: bench_slew [-v]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "sketch_protos.h"
+
+#define SETTLE_DEGR 0.2          // settled: motor side within this
+#define SETTLE_HOLD 2.0          //   for this time (s)
+#define SLEW_MAX_S 120.          // give up
+#define DIFF_MS 50               // acc./jerk: rate differences over this time
+#define MIN_RATE 1.              // acc./jerk only above this rate (deg/s): a
+                                 //   stepper's rate is coarse at the first steps
+#define LOOP_US 100
+
+extern ROTOR *SAX_rot,*SEY_rot;
+static double offset[2];         // motor - rotor angle after calibration
+
+typedef struct
+{
+  double settle;                 // s, <0: not settled
+  double in_since;
+  double start,over;             // start position, max. past target
+  double v[2],a[2];              // previous rate, acc.
+  double amax,jmax;
+} SLEW_STAT;
+
+static void sample(SLEW_STAT *s,int axis,double t,double target)
+{
+  PLANT_AXIS *p=plant_axis(axis);
+  double e=p->motor_degr-offset[axis]-target,v,a,past;
+  v=p->vel;
+  a=(v-s->v[0])/(DIFF_MS*1e-3);
+  if ((t>DIFF_MS*2e-3) && (fabs(v)>MIN_RATE) && (fabs(s->v[0])>MIN_RATE))
+  {
+    s->amax=MAX(s->amax,fabs(a));
+    s->jmax=MAX(s->jmax,fabs((a-s->a[0])/(DIFF_MS*1e-3)));
+  }
+  s->v[0]=v;
+  s->a[0]=a;
+  past=(target>s->start? e : -e);
+  s->over=MAX(s->over,past);
+  if (fabs(e)>=SETTLE_DEGR) { s->in_since=-1.; s->settle=-1.; }
+  else if (s->in_since<0.) s->in_since=t;
+  if ((s->settle<0.) && (s->in_since>=0.) && (t-s->in_since>=SETTLE_HOLD)) s->settle=s->in_since;
+}
+
+static void slew(float ax,float ey)
+{
+  SLEW_STAT st[2];
+  char cmd[80];
+  uint64_t t0,next;
+  double t=0.;
+  int i;
+
+  memset(st,0,sizeof(st));
+  for (i=0; i<2; i++)
+  {
+    st[i].settle=st[i].in_since=-1.;
+    st[i].start=plant_axis(i)->motor_degr-offset[i];
+  }
+  sprintf(cmd,"gotopos=%.2f,%.2f\n",ax,ey);
+  sim_serial_input(cmd);
+  t0=next=sim_now_us();
+  while (t<SLEW_MAX_S)
+  {
+    loop();
+    sim_advance_us(LOOP_US);
+    if (sim_now_us()<next) continue;
+    next+=DIFF_MS*1000;
+    t=(sim_now_us()-t0)*1e-6;
+    sample(&st[0],PLANT_AX,t,ax);
+    sample(&st[1],PLANT_EY,t,ey);
+    if ((st[0].settle>=0.) && (st[1].settle>=0.)) break;
+  }
+  for (i=0; i<2; i++)
+  {
+    printf("%-3s %7.2f -> %7.2f: ",i? EY_NAME : AX_NAME,st[i].start,i? ey : ax);
+    if (st[i].settle<0.) printf("settle:   none   ");
+    else printf("settle: %6.2f s  ",st[i].settle);
+    printf("over: %5.2f deg  acc.: %6.1f deg/s2  jerk: %7.1f deg/s3\n",
+           st[i].over,st[i].amax,st[i].jmax);
+  }
+}
+
+int main(int argc,char **argv)
+{
+  if ((argc>1) && (!strcmp(argv[1],"-v"))) sim_serial_echo(true);
+  sim_reset();
+  plant_init(37.,120.);
+  setup();
+  printf("calibration: %.1f s   status: %d %d\n",sim_now_us()/1e6,
+         SAX_rot->cal_status,SEY_rot->cal_status);
+  offset[PLANT_AX]=plant_axis(PLANT_AX)->motor_degr-to_degr(SAX_rot);  // stepper plant: no reference
+  offset[PLANT_EY]=plant_axis(PLANT_EY)->motor_degr-to_degr(SEY_rot);
+
+  slew(-80.,-80.);
+  slew(80.,80.);                           // as flip: 160 degr. both axes
+  slew(70.,85.);
+  slew(71.,84.5);
+  return 0;
+}
@@ -0,0 +1,185 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Stepper backend (stepgen.cpp) on the simulated plant: moves of
+ *   several lengths and speeds on rotor AX, only started with moveTo();
+ *   nothing else is called during the move (control task on hold).
+ *   All step edges are timed from the step/direction outputs:
+ *     time of the move against the ideal trapezoid,
+ *     max. deviation from the ideal profile (steps),
+ *     step interval spread at max. speed,
+ *     highest step rate, min. pulse width and direction setup time,
+ *     steps counted by the plant against currentPosition().
+ *
+ * usage: bench_step [-v]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "sketch_protos.h"
+
+#define MOVE_MAX_US 120000000ULL // give up
+
+extern ROTOR *SAX_rot,*SEY_rot;
+extern StepGen stepperAX;
+
+static std::vector<uint64_t> step_t;
+static std::vector<int> step_dir;
+static struct
+{
+  uint64_t t_high,t_dir;
+  uint64_t min_width,min_setup;
+} edges;
+
+// output hook: step and direction edges of AX
+static void log_edge(int pin,int level,uint64_t now_us)
+{
+  if (pin==PIN_ROTDIR_AX) edges.t_dir=now_us;
+  if (pin!=PIN_ROTPWM_AX) return;
+  if (level)
+  {
+    step_t.push_back(now_us);
+    step_dir.push_back(sim_get_output(PIN_ROTDIR_AX)? 1 : -1);
+    if ((edges.t_dir) && (now_us-edges.t_dir<edges.min_setup)) edges.min_setup=now_us-edges.t_dir;
+    edges.t_high=now_us;
+  }
+  else if (now_us-edges.t_high<edges.min_width)
+  {
+    edges.min_width=now_us-edges.t_high;
+  }
+}
+
+// ideal trapezoid from rest: position (steps) at t (s)
+static double ideal_pos(double t,long n,double v,double a)
+{
+  double ta=v/a,tc,tt;
+  if (n<v*ta)                              // triangle: max. speed not reached
+  {
+    ta=sqrt(n/a);
+    v=a*ta;
+  }
+  tc=(n-v*ta)/v;                           // cruise
+  tt=2*ta+tc;
+  if (t<=0.) return 0.;
+  if (t<ta) return 0.5*a*t*t;
+  if (t<ta+tc) return 0.5*a*ta*ta+v*(t-ta);
+  if (t<tt) return n-0.5*a*(tt-t)*(tt-t);
+  return n;
+}
+
+static double ideal_time(long n,double v,double a)
+{
+  if (n<v*v/a) return 2*sqrt(n/a);
+  return n/v+v/a;
+}
+
+/*********************************************************************
+ * Move AX 'n' steps from rest; only moveTo(), then wait.
+ *********************************************************************/
+static void move(long n,float vmax,float acc)
+{
+  long pos0=stepperAX.currentPosition();
+  long pls0=plant_axis(PLANT_AX)->nr_pulses;
+  uint64_t t0;
+  double t,dev,maxdev=0.,vcap,sum=0.,sum2=0.,imin=1e9,ideal;
+  long i,nc=0;
+
+  step_t.clear();
+  step_dir.clear();
+  stepperAX.setMaxSpeed(vmax);
+  stepperAX.setAcceleration(acc);
+  t0=sim_now_us();
+  stepperAX.moveTo(pos0+n);
+  while ((stepperAX.run()) && (sim_now_us()-t0<MOVE_MAX_US)) sim_advance_us(1000);
+
+  vcap=MIN(vmax,1e6/(2*STEPGEN_TICK_US));
+  for (i=0; i<(long)step_t.size(); i++)
+  {
+    t=(step_t[i]-t0)*1e-6;
+    dev=fabs((i+1)-ideal_pos(t,labs(n),vcap,acc));
+    if (dev>maxdev) maxdev=dev;
+    if (i)
+    {
+      double iv=(double)(step_t[i]-step_t[i-1]);
+      if (iv<imin) imin=iv;
+      if (fabs(1e6/iv-vcap)<0.02*vcap)     // at max. speed
+      {
+        sum+=iv;
+        sum2+=iv*iv;
+        nc++;
+      }
+    }
+  }
+  ideal=ideal_time(labs(n),vcap,acc);
+  printf("%7ld steps %6.0f/s %7.0f/s2: %7.3f s (ideal %7.3f)  dev %5.2f steps  ",
+         n,vmax,acc,step_t.size()? (step_t.back()-t0)*1e-6 : 0.,ideal,maxdev);
+  if (nc>1)
+    printf("max.speed: interval %.2f +/- %.2f us  ",sum/nc,sqrt(MAX(sum2/nc-(sum/nc)*(sum/nc),0.)));
+  printf("peak %5.0f/s  ",1e6/imin);
+  printf("pos %s, plant %s\n",
+         (stepperAX.currentPosition()==pos0+n? "ok" : "WRONG"),
+         (plant_axis(PLANT_AX)->nr_pulses-pls0==labs(n)? "ok" : "WRONG"));
+}
+
+/*********************************************************************
+ * Reverse while running: new target behind; ramp down, turn, back.
+ *********************************************************************/
+static void reverse(long n,float vmax,float acc)
+{
+  long pos0=stepperAX.currentPosition();
+  uint64_t t0;
+  long i,fwd=0,bwd=0;
+
+  step_t.clear();
+  step_dir.clear();
+  stepperAX.setMaxSpeed(vmax);
+  stepperAX.setAcceleration(acc);
+  stepperAX.moveTo(pos0+n);
+  sim_advance_us((uint64_t)(1e6*vmax/acc));  // at max. speed
+  stepperAX.moveTo(pos0-n);
+  t0=sim_now_us();
+  while ((stepperAX.run()) && (sim_now_us()-t0<MOVE_MAX_US)) sim_advance_us(1000);
+  for (i=0; i<(long)step_dir.size(); i++) if (step_dir[i]>0) fwd++; else bwd++;
+  printf("reverse at %.0f/s: %ld steps fwd, %ld back, pos %s\n",vmax,fwd,bwd,
+         (stepperAX.currentPosition()==pos0-n? "ok" : "WRONG"));
+}
+
+int main(int argc,char **argv)
+{
+  if ((argc>1) && (!strcmp(argv[1],"-v"))) sim_serial_echo(true);
+  sim_reset();
+  plant_init(37.,120.);
+  setup();
+  printf("calibration: %.1f s   status: %d %d\n",sim_now_us()/1e6,
+         SAX_rot->cal_status,SEY_rot->cal_status);
+  control_hold(true);                      // nothing but the timer moves AX
+  sim_add_output_hook(log_edge);
+  edges.min_width=edges.min_setup=~0ULL;
+
+  printf("step timer: %d us, profile %d us: max. %d steps/s\n",
+         STEPGEN_TICK_US,STEPGEN_PROFILE_US,1000000/(2*STEPGEN_TICK_US));
+  move(3600,AX_MotorSpeed,AX_MotorAccel);  // 360 degr., spec. speeds
+  move(-10,AX_MotorSpeed,AX_MotorAccel);
+  move(20000,5000,20000);
+  move(-2000,5000,20000);
+  move(100000,1e6,100000);                 // above max. rate
+  reverse(5000,2000,10000);
+  printf("min. step pulse width %llu us, min. direction setup %llu us\n",
+         (unsigned long long)edges.min_width,(unsigned long long)edges.min_setup);
+  printf("steps: %lu, peak rate %.0f steps/s\n",stepperAX.nr_steps,
+         stepperAX.max_inc/(STEPGEN_TICK_US*1e-6*4294967296.));
+  return 0;
+}
@@ -0,0 +1,187 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Two-line elements through the 'tle=' command (parse_elements(),
+ *   select_ephemeris(), SGP4/SDP4):
+ *   - test cases of Spacetrack Report #3 (88888: SGP4, 11801: SDP4)
+ *     against the positions of the report, 0...1440 min
+ *   - a wrong checksum is refused
+ *   - Molniya (12 h resonance) and geostationary (24 h) elements:
+ *     radius range over 10 days, next pass (a GEO one doesn't set)
+ *   - cost: SGP4() and SDP4() calls/s, SDP4 10 days from epoch
+ *   The report's elements have no valid checksums; they are set here.
+ *
+ * usage: bench_tle
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <ctype.h>
+#include "Arduino.h"
+#include "sketch_protos.h"
+#include "linebuf.h"
+
+extern COMMANDS command;
+extern KEPLER kepler;
+extern EPOINT refpos;
+
+#define NCALL 200000
+
+typedef struct
+{
+  const char *name,*line1,*line2;
+  double pos[5][3];              // km at 0, 360, 720, 1080, 1440 min
+} STR3_CASE;
+
+static const STR3_CASE str3[]=
+{
+  { "STR3 88888",
+    "1 88888U          80275.98708465  .00073094  13844-3  66816-4 0    87",
+    "2 88888  72.8435 115.9689 0086731  52.6988 110.5714 16.05824518  1058",
+    { {  2328.97048951, -5995.22076416,  1719.97067261 },
+      {  2456.10705566, -6071.93853760,  1222.89727783 },
+      {  2567.56195068, -6112.50384522,   713.96397400 },
+      {  2663.09078980, -6115.48229980,   196.39640427 },
+      {  2742.55133057, -6079.67144775,  -328.86087419 } } },
+  { "STR3 11801",
+    "1 11801U          80230.29629788  .01431103  00000-0  14311-1 0    13",
+    "2 11801  46.7916 230.4354 7318036  47.4722  10.4117  2.28537848    13",
+    { {  7473.37066650,   428.95261765,  5828.74786377 },
+      { -3305.22537232, 32410.86328125,-24697.17675781 },
+      { 14271.28759766, 24110.46411133, -4725.76837158 },
+      { -9990.05883789, 22717.35522461,-23616.89066315 },
+      {  9787.86975097, 33753.34667969,-15030.81176758 } } }
+};
+
+// made up, epoch 2023 day 100; GEO at 10 degr. east
+#define MOLNIYA_1 "1 99901U 23001A   23100.50000000  .00000000  00000-0  00000-0 0    10"
+#define MOLNIYA_2 "2 99901  63.4000 120.0000 7200000 270.0000  10.0000  2.00600000    10"
+#define GEO_1     "1 99902U 23001B   23100.50000000  .00000000  00000-0  00000-0 0    10"
+#define GEO_2     "2 99902   0.0500  90.0000 0002000 270.0000  28.5000  1.00271000    10"
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+// copy of 'line' with checksum set
+static void set_checksum(char *dst,const char *line)
+{
+  int i,sum=0;
+  strcpy(dst,line);
+  for (i=0; i<68; i++)
+  {
+    if (isdigit(dst[i])) sum+=dst[i]-'0';
+    if (dst[i]=='-') sum++;
+  }
+  dst[68]='0'+sum%10;
+}
+
+// tle=<name>,<line1>,<line2> as from the PC; return: status of load_tle()
+static int tle_cmd(const char *name,const char *l1,const char *l2,boolean fix)
+{
+  char cmd[200],c1[80],c2[80];
+  if (fix)
+  {
+    set_checksum(c1,l1);
+    set_checksum(c2,l2);
+  }
+  else
+  {
+    strcpy(c1,l1);
+    strcpy(c2,l2);
+  }
+  sprintf(cmd,"tle=%s,%s,%s",name,c1,c2);
+  if (strlen(cmd)+1>LINEBUF_SIZE) printf("  line too long: %d\n",(int)strlen(cmd));
+  if (!parse_cmd(cmd)) return -100;
+  return command.tle_status;
+}
+
+static void check_str3(const STR3_CASE *c)
+{
+  double pos[3],vel[3],d,dmax=0.;
+  int i,j,st;
+  st=tle_cmd(c->name,c->line1,c->line2,true);
+  printf("%-10s status %d, %s:",c->name,st,(kepler.deep? "SDP4" : "SGP4"));
+  for (i=0; i<5; i++)
+  {
+    sat_posn(i*360.,&kepler,pos,vel);
+    for (d=0.,j=0; j<3; j++) d+=(pos[j]-c->pos[i][j])*(pos[j]-c->pos[i][j]);
+    d=sqrt(d);
+    printf(" %.3f",d);
+    if (d>dmax) dmax=d;
+  }
+  printf(" km (t=0...1440 min)\n");
+}
+
+// radius range over 'days' and next pass from epoch
+static void check_orbit(const char *name,const char *l1,const char *l2,double days)
+{
+  double pos[3],r,rmin=1e30,rmax=0.,t0;
+  PASS pass;
+  int i,n=(int)(days*1440.),st;
+  st=tle_cmd(name,l1,l2,true);
+  printf("%-10s status %d, %s: ",name,st,(kepler.deep? "SDP4" : "SGP4"));
+  for (i=0; i<=n; i+=10)
+  {
+    sat_posn(i,&kepler,pos,NULL);
+    r=sqrt(pos[0]*pos[0]+pos[1]*pos[1]+pos[2]*pos[2]);
+    if (r<rmin) rmin=r;
+    if (r>rmax) rmax=r;
+  }
+  printf("r %.0f...%.0f km in %.0f days",rmin,rmax,days);
+  t0=(kepler.tle.epoch-J1900-YEAR1970)*86400.;
+  if (find_next_pass(&kepler,&refpos,t0,t0+2*86400.,&pass))
+    printf(", pass %.0f...%.0f s from epoch, max. elev %.1f\n",
+           pass.aos-t0,pass.los-t0,pass.max_elev);
+  else
+    printf(", no pass in 2 days\n");
+}
+
+static void bench(const char *name,double tsince)
+{
+  double pos[3],vel[3],tm;
+  int i;
+  tm=host_ns();
+  for (i=0; i<NCALL; i++) sat_posn(tsince+i*1e-3,&kepler,pos,vel);
+  tm=host_ns()-tm;
+  printf("%-10s %s t=%5.0f min: %9.0f calls/s\n",name,(kepler.deep? "SDP4()" : "SGP4()"),
+         tsince,NCALL*1e9/tm);
+}
+
+int main(int argc,char **argv)
+{
+  char l1[80];
+  load_default_refpos(&refpos);
+  check_str3(&str3[0]);
+  check_str3(&str3[1]);
+
+  set_checksum(l1,str3[0].line1);
+  l1[68]=(l1[68]=='9'? '0' : l1[68]+1);
+  printf("wrong checksum line 1: status %d (1 expected)\n",tle_cmd("bad",l1,str3[0].line2,false));
+
+  check_orbit("Molniya",MOLNIYA_1,MOLNIYA_2,10.);
+  check_orbit("GEO",GEO_1,GEO_2,10.);
+
+  tle_cmd("STR3 88888",str3[0].line1,str3[0].line2,true);
+  bench("STR3 88888",0.);
+  tle_cmd("STR3 11801",str3[1].line1,str3[1].line2,true);
+  bench("STR3 11801",0.);
+  bench("STR3 11801",14400.);
+  tle_cmd("GEO",GEO_1,GEO_2,true);
+  bench("GEO",14400.);
+  return 0;
+}
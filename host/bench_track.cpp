@@ -0,0 +1,196 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Closed-loop tracking benchmark on the simulated plant.
+ *   Calibrates, then tracks the highest NOAA-19 pass (default keplers)
+ *   within 24 h and reports per axis:
+ *     lock: time from AOS until the error stays < LOCK_DEGR for LOCK_HOLD s
+ *     rms, peak: pointing error of the dish after lock
+ *   The reference is the exact (sub-second) satellite direction.
+ *
+ * usage: bench_track [-l loop_us] [-c command]... [-t] [-v]
+ *   loop_us: extra virtual time per loop() (WiFi, serial, ...), default 100
+ *   command: sent after calibration, e.g. -c ctrl_pid=0 for the ramp
+ *   -t: trace target, dish and rotor angles each second
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "sketch_protos.h"
+
+#define LOCK_DEGR 1.0            // error for lock
+#define LOCK_HOLD 5.0            // s within LOCK_DEGR needed for lock
+#define SAMPLE_US 100000         // error sample interval
+
+extern ROTOR *SAX_rot,*SEY_rot;
+extern COMMANDS command;
+extern KEPLER kepler;
+extern EPOINT refpos;
+
+typedef struct
+{
+  double lock;                   // s after AOS, <0: no lock
+  double in_since;               // start of current run within LOCK_DEGR
+  double sum,sum2;               // bias, rms
+  double peak;
+  long n;
+} AXIS_STAT;
+
+// satellite direction in rotor coordinates (as calc_pos(), but exact time)
+static float sat_target(time_t t,int ms,float *ax,float *ey)
+{
+  struct tm tm=*gmtime(&t);
+  DIR dir;
+  EPOINT pos_sat,pos_subsat;
+  calc_sat_earth_v2(&tm,ms,&kepler,NULL,&pos_sat,&pos_subsat);
+  calceleazim_v2(tm,ms,&pos_subsat,&pos_sat,&refpos,&dir);
+  elevazim2xy(&dir,NULL);
+  #if ROTORTYPE == ROTORTYPE_XY
+    *ax=R2D(dir.x);
+    *ey=R2D(dir.y);
+  #else
+    *ax=R2D(dir.azim);
+    *ey=R2D(dir.elev);
+  #endif
+  return R2D(dir.elev);
+}
+
+// highest pass in [t0,t0+24h>, 30 s scan then 1 s refine
+static float find_pass(time_t t0,time_t *aos,time_t *los)
+{
+  time_t t,ta=0;
+  float ax,ey,el,maxel=-90.,pmax=-90.;
+  boolean up=false;
+  for (t=t0; t<t0+86400; t+=30)
+  {
+    el=sat_target(t,0,&ax,&ey);
+    if ((el>0.) && (!up)) { ta=t; pmax=el; up=true; }
+    if (up) pmax=MAX(pmax,el);
+    if ((el<=0.) && (up))
+    {
+      up=false;
+      if (pmax>maxel)
+      {
+        maxel=pmax;
+        for (*aos=ta-30; sat_target(*aos,0,&ax,&ey)<=0.; (*aos)++);
+        for (*los=t-30; sat_target(*los,0,&ax,&ey)>0.; (*los)++);
+      }
+    }
+  }
+  return maxel;
+}
+
+static void sample(AXIS_STAT *s,double t,float err)
+{
+  float serr=err;
+  err=fabs(err);
+  if (err>=LOCK_DEGR) s->in_since=-1.;
+  else if (s->in_since<0.) s->in_since=t;
+  if ((s->lock<0.) && (s->in_since>=0.) && (t-s->in_since>=LOCK_HOLD)) s->lock=s->in_since;
+  if (s->lock<0.) return;
+  s->sum+=serr;
+  s->sum2+=err*err;
+  s->peak=MAX(s->peak,err);
+  s->n++;
+}
+
+static void report(const char *name,AXIS_STAT *s)
+{
+  if (s->lock<0.)
+    printf("%-3s lock:   none\n",name);
+  else
+    printf("%-3s lock: %6.1f s   rms: %6.3f deg   peak: %6.3f deg   bias: %6.3f deg\n",
+           name,s->lock,sqrt(s->sum2/(s->n? s->n : 1)),s->peak,s->sum/(s->n? s->n : 1));
+}
+
+int main(int argc,char **argv)
+{
+  int loop_us=100;
+  boolean trace=false;
+  int i;
+  std::string cmds;
+  time_t aos,los,t;
+  float maxel;
+  uint64_t tstart,nsample;
+  AXIS_STAT st[2];
+  struct timespec h0,h1;
+
+  for (i=1; i<argc; i++)
+  {
+    if (!strcmp(argv[i],"-v")) sim_serial_echo(true);
+    if (!strcmp(argv[i],"-t")) trace=true;
+    if ((!strcmp(argv[i],"-l")) && (i+1<argc)) loop_us=atoi(argv[++i]);
+    if ((!strcmp(argv[i],"-c")) && (i+1<argc)) { cmds+=argv[++i]; cmds+="\n"; }
+  }
+
+  sim_reset();
+  plant_init(37.,120.);
+  setup();
+  printf("calibration: %.1f s   status: %d %d\n",sim_now_us()/1e6,
+         SAX_rot->cal_status,SEY_rot->cal_status);
+
+  time(&t);
+  maxel=find_pass(t,&aos,&los);
+  if (maxel<0.)
+  {
+    printf("no pass found\n");
+    return 1;
+  }
+  printf("pass: AOS %s",ctime(&aos));
+  printf("      LOS %s",ctime(&los));
+  printf("      max. elevation %.1f deg, %ld s\n",maxel,(long)(los-aos));
+
+  // start 2 minutes before AOS
+  sim_set_epoch(aos-120);
+  cmds+="run_calc=1\n";
+  sim_serial_input(cmds.c_str());
+
+  memset(st,0,sizeof(st));
+  st[0].lock=st[1].lock=-1.;
+  st[0].in_since=st[1].in_since=-1.;
+  tstart=sim_now_us();
+  nsample=0;
+  clock_gettime(CLOCK_MONOTONIC,&h0);
+  while ((t=time(NULL)) < los)
+  {
+    loop();
+    sim_advance_us(loop_us);
+    if ((sim_now_us()-tstart)/SAMPLE_US > nsample)
+    {
+      struct timeval tv;
+      float ax,ey;
+      double ts;
+      nsample=(sim_now_us()-tstart)/SAMPLE_US;
+      gettimeofday(&tv,NULL);
+      if (tv.tv_sec<aos) continue;
+      if (sat_target(tv.tv_sec,tv.tv_usec/1000,&ax,&ey)<=0.) continue;  // LOS
+      ts=(tv.tv_sec-aos)+tv.tv_usec*1e-6;
+      sample(&st[0],ts,plant_axis(PLANT_AX)->dish_degr-ax);
+      sample(&st[1],ts,plant_axis(PLANT_EY)->dish_degr-ey);
+      if ((trace) && (nsample%(1000000/SAMPLE_US)==0))
+        printf("%6.1f  %s %7.2f %7.2f %7.2f  %s %7.2f %7.2f %7.2f\n",ts,
+               AX_NAME,ax,plant_axis(PLANT_AX)->dish_degr,SAX_rot->degr,
+               EY_NAME,ey,plant_axis(PLANT_EY)->dish_degr,SEY_rot->degr);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC,&h1);
+
+  report(AX_NAME,&st[0]);
+  report(EY_NAME,&st[1]);
+  printf("host time: %.2f s\n",(h1.tv_sec-h0.tv_sec)+(h1.tv_nsec-h0.tv_nsec)*1e-9);
+  return 0;
+}
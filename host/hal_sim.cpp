@@ -0,0 +1,1001 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Simulated hardware for host builds: Arduino core, WiFi and the
+ *   C library time functions on a virtual clock.
+ *   time(), gettimeofday() and settimeofday() are replaced at link
+ *   time (-Wl,--wrap=...), so the unchanged sketch sees virtual time.
+ *
+ * public functions: see hal_sim.h, Arduino.h, WiFi.h, Preferences.h
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include <string>
+#include <map>
+#include <ucontext.h>
+#include "Arduino.h"
+#include "WiFi.h"
+#include "Preferences.h"
+#include "esp_timer.h"
+#include "hal_sim.h"
+
+#define SIM_NRHOOKS 8
+#define SIM_NRCHAN 16
+#define SIM_EPOCH 1681084800      // 2023-04-10 00:00:00 UTC, near default keplers
+#define SIM_NRTASKS 8
+#define SIM_NRTIMERS 8
+#define SIM_NRHWTIMERS 4
+#define SIM_TASK_STACK (256*1024)
+#define SIM_NEVER UINT64_MAX
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+EspClass ESP;
+
+static struct
+{
+  uint64_t now_us;                // virtual clock
+  unsigned int call_cost;         // us per millis()/micros() call
+  time_t epoch;                   // unix time at now_us=0
+  SIM_TICK_HOOK hook[SIM_NRHOOKS];
+  int nrhooks;
+  boolean in_hook;
+  boolean in_dispatch;            // running timers/tasks
+  uint64_t hook_us;               // time of event in hook (ISR), see micros()
+} clk={0,2,SIM_EPOCH};
+
+typedef struct sim_task
+{
+  boolean used;
+  boolean done;
+  ucontext_t ctx;
+  void *stack;
+  TaskFunction_t fn;
+  void *arg;
+  UBaseType_t prio;
+  uint32_t notify;                // notification count
+  boolean wait_notify;            // blocked in ulTaskNotifyTake()
+  uint64_t wake_us;               // runnable from this time
+} SIM_TASK;
+
+struct esp_timer
+{
+  boolean used;
+  boolean active;
+  uint64_t due;
+  uint64_t period;                // 0: one-shot
+  esp_timer_cb_t cb;
+  void *arg;
+};
+
+// Arduino ESP32 hardware timer, on top of esp_timer
+struct hw_timer_s
+{
+  boolean used;
+  esp_timer_handle_t tm;
+  void (*isr)(void);
+  uint16_t divider;               // of 80 MHz
+  uint64_t alarm;                 // counts
+  boolean reload;
+};
+
+static SIM_TASK tasks[SIM_NRTASKS];
+static struct esp_timer timers[SIM_NRTIMERS];
+static struct hw_timer_s hw_timers[SIM_NRHWTIMERS];
+static int cur_task=-1;           // running task, -1: main (loopTask)
+static ucontext_t main_ctx;
+
+static struct
+{
+  int mode[SIM_NRPINS];
+  int out[SIM_NRPINS];
+  int in[SIM_NRPINS];
+  void (*isr[SIM_NRPINS])(void);
+  int isr_mode[SIM_NRPINS];
+  SIM_OUTPUT_HOOK out_hook[SIM_NRHOOKS];
+  int nr_out_hooks;
+  int chan_pin[SIM_NRCHAN];
+  boolean chan_used[SIM_NRCHAN];
+  uint32_t chan_duty[SIM_NRCHAN];
+} gpio;
+
+typedef struct sim_conn
+{
+  boolean used;
+  boolean pending;                // waiting to be accepted by server
+  boolean open;
+  std::string rx;                 // to controller
+  std::string tx;                 // from controller
+} SIM_CONN;
+
+static SIM_CONN conns[SIM_NRCONN];
+static std::string ser_rx,ser_tx;
+static boolean ser_echo;
+static wl_status_t wifi_status=WL_DISCONNECTED;
+
+// NVS: "namespace/key" -> blob; not cleared by sim_reset() (flash)
+static std::map<std::string,std::string> nvs;
+static std::string nvs_path;      // file copy, empty: memory only
+static unsigned long nvs_writes;
+
+/*********************************************************************
+ * virtual clock
+ *********************************************************************/
+void sim_reset(void)
+{
+  int i;
+  clk.now_us=0;
+  clk.call_cost=2;
+  clk.epoch=SIM_EPOCH;
+  clk.nrhooks=0;
+  for (i=0; i<SIM_NRTASKS; i++)
+  {
+    free(tasks[i].stack);
+    tasks[i]=SIM_TASK();
+  }
+  memset(timers,0,sizeof(timers));
+  memset(hw_timers,0,sizeof(hw_timers));
+  memset(&gpio,0,sizeof(gpio));
+  for (i=0; i<SIM_NRCONN; i++) conns[i]=SIM_CONN();
+  ser_rx.clear();
+  ser_tx.clear();
+  wifi_status=WL_DISCONNECTED;
+}
+
+uint64_t sim_now_us(void)
+{
+  return clk.now_us;
+}
+
+// set clock and run tick hooks
+static void set_now(uint64_t t)
+{
+  int i;
+  if (t>clk.now_us) clk.now_us=t;
+  if (clk.in_hook) return;        // hooks don't advance time themselves
+  clk.in_hook=true;
+  for (i=0; i<clk.nrhooks; i++) clk.hook[i](clk.now_us);
+  clk.in_hook=false;
+  clk.hook_us=0;
+}
+
+static boolean task_runnable(SIM_TASK *t)
+{
+  if ((!t->used) || (t->done)) return false;
+  if ((t->wait_notify) && (t->notify)) return true;
+  return (t->wake_us<=clk.now_us);
+}
+
+// earliest time a timer or task is due
+static uint64_t next_event(void)
+{
+  uint64_t next=SIM_NEVER;
+  int i;
+  for (i=0; i<SIM_NRTIMERS; i++)
+    if ((timers[i].active) && (timers[i].due<next)) next=timers[i].due;
+  for (i=0; i<SIM_NRTASKS; i++)
+  {
+    if ((!tasks[i].used) || (tasks[i].done)) continue;
+    if (task_runnable(&tasks[i])) return clk.now_us;
+    if (tasks[i].wake_us<next) next=tasks[i].wake_us;
+  }
+  return next;
+}
+
+// fire due timers, then run runnable tasks (highest prio. first) until they block
+static void dispatch(void)
+{
+  int i,best;
+  for (i=0; i<SIM_NRTIMERS; i++)
+  {
+    struct esp_timer *tm=&timers[i];
+    while ((tm->active) && (tm->due<=clk.now_us))
+    {
+      if (tm->period) tm->due+=tm->period; else tm->active=false;
+      tm->cb(tm->arg);
+    }
+  }
+  for (;;)
+  {
+    best=-1;
+    for (i=0; i<SIM_NRTASKS; i++)
+      if ((task_runnable(&tasks[i])) && ((best<0) || (tasks[i].prio>tasks[best].prio))) best=i;
+    if (best<0) break;
+    cur_task=best;
+    swapcontext(&main_ctx,&tasks[best].ctx);
+    cur_task=-1;
+  }
+}
+
+void sim_advance_us(uint64_t us)
+{
+  uint64_t target=clk.now_us+us;
+  uint64_t next;
+  if ((cur_task<0) && (!clk.in_dispatch) && (!clk.in_hook))
+  {
+    // main context: step through all events up to 'target'
+    clk.in_dispatch=true;
+    for (;;)
+    {
+      dispatch();
+      next=next_event();
+      if ((next>target) || (next<=clk.now_us)) break;
+      set_now(next);
+    }
+    clk.in_dispatch=false;
+  }
+  set_now(target);
+}
+
+void sim_set_call_cost_us(unsigned int us)
+{
+  clk.call_cost=us;
+}
+
+void sim_set_epoch(time_t t)
+{
+  clk.epoch=t-(time_t)(clk.now_us/1000000);
+}
+
+int sim_add_tick_hook(SIM_TICK_HOOK hook)
+{
+  if (clk.nrhooks>=SIM_NRHOOKS) return 0;
+  clk.hook[clk.nrhooks++]=hook;
+  return 1;
+}
+
+// time of the simulated event in a tick hook, e.g. a pulse: returned by
+// micros() in an ISR called from the hook (hooks lag up to 1 event)
+void sim_set_hook_time(uint64_t t)
+{
+  clk.hook_us=t;
+}
+
+unsigned long micros(void)
+{
+  if ((clk.in_hook) && (clk.hook_us)) return (unsigned long)clk.hook_us;
+  sim_advance_us(clk.call_cost);
+  return (unsigned long)clk.now_us;
+}
+
+unsigned long millis(void)
+{
+  sim_advance_us(clk.call_cost);
+  return (unsigned long)(clk.now_us/1000);
+}
+
+void delay(unsigned long ms)
+{
+  if (cur_task>=0)
+    vTaskDelay(pdMS_TO_TICKS(ms));  // in a task: block
+  else
+    sim_advance_us((uint64_t)ms*1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  sim_advance_us(us);
+}
+
+extern "C" time_t __wrap_time(time_t *t)
+{
+  time_t now=clk.epoch+(time_t)(clk.now_us/1000000);
+  if (t) *t=now;
+  return now;
+}
+
+extern "C" int __wrap_gettimeofday(struct timeval *tv,void *tz)
+{
+  if (tv)
+  {
+    tv->tv_sec=clk.epoch+(time_t)(clk.now_us/1000000);
+    tv->tv_usec=(suseconds_t)(clk.now_us%1000000);
+  }
+  return 0;
+}
+
+extern "C" int __wrap_settimeofday(const struct timeval *tv,const void *tz)
+{
+  if (tv) sim_set_epoch(tv->tv_sec);
+  return 0;
+}
+
+void configTime(long gmtoffset,int dstoffset,const char *server)
+{
+}
+
+bool getLocalTime(struct tm *info,uint32_t ms)
+{
+  time_t t=__wrap_time(NULL);
+  *info=*gmtime(&t);
+  return true;
+}
+
+/*********************************************************************
+ * FreeRTOS tasks and esp_timer
+ *********************************************************************/
+static void task_entry(void)
+{
+  SIM_TASK *t=&tasks[cur_task];
+  t->fn(t->arg);
+  t->done=true;                   // task returned: never run again
+}
+
+// switch back to main context until runnable again
+static void task_block(void)
+{
+  SIM_TASK *t=&tasks[cur_task];
+  swapcontext(&t->ctx,&main_ctx);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn,const char *name,uint32_t stack,
+                                   void *arg,UBaseType_t prio,TaskHandle_t *task,BaseType_t core)
+{
+  int i;
+  SIM_TASK *t;
+  for (i=0; i<SIM_NRTASKS; i++) if (!tasks[i].used) break;
+  if (i>=SIM_NRTASKS) return pdFALSE;
+  t=&tasks[i];
+  *t=SIM_TASK();
+  t->used=true;
+  t->fn=fn;
+  t->arg=arg;
+  t->prio=prio;
+  t->wake_us=clk.now_us;
+  t->stack=malloc(SIM_TASK_STACK);
+  getcontext(&t->ctx);
+  t->ctx.uc_stack.ss_sp=t->stack;
+  t->ctx.uc_stack.ss_size=SIM_TASK_STACK;
+  t->ctx.uc_link=&main_ctx;
+  makecontext(&t->ctx,task_entry,0);
+  if (task) *task=(TaskHandle_t)t;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  if (cur_task<0) { delay(ticks*portTICK_PERIOD_MS); return; }
+  tasks[cur_task].wait_notify=false;
+  tasks[cur_task].wake_us=clk.now_us+(uint64_t)ticks*portTICK_PERIOD_MS*1000;
+  task_block();
+}
+
+void vTaskDelayUntil(TickType_t *prev,TickType_t inc)
+{
+  uint64_t wake;
+  *prev+=inc;
+  wake=(uint64_t)*prev*portTICK_PERIOD_MS*1000;
+  if (wake<=clk.now_us) return;
+  vTaskDelay((TickType_t)((wake-clk.now_us+999)/1000/portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(clk.now_us/1000/portTICK_PERIOD_MS);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear,TickType_t ticks)
+{
+  SIM_TASK *t;
+  uint32_t n;
+  if (cur_task<0) return 0;
+  t=&tasks[cur_task];
+  if (!t->notify)
+  {
+    t->wait_notify=true;
+    t->wake_us=(ticks==portMAX_DELAY? SIM_NEVER : clk.now_us+(uint64_t)ticks*portTICK_PERIOD_MS*1000);
+    task_block();
+    t->wait_notify=false;
+  }
+  n=t->notify;
+  if (clear) t->notify=0; else if (t->notify) t->notify--;
+  return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  if (task) ((SIM_TASK *)task)->notify++;
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task,BaseType_t *woken)
+{
+  xTaskNotifyGive(task);
+  if (woken) *woken=pdTRUE;
+}
+
+int uxTaskGetStackHighWaterMark(void *task)
+{
+  return 0;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,esp_timer_handle_t *handle)
+{
+  int i;
+  for (i=0; i<SIM_NRTIMERS; i++) if (!timers[i].used) break;
+  if (i>=SIM_NRTIMERS) return ESP_FAIL;
+  memset(&timers[i],0,sizeof(timers[i]));
+  timers[i].used=true;
+  timers[i].cb=args->callback;
+  timers[i].arg=args->arg;
+  *handle=&timers[i];
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,uint64_t period)
+{
+  if ((!timer) || (!period)) return ESP_FAIL;
+  timer->period=period;
+  timer->due=clk.now_us+period;
+  timer->active=true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer,uint64_t timeout)
+{
+  if (!timer) return ESP_FAIL;
+  timer->period=0;
+  timer->due=clk.now_us+timeout;
+  timer->active=true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  if (!timer) return ESP_FAIL;
+  timer->active=false;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void)
+{
+  return (int64_t)micros();
+}
+
+static void hw_timer_cb(void *arg)
+{
+  hw_timer_t *t=(hw_timer_t *)arg;
+  if (t->isr) t->isr();
+}
+
+hw_timer_t *timerBegin(uint8_t num,uint16_t divider,bool countUp)
+{
+  esp_timer_create_args_t args={hw_timer_cb};
+  hw_timer_t *t;
+  if (num>=SIM_NRHWTIMERS) return NULL;
+  t=&hw_timers[num];
+  if (!t->used)
+  {
+    args.arg=t;
+    if (esp_timer_create(&args,&t->tm)!=ESP_OK) return NULL;
+    t->used=true;
+  }
+  t->divider=(divider? divider : 1);
+  return t;
+}
+
+void timerAttachInterrupt(hw_timer_t *t,void (*isr)(void),bool edge)
+{
+  if (t) t->isr=isr;
+}
+
+void timerAlarmWrite(hw_timer_t *t,uint64_t alarm,bool autoreload)
+{
+  if (!t) return;
+  t->alarm=alarm;
+  t->reload=autoreload;
+}
+
+// period in whole us (the virtual clock resolution)
+void timerAlarmEnable(hw_timer_t *t)
+{
+  uint64_t us;
+  if (!t) return;
+  us=t->alarm*t->divider/80;
+  if (!us) us=1;
+  if (t->reload) esp_timer_start_periodic(t->tm,us); else esp_timer_start_once(t->tm,us);
+}
+
+void timerAlarmDisable(hw_timer_t *t)
+{
+  if (t) esp_timer_stop(t->tm);
+}
+
+void EspClass::restart(void)
+{
+  printf("sim: ESP.restart() ignored\n");
+}
+
+/*********************************************************************
+ * GPIO, interrupts and PWM
+ *********************************************************************/
+#define VALID_PIN(p) (((p)>=0) && ((p)<SIM_NRPINS))
+
+void pinMode(int pin,int mode)
+{
+  if (!VALID_PIN(pin)) return;
+  gpio.mode[pin]=mode;
+  if (mode==INPUT_PULLUP) gpio.in[pin]=HIGH;
+}
+
+void digitalWrite(int pin,int val)
+{
+  int i;
+  if (!VALID_PIN(pin)) return;
+  val=(val? HIGH : LOW);
+  if (gpio.out[pin]==val) return;
+  gpio.out[pin]=val;
+  for (i=0; i<gpio.nr_out_hooks; i++) gpio.out_hook[i](pin,val,clk.now_us);
+}
+
+// called on each output change, e.g. step pulses
+int sim_add_output_hook(SIM_OUTPUT_HOOK hook)
+{
+  if (gpio.nr_out_hooks>=SIM_NRHOOKS) return 0;
+  gpio.out_hook[gpio.nr_out_hooks++]=hook;
+  return 1;
+}
+
+int digitalRead(int pin)
+{
+  if (!VALID_PIN(pin)) return LOW;
+  if (gpio.mode[pin]==OUTPUT) return gpio.out[pin];
+  return gpio.in[pin];
+}
+
+void attachInterrupt(int irq,void (*isr)(void),int mode)
+{
+  if (!VALID_PIN(irq)) return;
+  gpio.isr[irq]=isr;
+  gpio.isr_mode[irq]=mode;
+}
+
+void detachInterrupt(int irq)
+{
+  if (!VALID_PIN(irq)) return;
+  gpio.isr[irq]=NULL;
+}
+
+// set input level; fires attached interrupt on matching edge
+void sim_set_input(int pin,int level)
+{
+  int old;
+  if (!VALID_PIN(pin)) return;
+  level=(level? HIGH : LOW);
+  old=gpio.in[pin];
+  gpio.in[pin]=level;
+  if ((old==level) || (!gpio.isr[pin])) return;
+  if ((level)  && (gpio.isr_mode[pin]&RISING))  gpio.isr[pin]();
+  if ((!level) && (gpio.isr_mode[pin]&FALLING)) gpio.isr[pin]();
+}
+
+// edges of an attached interrupt (another pin configuration, for a test)
+void sim_set_irq_mode(int pin,int mode)
+{
+  if (!VALID_PIN(pin)) return;
+  gpio.isr_mode[pin]=mode;
+}
+
+int sim_get_output(int pin)
+{
+  if (!VALID_PIN(pin)) return LOW;
+  return gpio.out[pin];
+}
+
+double ledcSetup(int chan,double freq,int bits)
+{
+  return freq;
+}
+
+void ledcAttachPin(int pin,int chan)
+{
+  if ((chan<0) || (chan>=SIM_NRCHAN)) return;
+  gpio.chan_pin[chan]=pin;
+  gpio.chan_used[chan]=true;
+}
+
+void ledcWrite(int chan,uint32_t duty)
+{
+  if ((chan<0) || (chan>=SIM_NRCHAN)) return;
+  gpio.chan_duty[chan]=duty;
+}
+
+// duty of PWM channel attached to 'pin', -1 if none
+int sim_pwm_duty(int pin)
+{
+  int i;
+  for (i=0; i<SIM_NRCHAN; i++)
+    if ((gpio.chan_used[i]) && (gpio.chan_pin[i]==pin)) return (int)gpio.chan_duty[i];
+  return -1;
+}
+
+char *dtostrf(double val,signed char width,unsigned char prec,char *s)
+{
+  sprintf(s,"%*.*f",width,prec,val);
+  return s;
+}
+
+/*********************************************************************
+ * Serial
+ *********************************************************************/
+void HardwareSerial::begin(unsigned long baud)
+{
+}
+
+int HardwareSerial::available(void)
+{
+  return (int)ser_rx.size();
+}
+
+int HardwareSerial::read(void)
+{
+  int ch;
+  if (ser_rx.empty()) return -1;
+  ch=(unsigned char)ser_rx[0];
+  ser_rx.erase(0,1);
+  return ch;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+  return 128;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf,size_t len)
+{
+  ser_tx.append((const char *)buf,len);
+  if (ser_echo) fwrite(buf,1,len,stdout);
+  return len;
+}
+
+size_t HardwareSerial::print(const char *s)
+{
+  return write((const uint8_t *)s,strlen(s));
+}
+
+size_t HardwareSerial::print(const IPAddress &ip)
+{
+  char str[20];
+  snprintf(str,sizeof(str),"%d.%d.%d.%d",ip.ip[0],ip.ip[1],ip.ip[2],ip.ip[3]);
+  return print(str);
+}
+
+size_t HardwareSerial::println(const char *s)
+{
+  return print(s)+print("\n");
+}
+
+size_t HardwareSerial::println(const IPAddress &ip)
+{
+  return print(ip)+print("\n");
+}
+
+void sim_serial_input(const char *str)
+{
+  ser_rx.append(str);
+}
+
+// get (and clear) serial output; returns nr. of bytes copied
+int sim_serial_output(char *buf,int len)
+{
+  int n=0;
+  if ((buf) && (len>0))
+  {
+    n=(int)ser_tx.copy(buf,len-1);
+    buf[n]=0;
+    ser_tx.erase(0,n);
+  }
+  else
+  {
+    ser_tx.clear();
+  }
+  return n;
+}
+
+void sim_serial_echo(bool echo)
+{
+  ser_echo=echo;
+}
+
+/*********************************************************************
+ * WiFi
+ *********************************************************************/
+wl_status_t WiFiClass::status(void)
+{
+  return wifi_status;
+}
+
+bool WiFiClass::mode(wifi_mode_t m)
+{
+  if (m==WIFI_OFF) wifi_status=WL_DISCONNECTED;
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid,const char *pwd)
+{
+  wifi_status=WL_CONNECTED;
+  return wifi_status;
+}
+
+bool WiFiClass::softAP(const char *ssid,const char *pwd)
+{
+  return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff)
+{
+  wifi_status=WL_DISCONNECTED;
+  return true;
+}
+
+IPAddress WiFiClass::localIP(void)
+{
+  return IPAddress(127,0,0,1);
+}
+
+void WiFiServer::begin(void)
+{
+}
+
+bool WiFiServer::hasClient(void)
+{
+  int i;
+  for (i=0; i<SIM_NRCONN; i++) if (conns[i].pending) return true;
+  return false;
+}
+
+WiFiClient WiFiServer::available(void)
+{
+  int i;
+  for (i=0; i<SIM_NRCONN; i++)
+  {
+    if (conns[i].pending)
+    {
+      conns[i].pending=false;
+      return WiFiClient(i);
+    }
+  }
+  return WiFiClient();
+}
+
+#define CONN(c) (((c)>=0) && ((c)<SIM_NRCONN) && (conns[c].open)? &conns[c] : NULL)
+
+uint8_t WiFiClient::connected(void)
+{
+  SIM_CONN *c=CONN(conn);
+  return (c) && (!c->pending)? 1 : 0;     // slot reused: not before accept
+}
+
+int WiFiClient::available(void)
+{
+  SIM_CONN *c=CONN(conn);
+  return c? (int)c->rx.size() : 0;
+}
+
+int WiFiClient::read(void)
+{
+  uint8_t ch;
+  if (read(&ch,1)<1) return -1;
+  return ch;
+}
+
+int WiFiClient::read(uint8_t *buf,size_t size)
+{
+  SIM_CONN *c=CONN(conn);
+  size_t n;
+  if (!c) return -1;
+  n=c->rx.copy((char *)buf,size);
+  c->rx.erase(0,n);
+  return (int)n;
+}
+
+size_t WiFiClient::write(const uint8_t *buf,size_t size)
+{
+  SIM_CONN *c=CONN(conn);
+  if (!c) return 0;
+  c->tx.append((const char *)buf,size);
+  return size;
+}
+
+int WiFiClient::availableForWrite(void)
+{
+  return CONN(conn)? 1024 : 0;
+}
+
+void WiFiClient::stop(void)
+{
+  SIM_CONN *c=CONN(conn);
+  if (c) c->open=false;
+}
+
+// new connection from 'PC'; returns connection id or -1
+int sim_tcp_connect(void)
+{
+  int i;
+  for (i=0; i<SIM_NRCONN; i++)
+  {
+    if ((!conns[i].used) || (!conns[i].open))
+    {
+      conns[i]=SIM_CONN();
+      conns[i].used=true;
+      conns[i].pending=true;
+      conns[i].open=true;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void sim_tcp_send(int conn,const char *str)
+{
+  SIM_CONN *c=CONN(conn);
+  if (c) c->rx.append(str);
+}
+
+// get (and clear) data sent by controller; returns nr. of bytes copied
+int sim_tcp_recv(int conn,char *buf,int len)
+{
+  SIM_CONN *c=CONN(conn);
+  int n=0;
+  if (!c) return -1;
+  if ((buf) && (len>0))
+  {
+    n=(int)c->tx.copy(buf,len-1);
+    buf[n]=0;
+    c->tx.erase(0,n);
+  }
+  else
+  {
+    c->tx.clear();
+  }
+  return n;
+}
+
+void sim_tcp_close(int conn)
+{
+  SIM_CONN *c=CONN(conn);
+  if (c) c->open=false;
+}
+
+/*********************************************************************
+ * NVS (Preferences)
+ * File: per entry <key len (1 byte)><key><blob len (4 bytes)><blob>
+ *********************************************************************/
+static void nvs_commit(void)
+{
+  FILE *fp;
+  std::map<std::string,std::string>::iterator it;
+  uint32_t n;
+  uint8_t k;
+  nvs_writes++;
+  if (nvs_path.empty()) return;
+  if (!(fp=fopen(nvs_path.c_str(),"wb"))) return;
+  for (it=nvs.begin(); it!=nvs.end(); it++)
+  {
+    k=(uint8_t)it->first.size();
+    n=(uint32_t)it->second.size();
+    fwrite(&k,1,1,fp);
+    fwrite(it->first.data(),1,k,fp);
+    fwrite(&n,4,1,fp);
+    fwrite(it->second.data(),1,n,fp);
+  }
+  fclose(fp);
+}
+
+// keep NVS in file 'path' (loaded now if it exists); NULL: memory only
+void sim_nvs_file(const char *path)
+{
+  FILE *fp;
+  char key[256];
+  uint32_t n;
+  uint8_t k;
+  nvs_path=(path? path : "");
+  if (!path) return;
+  if (!(fp=fopen(path,"rb"))) return;
+  nvs.clear();
+  while ((fread(&k,1,1,fp)==1) && (fread(key,1,k,fp)==k) && (fread(&n,4,1,fp)==1))
+  {
+    std::string v(n,0);
+    if (fread(&v[0],1,n,fp)!=n) break;
+    nvs[std::string(key,k)]=v;
+  }
+  fclose(fp);
+}
+
+// erase all (and the file)
+void sim_nvs_erase(void)
+{
+  nvs.clear();
+  if (!nvs_path.empty()) remove(nvs_path.c_str());
+}
+
+// nr. of writes (put, remove, clear) since start: flash wear
+unsigned long sim_nvs_writes(void)
+{
+  return nvs_writes;
+}
+
+bool Preferences::begin(const char *name,bool readOnly,const char *partition_label)
+{
+  if ((!name) || (strlen(name)>15)) return false;
+  strcpy(ns,name);
+  readonly=readOnly;
+  open=true;
+  return true;
+}
+
+void Preferences::end(void)
+{
+  open=false;
+}
+
+size_t Preferences::putBytes(const char *key,const void *value,size_t len)
+{
+  if ((!open) || (readonly) || (!key) || (strlen(key)>15)) return 0;
+  nvs[std::string(ns)+"/"+key]=std::string((const char *)value,len);
+  nvs_commit();
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+  std::map<std::string,std::string>::iterator it;
+  if ((!open) || (!key)) return 0;
+  it=nvs.find(std::string(ns)+"/"+key);
+  if (it==nvs.end()) return 0;
+  return it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key,void *buf,size_t maxLen)
+{
+  std::map<std::string,std::string>::iterator it;
+  if ((!open) || (!key)) return 0;
+  it=nvs.find(std::string(ns)+"/"+key);
+  if ((it==nvs.end()) || (it->second.size()>maxLen)) return 0;
+  memcpy(buf,it->second.data(),it->second.size());
+  return it->second.size();
+}
+
+bool Preferences::remove(const char *key)
+{
+  if ((!open) || (readonly) || (!key)) return false;
+  if (!nvs.erase(std::string(ns)+"/"+key)) return false;
+  nvs_commit();
+  return true;
+}
+
+bool Preferences::clear(void)
+{
+  std::map<std::string,std::string>::iterator it;
+  std::string pre=std::string(ns)+"/";
+  if ((!open) || (readonly)) return false;
+  for (it=nvs.begin(); it!=nvs.end(); )
+  {
+    if (it->first.compare(0,pre.size(),pre)==0) nvs.erase(it++); else it++;
+  }
+  nvs_commit();
+  return true;
+}
@@ -0,0 +1,83 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   control of the simulated hardware for host builds:
+ *     virtual clock, GPIO, PWM, pulse interrupts, serial, TCP and NVS
+ *
+ * Virtual clock:
+ *   All Arduino time functions (millis(), micros(), delay()) and the
+ *   C library time functions (time(), gettimeofday()) read the virtual
+ *   clock. Each call of millis()/micros() costs 'call_cost' us, so polling
+ *   loops make progress; delay() advances the clock directly.
+ *   Every advance runs the registered tick hooks (e.g. a rotor model),
+ *   which may change inputs with sim_set_input() and so fire interrupts.
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#ifndef HAL_SIM_HDR
+#define HAL_SIM_HDR
+#include <stdint.h>
+#include <time.h>
+
+#define SIM_NRPINS 64
+#define SIM_NRCONN 8
+
+typedef void (*SIM_TICK_HOOK)(uint64_t now_us);
+typedef void (*SIM_OUTPUT_HOOK)(int pin,int level,uint64_t now_us);
+
+// clock
+void sim_reset(void);
+uint64_t sim_now_us(void);
+void sim_advance_us(uint64_t us);
+void sim_set_call_cost_us(unsigned int us);
+void sim_set_epoch(time_t t);
+int sim_add_tick_hook(SIM_TICK_HOOK hook);
+void sim_set_hook_time(uint64_t t);
+
+// pins
+void sim_set_input(int pin,int level);
+void sim_set_irq_mode(int pin,int mode);
+int sim_get_output(int pin);
+int sim_pwm_duty(int pin);
+int sim_add_output_hook(SIM_OUTPUT_HOOK hook);
+
+// serial
+void sim_serial_input(const char *str);
+int sim_serial_output(char *buf,int len);
+void sim_serial_echo(bool echo);
+
+// tcp
+int sim_tcp_connect(void);
+void sim_tcp_send(int conn,const char *str);
+int sim_tcp_recv(int conn,char *buf,int len);
+void sim_tcp_close(int conn);
+
+// nvs (Preferences.h); survives sim_reset()
+void sim_nvs_file(const char *path);
+void sim_nvs_erase(void);
+unsigned long sim_nvs_writes(void);
+
+#endif
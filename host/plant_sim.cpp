@@ -0,0 +1,280 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Simulated rotor plant, see plant_sim.h.
+ *   Runs as tick hook of the virtual clock, in fixed 100 us steps;
+ *   stepper: steps directly from the output hook.
+ *
+ * public functions:
+ *   void plant_init(float ax_degr,float ey_degr)
+ *   PLANT_AXIS *plant_axis(int axis)
+ *   void plant_step(uint64_t now_us)
+ *   void plant_set_quad(int axis,int pin_b)
+ *   void plant_seed(uint32_t seed)
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include <math.h>
+#include <string.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "rotorctrl.h"
+
+#define PLANT_STEP_US 100
+#define PLANT_SEED 1
+
+static PLANT_AXIS plant[2];
+static uint64_t plant_t;
+static uint32_t plant_rnd=PLANT_SEED;
+
+// random number 0...1 (LCG, same sequence for the same seed)
+static double plant_rand(void)
+{
+  plant_rnd=plant_rnd*1664525UL+1013904223UL;
+  return (plant_rnd>>8)/16777216.;
+}
+
+// zenith sensor: position of the next edge of zen_raw
+static void zen_next(PLANT_AXIS *p)
+{
+  double h=(p->zen_raw? -p->zen_hyst/2. : p->zen_hyst/2.);
+  p->zen_thr=p->zen_degr+h+p->zen_jit*(2.*plant_rand()-1.);
+}
+
+// zenith sensor: level with hysteresis and jitter, output delayed
+static void step_zen(PLANT_AXIS *p,uint64_t now_us)
+{
+  int raw=(p->motor_degr > p->zen_thr? HIGH : LOW);
+  if (raw!=p->zen_raw)
+  {
+    p->zen_raw=raw;
+    zen_next(p);
+    p->t_zen=now_us;             // a glitch shorter than the delay is lost
+  }
+  if ((p->t_zen) && (now_us-p->t_zen >= p->zen_delay*1e6))
+  {
+    sim_set_input(p->pin_zen,p->zen_raw);
+    p->t_zen=0;
+  }
+}
+
+// quadrature levels of quarter 'quad_idx': A rises with B low at the start
+// of a pulse interval (forward); quarters A/B: 10 11 01 00
+static void set_quad(PLANT_AXIS *p)
+{
+  int ph=(int)(p->quad_idx&3);
+  sim_set_input(p->pin_plsb,((ph==1) || (ph==2)? HIGH : LOW));
+  sim_set_input(p->pin_pls,(ph<2? HIGH : LOW));
+}
+
+static void init_axis(PLANT_AXIS *p,float degr)
+{
+  #ifdef MAX_PWM
+    p->max_pwm=MAX_PWM;
+  #endif
+  p->vmax=6.;                    // 60 s for 360 degrees
+  p->pwm_min=0.15;
+  p->gamma=1.2;
+  p->tau=0.15;
+  p->backlash=0.2;
+  p->zen_degr=90.;
+  p->zen_hyst=0.3;
+  p->zen_jit=0.1;
+  p->zen_delay=0.002;
+
+  p->motor_degr=degr;
+  p->dish_degr=degr;
+  p->vel=0.;
+  p->pulse_idx=(long)floor(degr*p->steps_degr/360.);
+  p->quad_idx=(long)floor(degr*p->steps_degr/90.);
+  if (p->pin_plsb>=0) set_quad(p);
+  p->nr_pulses=0;
+  p->zen_raw=(p->motor_degr > p->zen_degr? HIGH : LOW);
+  zen_next(p);
+  p->t_zen=0;
+  sim_set_input(p->pin_zen,p->zen_raw);
+}
+
+#if MOTORTYPE == MOT_STEPPER
+// output hook: step pulse
+static void plant_step_pulse(int pin,int level,uint64_t now_us)
+{
+  int i;
+  for (i=0; i<2; i++)
+  {
+    PLANT_AXIS *p=&plant[i];
+    double step=360./p->steps_degr;
+    if ((pin!=p->pin_pwm) || (!level)) continue;
+    if (!sim_get_output(p->pin_dir)) step=-step;
+    #if SWAP_DIR
+      step=-step;
+    #endif
+    p->motor_degr+=step;
+    p->nr_pulses++;
+    if (p->t_step) p->vel=step*1e6/(double)(now_us-p->t_step);
+    p->t_step=now_us;
+  }
+}
+
+// rate of stepper: from last step interval, lower if no step since
+static void stepper_rate(PLANT_AXIS *p,uint64_t now_us)
+{
+  double t,step=360./p->steps_degr;
+  if (now_us<=p->t_step) return;                      // step in this plant step
+  t=(now_us-p->t_step)*1e-6;
+  if (t>1.) p->vel=0.;
+  else if (fabs(p->vel)*t>step) p->vel=step/t*(p->vel<0? -1 : 1);
+}
+#endif
+
+// start plant with rotors at given positions; call once after sim_reset()
+// (and after plant_seed())
+void plant_init(float ax_degr,float ey_degr)
+{
+  memset(plant,0,sizeof(plant));
+  plant[PLANT_AX].pin_pwm=PIN_ROTPWM_AX;
+  plant[PLANT_AX].pin_dir=PIN_ROTDIR_AX;
+  plant[PLANT_AX].pin_din=PIN_ROTDIN_AX;
+  plant[PLANT_AX].pin_pls=PIN_ROTPLS_AX;
+  plant[PLANT_AX].pin_plsb=PIN_ROTPLSB_AX;
+  plant[PLANT_AX].pin_zen=PIN_ROTZEN_AX;
+  plant[PLANT_AX].steps_degr=AX_STEPS_DEGR;
+  init_axis(&plant[PLANT_AX],ax_degr);
+
+  plant[PLANT_EY].pin_pwm=PIN_ROTPWM_EY;
+  plant[PLANT_EY].pin_dir=PIN_ROTDIR_EY;
+  plant[PLANT_EY].pin_din=PIN_ROTDIN_EY;
+  plant[PLANT_EY].pin_pls=PIN_ROTPLS_EY;
+  plant[PLANT_EY].pin_plsb=PIN_ROTPLSB_EY;
+  plant[PLANT_EY].pin_zen=PIN_ROTZEN_EY;
+  plant[PLANT_EY].steps_degr=EY_STEPS_DEGR;
+  init_axis(&plant[PLANT_EY],ey_degr);
+
+  #if MOTORTYPE == MOT_STEPPER
+    plant[PLANT_AX].pin_pls=plant[PLANT_AX].pin_plsb=-1;
+    plant[PLANT_EY].pin_pls=plant[PLANT_EY].pin_plsb=-1;
+    sim_add_output_hook(plant_step_pulse);
+  #endif
+  plant_t=sim_now_us();
+  sim_add_tick_hook(plant_step);
+}
+
+PLANT_AXIS *plant_axis(int axis)
+{
+  if ((axis<0) || (axis>1)) return NULL;
+  return &plant[axis];
+}
+
+#if MOTORTYPE != MOT_STEPPER
+// steady-state speed (degrees/s) for current outputs
+static double target_speed(PLANT_AXIS *p)
+{
+  int pwm=sim_pwm_duty(p->pin_pwm);
+  double duty,v;
+  if (pwm<=0) return 0.;
+  duty=(double)pwm/p->max_pwm;
+  if (duty<=p->pwm_min) return 0.;
+  if (duty>1.) duty=1.;
+  v=p->vmax*pow((duty-p->pwm_min)/(1.-p->pwm_min),p->gamma);
+  if (!sim_get_output(p->pin_dir)) v=-v;
+  #if SWAP_DIR
+    v=-v;
+  #endif
+  return v;
+}
+#endif
+
+static void step_axis(PLANT_AXIS *p,double dt)
+{
+  #if MOTORTYPE != MOT_STEPPER
+    double vt=target_speed(p);
+  #endif
+  long idx,q;
+
+  #if MOTORTYPE == MOT_STEPPER
+    stepper_rate(p,plant_t);                          // steps move the motor
+  #else
+    p->vel+=(vt-p->vel)*dt/p->tau;
+    if ((vt==0.) && (fabs(p->vel)<0.01)) p->vel=0.;   // friction holds
+    p->motor_degr+=p->vel*dt;
+  #endif
+
+  // gearbox backlash: dish is dragged at the edges of the play
+  if (p->motor_degr-p->dish_degr > p->backlash/2.) p->dish_degr=p->motor_degr-p->backlash/2.;
+  if (p->motor_degr-p->dish_degr < -p->backlash/2.) p->dish_degr=p->motor_degr+p->backlash/2.;
+
+  // pulse giver: one pulse per crossed interval; quadrature: A/B per quarter
+  idx=(long)floor(p->motor_degr*p->steps_degr/360.);
+  if (p->pin_pls<0) p->pulse_idx=idx;                 // no pulse giver (stepper)
+  if (p->pin_plsb>=0)
+  {
+    q=(long)floor(p->motor_degr*p->steps_degr/90.);
+    while (q!=p->quad_idx)
+    {
+      p->quad_idx+=(q>p->quad_idx? 1 : -1);
+      set_quad(p);
+      if ((p->quad_idx&3)==0) p->nr_pulses++;
+    }
+    p->pulse_idx=idx;
+  }
+  while (idx!=p->pulse_idx)
+  {
+    p->pulse_idx+=(idx>p->pulse_idx? 1 : -1);
+    sim_set_input(p->pin_pls,HIGH);
+    sim_set_input(p->pin_pls,LOW);
+    p->nr_pulses++;
+  }
+  step_zen(p,plant_t+PLANT_STEP_US);
+}
+
+// quadrature output on axis: channel B on 'pin_b' (another pin configuration
+// than rotor_spec.h, for a test); levels of the current position
+void plant_set_quad(int axis,int pin_b)
+{
+  PLANT_AXIS *p=&plant[axis];
+  p->pin_plsb=pin_b;
+  p->quad_idx=(long)floor(p->motor_degr*p->steps_degr/90.);
+  set_quad(p);
+}
+
+// seed of the zenith sensor jitter; default PLANT_SEED
+void plant_seed(uint32_t seed)
+{
+  plant_rnd=seed;
+}
+
+// tick hook: integrate up to 'now_us'
+void plant_step(uint64_t now_us)
+{
+  while (now_us-plant_t >= PLANT_STEP_US)
+  {
+    sim_set_hook_time(plant_t+PLANT_STEP_US);          // time of pulses
+    step_axis(&plant[PLANT_AX],PLANT_STEP_US*1e-6);
+    step_axis(&plant[PLANT_EY],PLANT_STEP_US*1e-6);
+    plant_t+=PLANT_STEP_US;
+  }
+}
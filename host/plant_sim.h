@@ -0,0 +1,78 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   Simulated rotor plant: DC motor + gearbox + pulse giver + zenith
+ *   sensor per axis, driven by the simulated PWM/direction outputs.
+ *
+ * Model per axis (angles in rotor degrees, as rot->degr):
+ *   pwm->speed: no motion below 'pwm_min' (static friction), above it
+ *               vmax*((d-pwm_min)/(1-pwm_min))^gamma, d=duty 0...1
+ *   inertia:    first order, time constant 'tau'
+ *   pulses:     on the motor side, 'steps_degr' per 360 degrees;
+ *               each crossing gives a pulse on 'pin_pls' (any direction)
+ *   backlash:   dish follows the motor side within +/- backlash/2
+ *   zenith:     'pin_zen' high if motor side > 'zen_degr', with
+ *               hysteresis 'zen_hyst', each edge moved by a random
+ *               +/- 'zen_jit' (seeded, see plant_seed()) and the output
+ *               delayed by 'zen_delay'
+ * Stepper (MOTORTYPE MOT_STEPPER): each rising edge on 'pin_pwm' (step)
+ *   moves the motor side 1 step in direction 'pin_dir'; no pulse giver.
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#ifndef PLANT_SIM_HDR
+#define PLANT_SIM_HDR
+#include <stdint.h>
+
+#define PLANT_AX 0
+#define PLANT_EY 1
+
+typedef struct plant_axis
+{
+  // pins
+  int pin_pwm;
+  int pin_dir;
+  int pin_din;           // inverted direction, <0 if not used
+  int pin_pls;
+  int pin_plsb;          // quadrature channel B, <0 if not used
+  int pin_zen;
+  int max_pwm;           // pwm value at 100% duty
+
+  // mechanics
+  long steps_degr;       // pulses per 360 degrees
+  float vmax;            // degrees/s at 100% pwm
+  float pwm_min;         // duty (0...1) needed to overcome friction
+  float gamma;           // curvature of pwm->speed
+  float tau;             // time constant (s), inertia
+  float backlash;        // degrees
+  float zen_degr;        // zenith sensor edge
+  float zen_hyst;        // hysteresis (degrees) of the zenith sensor
+  float zen_jit;         // jitter of its edges: uniform +/- (degrees)
+  float zen_delay;       // delay of its output (s)
+
+  // state
+  double motor_degr;     // motor side position
+  double dish_degr;      // dish (output) position
+  double vel;            // degrees/s, motor side
+  long pulse_idx;        // current pulse interval
+  long quad_idx;         // quadrature: current quarter of a pulse interval
+  long nr_pulses;        // pulses given
+  int zen_raw;           // zenith sensor level before the delay
+  double zen_thr;        // motor side position of its next edge
+  uint64_t t_zen;        // time of a change of zen_raw, not yet output; 0: none
+  uint64_t t_step;       // stepper: time of last step (us)
+} PLANT_AXIS;
+
+void plant_init(float ax_degr,float ey_degr);
+PLANT_AXIS *plant_axis(int axis);
+void plant_step(uint64_t now_us);
+void plant_set_quad(int axis,int pin_b);
+void plant_seed(uint32_t seed);
+
+#endif
@@ -0,0 +1,172 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Host runner: setup() and loop() on the simulated hardware.
+ *   Reports host CPU time of loop(), rotor_goto() and calc_pos(),
+ *   and of the pass plan with its interpolation error,
+ *   and the 24 h pass schedule of 3 satellites.
+ *
+ * usage: rotorctrl_sim [nr_loops] [-v]
+ *   -v: echo serial output of the controller
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "sketch_protos.h"
+
+extern ROTOR *SAX_rot,*SEY_rot;
+extern COMMANDS command;
+extern KEPLER kepler;
+extern EPOINT refpos;
+extern CAT_ENTRY catalogue[];
+
+// host time in ns (not the virtual clock)
+static double host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static void report(const char *name,int n,double ns)
+{
+  printf("%-12s %8d calls  %10.1f ns/call  %10.0f calls/s\n",name,n,ns/n,n*1e9/ns);
+}
+
+int main(int argc,char **argv)
+{
+  int nloop=100000;
+  int i;
+  double t0,t1;
+  uint64_t v0;
+
+  for (i=1; i<argc; i++)
+  {
+    if (!strcmp(argv[i],"-v")) sim_serial_echo(true);
+    else nloop=atoi(argv[i]);
+  }
+  if (nloop<=0) nloop=1;
+
+  sim_reset();
+
+  t0=host_ns();
+  setup();
+  t1=host_ns();
+  printf("setup(): %.1f s virtual, %.1f ms host\n",sim_now_us()/1e6,(t1-t0)/1e6);
+
+  // start tracking (default keplers)
+  sim_serial_input("run_calc=1\n");
+  loop();
+
+  v0=sim_now_us();
+  t0=host_ns();
+  for (i=0; i<nloop; i++) loop();
+  t1=host_ns();
+  report("loop()",nloop,t1-t0);
+  printf("             virtual loop rate: %.0f loops/s\n",nloop/((sim_now_us()-v0)/1e6));
+
+  t0=host_ns();
+  for (i=0; i<nloop; i++)
+  {
+    rotor_goto(SAX_rot,(i&1)? 10. : 80.);
+    rotor_goto(SEY_rot,(i&1)? 80. : 10.);
+  }
+  t1=host_ns();
+  report("rotor_goto()",2*nloop,t1-t0);
+
+  // calc_pos() only calculates once per second; step 1 s per call
+  {
+    int ncalc=nloop/10+1;
+    double ns=0.;
+    for (i=0; i<ncalc; i++)
+    {
+      sim_advance_us(1000000);
+      t0=host_ns();
+      calc_pos(&command.gotoval,&kepler,&refpos);
+      ns+=host_ns()-t0;
+    }
+    report("calc_pos()",ncalc,ns);
+  }
+
+  // pass plan: make plan of next pass, interpolate it, compare with SGP4
+  {
+    static PASS_PLAN plan;
+    GOTO_VAL gv;
+    int nint=nloop,n;
+    double tp,maxerr[2]={0.,0.};
+    long tn=time(NULL);
+    t0=host_ns();
+    while ((!(n=plan_pass(&plan,&kepler,&refpos,tn))) && (tn<time(NULL)+86400)) tn=plan.t_retry;
+    t1=host_ns();
+    printf("plan_pass(): %d points, %.1f ms (incl. scan of %.1f h)\n",n,(t1-t0)/1e6,(plan.t0-time(NULL))/3600.);
+    if (n>1)
+    {
+      t0=host_ns();
+      for (i=0; i<nint; i++) plan_interp(&plan,plan.t0+(i%(10*(n-1)))*0.1,&gv);
+      t1=host_ns();
+      report("plan_interp()",nint,t1-t0);
+
+      for (tp=plan.t0; tp<plan.t0+(n-1)*PLAN_STEP; tp+=0.1)
+      {
+        time_t tt=(time_t)tp;
+        struct tm tm=*gmtime(&tt);
+        DIR dir;
+        EPOINT pos_sat,pos_subsat;
+        if (plan_interp(&plan,tp,&gv)<1) continue;
+        calc_sat_earth_v2(&tm,(int)((tp-tt)*1000.+0.5),&kepler,NULL,&pos_sat,&pos_subsat);
+        calceleazim_v2(tm,(int)((tp-tt)*1000.+0.5),&pos_subsat,&pos_sat,&refpos,&dir);
+        elevazim2xy(&dir,NULL);
+        maxerr[0]=MAX(maxerr[0],fabs(gv.x-R2D(dir.x)));
+        maxerr[1]=MAX(maxerr[1],fabs(gv.y-R2D(dir.y)));
+      }
+      printf("             max. interpolation error X: %.4f  Y: %.4f deg\n",maxerr[0],maxerr[1]);
+    }
+  }
+
+  // schedule: NOAA-19 and 2 other sun-synchronous satellites, NOAA-19 highest prio
+  {
+    static SCHEDULE sched;
+    KEPLER *k;
+    int n;
+    memset(catalogue,0,CAT_SIZE*sizeof(CAT_ENTRY));
+    catalogue[0].kepler=kepler;
+    catalogue[0].prio=3;
+    k=&catalogue[1].kepler;
+    *k=kepler;
+    strcpy(k->name,"METEOR_like");
+    k->d_inclination=98.6; k->d_raan=60.; k->d_anomaly=240.; k->motion=14.24;
+    calc_sgp4_const(k,true);
+    catalogue[1].prio=2;
+    k=&catalogue[2].kepler;
+    *k=kepler;
+    strcpy(k->name,"N18_like");
+    k->d_raan=200.; k->d_anomaly=10.; k->motion=14.13;
+    calc_sgp4_const(k,true);
+    catalogue[2].prio=1;
+
+    sched_reset(&sched);
+    t0=host_ns();
+    n=sched_make(&sched,catalogue,&refpos,time(NULL));
+    t1=host_ns();
+    printf("sched_make(): 3 satellites, %d passes in 24 h, %.1f ms\n",n,(t1-t0)/1e6);
+    for (i=0; i<n; i++)
+    {
+      SCHED_PASS *p=&sched.p[i];
+      printf("  %-12s aos %+7.2f h  %3ld min  max %4.1f deg\n",catalogue[p->sat].kepler.name,
+             (p->aos-sched.t0)/3600.,(p->los-p->aos)/60,p->max_elev);
+    }
+  }
+  return 0;
+}
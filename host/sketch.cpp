@@ -0,0 +1,35 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Host build of the sketch.
+ *   Like the Arduino IDE, all .ino files form one translation unit:
+ *   the main sketch first, the others in alphabetical order.
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include "Arduino.h"
+#include "sketch_protos.h"
+
+// static in rotorfuncs.ino, used before in calibrate.ino (the IDE adds this)
+static void set_status(ROTOR *rot,CAL_STATUS status);
+
+#include "../rotorctrl.ino"
+#include "../calibrate.ino"
+#include "../command_binary.ino"
+#include "../command_serial.ino"
+#include "../command_wifi.ino"
+#include "../control.ino"
+#include "../handle_commands.ino"
+#include "../misc.ino"
+#include "../monitor.ino"
+#include "../output.ino"
+#include "../persist.ino"
+#include "../pins.ino"
+#include "../rotor_wififuncs.ino"
+#include "../rotorfuncs.ino"
@@ -0,0 +1,121 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   Prototypes of the sketch (.ino) functions.
+ *   The Arduino IDE generates these itself; the host build
+ *   concatenates the .ino files the same way and needs them explicit.
+ *   Add new public .ino functions here.
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#ifndef SKETCH_PROTOS_HDR
+#define SKETCH_PROTOS_HDR
+#include "rotorctrl.h"
+#include <WiFi.h>
+
+// calibrate.ino
+int calibrate(ROTOR *AX_rot,ROTOR *EY_rot);
+
+// command_binary.ino
+int bin_filter(BIN_RX *rx,char *buf,int n,int link);
+int parse_frame(BIN_FRAME *f,int link);
+void bin_execute();
+
+// command_serial.ino
+void readCommand_serial();
+
+// command_wifi.ino
+void readCommand_wifi();
+
+// control.ino
+void start_control(void);
+boolean control_active(void);
+void control_hold(boolean hold);
+void control_publish(void);
+void control_apply(void (*fn)(void));
+void send_jitter(boolean reset);
+
+// handle_commands.ino
+int parse_cmd(char *cmd);
+void execute_cmd();
+
+// misc.ino
+void xprintf(const char *frmt,...);
+void stackcheck();
+void blink(int n,int d);
+void blink_poll(void);
+void set_led(ROTOR *rot,int rgb,boolean enable);
+
+// monitor.ino
+void send_specs(ROTOR *AX_rot,ROTOR *EY_rot);
+void send_stat(ROTOR *AX_rot,ROTOR *EY_rot);
+void send_schedule(SCHEDULE *s,CAT_ENTRY *cat);
+void send_plan(PASS_PLAN *plan);
+
+// output.ino
+void out_start(void);
+int out_write(int sink,const void *data,int n);
+int out_print(int sink,const char *s);
+int out_tcp(const void *data,int n);
+void out_new_client(int i,WiFiClient c);
+boolean out_client_ready(int i);
+boolean out_client_free(int i);
+void out_drain(void);
+void send_outstat(void);
+
+// persist.ino
+boolean persist_load_kepler(KEPLER *k);
+boolean persist_load_refpos(EPOINT *refpos);
+boolean persist_load_rotors(ROTOR *AX_rot,ROTOR *EY_rot);
+boolean persist_run_calc(void);
+void persist_save_kepler(KEPLER *k);
+void persist_save_refpos(EPOINT *refpos);
+void persist_moving(ROTOR *AX_rot,ROTOR *EY_rot);
+void persist_poll(ROTOR *AX_rot,ROTOR *EY_rot);
+
+// pins.ino
+void AX_set_pins(ROTOR *rot);
+void EY_set_pins(ROTOR *rot);
+
+// rotor_wififuncs.ino
+void CheckForConnections();
+void telem_subscribe(int client,int mask,int rate);
+void send_telemetry(int client);
+void connect_wifi_ap(const char *ssid,const char *pwd);
+void connect_wifi(const char *ssid,const char *pwd);
+void disconnect_wifi();
+void set_time(char *str);
+void get_ntp();
+void send_keplers(KEPLER *k,boolean use_degrees);
+void send_refposition(EPOINT *refpos);
+void send_ctrltime();
+void send_pos(GOTO_VAL *gv,char *name);
+void send_ctrldata(ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv);
+
+// rotorfuncs.ino
+float to_degr(ROTOR *rot);
+float pulse_rate(ROTOR *rot);
+float pos_estimate(ROTOR *rot);
+long from_degr(ROTOR *rot);
+int run_motor_soft(ROTOR *rot,int speed);
+int run_motor_hard(ROTOR *rot,int speed);
+int rotor_goto(ROTOR *rot,float val);
+int rotor_track(ROTOR *rot,float val,float vel);
+float rotors_slew(ROTOR *AX_rot,ROTOR *EY_rot,float ax,float ey);
+void rotors_track(ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv);
+void set_motion(ROTOR *rot,int motion);
+void reset_to_pos(ROTOR *rot,long pos);
+void run_to_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_pos,float ey_pos,boolean relative);
+void run_to_endswitch(ROTOR *AX_rot, ROTOR *EY_rot,int speed);
+
+// rotorctrl.ino
+void setup(void);
+void loop(void);
+
+#endif
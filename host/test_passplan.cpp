@@ -0,0 +1,108 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Test of calc_pos_plan() around AOS: for the passes of a day the
+ *   setpoint every 10 ms from AOS-PREPOS_CHECK until AOS+30 s may not
+ *   step more than MAX_STEP degr (so no return to park just before
+ *   AOS, where the table starts below the horizon).
+ *   Exit status 1 if a step is too large.
+ *
+ * usage: test_passplan [-v]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+
+#define STEP_US 10000            // setpoint sample interval
+#define PREPOS_CHECK 5           // s before AOS: prepos() is active
+#define MAX_STEP 0.5             // degr per sample
+#define NR_PASSES 8
+
+// setpoint change, azimuth through north
+static float d_degr(float a,float b)
+{
+  float d=fabs(a-b);
+  return (d>180.? 360.-d : d);
+}
+
+// setpoint around AOS of 'pass'; return max. step
+static float check_pass(KEPLER *k,EPOINT *refpos,PASS *pass,boolean verbose)
+{
+  static PASS_PLAN plan;
+  GOTO_VAL gv,pgv;
+  long aos=(long)ceil(pass->aos);
+  float d,dmax=0.;
+  boolean first=true;
+  double t;
+
+  plan_reset(&plan);
+  memset(&gv,0,sizeof(gv));
+  sim_set_epoch(aos-120);
+  calc_pos_plan(&gv,&plan,k,refpos);            // makes the plan
+  sim_set_epoch(aos-PREPOS_CHECK);
+  for (t=0.; t<PREPOS_CHECK+30.; t+=STEP_US*1e-6)
+  {
+    calc_pos_plan(&gv,&plan,k,refpos);
+    if (!first)
+    {
+      d=MAX(d_degr(gv.ax,pgv.ax),d_degr(gv.ey,pgv.ey));
+      if ((verbose) && (d>MAX_STEP))
+        printf("  AOS%+6.2f s: %7.2f %7.2f -> %7.2f %7.2f\n",t-PREPOS_CHECK-(pass->aos-aos),
+               pgv.ax,pgv.ey,gv.ax,gv.ey);
+      dmax=MAX(dmax,d);
+    }
+    pgv=gv;
+    first=false;
+    sim_advance_us(STEP_US);
+  }
+  return dmax;
+}
+
+int main(int argc,char **argv)
+{
+  KEPLER k;
+  EPOINT refpos;
+  PASS pass;
+  boolean verbose;
+  double t;
+  float d;
+  int i,nfail=0;
+
+  verbose=((argc>1) && (!strcmp(argv[1],"-v")));
+  sim_reset();
+  memset(&refpos,0,sizeof(refpos));
+  load_default_refpos(&refpos);
+  memset(&k,0,sizeof(k));
+  load_default_kepler(&k);
+  calc_sgp4_const(&k,true);
+
+  t=(k.tle.epoch-J1900-YEAR1970)*86400.;
+  for (i=0; (i<NR_PASSES) && (find_next_pass(&k,&refpos,t,t+86400.,&pass)); i++)
+  {
+    d=check_pass(&k,&refpos,&pass,verbose);
+    printf("pass %d: max. elev. %5.1f  max. setpoint step %.3f degr %s\n",
+           i,pass.max_elev,d,(d>MAX_STEP? "FAIL" : "ok"));
+    if (d>MAX_STEP) nfail++;
+    t=pass.los+1.;
+  }
+  if (!i)
+  {
+    printf("no pass found\n");
+    return 1;
+  }
+  return (nfail? 1 : 0);
+}
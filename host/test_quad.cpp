@@ -0,0 +1,99 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Test of the quadrature pulse counter: channel B switched on for
+ *   rotor X (plant and controller), control held, then the motor is
+ *   moved to and fro across both edges of A, across B, and over some
+ *   pulses. Count minus pulse interval of the motor may not change.
+ *   Exit status 1 if it drifts.
+ *
+ * usage: test_quad [-v]
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Arduino.h"
+#include "hal_sim.h"
+#include "plant_sim.h"
+#include "sketch_protos.h"
+
+#define PIN_QUAD_B 34            // channel B, unused pin
+#define STEP_US 200              // sim time per motor position
+#define NR_DITHER 200            // to and fro per case
+
+extern ROTOR *SAX_rot,*SEY_rot;
+
+// count minus pulse interval of the motor (constant if no miscount)
+static long cnt_err(void)
+{
+  return SAX_rot->rotated-plant_axis(PLANT_AX)->pulse_idx;
+}
+
+// motor to and fro around 'x' (pulses) with amplitude 'a'; return drift
+static long dither(double x,double a,long e0,boolean verbose)
+{
+  PLANT_AXIS *p=plant_axis(PLANT_AX);
+  double pls=360./p->steps_degr;
+  long e;
+  int i,j;
+  for (i=0; i<NR_DITHER; i++)
+  {
+    for (j=0; j<16; j++)
+    {
+      p->motor_degr=(x+a*sin(2.*M_PI*j/16.))*pls;
+      sim_advance_us(STEP_US);
+    }
+  }
+  e=cnt_err()-e0;
+  if (verbose)
+    printf("  x %8.2f +/- %4.2f pulses: pulses %ld  count %ld  drift %+ld\n",
+           x,a,p->pulse_idx,SAX_rot->rotated,e);
+  return e;
+}
+
+int main(int argc,char **argv)
+{
+  static const double rel[][2]={ {0.,0.1},{0.5,0.1},{0.25,0.1},{0.75,0.1},
+                                 {0.,0.6},{0.5,3.},{0.,25.} };
+  PLANT_AXIS *p;
+  boolean verbose;
+  double x0;
+  long e0,e;
+  int i,nfail=0;
+
+  verbose=((argc>1) && (!strcmp(argv[1],"-v")));
+  sim_reset();
+  plant_init(37.,120.);
+  setup();
+  sim_serial_output(NULL,0);
+
+  control_hold(true);                      // motor moved by this test only
+  run_motor_hard(SAX_rot,0);
+  run_motor_hard(SEY_rot,0);
+  sim_advance_us(1000000);
+
+  p=plant_axis(PLANT_AX);
+  plant_set_quad(PLANT_AX,PIN_QUAD_B);
+  SAX_rot->pin_plsb=PIN_QUAD_B;
+  sim_set_irq_mode(SAX_rot->pin_pls,CHANGE);
+  e0=cnt_err();
+  x0=floor(p->motor_degr*p->steps_degr/360.);
+
+  // edge of A (B low), edge of A (B high), edges of B, some pulses
+  for (i=0; i<(int)(sizeof(rel)/sizeof(rel[0])); i++)
+  {
+    e=dither(x0+1.+rel[i][0],rel[i][1],e0,verbose);
+    printf("x +%4.2f +/- %4.2f pulses: drift %+ld %s\n",1.+rel[i][0],rel[i][1],e,(e? "FAIL" : "ok"));
+    if (e) nfail++;
+  }
+  return (nfail? 1 : 0);
+}
@@ -9,3 +9,27 @@ void load_default_refpos(EPOINT *refpos);
 void load_default_kepler(KEPLER *kepler);
 boolean calc_pos(GOTO_VAL *gotoval,KEPLER *kepler,EPOINT *refpos);
 int calc_sgp4_const(KEPLER *kepler,boolean);
+int load_tle(KEPLER *kepler,const char *name,const char *line1,const char *line2);
+int sat_posn(double tsince,KEPLER *kepler,double *pos,double *vel);
+double ThetaG_JD(double jd);
+double gmst_jd(double jd);
+OBSERVER *observer(EPOINT *refpos);
+void sgp4f_init(KEPLER *kepler);
+double calc_sat_f(double t,KEPLER *kepler,EPOINT *refpos,DIR *satdir,EPOINT *pos_subsat);
+void sincos_f(float x,float *s,float *c);
+int SGP4_batch(const double *params,const tle_t *tle,const double *tsince,int n,double *pos);
+void sgp4_soa_init(SGP4_SOA *s,double *buf,int nmax);
+int sgp4_soa_add(SGP4_SOA *s,const double *params,const tle_t *tle);
+int SGP4_soa(SGP4_SOA *s,double jd,double *pos);
+double calc_sat_dir(double t,KEPLER *kepler,EPOINT *refpos,DIR *dir,EPOINT *pos_subsat);
+int find_next_pass(KEPLER *kepler,EPOINT *refpos,double t0,double t_end,PASS *pass);
+void plan_reset(PASS_PLAN *plan);
+int plan_pass(PASS_PLAN *plan,KEPLER *kepler,EPOINT *refpos,long t);
+int plan_interp(PASS_PLAN *plan,double t,GOTO_VAL *gv);
+double plan_lead(PASS_PLAN *plan);
+boolean calc_pos_plan(GOTO_VAL *gv,PASS_PLAN *plan,KEPLER *kepler,EPOINT *refpos);
+void sched_reset(SCHEDULE *s);
+int sched_make(SCHEDULE *s,CAT_ENTRY *cat,EPOINT *refpos,long t);
+int sched_next(SCHEDULE *s,long t);
+boolean calc_pos_sched(GOTO_VAL *gv,SCHEDULE *s,CAT_ENTRY *cat,
+                       KEPLER *kepler,PASS_PLAN *plan,EPOINT *refpos);
@@ -5,6 +5,9 @@
 #include <string.h>
 #include <math.h>
 
+#ifndef PREPOS_LEAD
+  #define PREPOS_LEAD 0
+#endif
 #ifndef ROTOR_AX_STOP
   #define ROTOR_AX_STOP 90
 #endif
@@ -12,6 +15,8 @@
   #define ROTOR_EY_STOP 90
 #endif
 
+#define MAX_FF_RATE 20.            // degr/s; larger rate: jump, no feed-forward
+
 // set default sat keplers (NOAA19)
 void load_default_kepler(KEPLER *kepler)
 {
@@ -86,23 +91,76 @@ long mktime_ntz(struct tm *tm)
   return secs;
 }
 
+// rotor angles ax, ey for direction 'dir'
+static void dir2rot(DIR *dir,float *ax,float *ey)
+{
+  #if ROTORTYPE == ROTORTYPE_XY
+    *ax=R2D(dir->x);
+    *ey=R2D(dir->y);
+  #else
+    *ax=R2D(dir->azim);
+    *ey=R2D(dir->elev);
+  #endif
+}
+
+/*********************************************************************
+ * Direction (azim, elev, x, y) of satellite at time 't' (s, with fraction) seen from 'refpos'
+ * pos_subsat: sub-satellite point
+ * USE_SGP4F: single-precision path (sgp4f.cpp), else double
+ * return: height (m)
+ *********************************************************************/
+double calc_sat_dir(double t,KEPLER *kepler,EPOINT *refpos,DIR *dir,EPOINT *pos_subsat)
+{
+  double height;
+  #if USE_SGP4F
+    height=calc_sat_f(t,kepler,refpos,dir,pos_subsat);
+  #else
+    time_t ts=(time_t)floor(t);
+    int ms=(int)((t-ts)*1000.+0.5);
+    struct tm tm=*gmtime(&ts);
+    EPOINT pos_sat;
+    calc_sat_earth_v2(&tm,ms,kepler,NULL,&pos_sat,pos_subsat);
+    height=calceleazim_v2(tm,ms,pos_subsat,&pos_sat,refpos,dir);
+  #endif
+  elevazim2xy(dir,NULL); // 2e arg.: ROTOR, alleen voor x_west_is_0, y_south_is_0
+  return height;
+}
+
+// rate (degr/s) of the rotor angles from t to t+1 s, for feed-forward
+static void calc_rate(time_t t,KEPLER *kepler,EPOINT *refpos,GOTO_VAL *gotoval)
+{
+  DIR dir;
+  EPOINT pos_subsat;
+  float ax,ey;
+  calc_sat_dir(t+1,kepler,refpos,&dir,&pos_subsat);
+  dir2rot(&dir,&ax,&ey);
+  gotoval->vax=ax-gotoval->ax;
+  gotoval->vey=ey-gotoval->ey;
+  #if ROTORTYPE == ROTORTYPE_AE
+    if (gotoval->vax > 180.) gotoval->vax-=360.;  // azimuth through north
+    if (gotoval->vax <-180.) gotoval->vax+=360.;
+  #endif
+  if (fabs(gotoval->vax) > MAX_FF_RATE) gotoval->vax=0.;  // flip etc.
+  if (fabs(gotoval->vey) > MAX_FF_RATE) gotoval->vey=0.;
+}
+
+// calc. pos. of satellite for current time, once per second.
+// below horizon: park, or AOS direction from PREPOS_LEAD s before AOS
+// gotoval->vax, vey: rate of gotoval->ax, ey during this second
 boolean calc_pos(GOTO_VAL *gotoval,KEPLER *kepler,EPOINT *refpos)
 {
   static int prevsec;
   static struct tm tm;
   time_t t;
   DIR dir;
-  EPOINT pos_sat,pos_subsat;
+  EPOINT pos_subsat;
   static boolean above_hor;
 
   time(&t);
   tm=*gmtime(&t);
   if (prevsec!=tm.tm_sec)
   {
-    calc_sat_earth_v2(&tm,0,kepler,NULL,&pos_sat,&pos_subsat);
-//printf("%f  %f\n",pos_sat.lat,pos_sat.lon);
-    gotoval->height=calceleazim_v2(tm,0,&pos_subsat,&pos_sat,refpos,&dir);
-    elevazim2xy(&dir,NULL); // 2e arg.: ROTOR, alleen voor x_west_is_0, y_south_is_0
+    gotoval->height=calc_sat_dir(t,kepler,refpos,&dir,&pos_subsat);
     gotoval->a=R2D(dir.azim);
     gotoval->e=R2D(dir.elev);
     gotoval->x=R2D(dir.x);
@@ -112,21 +170,27 @@ boolean calc_pos(GOTO_VAL *gotoval,KEPLER *kepler,EPOINT *refpos)
 
     if (gotoval->e < 0)
     {
-        gotoval->ax=ROTOR_AX_STOP;
-        gotoval->ey=ROTOR_EY_STOP;
-        above_hor=false;
+      PASS pass;
+      gotoval->ax=ROTOR_AX_STOP;
+      gotoval->ey=ROTOR_EY_STOP;
+      gotoval->vax=0.;
+      gotoval->vey=0.;
+      if ((PREPOS_LEAD) && (find_next_pass(kepler,refpos,t,t+PREPOS_LEAD,&pass)))
+      {                                         // pre-position: AOS direction
+        calc_sat_dir(pass.aos,kepler,refpos,&dir,&pos_subsat);
+        dir.elev=MAX(dir.elev,0.);
+        elevazim2xy(&dir,NULL);
+        dir2rot(&dir,&gotoval->ax,&gotoval->ey);
+      }
+      above_hor=false;
     }
     else
     {
-      #if ROTORTYPE == ROTORTYPE_XY
-        gotoval->ax=gotoval->x;
-        gotoval->ey=gotoval->y;
-      #else
-        gotoval->ax=gotoval->a;
-        gotoval->ey=gotoval->e;
-      #endif
+      dir2rot(&dir,&gotoval->ax,&gotoval->ey);
+      calc_rate(t,kepler,refpos,gotoval);
       above_hor=true;
     }
+    gotoval->t_calc=t;
     prevsec=tm.tm_sec;
   }
   return above_hor;
@@ -0,0 +1,117 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Line reader for serial and wifi input
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * Received bytes are read directly into the buffer (lb_space(),
+ * lb_commit()) and searched for '\n' once; a complete line is handed
+ * out in place (lb_getline()), '\n' replaced by 0. Only the unfinished
+ * last line is moved to the start when the end of the buffer is
+ * reached, so each byte is touched about once, also for a burst of
+ * Kepler lines.
+ * A line longer than LINEBUF_SIZE is dropped as a whole (counted in
+ * nr_overflow, nr_dropped), not truncated into another command.
+ *
+ * public functions:
+ *   void lb_reset(LINE_BUF *lb)
+ *   char *lb_space(LINE_BUF *lb,int *n)
+ *   void lb_commit(LINE_BUF *lb,int n)
+ *   char *lb_getline(LINE_BUF *lb)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+#include <string.h>
+
+// empty buffer; counters are kept
+void lb_reset(LINE_BUF *lb)
+{
+  lb->rpos=lb->scan=lb->wpos=0;
+  lb->skip=false;
+}
+
+/*********************************************************************
+ * Free space to receive into
+ * n: max. nr. of bytes (always > 0)
+ * return: where to put them; then call lb_commit()
+ *********************************************************************/
+char *lb_space(LINE_BUF *lb,int *n)
+{
+  if (lb->wpos==LINEBUF_SIZE)
+  {
+    if (lb->rpos)                          // unfinished line to start
+    {
+      memmove(lb->buf,lb->buf+lb->rpos,lb->wpos-lb->rpos);
+      lb->wpos-=lb->rpos;
+      lb->scan-=lb->rpos;
+      lb->rpos=0;
+    }
+    else                                   // line too long: drop it
+    {
+      lb->nr_overflow++;
+      lb->nr_dropped+=lb->wpos;
+      lb_reset(lb);
+      lb->skip=true;
+    }
+  }
+  *n=LINEBUF_SIZE-lb->wpos;
+  return lb->buf+lb->wpos;
+}
+
+// n bytes received in space of lb_space()
+void lb_commit(LINE_BUF *lb,int n)
+{
+  if (n>0) lb->wpos+=n;
+}
+
+/*********************************************************************
+ * Next complete line, without '\n'
+ * return: line (in lb->buf, valid until next lb_space()) or NULL
+ *********************************************************************/
+char *lb_getline(LINE_BUF *lb)
+{
+  char *p,*line;
+  while ((p=(char *)memchr(lb->buf+lb->scan,'\n',lb->wpos-lb->scan)))
+  {
+    *p=0;
+    line=lb->buf+lb->rpos;
+    lb->rpos=lb->scan=p+1-lb->buf;
+    if (lb->skip)                          // end of too long line
+    {
+      lb->nr_dropped+=p-line+1;
+      lb->skip=false;
+      continue;
+    }
+    lb->nr_lines++;
+    return line;
+  }
+  lb->scan=lb->wpos;
+  if (lb->skip)                            // still in too long line
+  {
+    lb->nr_dropped+=lb->wpos-lb->rpos;
+    lb->rpos=lb->scan;
+  }
+  if (lb->rpos==lb->wpos) lb->rpos=lb->scan=lb->wpos=0;  // all used
+  return NULL;
+}
@@ -0,0 +1,36 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   line reader for serial and wifi input, see linebuf.cpp
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#ifndef LINEBUF_HDR
+#define LINEBUF_HDR
+
+#define LINEBUF_SIZE 192         // max. line length incl. '\n' (tle=<name>,<line1>,<line2>)
+
+typedef struct line_buf
+{
+  char buf[LINEBUF_SIZE+1];
+  int rpos;                      // start of current (unfinished) line
+  int scan;                      // searched for '\n' up to here
+  int wpos;                      // end of received data
+  boolean skip;                  // line too long: drop until '\n'
+  unsigned long nr_lines;        // lines handed out
+  unsigned long nr_overflow;     // lines dropped: too long
+  unsigned long nr_dropped;      // bytes dropped
+} LINE_BUF;
+
+void lb_reset(LINE_BUF *lb);
+char *lb_space(LINE_BUF *lb,int *n);
+void lb_commit(LINE_BUF *lb,int n);
+char *lb_getline(LINE_BUF *lb);
+
+#endif
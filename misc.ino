@@ -45,48 +45,41 @@
 extern boolean do_feedback;
 
 // Print over ethernet or serial.
-//   serial print without blocking: only print if enough buffer!
-//   (Otherwise big delays will occur if sent bits are not received by xtrack)
-//    hm, if not received at PC: filling up buffer in PC, if full: TX and RX cont. on.
-//    So if TX blocks also RX blocks??? 
+//   Only queued, sent by the output task (see output.ino): never blocks,
+//   also not if xtrack doesn't read (then the queue gets full and
+//   messages are refused and counted).
 
 #define STRLEN 60
 
 #if USE_DISPLAY
-// print string to display (if available)
-void dprint(int x,int y,char *s)
+// print format to display (if available) at x, y
+void dprint(int x,int y,const char *frmt,...)
 {
-  char str[STRLEN];
+  char str[STRLEN+3];
   va_list ap;
+  if ((x<0) || (y<0)) return;
+  str[0]=OUT_LCD_POS;
+  str[1]=x+OUT_LCD_XY;            // record marker only at record start
+  str[2]=y+OUT_LCD_XY;
   va_start(ap,frmt);
-  vsnprintf(str,STRLEN,frmt,ap);
+  vsnprintf(str+3,STRLEN,frmt,ap);
   va_end(ap);
-  if ((x>=0) && (y>=0))
-  {
-    lcd.setCursor(x, y);
-    lcd.print(str);
-  }
+  out_write(OUT_LCD,str,strlen(str+3)+3);
 }
 #endif
 
-// print format to ethernet or serial
+// print format to ethernet and serial
 void xprintf(const char *frmt,...)
 {
   char str[STRLEN];
+  int n;
   va_list ap;
   va_start(ap,frmt);
   vsnprintf(str,STRLEN,frmt,ap);
   va_end(ap);
-  if  (Serial.availableForWrite())
-  {
-    Serial.print(str);
-  }
-  #if USE_WIFI
-    if (RemoteClient.connected())
-    {
-      RemoteClient.write((uint8_t* )str, strlen(str));
-    }
-  #endif
+  n=strlen(str);
+  out_write(OUT_UART,str,n);
+  out_tcp(str,n);
 }
 
 #if USE_WIFI
@@ -103,16 +96,27 @@ void stackcheck()
 }
 #endif
 
-// blink buit-in LED n times with delay d ms
+// blink buit-in LED n times with delay d ms, without blocking: started
+// here, LED switched by blink_poll(); n=0: stop
+static int blink_n;              // LED switches to go
+static int blink_d;
+static unsigned long blink_t;
 void blink(int n,int d)
 {
-  for (; n>0; n--)
-  {
-    digitalWrite(LED_BUILTIN, HIGH);   // LED on; command received
-    delay(d);
-    digitalWrite(LED_BUILTIN, LOW);    // LED off; command not (yet) received
-    delay(d);
-  }
+  blink_n=2*n;
+  blink_d=d;
+  blink_t=millis();
+  if (blink_n>0) digitalWrite(LED_BUILTIN, HIGH);
+}
+
+// next LED switch of blink(); call from loop()
+void blink_poll(void)
+{
+  if (blink_n<=0) return;
+  if (millis()-blink_t < (unsigned long)blink_d) return;
+  blink_t+=blink_d;
+  if (--blink_n>0)               // last one: stays off
+    digitalWrite(LED_BUILTIN, (blink_n&1? LOW : HIGH));
 }
 
 // set 3-colour led
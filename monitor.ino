@@ -8,6 +8,8 @@
  *   monitor functions:
  *     void send_specs(ROTOR *AX_rot,ROTOR *EY_rot)
  *     void send_stat(ROTOR *AX_rot,ROTOR *EY_rot)
+ *     void send_schedule(SCHEDULE *s,CAT_ENTRY *cat)
+ *     void send_plan(PASS_PLAN *plan)
  *
  * History: 
  * $Log: monitor.ino,v $
@@ -38,45 +40,52 @@
  * 02111-1307, USA.
  ********************************************************************/
 // Send rotor specs
-// delay between 2 write actions, to prevent buffer overflow
-#define SERDEL 20
 void send_specs(ROTOR *AX_rot,ROTOR *EY_rot)
 {
   char tmp[10];
-  xprintf("SPEC: Release %s\n",RELEASE);                              delay(SERDEL);
-  xprintf("SPEC: AX_POffset     =%ld\n",(long)AX_POffset);            delay(SERDEL);
-  xprintf("SPEC: EY_POffset     =%ld\n",(long)EY_POffset);            delay(SERDEL);
+  xprintf("SPEC: Release %s\n",RELEASE);
+  xprintf("SPEC: AX_POffset     =%ld\n",(long)AX_POffset);
+  xprintf("SPEC: EY_POffset     =%ld\n",(long)EY_POffset);
 
-  xprintf("SPEC: AX_REFPOS      =%s\n",dtostrf(AX_REFPOS,5,1,tmp));   delay(SERDEL);
-  xprintf("SPEC: EY_REFPOS      =%s\n",dtostrf(EY_REFPOS,5,1,tmp));   delay(SERDEL);
+  xprintf("SPEC: AX_REFPOS      =%s\n",dtostrf(AX_REFPOS,5,1,tmp));
+  xprintf("SPEC: EY_REFPOS      =%s\n",dtostrf(EY_REFPOS,5,1,tmp));
 
-  xprintf("SPEC: AX_STEPS_DEGR  =%ld\n",(long)AX_STEPS_DEGR);         delay(SERDEL);
-  xprintf("SPEC: EY_STEPS_DEGR  =%ld\n",(long)EY_STEPS_DEGR);         delay(SERDEL);
+  xprintf("SPEC: AX_STEPS_DEGR  =%ld\n",(long)AX_STEPS_DEGR);
+  xprintf("SPEC: EY_STEPS_DEGR  =%ld\n",(long)EY_STEPS_DEGR);
 
-  xprintf("SPEC: CAL_ZENITH     =%d\n",(int)CAL_ZENITH);              delay(SERDEL);
+  xprintf("SPEC: CAL_ZENITH     =%d\n",(int)CAL_ZENITH);
 
   #ifdef USE_EASTWEST
-    xprintf("SPEC: USE_EASTWEST   =%ld\n",(long)USE_EASTWEST);          delay(SERDEL);
+    xprintf("SPEC: USE_EASTWEST   =%ld\n",(long)USE_EASTWEST);
   #endif
   #ifdef FULLRANGE_AZIM
-    xprintf("SPEC: FULLRANGE_AZIM =%ld\n",(long)FULLRANGE_AZIM);        delay(SERDEL);
+    xprintf("SPEC: FULLRANGE_AZIM =%ld\n",(long)FULLRANGE_AZIM);
   #endif
 
  #if MOTORTYPE == MOT_STEPPER
-  xprintf("SPEC: AX_MotorSpeed  =%d\n",(int)AX_MotorSpeed);           delay(SERDEL);
-  xprintf("SPEC: AX_MotorAccel  =%d\n",(int)AX_MotorAccel);           delay(SERDEL);
-  xprintf("SPEC: EY_MotorSpeed  =%d\n",(int)EY_MotorSpeed);           delay(SERDEL);
-  xprintf("SPEC: EY_MotorAccel  =%d\n",(int)EY_MotorAccel);           delay(SERDEL);
+  xprintf("SPEC: AX_MotorSpeed  =%d\n",(int)AX_MotorSpeed);
+  xprintf("SPEC: AX_MotorAccel  =%d\n",(int)AX_MotorAccel);
+  xprintf("SPEC: EY_MotorSpeed  =%d\n",(int)EY_MotorSpeed);
+  xprintf("SPEC: EY_MotorAccel  =%d\n",(int)EY_MotorAccel);
  #else
-  xprintf("SPEC: AX_MINSPEED    =%d\n",(int)AX_MINSPEED);             delay(SERDEL);
-  xprintf("SPEC: AX_MAXSPEED    =%d\n",(int)AX_MAXSPEED);             delay(SERDEL);
-  xprintf("SPEC: EY_MINSPEED    =%d\n",(int)EY_MINSPEED);             delay(SERDEL);
-  xprintf("SPEC: EY_MAXSPEED    =%d\n",(int)EY_MAXSPEED);             delay(SERDEL);
-  xprintf("SPEC: L_DEGR_MAXSPEED=%d\n",(int)L_DEGR_MAXSPEED);         delay(SERDEL);
-  xprintf("SPEC: H_DEGR_MINSPEED=%d\n",(int)H_DEGR_MINSPEED);         delay(SERDEL);
-  xprintf("SPEC: D_DEGR_STOP    =%s\n",dtostrf(D_DEGR_STOP,5,1,tmp)); delay(SERDEL);
-  xprintf("SPEC: PWMFreq        =%d\n",(int)PWMFreq);                 delay(SERDEL);
-  xprintf("SPEC: MAX_PWM        =%d\n",(int)MAX_PWM);                 delay(SERDEL);
+  xprintf("SPEC: AX_MINSPEED    =%d\n",(int)AX_MINSPEED);
+  xprintf("SPEC: AX_MAXSPEED    =%d\n",(int)AX_MAXSPEED);
+  xprintf("SPEC: EY_MINSPEED    =%d\n",(int)EY_MINSPEED);
+  xprintf("SPEC: EY_MAXSPEED    =%d\n",(int)EY_MAXSPEED);
+  xprintf("SPEC: L_DEGR_MAXSPEED=%d\n",(int)L_DEGR_MAXSPEED);
+  xprintf("SPEC: H_DEGR_MINSPEED=%d\n",(int)H_DEGR_MINSPEED);
+  xprintf("SPEC: D_DEGR_STOP    =%s\n",dtostrf(D_DEGR_STOP,5,1,tmp));
+  if (AX_rot)
+  {
+    xprintf("SPEC: MOTION_CTRL    =%d\n",AX_rot->motion);
+    xprintf("SPEC: deadband       =%s\n",dtostrf(AX_rot->deadband,5,2,tmp));
+    xprintf("SPEC: PID_KP         =%s\n",dtostrf(AX_rot->kp,5,1,tmp));
+    xprintf("SPEC: PID_KI         =%s\n",dtostrf(AX_rot->ki,5,1,tmp));
+    xprintf("SPEC: PID_KD         =%s\n",dtostrf(AX_rot->kd,5,1,tmp));
+    xprintf("SPEC: PID_KFF        =%s\n",dtostrf(AX_rot->kff,5,1,tmp));
+  }
+  xprintf("SPEC: PWMFreq        =%d\n",(int)PWMFreq);
+  xprintf("SPEC: MAX_PWM        =%d\n",(int)MAX_PWM);
  #endif
  #if USE_SGP4
  {
@@ -100,6 +109,73 @@ void send_stat(ROTOR *AX_rot,ROTOR *EY_rot)
   xprintf("STAT: ax=%d  ey=%d\n",stat_ax,stat_ey);
 }
 
+#if USE_SCHEDULER
+// Send pass schedule: nr, satellite, prio, AOS, LOS (UTC), max. elevation
+void send_schedule(SCHEDULE *s,CAT_ENTRY *cat)
+{
+  int i;
+  char tmp[10],aos[10],los[10];
+  time_t t;
+  for (i=0; i<s->n; i++)
+  {
+    SCHED_PASS *p=&s->p[i];
+    t=p->aos; strftime(aos,10,"%H:%M:%S",gmtime(&t));
+    t=p->los; strftime(los,10,"%H:%M:%S",gmtime(&t));
+    xprintf("SCHED: %2d %-10.10s %d %s-%s %s\n",              // < STRLEN
+            i,cat[p->sat].kepler.name,cat[p->sat].prio,aos,los,dtostrf(p->max_elev,4,1,tmp));
+  }
+  xprintf("SCHED: %d passes\n",s->n);
+}
+#endif
+
+#if USE_PASSPLAN
+/*******************************************************************
+ * Send pass plan:
+ *   start, end (UTC), nr. of points, slew time park -> AOS,
+ *   solution: east/west pass, flip to the other one at (UTC),
+ *     keyhole time (azimuth interpolated), max. pointing error there
+ *   per rotor: peak rate needed / max. rate (degr/s)
+ *   trackable: ok, or which limit is exceeded
+ *******************************************************************/
+void send_plan(PASS_PLAN *plan)
+{
+  char tmp[10],t0[10],t1[10];
+  boolean fast_ax,fast_ey;
+  time_t t;
+  if (!plan->n)
+  {
+    xprintf("PLAN: none\n");
+    return;
+  }
+  t=plan->t0; strftime(t0,10,"%H:%M:%S",gmtime(&t));
+  t=plan->t0+(long)(plan->n-1)*PLAN_STEP; strftime(t1,10,"%H:%M:%S",gmtime(&t));
+  xprintf("PLAN: %s-%s %d slew %s s\n",t0,t1,plan->n,dtostrf(plan->slew_s,5,1,tmp));
+  #if ROTORTYPE == ROTORTYPE_AE
+    if (plan->flip<plan->n)
+    {
+      t=plan->t0+(long)plan->flip*PLAN_STEP; strftime(t0,10,"%H:%M:%S",gmtime(&t));
+      xprintf("PLAN: %s, flip at %s\n",(plan->east_pass? "east" : "west"),t0);     // < STRLEN
+      xprintf("PLAN: keyhole %d s, pointing %s degr\n",(2*plan->keyhole+1)*PLAN_STEP,dtostrf(plan->err_max,4,1,tmp));
+    }
+    else
+    {
+      xprintf("PLAN: %s\n",(plan->east_pass? "east" : "west"));
+    }
+  #endif
+  xprintf("PLAN: %s rate %s",AX_NAME,dtostrf(plan->rate_ax,5,2,tmp));
+  xprintf(" / %s\n",dtostrf(plan->vmax_ax,5,2,tmp));
+  xprintf("PLAN: %s rate %s",EY_NAME,dtostrf(plan->rate_ey,5,2,tmp));
+  xprintf(" / %s\n",dtostrf(plan->vmax_ey,5,2,tmp));
+  fast_ax=((plan->vmax_ax) && (plan->rate_ax>plan->vmax_ax));
+  fast_ey=((plan->vmax_ey) && (plan->rate_ey>plan->vmax_ey));
+  if ((plan->fits) && (!fast_ax) && (!fast_ey))
+    xprintf("PLAN: trackable\n");
+  else
+    xprintf("PLAN: not trackable:%s%s%s\n",(plan->fits? "" : " azimuth range"),
+            (fast_ax? " " AX_NAME " rate" : ""),(fast_ey? " " EY_NAME " rate" : ""));
+}
+#endif
+
 #ifdef DISPLAY_FUNCS
 // current ax/ey to display
 void rec2displ(int ep,float ax,float ey)
@@ -81,6 +81,7 @@ typedef struct
    double coef, coef1, tsi, s4, unused_a3ovk2, eta;
 } init_t;
 
+void sxpall_common_init( const tle_t *tle, deep_arg_t *deep_arg);
 void sxpx_common_init( double *params, const tle_t *tle,
                                   init_t *init, deep_arg_t *deep_arg);
 
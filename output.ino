@@ -0,0 +1,350 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   Non-blocking output: per sink (UART, LCD, each TCP client) a byte
+ *   queue, emptied by a low-priority task (ESP) or from loop() (AVR).
+ *   The same task pushes the subscribed telemetry to the TCP clients.
+ *   Writers (loop(), command handling) only copy into the queue and
+ *   never wait for the UART, the network or the display.
+ *
+ *   Queues are single producer (loop() context), single consumer
+ *   (output task), lock-free: head is only written by the producer,
+ *   tail only by the consumer.
+ *   A new TCP client is handed to the output task (out_new_client()),
+ *   which replaces the WiFiClient of the slot and discards what was
+ *   still queued for the previous client; loop() doesn't use the slot
+ *   until then, so only the task replaces a WiFiClient the task uses.
+ *   Policy per queue when full:
+ *     OUT_BACKPRESSURE: message refused as a whole (return 0), counted;
+ *                       lines are never cut (UART, TCP: replies to PC).
+ *     OUT_DROP_OLDEST:  oldest bytes are overwritten, counted by the
+ *                       consumer (LCD: only the latest text matters).
+ *
+ * public functions:
+ *   void out_start(void)
+ *   int out_write(int sink,const void *data,int n)
+ *   int out_print(int sink,const char *s)
+ *   int out_tcp(const void *data,int n)
+ *   void out_new_client(int i,WiFiClient c)
+ *   boolean out_client_ready(int i)
+ *   boolean out_client_free(int i)
+ *   void out_drain(void)
+ *   void send_outstat(void)
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+
+// queue sizes (power of 2); 0: sink not used
+#if PROCESSOR==PROC_ESP
+  #define OUTQ_UART 2048
+#else
+  #define OUTQ_UART 256
+#endif
+#define OUTQ_TCP 1024            // per client
+#if USE_DISPLAY
+  #define OUTQ_LCD 128
+#else
+  #define OUTQ_LCD 0
+#endif
+
+#define OUT_PERIOD_MS 10         // task wakes at least this often
+#define OUT_CHUNK 128            // max. bytes per write to a sink
+
+#define OUT_NRSINKS (OUT_TCP+NR_CLIENTS)
+
+extern COMMANDS command;
+
+static char outq_uart[OUTQ_UART+1];
+static char outq_lcd[OUTQ_LCD+1];
+#if NR_CLIENTS
+  static char outq_tcp[NR_CLIENTS][OUTQ_TCP];
+  static WiFiClient new_client[NR_CLIENTS];   // accepted, for the output task
+  static boolean client_new[NR_CLIENTS];      // new_client[i] waiting
+#endif
+
+static OUT_QUEUE outq[OUT_NRSINKS]=
+{
+  { outq_uart, OUTQ_UART, OUT_BACKPRESSURE },
+  { outq_lcd,  OUTQ_LCD,  OUT_DROP_OLDEST  },
+};                                         // tcp clients: see out_start()
+
+#if USE_OUT_TASK
+  static TaskHandle_t out_task;
+#endif
+
+/*********************************************************************
+ * Put n bytes in queue of 'sink'; never blocks.
+ * return: nr. of bytes queued (0: refused, queue full)
+ *********************************************************************/
+int out_write(int sink,const void *data,int n)
+{
+  OUT_QUEUE *q=&outq[sink];
+  const char *p=(const char *)data;
+  unsigned long h,t;
+  int i,m;
+
+  if ((!q->size) || (n<=0)) return 0;
+  h=q->head;
+  t=__atomic_load_n(&q->tail,__ATOMIC_ACQUIRE);
+  if (q->policy==OUT_BACKPRESSURE)
+  {
+    if (n>q->size-(int)(h-t))
+    {
+      q->refused+=n;
+      return 0;
+    }
+  }
+  else if (n>q->size)                      // only the last part fits anyway
+  {
+    q->refused+=n-q->size;
+    p+=n-q->size;
+    n=q->size;
+  }
+  for (i=0; i<n; i+=m)                     // max. 2 parts: wrap at end
+  {
+    int pos=(h+i)&(q->size-1);
+    m=MIN(n-i,q->size-pos);
+    memcpy(q->buf+pos,p+i,m);
+  }
+  __atomic_store_n(&q->head,h+n,__ATOMIC_RELEASE);
+  if ((int)(h+n-t)>q->max_used) q->max_used=MIN((int)(h+n-t),q->size);
+  #if USE_OUT_TASK
+    if (out_task) xTaskNotifyGive(out_task);
+  #endif
+  return n;
+}
+
+int out_print(int sink,const char *s)
+{
+  return out_write(sink,s,strlen(s));
+}
+
+/*********************************************************************
+ * Reply to tcp: to the client of the current command, else (serial
+ * command, messages from loop()) to all connected clients.
+ * return: nr. of bytes queued (for 1 client)
+ *********************************************************************/
+int out_tcp(const void *data,int n)
+{
+  int r=0;
+  #if NR_CLIENTS
+    int i;
+    if (command.client)
+    {
+      i=command.client-1;
+      return (out_client_ready(i)? out_write(OUT_TCP+i,data,n) : 0);
+    }
+    for (i=0; i<NR_CLIENTS; i++)
+    {
+      if (out_client_ready(i)) r=out_write(OUT_TCP+i,data,n);
+    }
+  #endif
+  return r;
+}
+
+#if NR_CLIENTS
+/*********************************************************************
+ * loop(): new client 'c' for free slot 'i'. Taken over by the output
+ * task in drain_tcp(); until then the slot is not ready.
+ *********************************************************************/
+void out_new_client(int i,WiFiClient c)
+{
+  new_client[i]=c;
+  __atomic_store_n(&client_new[i],true,__ATOMIC_RELEASE);
+  #if USE_OUT_TASK
+    if (out_task) xTaskNotifyGive(out_task);
+  #endif
+}
+
+// loop(): slot 'i' has a connected client, handed over to the output task
+boolean out_client_ready(int i)
+{
+  return ((!__atomic_load_n(&client_new[i],__ATOMIC_ACQUIRE)) && (Clients[i].connected()));
+}
+
+// loop(): slot 'i' can take a new client
+boolean out_client_free(int i)
+{
+  return ((!__atomic_load_n(&client_new[i],__ATOMIC_ACQUIRE)) && (!Clients[i].connected()));
+}
+#endif
+
+/*********************************************************************
+ * Consumer: copy max. 'n' queued bytes into 'buf', don't release yet.
+ * A drop-oldest queue may be overwritten meanwhile: then the copy is
+ * invalid, the overwritten bytes are skipped and counted.
+ * return: nr. of bytes
+ *********************************************************************/
+static int out_peek(OUT_QUEUE *q,char *buf,int n)
+{
+  unsigned long h,t;
+  int i,m;
+  for (;;)
+  {
+    h=__atomic_load_n(&q->head,__ATOMIC_ACQUIRE);
+    t=q->tail;
+    if (h-t>(unsigned long)q->size)        // overwritten: drop oldest
+    {
+      q->dropped+=h-t-q->size;
+      t=h-q->size;
+      __atomic_store_n(&q->tail,t,__ATOMIC_RELEASE);
+    }
+    n=MIN(n,(int)(h-t));
+    for (i=0; i<n; i+=m)
+    {
+      int pos=(t+i)&(q->size-1);
+      m=MIN(n-i,q->size-pos);
+      memcpy(buf+i,q->buf+pos,m);
+    }
+    if ((q->policy==OUT_BACKPRESSURE) ||
+        (__atomic_load_n(&q->head,__ATOMIC_ACQUIRE)-t<=(unsigned long)q->size)) break;
+  }
+  return n;
+}
+
+// consumer: n bytes written to the sink
+static void out_release(OUT_QUEUE *q,int n)
+{
+  __atomic_store_n(&q->tail,q->tail+n,__ATOMIC_RELEASE);
+}
+
+static void drain_uart(OUT_QUEUE *q)
+{
+  char buf[OUT_CHUNK];
+  int n;
+  while ((n=Serial.availableForWrite())>0)  // only what fits: no wait
+  {
+    if (!(n=out_peek(q,buf,MIN(n,OUT_CHUNK)))) break;
+    Serial.write((uint8_t *)buf,n);
+    out_release(q,n);
+  }
+}
+
+#if NR_CLIENTS
+static void drain_tcp(int i)
+{
+  OUT_QUEUE *q=&outq[OUT_TCP+i];
+  char buf[OUT_CHUNK];
+  int n;
+  if (__atomic_load_n(&client_new[i],__ATOMIC_ACQUIRE))  // new client: take over
+  {                                        // (no producer meanwhile, see out_tcp())
+    __atomic_store_n(&q->tail,__atomic_load_n(&q->head,__ATOMIC_ACQUIRE),__ATOMIC_RELEASE);
+    Clients[i]=new_client[i];              // output of previous client discarded
+    new_client[i]=WiFiClient();
+    __atomic_store_n(&client_new[i],false,__ATOMIC_RELEASE);
+  }
+  while ((n=out_peek(q,buf,OUT_CHUNK)))
+  {
+    if (Clients[i].connected())
+      Clients[i].write((uint8_t *)buf,n);  // may wait: only this task
+    out_release(q,n);                      // no client: discard
+  }
+  // queue empty, so at a message boundary: telemetry in between
+  if (Clients[i].connected()) send_telemetry(i);
+}
+#endif
+
+#if USE_DISPLAY
+// records: OUT_LCD_POS x+OUT_LCD_XY y+OUT_LCD_XY text
+static void drain_lcd(OUT_QUEUE *q)
+{
+  char buf[OUTQ_LCD+1];
+  int n,i;
+  if (!(n=out_peek(q,buf,OUTQ_LCD))) return;
+  out_release(q,n);
+  buf[n]=0;
+  for (i=0; (i<n) && (buf[i]!=OUT_LCD_POS); i++);  // after overwrite: next record
+  while (i+3<=n)
+  {
+    int x=buf[i+1]-OUT_LCD_XY,y=buf[i+2]-OUT_LCD_XY,j;
+    for (j=i+3; (j<n) && (buf[j]!=OUT_LCD_POS); j++);
+    buf[j]=0;
+    lcd.setCursor(x, y);
+    lcd.print(buf+i+3);
+    i=j;
+  }
+}
+#endif
+
+// write queued output to the sinks
+void out_drain(void)
+{
+  #if NR_CLIENTS
+    int i;
+  #endif
+  if (outq[OUT_UART].size) drain_uart(&outq[OUT_UART]);
+  #if NR_CLIENTS
+    for (i=0; i<NR_CLIENTS; i++) drain_tcp(i);
+  #endif
+  #if USE_DISPLAY
+    drain_lcd(&outq[OUT_LCD]);
+  #endif
+}
+
+#if USE_OUT_TASK
+static void output_task(void *arg)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OUT_PERIOD_MS));
+    out_drain();
+  }
+}
+#endif
+
+void out_start(void)
+{
+  #if NR_CLIENTS
+    int i;
+    for (i=OUT_TCP; i<OUT_NRSINKS; i++)
+    {
+      outq[i].buf=outq_tcp[i-OUT_TCP];
+      outq[i].size=OUTQ_TCP;
+      outq[i].policy=OUT_BACKPRESSURE;
+    }
+  #endif
+  #if USE_OUT_TASK
+    if (out_task) return;        // already running (setup() again)
+    xTaskCreatePinnedToCore(output_task, "output", 4096, NULL, OUT_TASK_PRIO, &out_task, 0);
+  #endif
+}
+
+// Send queue statistics: used now, max. used, refused/dropped bytes
+void send_outstat(void)
+{
+  static const char *sink_name[OUT_TCP]={"uart","lcd"};
+  char name[8];
+  int i;
+  for (i=0; i<OUT_NRSINKS; i++)
+  {
+    OUT_QUEUE *q=&outq[i];
+    if (!q->size) continue;
+    if (i<OUT_TCP) strcpy(name,sink_name[i]); else sprintf(name,"tcp%d",i-OUT_TCP);
+    xprintf("OUTQ: %-4s %4d/%d max=%d refused=%lu dropped=%lu\n",name,
+            (int)(q->head-q->tail),q->size,q->max_used,q->refused,q->dropped);
+  }
+}
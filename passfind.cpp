@@ -0,0 +1,208 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Pass finder: next AOS, TCA, LOS
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * Far from visibility, the time to the next pass is bounded by the
+ * geocentric angle between observer and sub-satellite point: that
+ * angle can't shrink faster than orbital motion + earth rotation
+ * (from KEPLER::motion). So we jump close to the pass, then step at
+ * 1/PASS_NR_FINE of the orbital period; horizon crossings are refined
+ * by Illinois (secant with bracket), the max. elevation by golden
+ * section. A local elevation max. below the horizon between steps is
+ * checked too, so short grazing passes are not missed.
+ * Typical: < 100 SGP4 calls per pass (search included) instead of
+ * ~6000 with a 1 s scan; see host/bench_pass.cpp.
+ * A satellite that doesn't set (geostationary, SDP4) gets AOS and LOS
+ * at PASS_MAX before and after the start of the search (or AOS).
+ *
+ * public functions:
+ *   int find_next_pass(KEPLER *kepler,EPOINT *refpos,double t0,double t_end,PASS *pass)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+#include <math.h>
+
+#define OMEGA_E    7.2921159e-5  // earth rotation (rad/s)
+#define RATE_MARGIN 1.2          // on max. rate of geocentric angle
+#define PSI_MARGIN D2R(3.)       // geodetic/geocentric lat., refraction-free horizon etc.
+#define PASS_NR_FINE 60          // fine steps per orbit
+#define ROOT_TOL 0.05            // s, AOS/LOS
+#define MAX_TOL  1.0             // s, TCA
+#define GOLDEN 0.381966011
+#define PASS_MAX 86400.          // s; pass not longer (geostationary: always up)
+
+/*********************************************************************
+ * Elevation (degr) at time 't'
+ * skip: if not NULL: time (s) in which the satellite surely stays
+ *       below the horizon; 0 if it may be near/above.
+ * azim: if not NULL: azimuth (degr)
+ *********************************************************************/
+static double elev_at(KEPLER *kepler,EPOINT *refpos,double t,double *skip,float *azim)
+{
+  DIR dir;
+  EPOINT ss;
+  double height=calc_sat_dir(t,kepler,refpos,&dir,&ss);
+  if (azim) *azim=R2D(dir.azim);
+  if (skip)
+  {
+    double cpsi=sin(refpos->lat)*sin(ss.lat)+cos(refpos->lat)*cos(ss.lat)*cos(ss.lon-refpos->lon);
+    double psi=acos(MIN(1.,cpsi));                  // geocentric angle observer - sub-sat.
+    double lambda0=acos(Rearth/(Rearth+(MAX(height,0.))));  // ... at horizon
+    double rate=(kepler->motion*PIx2/86400.+OMEGA_E)*RATE_MARGIN;
+    *skip=MAX((psi-lambda0-PSI_MARGIN)/rate,0.);
+  }
+  return R2D(dir.elev);
+}
+
+// horizon crossing in [ta,tb] (elevations ea, eb of opposite sign): Illinois
+static double root(KEPLER *kepler,EPOINT *refpos,double ta,double ea,double tb,double eb)
+{
+  double t=tb,e;
+  int side=0,i;
+  for (i=0; (i<40) && (tb-ta>ROOT_TOL); i++)
+  {
+    t=(ta*eb-tb*ea)/(eb-ea);
+    e=elev_at(kepler,refpos,t,NULL,NULL);
+    if ((e>=0.)==(eb>=0.))
+    {
+      tb=t; eb=e;
+      if (side==1) ea/=2.;
+      side=1;
+    }
+    else
+    {
+      ta=t; ea=e;
+      if (side==-1) eb/=2.;
+      side=-1;
+    }
+    if (fabs(e)<1e-6) break;
+  }
+  return t;
+}
+
+// time of max. elevation in [ta,tb]: golden section; *emax: max. elevation
+static double max_elev(KEPLER *kepler,EPOINT *refpos,double ta,double tb,double *emax)
+{
+  double t1=ta+GOLDEN*(tb-ta),t2=tb-GOLDEN*(tb-ta);
+  double e1=elev_at(kepler,refpos,t1,NULL,NULL);
+  double e2=elev_at(kepler,refpos,t2,NULL,NULL);
+  while (tb-ta>MAX_TOL)
+  {
+    if (e1>e2)
+    {
+      tb=t2; t2=t1; e2=e1;
+      t1=ta+GOLDEN*(tb-ta);
+      e1=elev_at(kepler,refpos,t1,NULL,NULL);
+    }
+    else
+    {
+      ta=t1; t1=t2; e1=e2;
+      t2=tb-GOLDEN*(tb-ta);
+      e2=elev_at(kepler,refpos,t2,NULL,NULL);
+    }
+  }
+  if (e1>e2) { *emax=e1; return t1; }
+  *emax=e2; return t2;
+}
+
+/*********************************************************************
+ * From 't_up' (above horizon, after AOS): TCA, max. elevation and LOS
+ * LOS not after 't_max'
+ *********************************************************************/
+static void pass_rest(KEPLER *kepler,EPOINT *refpos,double t_up,double dt,double t_max,PASS *pass)
+{
+  double t=t_up,e,tp,ep,tbest=t_up,ebest,emax;
+  ebest=elev_at(kepler,refpos,t,NULL,NULL);
+  e=ebest;
+  do
+  {
+    tp=t; ep=e;
+    t+=dt;
+    e=elev_at(kepler,refpos,t,NULL,NULL);
+    if (e>ebest) { ebest=e; tbest=t; }
+  } while ((e>=0.) && (t<t_max));
+  pass->los=(e>=0.? t : root(kepler,refpos,tp,ep,t,e));
+  pass->tca=max_elev(kepler,refpos,MAX(tbest-dt,pass->aos),MIN(tbest+dt,pass->los),&emax);
+  pass->max_elev=MAX(emax,ebest);
+  elev_at(kepler,refpos,pass->aos,NULL,&pass->aos_azim);
+  elev_at(kepler,refpos,pass->los,NULL,&pass->los_azim);
+}
+
+/*********************************************************************
+ * Next pass at or after 't0', AOS before 't_end'.
+ * If the satellite is above the horizon at 't0': that pass (AOS <= t0).
+ * return: 1: found, pass filled; 0: no pass before t_end
+ *********************************************************************/
+int find_next_pass(KEPLER *kepler,EPOINT *refpos,double t0,double t_end,PASS *pass)
+{
+  double dt=86400./kepler->motion/PASS_NR_FINE;   // fine step: part of orbit
+  double t,e,skip,tp=0.,ep=0.,tpp=0.,epp=0.;
+  int nsamp=0;
+
+  if (kepler->motion<=0.) return 0;
+  for (t=t0; t<t_end; )
+  {
+    e=elev_at(kepler,refpos,t,&skip,NULL);
+    if ((e>=0.) && (!nsamp))                     // in pass (at t0): back to AOS
+    {
+      for (tp=t,ep=e; (ep>=0.) && (t0-tp<PASS_MAX); )
+      {
+        t=tp; e=ep;
+        tp-=dt;
+        ep=elev_at(kepler,refpos,tp,NULL,NULL);
+      }
+    }
+    if (e>=0.)                                     // rising
+    {
+      pass->aos=(ep>=0.? tp : root(kepler,refpos,tp,ep,t,e));
+      pass_rest(kepler,refpos,t,dt,(MAX(t,t0))+PASS_MAX,pass);
+      return 1;
+    }
+    if ((nsamp>=2) && (ep>epp) && (ep>e))         // max. below horizon between samples?
+    {
+      double emax,tm=max_elev(kepler,refpos,tpp,t,&emax);
+      if (emax>=0.)                                // short, grazing pass
+      {
+        pass->aos=root(kepler,refpos,tpp,epp,tm,emax);
+        pass_rest(kepler,refpos,tm,MIN(dt,(t-tm)/2.),tm+PASS_MAX,pass);
+        return 1;
+      }
+    }
+    if (skip>dt)                                   // far away: jump
+    {
+      t+=skip;
+      nsamp=0;
+      continue;
+    }
+    tpp=tp; epp=ep;
+    tp=t; ep=e;
+    nsamp++;
+    t+=dt;
+  }
+  return 0;
+}
@@ -0,0 +1,494 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Pass plan: precalculated satellite pass
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * The coming (or current) pass is calculated once with SGP4 at
+ * PLAN_STEP seconds into a table; setpoints in between are made by
+ * cubic Hermite interpolation. So no SGP4 in the loop, and smooth
+ * setpoints (and rates) at any time instead of a 1 s staircase.
+ *
+ * With each plan, before AOS, the whole pass is checked: the rotor
+ * positions are chosen for the lowest peak rate (plan_solution()), and
+ * the rates needed are kept with the max. rates of the rotors, so it
+ * is known in advance whether the pass can be tracked (get_plan).
+ * Elevation/azimuth rotors with east/west info: east pass, west pass
+ * (azimuth-180, elevation over zenith) or a flip between them at the
+ * culmination, so a high pass needs no fast 180 degr. azimuth turn.
+ * The slew from park to the AOS direction is timed (coordinated, see
+ * sc_sync()); the rotors leave park in time for it.
+ *
+ * public functions:
+ *   void plan_reset(PASS_PLAN *plan)
+ *   int plan_pass(PASS_PLAN *plan,KEPLER *kepler,EPOINT *refpos,long t)
+ *   int plan_interp(PASS_PLAN *plan,double t,GOTO_VAL *gv)
+ *   double plan_lead(PASS_PLAN *plan)
+ *   boolean calc_pos_plan(GOTO_VAL *gv,PASS_PLAN *plan,KEPLER *kepler,EPOINT *refpos)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+#include <time.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#ifndef ROTOR_AX_STOP
+  #define ROTOR_AX_STOP 90
+#endif
+#ifndef ROTOR_EY_STOP
+  #define ROTOR_EY_STOP 90
+#endif
+
+#ifndef PREPOS_LEAD
+  #define PREPOS_LEAD 0
+#endif
+
+#define NRVAL 9                  // nr. of floats in PLAN_POINT
+#define PREPOS_MARGIN 10         // s, leave park this much before end of slew to AOS
+
+// satellite at time t into plan point p
+static void plan_point(KEPLER *kepler,EPOINT *refpos,long t,PLAN_POINT *p)
+{
+  DIR dir;
+  EPOINT pos_subsat;
+  p->height=calc_sat_dir(t,kepler,refpos,&dir,&pos_subsat);
+  p->a=R2D(dir.azim);
+  p->e=R2D(dir.elev);
+  p->x=R2D(dir.x);
+  p->y=R2D(dir.y);
+  p->lon=R2D(pos_subsat.lon);
+  p->lat=R2D(pos_subsat.lat);
+}
+
+// make 'val' continuous with 'prev' (steps of 360 degrees)
+static float unwrap(float val,float prev)
+{
+  while (val-prev > 180.) val-=360.;
+  while (val-prev <-180.) val+=360.;
+  return val;
+}
+
+static float wrap360(float val)
+{
+  val=fmod(val,360.);
+  if (val<0.) val+=360.;
+  return val;
+}
+
+static float wrap180(float val)
+{
+  val=wrap360(val);
+  if (val>180.) val-=360.;
+  return val;
+}
+
+// rotors to park position
+static boolean park(GOTO_VAL *gv)
+{
+  gv->ax=ROTOR_AX_STOP;
+  gv->ey=ROTOR_EY_STOP;
+  gv->vax=0.;
+  gv->vey=0.;
+  return false;
+}
+
+/*********************************************************************
+ * Rotor position 'ax', 'ey' of plan point 'p'.
+ * Elevation/azimuth, not 'east': west-pass solution (as convert_eastwest());
+ *   azimuth in rotor range (as rotor_track()), or unwrapped with
+ *   FULLRANGE_AZIM (rotor_track() counts the rounds).
+ *********************************************************************/
+static void rotor_pos(PLAN_POINT *p,boolean east,float *ax,float *ey)
+{
+  #if ROTORTYPE == ROTORTYPE_XY
+    (void)east;                  // no east/west solution
+    *ax=p->x;
+    *ey=p->y;
+  #else
+    #if FULLRANGE_AZIM
+      *ax=p->a;
+    #else
+      *ax=wrap360(east? p->a : p->a-180.);
+      if (*ax>270.) *ax-=360.;
+    #endif
+    *ey=MAX(p->e,0.);
+    if (!east) *ey=180.-*ey;
+  #endif
+}
+
+#if USE_SCURVE
+// limits of the rotors (as setup_ax(), setup_ey())
+static void axis_limits(SCURVE *ax,SCURVE *ey)
+{
+  sc_set_limits(ax,AX_PROF_VMAX,AX_PROF_AMAX,AX_PROF_JMAX);
+  sc_set_limits(ey,EY_PROF_VMAX,EY_PROF_AMAX,EY_PROF_JMAX);
+}
+
+// coordinated slew time (s) from park to AOS direction, solution 'east'
+static float slew_time(PASS_PLAN *plan,boolean east)
+{
+  SCURVE ax,ey;                  // limits only
+  float pax,pey;
+  float tax,tey;
+  axis_limits(&ax,&ey);
+  rotor_pos(&plan->p[0],east,&pax,&pey);
+  tax=sc_move_time(&ax,pax-ROTOR_AX_STOP);
+  tey=sc_move_time(&ey,pey-ROTOR_EY_STOP);
+  return MAX(tax,tey);
+}
+#endif
+
+/*********************************************************************
+ * Rotor position 'ax', 'ey' of point 'i' for solution 'east' before
+ * p[flip], the other one from there (flip>=n: no flip). Keyhole: 'kh'
+ * points each side of the flip get the azimuth interpolated between
+ * the points around them, instead of the fast turn near the zenith.
+ *********************************************************************/
+static void plan_pos(PASS_PLAN *plan,int i,boolean east,int flip,int kh,float *ax,float *ey)
+{
+  float ax0,ax1,dum;
+  rotor_pos(&plan->p[i],(i<flip? east : !east),ax,ey);
+  if ((kh<=0) || (i<flip-kh) || (i>=flip+kh)) return;
+  rotor_pos(&plan->p[flip-kh-1],east,&ax0,&dum);
+  rotor_pos(&plan->p[flip+kh],!east,&ax1,&dum);
+  *ax=ax0+(ax1-ax0)*(i-flip+kh+1)/(2*kh+1);
+}
+
+#if ROTORTYPE == ROTORTYPE_AE && USE_EASTWEST
+// angle (degr) between satellite of point 'p' and rotor direction 'ax', 'ey'
+static float point_err(PLAN_POINT *p,float ax,float ey)
+{
+  float c;
+  if (ey>90.) { ax+=180.; ey=180.-ey; }
+  c=sin(D2R(p->e))*sin(D2R(ey))+cos(D2R(p->e))*cos(D2R(ey))*cos(D2R(p->a-ax));
+  return R2D(acos(c>1.? 1. : c));
+}
+#endif
+
+/*********************************************************************
+ * Peak rates 'rax', 'rey' (degr/s) and max. pointing error 'err' of
+ * the plan with solution 'east', 'flip', 'kh' (see plan_pos()).
+ * From the table, as the rotors get it (plan_interp()).
+ * return: false if azimuth leaves the rotor range (SET_AZIM_*)
+ *********************************************************************/
+static boolean plan_rates(PASS_PLAN *plan,boolean east,int flip,int kh,
+                          float *rax,float *rey,float *err)
+{
+  float ax,ey,pax=0.,pey=0.,r;
+  boolean fits=true;
+  int i;
+  *rax=*rey=*err=0.;
+  for (i=0; i<plan->n; i++)
+  {
+    plan_pos(plan,i,east,flip,kh,&ax,&ey);
+    #if ROTORTYPE == ROTORTYPE_AE && USE_EASTWEST
+      r=wrap360(ax);
+      if ((plan->p[i].e>=0.) && (r > SET_AZIM_MAX) && (r < SET_AZIM_MIN)) fits=false;
+      if (kh)
+      {
+        r=point_err(&plan->p[i],ax,ey); if (r>*err) *err=r;
+      }
+    #endif
+    if (i)
+    {
+      r=fabs(ax-pax)/PLAN_STEP; if (r>*rax) *rax=r;
+      r=fabs(ey-pey)/PLAN_STEP; if (r>*rey) *rey=r;
+    }
+    pax=ax;
+    pey=ey;
+  }
+  return fits;
+}
+
+/*********************************************************************
+ * Solution 'east', 'flip', 'kh' (see plan_pos()) into the plan if it
+ * is better than the one there (peak rate 'm_best' relative to max.
+ * rate, <0: none yet): lower peak rate; about the same: shorter slew.
+ *********************************************************************/
+static void try_solution(PASS_PLAN *plan,boolean east,int flip,int kh,float *m_best)
+{
+  float rax,rey,err,m,slew=0.;
+  if (!plan_rates(plan,east,flip,kh,&rax,&rey,&err)) return;
+  #ifdef KEYHOLE_ERR
+    if (err>KEYHOLE_ERR) return;
+  #endif
+  if (plan->vmax_ax) rax/=plan->vmax_ax;
+  if (plan->vmax_ey) rey/=plan->vmax_ey;
+  m=(rax>rey? rax : rey);
+  #if USE_SCURVE
+    slew=slew_time(plan,east);
+  #endif
+  if ((*m_best<0.) || (m<*m_best*0.99) || ((m<*m_best*1.01) && (slew<plan->slew_s)))
+  {
+    *m_best=m;
+    plan->east_pass=east;
+    plan->flip=flip;
+    plan->keyhole=kh;
+    plan->slew_s=slew;
+  }
+}
+
+/*********************************************************************
+ * Choose how the rotors follow the pass, before AOS, from the whole
+ * pass: the solution with the lowest peak rate, relative to the max.
+ * rate of each rotor. Elevation/azimuth with east/west info: east or
+ * west pass, or a flip from one to the other around the culmination:
+ * elevation over the zenith, azimuth interpolated over the keyhole as
+ * long as the dish points within KEYHOLE_ERR. About equal rates: the
+ * one with the shortest slew from park.
+ * Fills rotor positions ax, ey of the table, peak and max. rates,
+ * pointing error and slew time.
+ *********************************************************************/
+#define FLIP_RANGE 2             // flip at culmination +/- this nr. of points
+#define KEYHOLE_MAX 8            // max. nr. of points each side of the flip
+static void plan_solution(PASS_PLAN *plan)
+{
+  float m_best=-1.;
+  int i;
+  #if ROTORTYPE == ROTORTYPE_AE && USE_EASTWEST
+    int kh,i_max=0;
+  #endif
+
+  plan->vmax_ax=plan->vmax_ey=0.;
+  #if USE_SCURVE
+  {
+    SCURVE ax,ey;
+    axis_limits(&ax,&ey);
+    plan->vmax_ax=ax.vmax;
+    plan->vmax_ey=ey.vmax;
+  }
+  #endif
+
+  plan->east_pass=true;
+  plan->flip=plan->n;
+  plan->keyhole=0;
+  plan->slew_s=0.;
+  try_solution(plan,true,plan->n,0,&m_best);
+  #if ROTORTYPE == ROTORTYPE_AE && USE_EASTWEST
+    try_solution(plan,false,plan->n,0,&m_best);
+    for (i=0; i<plan->n; i++) if (plan->p[i].e>plan->p[i_max].e) i_max=i;
+    for (i=i_max-FLIP_RANGE; i<=i_max+FLIP_RANGE; i++)
+    {
+      for (kh=0; kh<=KEYHOLE_MAX; kh++)
+      {
+        if ((i-kh<1) || (i+kh>=plan->n)) break;
+        try_solution(plan,true,i,kh,&m_best);
+        try_solution(plan,false,i,kh,&m_best);
+      }
+    }
+  #endif
+  // none fits (shouldn't happen): east, as convert_eastwest() would
+  plan->fits=plan_rates(plan,plan->east_pass,plan->flip,plan->keyhole,
+                        &plan->rate_ax,&plan->rate_ey,&plan->err_max);
+
+  for (i=0; i<plan->n; i++)
+    plan_pos(plan,i,plan->east_pass,plan->flip,plan->keyhole,&plan->p[i].ax,&plan->p[i].ey);
+}
+
+void plan_reset(PASS_PLAN *plan)
+{
+  plan->n=0;
+  plan->t_retry=0;
+}
+
+/*********************************************************************
+ * Calculate pass at or after 't':
+ *   above horizon at 't': from 't' until LOS
+ *   else: next AOS within PLAN_SCAN_MAX (find_next_pass())
+ * Table starts just before AOS (or at 't') and ends 1 step after LOS,
+ *   or when full.
+ * return: nr. of points; 0: no pass found (plan->t_retry set)
+ *********************************************************************/
+int plan_pass(PASS_PLAN *plan,KEPLER *kepler,EPOINT *refpos,long t)
+{
+  PASS pass;
+  int i;
+
+  plan->n=0;
+  if (!find_next_pass(kepler,refpos,t,t+PLAN_SCAN_MAX,&pass))
+  {
+    plan->t_retry=t+PLAN_SCAN_MAX;   // a pass then in progress is found too
+    return 0;
+  }
+  if (pass.aos>t) t=(long)floor(pass.aos)-1;    // just below horizon
+
+  plan->t0=t;
+  for (i=0; i<PLAN_SIZE; i++)
+  {
+    plan_point(kepler,refpos,t+(long)i*PLAN_STEP,&plan->p[i]);
+    if (i)
+    {
+      plan->p[i].a=unwrap(plan->p[i].a,plan->p[i-1].a);
+      plan->p[i].lon=unwrap(plan->p[i].lon,plan->p[i-1].lon);
+    }
+    if ((i) && (plan->p[i].e<0.) && (plan->p[i-1].e>=0.))
+    {
+      i++;                       // 1 point after LOS
+      break;
+    }
+  }
+  plan->n=i;
+  plan->t_retry=0;
+  plan_solution(plan);
+  return plan->n;
+}
+
+/*********************************************************************
+ * Interpolate plan at time 't' (s, with fraction) into 'gv':
+ *   ax, ey, vax, vey and a, e, x, y, lon, lat, height
+ * Cubic Hermite; tangents from neighbour points.
+ * Below horizon before AOS (plan starts just before it): the rotor
+ *   positions of the table, from the AOS direction of prepos() on, so
+ *   the setpoint is continuous at t0 and AOS; after LOS: park.
+ * return: -1: 't' outside plan, 0: below horizon, 1: above horizon
+ *********************************************************************/
+int plan_interp(PASS_PLAN *plan,double t,GOTO_VAL *gv)
+{
+  float *p0,*p1,*pm,*pp;
+  float val[NRVAL],rate[NRVAL];
+  double s;
+  float h00,h10,h01,h11,d00,d10,d01,d11;
+  int i,k;
+
+  if (plan->n<2) return -1;
+  s=(t-plan->t0)/PLAN_STEP;
+  i=(int)floor(s);
+  if ((i<0) || (i>=plan->n-1)) return -1;
+  s-=i;
+
+  p0=&plan->p[i].a;
+  p1=&plan->p[i+1].a;
+  pm=(i>0? &plan->p[i-1].a : p0);                 // one-sided at ends
+  pp=(i+2<plan->n? &plan->p[i+2].a : p1);
+
+  h00=(1.+2.*s)*(1.-s)*(1.-s);
+  h10=s*(1.-s)*(1.-s);
+  h01=s*s*(3.-2.*s);
+  h11=s*s*(s-1.);
+  d00=6.*s*(s-1.);                                // derivatives to s
+  d10=(1.-s)*(1.-3.*s);
+  d01=-d00;
+  d11=s*(3.*s-2.);
+  for (k=0; k<NRVAL; k++)
+  {
+    float m0=(p1[k]-pm[k])/(p0==pm? 1. : 2.);     // tangents per step
+    float m1=(pp[k]-p0[k])/(pp==p1? 1. : 2.);
+    val[k]=h00*p0[k]+h10*m0+h01*p1[k]+h11*m1;
+    rate[k]=(d00*p0[k]+d10*m0+d01*p1[k]+d11*m1)/PLAN_STEP;
+  }
+
+  // same order as PLAN_POINT
+  gv->a=wrap360(val[0]);
+  gv->e=val[1];
+  gv->x=val[2];
+  gv->y=val[3];
+  gv->lon=wrap180(val[4]);
+  gv->lat=val[5];
+  gv->height=val[6];
+  gv->t_calc=(long)t;
+
+  if (gv->e < 0.)
+  {
+    for (k=0; (k<=i) && (plan->p[k].e<0.); k++);
+    if (k<=i) return park(gv);                    // after LOS
+  }                                               // before AOS: from prepos() point on
+  gv->ax=val[7];                                  // solution of plan_solution()
+  gv->ey=val[8];
+  gv->vax=rate[7];
+  gv->vey=rate[8];
+  #if ROTORTYPE == ROTORTYPE_AE
+    gv->ax=wrap360(gv->ax);
+    #if USE_EASTWEST
+      gv->east_pass=(i<plan->flip? plan->east_pass : !plan->east_pass);
+      gv->eastwest_pass_info=true;
+    #endif
+  #endif
+  return (gv->e >= 0.);
+}
+
+/*********************************************************************
+ * Time (s) before plan->t0 the rotors leave park for the AOS direction:
+ * PREPOS_LEAD, longer if the slew takes longer (0: park until AOS).
+ *********************************************************************/
+double plan_lead(PASS_PLAN *plan)
+{
+  double lead=PREPOS_LEAD;         // double: t0 doesn't fit a float
+  if ((lead) && (lead<plan->slew_s+PREPOS_MARGIN)) lead=plan->slew_s+PREPOS_MARGIN;
+  return lead;
+}
+
+/*********************************************************************
+ * Before AOS: park, or AOS direction (first point of plan) from
+ * plan_lead() s before the plan starts.
+ *********************************************************************/
+static boolean prepos(GOTO_VAL *gv,PASS_PLAN *plan,double t)
+{
+  PLAN_POINT *p=&plan->p[0];
+  if (t<plan->t0-plan_lead(plan)) return park(gv);
+  gv->ax=p->ax;
+  gv->ey=p->ey;
+  #if ROTORTYPE == ROTORTYPE_AE
+    gv->ax=wrap360(gv->ax);
+  #endif
+  gv->vax=0.;
+  gv->vey=0.;
+  return false;
+}
+
+/*********************************************************************
+ * As calc_pos(), but from pass plan, at current time (sub-second).
+ * Before the planned pass: park; PREPOS_LEAD s (or the slew time) before
+ *   AOS to AOS direction.
+ * After it (or time jumped): make a new plan; if no pass is found
+ *   park until plan->t_retry.
+ * Falls back to calc_pos() if the plan doesn't cover current time.
+ *********************************************************************/
+boolean calc_pos_plan(GOTO_VAL *gv,PASS_PLAN *plan,KEPLER *kepler,EPOINT *refpos)
+{
+  struct timeval tv;
+  double t;
+  int ret;
+
+  gettimeofday(&tv,NULL);
+  t=tv.tv_sec+tv.tv_usec*1e-6;
+  if ((plan->n) && (t<plan->t0) && (t>plan->t0-PLAN_SCAN_MAX-PLAN_STEP))
+    return prepos(gv,plan,t);                  // waiting for AOS
+
+  ret=plan_interp(plan,t,gv);
+  if (ret<0)
+  {
+    if ((!plan->n) && (tv.tv_sec<plan->t_retry) && (plan->t_retry-tv.tv_sec<=PLAN_SCAN_MAX))
+      return park(gv);                         // no pass found recently
+
+    plan_pass(plan,kepler,refpos,tv.tv_sec);
+    if (!plan->n) return park(gv);             // no pass within PLAN_SCAN_MAX
+    if (t<plan->t0) return prepos(gv,plan,t);
+    ret=plan_interp(plan,t,gv);
+  }
+  if (ret<0) return calc_pos(gv,kepler,refpos);
+  return (ret>0);
+}
@@ -0,0 +1,294 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content:
+ *   State in flash (ESP32 NVS, Preferences library), so a reset or
+ *   power blip doesn't need a calibration and a new upload from the PC:
+ *     "kepler": KEPLER incl. SGP4 constants (tle=, run_calc=)
+ *     "refpos": EPOINT (upload_refpos=)
+ *     "rotors": calibrated pulse counts, tracking on/off (loop())
+ *   Each record: header with PERSIST_VERSION, length and CRC of the
+ *   data; a record of another version or size is ignored.
+ *
+ *   Warm boot: the rotor positions are used instead of a calibration
+ *   only if they were saved at rest: the record is marked 'moving' at
+ *   the first pulse after it, and at the start of a calibration.
+ *   With zenith calibration the sensors must agree with the positions.
+ *   Writes stall the flash cache for some ms: only on commands, at the
+ *   start of a move and at rest (at most once per PERSIST_MIN_MS).
+ *
+ * public functions:
+ *   boolean persist_load_kepler(KEPLER *k)
+ *   boolean persist_load_refpos(EPOINT *refpos)
+ *   boolean persist_load_rotors(ROTOR *AX_rot,ROTOR *EY_rot)
+ *   boolean persist_run_calc(void)
+ *   void persist_save_kepler(KEPLER *k)
+ *   void persist_save_refpos(EPOINT *refpos)
+ *   void persist_moving(ROTOR *AX_rot,ROTOR *EY_rot)
+ *   void persist_poll(ROTOR *AX_rot,ROTOR *EY_rot)
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+
+#if USE_PERSIST
+#include <Preferences.h>
+
+#define PERSIST_NS "rotorctrl"
+#define PERSIST_MAGIC 0x5250     // "PR"
+#define PERSIST_VERSION 1        // +1 if a record or the SGP4 constants change
+
+#define KEY_KEPLER "kepler"
+#define KEY_REFPOS "refpos"
+#define KEY_ROTORS "rotors"
+
+#if USE_SGP4
+  #define PERSIST_MAXREC sizeof(KEPLER)
+#else
+  #define PERSIST_MAXREC sizeof(PERSIST_ROT)
+#endif
+
+extern COMMANDS command;
+
+static Preferences prefs;
+static uint8_t pbuf[sizeof(PERSIST_HDR)+PERSIST_MAXREC];
+static PERSIST_ROT prot;         // rotor record as in flash
+
+// write 'data' (len bytes) with header as record 'key'
+static boolean put_rec(const char *key,const void *data,int len)
+{
+  PERSIST_HDR *h=(PERSIST_HDR *)pbuf;
+  size_t n;
+  if (len>(int)PERSIST_MAXREC) return false;
+  memset(h,0,sizeof(PERSIST_HDR));
+  h->magic=PERSIST_MAGIC;
+  h->version=PERSIST_VERSION;
+  h->len=len;
+  h->crc=bin_crc(0xffff,(const uint8_t *)data,len);
+  memcpy(pbuf+sizeof(PERSIST_HDR),data,len);
+  if (!prefs.begin(PERSIST_NS,false)) return false;
+  n=prefs.putBytes(key,pbuf,sizeof(PERSIST_HDR)+len);
+  prefs.end();
+  return (n==sizeof(PERSIST_HDR)+len);
+}
+
+// record 'key' of 'len' bytes into pbuf
+// return: its data; NULL: none, other version or size, bad CRC
+static uint8_t *read_rec(const char *key,int len)
+{
+  PERSIST_HDR *h=(PERSIST_HDR *)pbuf;
+  size_t n;
+  if (len>(int)PERSIST_MAXREC) return NULL;
+  if (!prefs.begin(PERSIST_NS,true)) return NULL;
+  n=prefs.getBytes(key,pbuf,sizeof(pbuf));
+  prefs.end();
+  if (n!=sizeof(PERSIST_HDR)+len) return NULL;
+  if ((h->magic!=PERSIST_MAGIC) || (h->version!=PERSIST_VERSION) || (h->len!=len)) return NULL;
+  if (bin_crc(0xffff,pbuf+sizeof(PERSIST_HDR),len)!=h->crc) return NULL;
+  return pbuf+sizeof(PERSIST_HDR);
+}
+
+static boolean get_rec(const char *key,void *data,int len)
+{
+  uint8_t *p;
+  if (!(p=read_rec(key,len))) return false;
+  memcpy(data,p,len);
+  return true;
+}
+
+// write record only if different from the one in flash
+static void update_rec(const char *key,const void *data,int len)
+{
+  uint8_t *p=read_rec(key,len);
+  if ((p) && (!memcmp(p,data,len))) return;
+  put_rec(key,data,len);
+}
+
+#if USE_SGP4
+boolean persist_load_kepler(KEPLER *k)
+{
+  if (!k) return false;
+  return get_rec(KEY_KEPLER,k,sizeof(KEPLER));
+}
+
+boolean persist_load_refpos(EPOINT *refpos)
+{
+  if (!refpos) return false;
+  return get_rec(KEY_REFPOS,refpos,sizeof(EPOINT));
+}
+
+// after calc_sgp4_const(): constants are saved too
+void persist_save_kepler(KEPLER *k)
+{
+  if (!k) return;
+  update_rec(KEY_KEPLER,k,sizeof(KEPLER));
+}
+
+void persist_save_refpos(EPOINT *refpos)
+{
+  if (!refpos) return;
+  update_rec(KEY_REFPOS,refpos,sizeof(EPOINT));
+}
+#endif
+
+// rotor settings the pulse counts depend on; other settings: calibrate
+static uint16_t cfg_crc(void)
+{
+  long cfg[]={ AX_STEPS_DEGR,EY_STEPS_DEGR,AX_POffset,EY_POffset,
+               (long)(AX_REFPOS*100.),(long)(EY_REFPOS*100.),
+               ROTORTYPE,MOTORTYPE,SWAP_DIR,CAL_ZENITH };
+  return bin_crc(0xffff,(const uint8_t *)cfg,sizeof(cfg));
+}
+
+static void save_rotors(ROTOR *AX_rot,ROTOR *EY_rot,boolean at_rest)
+{
+  PERSIST_ROT r;
+  memset(&r,0,sizeof(r));
+  r.cfg=cfg_crc();
+  r.at_rest=at_rest;
+  #if USE_SGP4
+    r.run_calc=((command.run_calc) && (!command.run_sched));
+  #endif
+  if (AX_rot) r.rotated[0]=AX_rot->rotated;
+  if (EY_rot) r.rotated[1]=EY_rot->rotated;
+  put_rec(KEY_ROTORS,&r,sizeof(r));
+  prot=r;                        // also if failed: no retry each loop
+}
+
+#if CAL_ZENITH
+// zenith sensor as expected at pulse count 'rotated'? (not checked near the edge)
+static boolean zen_agrees(ROTOR *rot,long rotated)
+{
+  float degr,zen_degr;
+  if (!rot) return true;
+  degr=(float)rotated*360./(float)rot->steps_degr;
+  zen_degr=(rot->id==AX_ID? AX_REFPOS : EY_REFPOS);
+  if (fabs(degr-zen_degr) < PERSIST_ZEN_MARGIN) return true;
+  return (get_zenpos(rot)==(degr > zen_degr? 1 : 0));
+}
+#endif
+
+// as end of run_to_cal_pos()
+static void restore_rot(ROTOR *rot,long rotated)
+{
+  if (!rot) return;
+  rot->rotated=rotated;
+  rot->degr=to_degr(rot);
+  #if MOTORTYPE == MOT_STEPPER                // stepper counts itself
+    CMDP(rot,setCurrentPosition(rot->rotated));
+  #endif
+  rot->calibrated=true;
+  rot->cal_status=cal_ready;
+}
+
+/*********************************************************************
+ * Warm boot: calibrated rotor positions from flash.
+ * Only if saved at rest, by the same rotor settings, and (zenith
+ *   calibration) the zenith sensors agree: not turned by hand while off.
+ * return: true if positions restored (rotors calibrated), else calibrate
+ *********************************************************************/
+boolean persist_load_rotors(ROTOR *AX_rot,ROTOR *EY_rot)
+{
+  PERSIST_ROT r;
+  if (!get_rec(KEY_ROTORS,&r,sizeof(r))) return false;
+  prot=r;
+  if ((!r.at_rest) || (r.cfg!=cfg_crc())) return false;
+  #if CAL_ZENITH
+    if ((!zen_agrees(AX_rot,r.rotated[0])) || (!zen_agrees(EY_rot,r.rotated[1])))
+    {
+      xprintf("MES: zenith sensor doesn't match stored position\n");
+      return false;
+    }
+  #endif
+  restore_rot(AX_rot,r.rotated[0]);
+  restore_rot(EY_rot,r.rotated[1]);
+  return true;
+}
+
+// tracking was on at the last save (valid after persist_load_rotors())
+boolean persist_run_calc(void)
+{
+  return prot.run_calc;
+}
+
+// rotors start moving outside loop() (calibration): positions invalid
+void persist_moving(ROTOR *AX_rot,ROTOR *EY_rot)
+{
+  if (prot.at_rest) save_rotors(AX_rot,EY_rot,false);
+}
+
+static boolean cal_ok(ROTOR *rot)
+{
+  return ((!rot) || (rot->cal_status==cal_ready));
+}
+
+/*********************************************************************
+ * From loop(): rotor record up to date.
+ *   - first pulse after a save at rest: marked 'moving' at once
+ *   - tracking switched on/off: saved at once
+ *   - calibrated and no pulses for PERSIST_REST_MS: saved at rest,
+ *     at most once per PERSIST_MIN_MS
+ *********************************************************************/
+void persist_poll(ROTOR *AX_rot,ROTOR *EY_rot)
+{
+  static boolean started;
+  static long prev[2];
+  static unsigned long t_moved,t_write;
+  unsigned long t=millis();
+  long pos[2];
+  boolean run=false,moved;
+
+  pos[0]=(AX_rot? AX_rot->rotated : 0);
+  pos[1]=(EY_rot? EY_rot->rotated : 0);
+  #if USE_SGP4
+    run=((command.run_calc) && (!command.run_sched));
+  #endif
+  if ((!started) || (pos[0]!=prev[0]) || (pos[1]!=prev[1]))
+  {
+    prev[0]=pos[0];
+    prev[1]=pos[1];
+    t_moved=t;
+  }
+  if (!started) t_write=t-PERSIST_MIN_MS;
+  started=true;
+
+  moved=((pos[0]!=prot.rotated[0]) || (pos[1]!=prot.rotated[1]));
+  if ((prot.at_rest) && (moved))
+  {
+    save_rotors(AX_rot,EY_rot,false);
+  }
+  else if (run!=prot.run_calc)
+  {
+    save_rotors(AX_rot,EY_rot,prot.at_rest);
+  }
+  else if ((!prot.at_rest) && (cal_ok(AX_rot)) && (cal_ok(EY_rot)) &&
+           (t-t_moved>=PERSIST_REST_MS) && (t-t_write>=PERSIST_MIN_MS))
+  {
+    save_rotors(AX_rot,EY_rot,true);
+    t_write=t;
+  }
+}
+
+#endif
@@ -56,8 +56,11 @@ void AX_set_pins(ROTOR *rot)
 
   rot->pin_end1=PIN_ENDSW1_AX;
   rot->pin_end2=PIN_ENDSW2_AX;
+  rot->pin_pls=PIN_ROTPLS_AX;
+  rot->pin_plsb=PIN_ROTPLSB_AX;
 
   set_pinmode(PIN_ROTPLS_AX, INPUT);        // dc rotor fb pulses
+  set_pinmode(rot->pin_plsb, INPUT);        // dc rotor fb pulses, channel B
   set_pinmode(rot->pin_zen,  INPUT);        // zenith detect
   set_pinmode(rot->pin_pwm,  OUTPUT);       // rotor speed or step
   set_pinmode(rot->pin_dir,  OUTPUT);       // rotor direction
@@ -101,8 +104,11 @@ void EY_set_pins(ROTOR *rot)
 
   rot->pin_end1=PIN_ENDSW1_EY;
   rot->pin_end2=PIN_ENDSW2_EY;
+  rot->pin_pls=PIN_ROTPLS_EY;
+  rot->pin_plsb=PIN_ROTPLSB_EY;
 
   set_pinmode(PIN_ROTPLS_EY, INPUT);        // dc rotor fb pulses
+  set_pinmode(rot->pin_plsb, INPUT);        // dc rotor fb pulses, channel B
   set_pinmode(rot->pin_zen,  INPUT);        // zenith detect
   set_pinmode(rot->pin_pwm,  OUTPUT);       // rotor speed or step
   set_pinmode(rot->pin_dir,  OUTPUT);       // rotor direction
@@ -57,17 +57,44 @@
   // use SGP4-calc. in controller (needs wifi)
   #define USE_SGP4 true
   #define CAL_AFTER_TRACK true
+  #define CAL_TIME 60         // s needed for calibration; after a pass only if this fits before next AOS
+  #define PREPOS_LEAD 60      // s before AOS: rotors to AOS direction (0: park until AOS)
+  #define USE_PASSPLAN true   // interpolate precalculated pass (else SGP4 each second)
+  #define USE_SGP4F true      // SGP4 in float (ESP32 FPU), else double
+  #define USE_SCHEDULER true  // catalogue of satellites, passes scheduled in controller
 
   // use webserver
+  #ifndef ADD_OTA_UPLOAD
   #define ADD_OTA_UPLOAD true
+  #endif
 
 #else
   #define USE_SGP4 false  // Don't change!
 #endif
 
+// binary framed protocol next to text, on serial and wifi (see binproto.cpp)
+#define USE_BINPROTO true
+
 // Define processor
 #define PROCESSOR PROC_ESP
 
+// Rotor control from a fixed-rate timer task (ESP only), else from loop()
+#if PROCESSOR==PROC_ESP
+  #define USE_CTRL_TASK true
+  #define CTRL_PERIOD_US 1000      // control period (us), 1 kHz
+  #define CTRL_TASK_PRIO 10        // above loop() (1), below WiFi/esp_timer
+#else
+  #define USE_CTRL_TASK false
+#endif
+
+// Output (serial, wifi, display) queued and sent by a task (ESP only), else from loop()
+#if PROCESSOR==PROC_ESP
+  #define USE_OUT_TASK true
+  #define OUT_TASK_PRIO 2          // above loop() (1), below control
+#else
+  #define USE_OUT_TASK false
+#endif
+
 // Set rotortype
 #ifndef ROTORTYPE
 #define ROTORTYPE ROTORTYPE_XY
@@ -98,15 +125,70 @@
   #define EY_MAXSPEED 100          // max. speed (% of max. voltage)
   #define L_DEGR_MAXSPEED 10.      // >= diff-degrees where rotorspeed is max.
   #define H_DEGR_MINSPEED 2.       // <= diff-degrees where rotorspeed is min.
-  #define D_DEGR_STOP 0.2          // <= diff-degrees to stop rotor
+  #define D_DEGR_STOP 0.2          // ramp deadband: <= diff-degrees to stop rotor
+  #define ROTOR_TAU 0.15           // time constant of the rotor (s)
+
+  // Motion control: MOTION_RAMP (speed from error + ramp) or MOTION_PID
+  // Runtime: ctrl_pid=<0|1>, deadband=<degr>, pid=<kp>,<ki>,<kd>,<kff>
+  #define MOTION_CTRL MOTION_PID
+  #define PID_KP 40.               // speed% per degr error
+  #define PID_KI 20.               // speed% per degr*s
+  #define PID_KD 0.                // speed% per degr/s error rate (measured pulse rate)
+  #define PID_KFF 16.7             // speed% per degr/s sat. rate: 100/max. rotor rate
+  #define PID_TFF ROTOR_TAU        // s: feed-forward of profile acc.
+  #define PID_IMAX 30.             // max. integrator contribution (speed%)
+  #define PID_MINSPEED 15          // speed% where motor starts to turn
+  #define PID_DEADBAND 0.1         // PID deadband (degr)
+
+  // Position between pulses from pulse edges and times (alpha-beta filter);
+  // allows deadbands below 1 pulse
+  #define USE_POS_EST true
+
+  // MOTION_PID follows a jerk-limited profile (scurve.cpp) to the target:
+  // max. rate (degr/s, rotor max.), acceleration, jerk
+  #define USE_SCURVE true
+  #define AX_PROF_VMAX (100./PID_KFF)
+  #define AX_PROF_AMAX 20.
+  #define AX_PROF_JMAX 300.
+  #define EY_PROF_VMAX (100./PID_KFF)
+  #define EY_PROF_AMAX 20.
+  #define EY_PROF_JMAX 300.
+#else
+  #define USE_POS_EST false
 #endif
 
 // Speeds
 #if MOTORTYPE == MOT_STEPPER       // 
   #define AX_MotorSpeed 100        // max. motorspeed
-  #define AX_MotorAccel 50         // max. acceleration
+  #define AX_MotorAccel 100        // max. acceleration
   #define EY_MotorSpeed 100        // max. motorspeed
-  #define EY_MotorAccel 50         // max. acceleration
+  #define EY_MotorAccel 100        // max. acceleration
+  #define AX_MotorJerk 1000        // max. jerk (steps/s^3), S-curve with stepgen
+  #define EY_MotorJerk 1000        // max. jerk
+
+  // Steps from a timer interrupt (ESP, see stepgen.cpp), else AccelStepper::run() polled
+  #if PROCESSOR==PROC_ESP
+    #define USE_STEPGEN true
+    #define STEPGEN_TIMER 0          // hardware timer nr.
+    #define STEPGEN_TICK_US 25       // interrupt period; max. 1 step per 2 ticks: 20000 steps/s
+    #define STEPGEN_PROFILE_US 1000  // speed profile update period
+    #define STEPGEN_FOLLOW_US 200000 // follow(): time constant of position correction
+
+    // Steps follow a jerk-limited profile (scurve.cpp), limits in degr
+    #define USE_SCURVE true
+    #define AX_PROF_VMAX (AX_MotorSpeed*360./(AX_STEPS_DEGR))
+    #define AX_PROF_AMAX (AX_MotorAccel*360./(AX_STEPS_DEGR))
+    #define AX_PROF_JMAX (AX_MotorJerk*360./(AX_STEPS_DEGR))
+    #define EY_PROF_VMAX (EY_MotorSpeed*360./(EY_STEPS_DEGR))
+    #define EY_PROF_AMAX (EY_MotorAccel*360./(EY_STEPS_DEGR))
+    #define EY_PROF_JMAX (EY_MotorJerk*360./(EY_STEPS_DEGR))
+  #endif
+#endif
+#ifndef USE_STEPGEN
+  #define USE_STEPGEN false
+#endif
+#ifndef USE_SCURVE
+  #define USE_SCURVE false
 #endif
 
 #define SWAP_DIR false             // flip directions
@@ -152,6 +234,9 @@
   #define SPD_CAL2   0             // speed2: same, for second cal. (0: single-calibration)
 #endif
 
+#define CAL_CLEAR_DEGR 1.          // zenith: final slow approach starts this far above the edge
+#define CAL_STILL_MS 200           // rotor at rest: no pulse for this time (ms)
+
 #if ROTORTYPE==ROTORTYPE_AE
   #define USE_EASTWEST true        // use east/west pass info (set false if X/Y rotor)
   #define FULLRANGE_AZIM false     // azimut rotor has limited range 0...180
@@ -167,6 +252,10 @@
   #define SET_AZIM_MIN 340         // min. degrees from tracker   (ROT_AZIM_MIN+360)
   #define SET_AZIM_MAX 200         // max. degrees from tracker
 
+  // pass plan, flip over the zenith: azimuth may lag the satellite as
+  // long as the dish points within this (degr), see passplan.cpp
+  #define KEYHOLE_ERR 2.
+
 #endif
 
 // timeout for calibration: 
@@ -175,6 +264,17 @@
 #define ROT_TIMEOUT 30000
 #define PLS_TIMEOUT 4000
 
+// Kepler set, refpos and rotor positions in flash (ESP32 NVS, see persist.ino).
+// After a reset no calibration if the rotors were at rest when saved.
+#if PROCESSOR==PROC_ESP
+  #define USE_PERSIST true
+#else
+  #define USE_PERSIST false
+#endif
+#define PERSIST_REST_MS 5000       // no pulses this long: at rest, position saved
+#define PERSIST_MIN_MS 60000       // at most 1 position write per this time (flash wear)
+#define PERSIST_ZEN_MARGIN 2.      // degr around zenith edge not checked at warm boot
+
 
 #if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX)) // DC motor
 // PWM frequency and max. PWM (some controllers MUST have pulses, so not 100%!)
@@ -192,6 +292,7 @@
   #define my_PASSWORD2 "xxxxyyyy"
 
   #define ServerPort 23
+  #define NR_CLIENTS 4             // tcp clients at the same time (xtrack, monitors)
 
   #if USE_SGP4
     #define NTPSERVER "pool.ntp.org"
@@ -201,6 +302,8 @@
     // rotor config
     #define XY_CONFIG X_AT_DISC
   #endif
+#else
+  #define NR_CLIENTS 0
 #endif
 
 //==================== Define pins ====================
@@ -219,6 +322,7 @@
 // NOTE: Use ESP32Dev Module otherwise GPIO25 will behave strange with Wifi!
 #define PIN_ROTZEN_AX  19          // : zenit-detect
 #define PIN_ROTPLS_AX  18          // : input pulses (interrupt)
+#define PIN_ROTPLSB_AX -100        // : input pulses channel B (quadrature), optional
 #define PIN_ROTDIR_AX   5          // : output direction
 #define PIN_ROTPWM_AX  17          // : output speed (pwm)
 #define PIN_ROTDIN_AX -100         // : inverted output direction
@@ -226,6 +330,7 @@
 
 #define PIN_ROTZEN_EY  32          // : zenit-detect
 #define PIN_ROTPLS_EY  33          // : input pulses (interrupt)
+#define PIN_ROTPLSB_EY -100        // : input pulses channel B (quadrature), optional
 #define PIN_ROTDIR_EY  25          // : output direction
 #define PIN_ROTPWM_EY  26          // : output speed (pwm)
 #define PIN_ROTDIN_EY -100         // : inverted output direction
@@ -6,16 +6,22 @@
  *
  * content: 
  *   Wifi related commands
+ *   Max. NR_CLIENTS tcp clients (e.g. xtrack and a monitor); each can
+ *   subscribe to periodic telemetry, pushed by the output task.
  *
  * public functions:
  *   void CheckForConnections()
+ *   void telem_subscribe(int client,int mask,int rate)
+ *   void send_telemetry(int client)
  *   void connect_wifi()
  *   void disconnect_wifi()
  *   void get_ntp()
- *   void send_keplers(WiFiClient RemoteClient,KEPLER *k)
- *   void send_refposition(WiFiClient RemoteClient,EPOINT *refpos)
- *   void send_pos(WiFiClient RemoteClient,GOTO_VAL *gv,char *name)
- *   void send_ctrldata(WiFiClient RemoteClient,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv)
+ *   void send_keplers(KEPLER *k,boolean use_degrees)
+ *   void send_refposition(EPOINT *refpos)
+ *   void send_ctrltime()
+ *   void send_pos(GOTO_VAL *gv,char *name)
+ *   void send_ctrldata(ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv)
+ *   (replies to PC are queued, see output.ino)
  *
  *
  * History: 
@@ -53,30 +59,125 @@
 #include "rotorctrl_sgp4.h"
 #endif
 
+extern ROTOR *SAX_rot,*SEY_rot;
+extern COMMANDS command;
+
+static TELEM_SUB subs[NR_CLIENTS];
+
 // esp32-75EC4C
 void CheckForConnections()
 {
+  char str[60];
+  int i;
   if (Server.hasClient())
   {
-    // If we are already connected to another computer, 
-    // then reject the new connection. Otherwise accept
-    // the connection. 
-    if (RemoteClient.connected())
+    // Accept the connection in a free slot; if all NR_CLIENTS are
+    // connected then reject the new connection.
+    for (i=0; i<NR_CLIENTS; i++)
+      if (out_client_free(i)) break;
+    if (i==NR_CLIENTS)
     {
-      Serial.println("Connection rejected");
+      out_print(OUT_UART,"Connection rejected: max. clients\n");
       Server.available().stop();
     }
     else
     {
-      Serial.print("Connection accepted, IP address: ");
-      Serial.println(WiFi.localIP());
-      RemoteClient = Server.available();
+      IPAddress ip=WiFi.localIP();
+      snprintf(str,60,"Connection %d accepted, IP address: %d.%d.%d.%d\n",i,ip[0],ip[1],ip[2],ip[3]);
+      out_print(OUT_UART,str);
+      telem_subscribe(i,0,0);              // nothing from previous client
+      out_new_client(i,Server.available());  // output task takes it over
     }
   }
 }
 
+/*********************************************************************
+ * Telemetry of tcp client 'client' (index)
+ * mask: TLM_* items, 0: stop
+ * rate: Hz, max. TLM_MAXRATE
+ *********************************************************************/
+void telem_subscribe(int client,int mask,int rate)
+{
+  TELEM_SUB *s;
+  if ((client<0) || (client>=NR_CLIENTS)) return;
+  s=&subs[client];
+  if (rate<=0) mask=0;
+  if (rate>TLM_MAXRATE) rate=TLM_MAXRATE;
+  s->mask=0;                               // task: stop before change
+  if (!mask) return;
+  s->period_ms=1000/rate;
+  s->next_ms=millis();
+  s->mask=mask;
+}
+
+/*********************************************************************
+ * Push telemetry to tcp client 'client', if due.
+ * Called from the output task only, after the queue of this client
+ * is sent: written directly, so between 2 replies, never inside one.
+ * Values are read without lock: each item is a snapshot, items may
+ * be one control step apart.
+ *********************************************************************/
+void send_telemetry(int client)
+{
+  TELEM_SUB *s=&subs[client];
+  char str[160],sdig[2][10];
+  int mask=s->mask,n,swap=(SWAP_DIR? -1 : 1);
+  unsigned long now=millis();
+  GOTO_VAL *gv=&command.gotoval;
+
+  if ((!mask) || ((long)(now-s->next_ms)<0)) return;
+  s->next_ms+=s->period_ms;
+  if ((long)(now-s->next_ms)>=0) s->next_ms=now+s->period_ms;  // too late: no burst
+
+  #if USE_BINPROTO
+    if (mask&TLM_BINARY)
+    {
+      uint8_t frm[BIN_MAXFRAME];
+      n=bin_put_rotdata(frm,SAX_rot,SEY_rot,gv,time(NULL));
+      Clients[client].write(frm,n);
+      return;
+    }
+  #endif
+  n=snprintf(str,sizeof(str),"tlm=%lu",now);
+  if (mask&TLM_POS)
+  {
+    dtostrf((SAX_rot? SAX_rot->degr*swap : 0.),0, 1, sdig[0]);
+    dtostrf((SEY_rot? SEY_rot->degr*swap : 0.),0, 1, sdig[1]);
+    n+=snprintf(str+n,sizeof(str)-n," pos=[%s,%s]",sdig[0],sdig[1]);
+  }
+  if (mask&TLM_REQ)
+  {
+    dtostrf((SAX_rot? SAX_rot->req_degr : 0.),0, 1, sdig[0]);
+    dtostrf((SEY_rot? SEY_rot->req_degr : 0.),0, 1, sdig[1]);
+    n+=snprintf(str+n,sizeof(str)-n," req=[%s,%s]",sdig[0],sdig[1]);
+  }
+  if (mask&TLM_SPEED)
+  {
+    n+=snprintf(str+n,sizeof(str)-n," spd=[%d,%d]",(SAX_rot? SAX_rot->speed : 0),(SEY_rot? SEY_rot->speed : 0));
+  }
+  if (mask&TLM_VEL)
+  {
+    dtostrf((SAX_rot? SAX_rot->vel : 0.),0, 2, sdig[0]);
+    dtostrf((SEY_rot? SEY_rot->vel : 0.),0, 2, sdig[1]);
+    n+=snprintf(str+n,sizeof(str)-n," vel=[%s,%s]",sdig[0],sdig[1]);
+  }
+  if (mask&TLM_SUBSAT)
+  {
+    dtostrf(gv->lat,0, 1, sdig[0]);
+    dtostrf(gv->lon,0, 1, sdig[1]);
+    n+=snprintf(str+n,sizeof(str)-n," subsat=[%s,%s]",sdig[0],sdig[1]);
+  }
+  if (mask&TLM_HEIGHT)
+  {
+    dtostrf(gv->height,0, 1, sdig[0]);
+    n+=snprintf(str+n,sizeof(str)-n," height=%s",sdig[0]);
+  }
+  n+=snprintf(str+n,sizeof(str)-n,"\n");
+  Clients[client].write((uint8_t *)str,n);
+}
+
 // Connect to wifi as access point, use my_SSID2 / my_PASSWORD2
-void connect_wifi_ap(char *ssid,char *pwd)
+void connect_wifi_ap(const char *ssid,const char *pwd)
 {
   Serial.println("Creating wifi access point: ");
   Serial.println(ssid);
@@ -86,7 +187,7 @@ void connect_wifi_ap(char *ssid,char *pwd)
 }
 
 // Connect to wifi as station', use my_SSID1 / 'my_PASSWORD1'
-void connect_wifi(char *ssid,char *pwd)
+void connect_wifi(const char *ssid,const char *pwd)
 {
   Serial.print("Connecting to wifi: ");
   Serial.println(ssid);
@@ -110,7 +211,6 @@ void disconnect_wifi()
 // yyyy-mm-dd_HH:MM:SS
 void set_time(char *str)
 {
-  time_t t;
   struct tm tm;
   struct timeval curtime;
 
@@ -139,53 +239,53 @@ void get_ntp()
 
 #if USE_SGP4
 // Send current keplers back to PC (for checking)
-void send_keplers(WiFiClient RemoteClient,KEPLER *k,boolean use_degrees)
+void send_keplers(KEPLER *k,boolean use_degrees)
 {
   char sb[30];
   sprintf(sb,"satname=%s\n",k->name);
-  RemoteClient.write((uint8_t *)sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
   sprintf(sb,"epoch_year=%d\n",k->epoch_year);
-  RemoteClient.write((uint8_t *)sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
   sprintf(sb,"epoch_day=%f\n",k->epoch_day);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
   sprintf(sb,"decay_rate=%f\n",k->decay_rate);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
   sprintf(sb,"bstar=%f\n",k->bstar);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 
   if (use_degrees)
     sprintf(sb,"inclination=%f\n",k->d_inclination);
   else
     sprintf(sb,"inclination=%f\n",k->inclination);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 
   if (use_degrees)
     sprintf(sb,"raan=%f\n",k->d_raan);
   else
     sprintf(sb,"raan=%f\n",k->raan);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 
   sprintf(sb,"eccentricity=%f\n",k->eccentricity);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 
   if (use_degrees)
     sprintf(sb,"perigee=%f\n",k->d_perigee);
   else
     sprintf(sb,"perigee=%f\n",k->perigee);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 
   if (use_degrees)
     sprintf(sb,"anomaly=%f\n",k->d_anomaly);
   else
     sprintf(sb,"anomaly=%f\n",k->anomaly);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 
   sprintf(sb,"motion=%f\n",k->motion);
-  RemoteClient.write((uint8_t* )sb, strlen(sb));
+  out_tcp(sb,strlen(sb));
 }
 
 // Send current reference back to PC (for checking)
-void send_refposition(WiFiClient RemoteClient,EPOINT *refpos)
+void send_refposition(EPOINT *refpos)
 {
   char str[50];
   char sdig[2][10];
@@ -193,12 +293,12 @@ void send_refposition(WiFiClient RemoteClient,EPOINT *refpos)
   dtostrf(R2D(refpos->lon),0, 2, sdig[1]);
   snprintf(str,50,"refpos=[%s,%s]\n",sdig[0],sdig[1]);
 //  xprintf(str);
-  RemoteClient.write((uint8_t *)str, strlen(str));
+  out_tcp(str,strlen(str));
 }
 
 #endif
 
-void send_ctrltime(WiFiClient RemoteClient)
+void send_ctrltime()
 {
   char str[100];
   struct tm *tm;
@@ -208,28 +308,27 @@ void send_ctrltime(WiFiClient RemoteClient)
   if (tm)
   {
     strftime(str,100,"time=%F_%T\n",tm);
-    RemoteClient.write((uint8_t *)str, strlen(str));
+    out_tcp(str,strlen(str));
   }
 }
 
 // Send current position back to PC (can be local calculated or received position)
-void send_pos(WiFiClient RemoteClient,GOTO_VAL *gv,char *name)
+void send_pos(GOTO_VAL *gv,char *name)
 {
   char str[100];        // max. stringlen=23+4*6+2*3=53
   char sdig[2][10];
   dtostrf(gv->lat,0, 1, sdig[0]);
   dtostrf(gv->lon,0, 1, sdig[1]);
   snprintf(str,100,"subsat=[%s,%s]\n",sdig[0],sdig[1]);
-  RemoteClient.write((uint8_t *)str, strlen(str));
+  out_tcp(str,strlen(str));
 }
 
 // Send all current rotor info  back to PC
-void send_ctrldata(WiFiClient RemoteClient,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv)
+void send_ctrldata(ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv)
 {
   char sdig[4][10];
   char str[100];
   float axpos_degr=0.,axreq_degr=0.,eypos_degr=0.,eyreq_degr=0.;
-  float a[2],b[2];
   int ax_speed=0,ey_speed=0;
   int swap=(SWAP_DIR? -1 : 1);
   if (AX_rot) 
@@ -252,7 +351,7 @@ void send_ctrldata(WiFiClient RemoteClient,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL
   // max. len=23+4*6+2*3=53
   snprintf(str,100,"pos=[%s,%s] req=[%s,%s] spd=[%d,%d]\n",sdig[0],sdig[1],sdig[2],sdig[3],ax_speed,ey_speed);
 //  xprintf(str);
-  RemoteClient.write((uint8_t *)str, strlen(str));
+  out_tcp(str,strlen(str));
 
   dtostrf(gv->x,0, 1, sdig[0]);
   dtostrf(gv->y,0, 1, sdig[1]);
@@ -260,25 +359,25 @@ void send_ctrldata(WiFiClient RemoteClient,ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL
   dtostrf(gv->e,0, 1, sdig[3]);
   snprintf(str,100,"xy=[%s,%s] ae=[%s,%s]\n",sdig[0],sdig[1],sdig[2],sdig[3]);
 //  xprintf(str);
-  RemoteClient.write((uint8_t *)str, strlen(str));
+  out_tcp(str,strlen(str));
 
   dtostrf(gv->ax,0, 1, sdig[0]);
   dtostrf(gv->ey,0, 1, sdig[1]);
   snprintf(str,100,"ax/ey=[%s,%s] ew=%d\n",sdig[0],sdig[1],gv->east_pass);
 //  xprintf(str);
-  RemoteClient.write((uint8_t *)str, strlen(str));
+  out_tcp(str,strlen(str));
 
   dtostrf(gv->lat,0, 1, sdig[0]);
   dtostrf(gv->lon,0, 1, sdig[1]);
   snprintf(str,100,"subsat=[%s,%s]\n",sdig[0],sdig[1]);
-  RemoteClient.write((uint8_t *)str, strlen(str));
+  out_tcp(str,strlen(str));
 
   #if USE_SGP4
-    send_ctrltime(RemoteClient);  // Send local used time back to PC
+    send_ctrltime();  // Send local used time back to PC
 
     dtostrf(gv->height,0, 1, sdig[0]);
     snprintf(str,100,"height=%s\n",sdig[0]);
-    RemoteClient.write((uint8_t *)str, strlen(str));
+    out_tcp(str,strlen(str));
   #endif
 }
 #endif
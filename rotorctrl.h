@@ -39,6 +39,7 @@
 
 #ifndef ROTORCTRL_HDR
 #define ROTORCTRL_HDR
+#include <stdint.h>
 
 // processor, default: AVR/ATmega
 #define PROC_AVR 0
@@ -101,6 +102,9 @@ typedef enum
 #define ROTORTYPE_XY 1
 #define ROTORTYPE_AE 2
 
+#define MOTION_RAMP 0            // speed from error, accel. ramp
+#define MOTION_PID 1             // PID with feed-forward of satellite rate
+
 typedef struct goto_val
 {
   float ax;                      // goto value azimut or Y
@@ -111,14 +115,20 @@ typedef struct goto_val
   float height;
   boolean east_pass;             // true if sat. passes east
   boolean eastwest_pass_info;    // true if east_pass is valid
+  float vax,vey;                 // rate of ax, ey in degr/s (feed-forward)
+  long t_calc;                   // time (s) of calculated ax, ey
+  unsigned long t_ms;            // millis() at t_calc
 } GOTO_VAL;
 
+#include "scurve.h"
+
+#define PLS_RING 8               // pulse timestamps per rotor (power of 2)
 
 typedef struct rotor
 {
   char name[10];
   int id;
-  long rotated;          // rotation done in some integer form (pulses, steps...)
+  volatile long rotated; // rotation done in some integer form (pulses, steps...)
   long pre_rotated;      // previous rotated (for run-check)
   long cnt        ;      // counter for run-check
   float req_degr;        // requested position rotor in degrees
@@ -133,6 +143,15 @@ typedef struct rotor
   float d2v_slope;       // slope speed/degr
   int round;             // full 360 degrees
   boolean dir;           // direction
+  boolean reversing;     // stopped for direction change
+  unsigned long t_reverse; // start of stop for direction change (ms)
+  unsigned long reverse_ms; // duration of that stop (ms)
+  int motion;            // MOTION_RAMP or MOTION_PID
+  float deadband;        // <= diff-degrees to stop rotor
+  float req_vel;         // requested rate (degr/s), for feed-forward
+  float kp,ki,kd,kff;    // PID gains: speed% per degr, degr*s, degr/s; kff per degr/s
+  float pid_int;         // PID integrator (degr*s)
+  unsigned long pid_t;   // time of previous PID step (us)
   boolean calibrated;    // calibration done and successfull
   CAL_STATUS cal_status; // status calibration
   int pwm;               // pwm: 0 (=stop)...100 (=max. speed) (percentage)
@@ -145,6 +164,18 @@ typedef struct rotor
   int pin_lsp;           // pin nr. for low speed indication (if no PWM used)
   int pin_end1;          // pin nr. for end indication
   int pin_end2;          // pin nr. for end indication
+  int pin_pls;           // pin nr. for pulses (quadrature channel A)
+  int pin_plsb;          // pin nr. quadrature channel B (<0: direction from 'dir')
+  volatile unsigned long pls_head;         // nr. of pulses (ISR)
+  volatile unsigned long pls_t[PLS_RING];  // micros() of last pulses (ISR)
+  volatile long pls_cnt[PLS_RING];         // 'rotated' after these pulses (ISR)
+  float vel;             // measured rate (degr/s), from pulse periods
+  float est_x;           // estimator: position at last edge (pulses, fractional)
+  float est_v;           // estimator: rate (pulses/s)
+  unsigned long est_t;   // estimator: micros() of last edge
+  unsigned long est_n;   // estimator: pulses (pls_head) processed
+  long est_cnt;          // estimator: 'rotated' at last edge
+  SCURVE prof;           // motion profile: setpoints for run_motor_soft_dd()
   void *stepper;         // stepper class, for stepping motor
   boolean x_west_is_0;
   boolean y_south_is_0;
@@ -168,8 +199,19 @@ typedef enum CURRENT_COMMAND
   get_time,
   send_time,
   do_setup,
-  restart
-};
+  restart,
+  jitter,
+  ctrl_mode,
+  deadband,
+  pid_gains,
+  cat_store,
+  send_sched,
+  send_passplan,
+  get_kep,
+  get_tle,
+  outstat,
+  subscribe
+} CURRENT_COMMAND;
 
 typedef struct commands
 {
@@ -177,6 +219,9 @@ typedef struct commands
   boolean contrunning;
   int a_spd,b_spd;
   int pwm_freq;
+  int ctrl_mode;                 // MOTION_RAMP or MOTION_PID
+  float deadband;
+  float pid_gains[4];            // kp, ki, kd, kff
   GOTO_VAL gotoval;
   boolean set_refpos;
   float ref_lat,ref_lon;
@@ -188,8 +233,119 @@ typedef struct commands
   boolean get_pos;
   boolean get_ctrldata;
   boolean run_calc;
+  boolean run_sched;             // track satellites of catalogue
+  int cat_nr,cat_prio;           // cat_store=<nr>,<prio>
+  int tle_status;                // tle=...: load_tle() result
+  int bin_link;                  // command from binary frame: reply to this link
+  int client;                    // command from tcp client: 1+index, 0: serial
+  int tlm_mask,tlm_rate;         // subscribe=<mask>,<rate>
 } COMMANDS;
 
+// command table entry, see handle_commands.ino
+#define CMD_NOVAL 0              // <key>
+#define CMD_VAL 1                // <key>=<val> or <key> <val>
+#define CMD_OPTVAL 2             // both
+typedef struct cmd_def
+{
+  const char *key;
+  int val;
+  CURRENT_COMMAND cmd;           // command if no handler
+  int (*func)(char *val,int arg);
+  int arg;
+} CMD_DEF;
+
+// output queue, see output.ino
+#define OUT_UART 0               // sinks
+#define OUT_LCD 1
+#define OUT_TCP 2                // tcp client i: OUT_TCP+i
+#define OUT_BACKPRESSURE 0       // policy if full: refuse new message
+#define OUT_DROP_OLDEST 1        // policy if full: overwrite oldest bytes
+#define OUT_LCD_POS 0x01         // LCD record: OUT_LCD_POS x y text
+#define OUT_LCD_XY 0x20          // offset of x, y: never equal to OUT_LCD_POS
+typedef struct out_queue
+{
+  char *buf;
+  int size;                      // power of 2
+  int policy;
+  volatile unsigned long head;   // bytes written (producer only)
+  volatile unsigned long tail;   // bytes sent (consumer only)
+  int max_used;
+  unsigned long refused;         // bytes refused (full) or cut (producer)
+  unsigned long dropped;         // bytes overwritten unsent (consumer)
+} OUT_QUEUE;
+
+// telemetry subscription per tcp client, see rotor_wififuncs.ino
+#define TLM_POS    0x01          // rotor position
+#define TLM_REQ    0x02          // setpoint
+#define TLM_SPEED  0x04          // motor speed
+#define TLM_SUBSAT 0x08          // sub-satellite point
+#define TLM_HEIGHT 0x10          // satellite height
+#define TLM_VEL    0x20          // measured rate (pulses)
+#define TLM_BINARY 0x80          // as BIN_ROTDATA frame (all items)
+#define TLM_MAXRATE 50           // Hz
+typedef struct telem_sub
+{
+  int mask;                      // TLM_*, 0: off
+  unsigned long period_ms;
+  unsigned long next_ms;
+} TELEM_SUB;
+
+// record in flash: header + data, see persist.ino
+typedef struct persist_hdr
+{
+  uint16_t magic;
+  uint8_t version;               // PERSIST_VERSION of the firmware that wrote it
+  uint16_t len;                  // of the data
+  uint16_t crc;                  // of the data
+} PERSIST_HDR;
+
+// rotor record: calibrated positions
+typedef struct persist_rot
+{
+  uint16_t cfg;                  // rotor settings that wrote it, see cfg_crc()
+  boolean at_rest;               // rotors at rest: positions valid after a reset
+  boolean run_calc;              // tracking (single satellite) was on
+  long rotated[2];               // pulse count AX, EY
+} PERSIST_ROT;
+
+// zenith calibration of one rotor, see calibrate.ino
+typedef enum
+{
+  cz_search=0,                   // fast to the sensor edge, from either side
+  cz_clear,                      // fast to CAL_CLEAR_DEGR above the edge
+  cz_final,                      // slow down to the edge, always from above
+  cz_stop,                       // ramp down, then new pulse count
+  cz_rest,                       // stop until at rest, then 'next'
+  cz_done,
+  cz_error
+} CZ_STATE;
+
+typedef struct cal_axis
+{
+  ROTOR *rot;
+  CZ_STATE state;
+  CZ_STATE next;                 // after cz_rest
+  int zen;                       // zenith sensor at last poll
+  int spd_fast,spd_slow;         // % of max. speed
+  long clear;                    // CAL_CLEAR_DEGR in pulses
+  long edge;                     // pulse count of the edge (estimate)
+  boolean crossed;               // 'edge' passed in this calibration
+  long width;                    // final edge minus 'edge' (pulses)
+  long shift;                    // correction of the count at the final edge
+  boolean framed;                // calibrated before: 'shift' is the count drift
+  long cnt;                      // pulse count at t_cnt
+  unsigned long t_cnt;           // ms: last pulse
+  unsigned long t_start,t_state,t_end; // ms
+} CAL_AXIS;
+
+typedef struct cal_stat
+{
+  int n;                         // calibrations with a previous edge
+  long dmin,dmax;                // count drift (pulses)
+  int ne;                        // calibrations with 'crossed'
+  long emin,emax;                // final edge minus 'edge' (pulses)
+} CAL_STAT;
+
 #include "rotor_spec.h"
 
 #define SIGN(a) ((a)<0? -1 : (a)>0? 1 : 0)
@@ -219,4 +375,14 @@ typedef struct commands
 #include "keplerfuncs.h"
 #endif
 
+#include "linebuf.h"
+
+#if USE_BINPROTO || USE_PERSIST
+#include "binproto.h"
+#endif
+
+#if USE_STEPGEN
+#include "stepgen.h"
+#endif
+
 #endif
@@ -59,7 +59,7 @@
 #if USE_WIFI
   #include <WiFi.h>
   WiFiServer Server(ServerPort);
-  WiFiClient RemoteClient;
+  WiFiClient Clients[NR_CLIENTS];
   #if ADD_OTA_UPLOAD
     #include <AsyncTCP.h>
     #include <AsyncElegantOTA.h>
@@ -71,6 +71,11 @@
 #if USE_SGP4
   KEPLER kepler;
   EPOINT refpos;
+  PASS_PLAN passplan;
+  #if USE_SCHEDULER
+    CAT_ENTRY catalogue[CAT_SIZE];
+    SCHEDULE schedule;
+  #endif
 #endif
 
 #if USE_DISPLAY
@@ -80,7 +85,11 @@
 
 
 #if MOTORTYPE == MOT_STEPPER       // stepper motor
-  #include <AccelStepper.h>        // http://www.airspayce.com/mikem/arduino/AccelStepper/index.html
+  #if USE_STEPGEN                  // steps from timer interrupt, see stepgen.cpp
+    typedef StepGen AccelStepper;
+  #else
+    #include <AccelStepper.h>      // http://www.airspayce.com/mikem/arduino/AccelStepper/index.html
+  #endif
   AccelStepper stepperAX(1, PIN_ROTPWM_AX, PIN_ROTDIR_AX);
   AccelStepper stepperEY(1, PIN_ROTPWM_EY, PIN_ROTDIR_EY);
 
@@ -96,10 +105,29 @@ COMMANDS command;
 boolean do_feedback;
 
 // Pulse counter
-static void pos_handler(ROTOR *rot)
+// With quadrature (pin_plsb>=0) both edges of A interrupt; direction is
+// A xor B, counted only at the edge of A where B is low (1 count per
+// pulse), so a rotor dithering across an edge counts +1 -1.
+// Else (rising edge only) the commanded direction is used.
+// Each pulse is timestamped in a ring, for the rate, see pulse_rate().
+static ISR_FUNC pos_handler(ROTOR *rot)
 {
+  boolean dir;
+  unsigned long h;
   if (!rot) return;
-  if (rot->dir)
+  if (rot->pin_plsb>=0)
+  {
+    if (digitalRead(rot->pin_plsb)==HIGH) return;  // other edge of A
+    dir=(digitalRead(rot->pin_pls)==HIGH);
+    #if SWAP_DIR
+      dir=!dir;
+    #endif
+  }
+  else
+  {
+    dir=rot->dir;
+  }
+  if (dir)
   {
     rot->rotated++;
   }
@@ -107,6 +135,10 @@ static void pos_handler(ROTOR *rot)
   {
     rot->rotated--;
   }
+  h=rot->pls_head;
+  rot->pls_t[h&(PLS_RING-1)]=micros();
+  rot->pls_cnt[h&(PLS_RING-1)]=rot->rotated;
+  __atomic_store_n(&rot->pls_head,h+1,__ATOMIC_RELEASE);
 }
 
 // Pulse counter rotor Azimut/X
@@ -135,12 +167,17 @@ static void setup_ax(ROTOR *rot)
   #if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
     rot->minspeed = AX_MINSPEED;
     rot->maxspeed = AX_MAXSPEED;
+    set_motion(rot, MOTION_CTRL);
   #endif
   #if MOTORTYPE == MOT_STEPPER
     rot->stepper = &stepperAX;
+    rot->motorspeed = AX_MotorSpeed;
     CMDP(rot, setMaxSpeed(AX_MotorSpeed));     // Set the X rotor-motor maximum speed
     CMDP(rot, setAcceleration(AX_MotorAccel)); // Set the X rotor-motor acceleration speed
   #endif
+  #if USE_SCURVE
+    sc_set_limits(&rot->prof,AX_PROF_VMAX,AX_PROF_AMAX,AX_PROF_JMAX);
+  #endif
 }
 
 // setup rotor EY
@@ -157,23 +194,40 @@ static void setup_ey(ROTOR *rot)
   #if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
     rot->minspeed = EY_MINSPEED;
     rot->maxspeed = EY_MAXSPEED;
+    set_motion(rot, MOTION_CTRL);
   #endif
   #if MOTORTYPE == MOT_STEPPER
     rot->stepper = &stepperEY;
+    rot->motorspeed = EY_MotorSpeed;
     CMDP(rot, setMaxSpeed(EY_MotorSpeed));     // Set the X rotor-motor maximum speed
     CMDP(rot, setAcceleration(EY_MotorAccel)); // Set the Y rotor-motor acceleration speed
   #endif
+  #if USE_SCURVE
+    sc_set_limits(&rot->prof,EY_PROF_VMAX,EY_PROF_AMAX,EY_PROF_JMAX);
+  #endif
 }
 
 // setup and calibrate
 void setup(void)
 {
-  int err = 0;
+  boolean warm = false;
+  #if USE_SGP4
+    boolean kep_stored = false;
+  #endif
+  // setup() again ('setup' command): control task stopped until calibrated
+  control_hold(true);
+  run_motor_hard(SAX_rot, 0);
+  run_motor_hard(SEY_rot, 0);
+  #if USE_PERSIST
+    if ((SAX_rot) || (SEY_rot))
+      persist_poll(SAX_rot, SEY_rot); // moved since saved at rest: no warm boot
+  #endif
   SAX_rot = NULL;
   SEY_rot = NULL;
 
   // define serial input, if USB connected: commands (if no wifi), debugging
   Serial.begin(SERIAL_SPEED);       // Start Serial Communication Interface
+  out_start();                      // output queues, see output.ino
 
   #if ROTOR_AX
     SAX_rot = &gAX_rot;
@@ -203,15 +257,26 @@ void setup(void)
       configTime((long)0,(int)0, NTPSERVER);
       get_ntp();
 
-      // load defaults
-      load_default_refpos(&refpos);
-      load_default_kepler(&kepler); // just some defaults, to make keplerdata valid
-
-      calc_sgp4_const(&kepler,true);
+      // stored ones (SGP4 constants included), else defaults
+    #if USE_PERSIST
+      if (!persist_load_refpos(&refpos))
+    #endif
+        load_default_refpos(&refpos);
+    #if USE_PERSIST
+      kep_stored=persist_load_kepler(&kepler);
+    #endif
+      if (!kep_stored)
+      {
+        load_default_kepler(&kepler); // just some defaults, to make keplerdata valid
+        calc_sgp4_const(&kepler,true);
+      }
     #endif
   #endif
 
   #if MOTORTYPE == MOT_STEPPER
+    #if USE_STEPGEN
+      stepgen_start();              // step timer
+    #endif
     #ifdef PIN_AXEYEnable
       if (PIN_AXEYEnable >= 0)
         digitalWrite(PIN_AXEYEnable, HIGH);             // Enable use of M415C controllers
@@ -221,12 +286,12 @@ void setup(void)
   pinMode(LED_BUILTIN, OUTPUT);     // calibration indication
   do_feedback = true;
 
-  // define interrupts for backpulsecounters
+  // define interrupts for backpulsecounters (quadrature: both edges of A)
   #if PIN_ROTPLS_AX && PIN_ROTPLS_AX >=0
-    attachInterrupt(digitalPinToInterrupt(PIN_ROTPLS_AX) , AX_pos_handler , RISING);
+    attachInterrupt(digitalPinToInterrupt(PIN_ROTPLS_AX) , AX_pos_handler , (PIN_ROTPLSB_AX>=0? CHANGE : RISING));
   #endif
   #if PIN_ROTPLS_EY && PIN_ROTPLS_EY >=0
-    attachInterrupt(digitalPinToInterrupt(PIN_ROTPLS_EY) , EY_pos_handler , RISING);
+    attachInterrupt(digitalPinToInterrupt(PIN_ROTPLS_EY) , EY_pos_handler , (PIN_ROTPLSB_EY>=0? CHANGE : RISING));
   #endif
 
   #if USE_DISPLAY
@@ -244,15 +309,60 @@ void setup(void)
     Serial.println("HTTP server started");
   #endif
 
-  digitalWrite(LED_BUILTIN, LOW);   // LED off; start calibration
-  delay(1000);
-  err = calibrate(SAX_rot, SEY_rot);
+  #if USE_PERSIST
+    warm = persist_load_rotors(SAX_rot, SEY_rot);  // at rest when saved: no calibration
+  #endif
+  if (warm)
+  {
+    xprintf("Warm boot: calibration from flash\n");
+    blink(0, 0);                     // no blinking of setup() anymore
+    digitalWrite(LED_BUILTIN, HIGH); // LED on; calibration done
+  }
+  else
+  {
+    digitalWrite(LED_BUILTIN, LOW);  // LED off; start calibration
+    calibrate(SAX_rot, SEY_rot);
+  }
   if (SAX_rot) command.gotoval.ax = SAX_rot->degr;
   if (SEY_rot) command.gotoval.ey = SEY_rot->degr;
+  #if USE_PERSIST && USE_SGP4
+    command.run_calc = ((kep_stored) && (persist_run_calc())); // resume tracking without PC
+  #endif
+
+  #if USE_CTRL_TASK
+    start_control();                // from now rotors driven by control task
+  #endif
+  control_publish();                // new setpoint before the task continues
+  control_hold(false);
 }
 
 
+#if USE_SGP4 && CAL_AFTER_TRACK
+// enough time for calibration before pre-positioning for the next pass?
+static boolean cal_fits(void)
+{
+  time_t t=time(NULL);
+  long t_aos;
+  PASS pass;
+  #if USE_SCHEDULER
+    if (command.run_sched)
+    {
+      int i=sched_next(&schedule,t);
+      if (i<0) return true;
+      t_aos=schedule.p[i].aos;
+    }
+    else
+  #endif
+  {
+    if (!find_next_pass(&kepler,&refpos,t,t+PREPOS_LEAD+CAL_TIME,&pass)) return true;
+    t_aos=(long)pass.aos;
+  }
+  return (t_aos-PREPOS_LEAD-t >= CAL_TIME);
+}
+#endif
+
 // endless loop: catch position from serial interface and run motors
+// (with USE_CTRL_TASK the motors are run by the control task)
 void loop(void)
 {
   if (Serial.available())
@@ -269,50 +379,74 @@ void loop(void)
   #if USE_SGP4
     if (command.run_calc)
     {
+    #if CAL_AFTER_TRACK
       static boolean pabove_hor;
+    #endif
       boolean above_hor;
-      above_hor=calc_pos(&command.gotoval,&kepler,&refpos);
-    #if CAL_AFTER_TRACK
-      if ((!above_hor) && (pabove_hor))
+    #if !USE_PASSPLAN
+      static long pt_calc;
+    #endif
+    #if USE_SCHEDULER
+      if (command.run_sched)              // satellite from catalogue
+        above_hor=calc_pos_sched(&command.gotoval,&schedule,catalogue,&kepler,&passplan,&refpos);
+      else
+    #endif
+    #if USE_PASSPLAN
+        above_hor=calc_pos_plan(&command.gotoval,&passplan,&kepler,&refpos);
+      command.gotoval.t_ms=millis();      // valid now
+    #else
+        above_hor=calc_pos(&command.gotoval,&kepler,&refpos);
+      if (command.gotoval.t_calc!=pt_calc)  // new pos.: start of extrapolation
       {
-        calibrate(SAX_rot, SEY_rot);
+        command.gotoval.t_ms=millis();
+        pt_calc=command.gotoval.t_calc;
       }
-      pabove_hor=above_hor;
     #endif
-
-      #ifdef CONTSENDINFO
+    #if CAL_AFTER_TRACK
+      static boolean cal_pending;
+      static time_t t_check;
+      if ((!above_hor) && (pabove_hor)) cal_pending=true;
+      if ((cal_pending) && (!above_hor) && (time(NULL)!=t_check))
       {
-        static int pa,pe;
-        // detect >=1 degrees step
-        if ((int)(command.gotoval.a)!=pa) command.got_new_pos=true;
-        if ((int)(command.gotoval.e)!=pe) command.got_new_pos=true;
-        pa=(int)(command.gotoval.a);
-        pe=(int)(command.gotoval.e);
+        t_check=time(NULL);                 // check once per second
+        if (cal_fits())
+        {
+          calibrate(SAX_rot, SEY_rot);
+          cal_pending=false;
+        }
       }
-      #endif
+      pabove_hor=above_hor;
+    #else
+      (void)above_hor;
+    #endif
     }
   #endif
 
+  control_publish();             // setpoint for the control task
+  blink_poll();                  // LED of blink()
+
   if (command.contrunning)
   { // especially needed for stepper motors, see spec 'AccelStepper'
-    run_motor_hard(SAX_rot, command.a_spd);
-    run_motor_hard(SEY_rot, command.b_spd);
+    if (!control_active())
+    {
+      run_motor_hard(SAX_rot, command.a_spd);
+      run_motor_hard(SEY_rot, command.b_spd);
+    }
   }
   else
   {
-    rotor_goto(SAX_rot, command.gotoval.ax);
-    rotor_goto(SEY_rot, command.gotoval.ey);
-
-    #ifdef CONTSENDINFO
-     #if USE_WIFI
-      // if pos. is calculated in controller then send results back for monitoring 
-      if (command.got_new_pos)
-      {
-        send_ctrldata(RemoteClient,SAX_rot, SEY_rot,&command.gotoval); // send pos. to PC for monitoring
-        usleep(1000000);
-      }
-     #endif
-    #endif
+    if (!control_active())
+    {
+      rotors_track(SAX_rot, SEY_rot, &command.gotoval);
+    }
     command.got_new_pos = false;
   }
+
+  #if USE_PERSIST
+    persist_poll(SAX_rot, SEY_rot);  // rotor positions in flash
+  #endif
+
+  #if !USE_OUT_TASK
+    out_drain();                 // no output task: send queued output here
+  #endif
 }
@@ -9,6 +9,11 @@
 #define D2R(g) ((g)*PI/180.)     /* degree --> radians */
 #define R2D(g) ((g)*180./PI)     /* radians --> degree */
 
+#define J2000 2451545.5
+#define J1900 (J2000 - 36525. - 1.)
+#define YEAR1970 25568. // 365.25*70 + 0.5
+#define UNIX2JD(t) (((double)(t)/86400.)+J1900+YEAR1970)
+
 #define Rearth 6378135.
 #define G0    9.798
 
@@ -22,6 +27,27 @@ typedef struct epoint
   float alt;
 } EPOINT;
 
+// observer context, see observer() in sgp4_calcsat.cpp
+typedef struct observer
+{
+  float lat,lon,alt;             // refpos of this context (radians, km)
+  double pos[3];                 // km, earth-fixed (GMST=0)
+  double rot[3][3];              // earth-fixed -> south, east, zenith
+  float pos_f[3],rot_f[3][3];    // float copies, see sgp4f.cpp
+  boolean valid;
+} OBSERVER;
+
+// float copy of SGP4 constants, see sgp4f.cpp
+typedef struct sgp4f
+{
+  float c1,c4,c5,d2,d3,d4;
+  float t2cof,t3cof,t4cof,t5cof;
+  float xnodcf,omgcof,xmcof,delmo,sinmo,eta;
+  float aodp,xnodp,cosio,sinio,xincl,eo,bstar;
+  float xlcof,aycof,x3thm1,x7thm1,sinio2;
+  int simple;
+} SGP4F;
+
 typedef struct kepler
 {
   char   name[20];
@@ -39,15 +65,97 @@ typedef struct kepler
   float  anomaly;
   float  d_anomaly;
   float  motion;
-  tle_t  tle;                 // for SGP4
+  tle_t  tle;                 // for SGP4/SDP4
+  boolean from_tle;           // tle from load_tle(), not from the fields above
+  boolean deep;               // SDP4 (period >= 225 min), see calc_sgp4_const()
   double sgp4_params[N_SAT_PARAMS];
+  SGP4F  sgp4f;               // for calc_sat_f()
 } KEPLER;
 
+// many satellites for SGP4_soa(), one array per constant, see sgp4batch.cpp
+#define SGP4_SOA_NPAR 29         // nr. of arrays
+typedef struct sgp4_soa
+{
+  int n,nmax;                    // nr. of satellites, room for
+  double *epoch;                 // JD
+  double *xmo,*xmdot,*omegao,*omgdot,*xnodeo,*xnodot,*xnodcf;
+  double *c1,*c4b,*c5b;          // c4, c5 with bstar
+  double *t2cof,*t3cof,*t4cof,*t5cof,*d2,*d3,*d4;
+  double *omgcof,*xmcof,*eta,*delmo,*sinmo;
+  double *eo,*aodp,*xnodp,*cosio,*sinio,*xincl;
+} SGP4_SOA;
+
 typedef struct dir
 {
   float elev,azim;
   float x,y;
 } DIR;
 
+// pass, see passfind.cpp
+typedef struct pass
+{
+  double aos,tca,los;            // s
+  float max_elev;                // degr, at tca
+  float aos_azim,los_azim;       // degr
+} PASS;
+
+// pass plan, see passplan.cpp
+#define PLAN_STEP 5              // s between points
+#define PLAN_SIZE 256            // max. nr. of points (21 min. with 5 s)
+#define PLAN_SCAN_MAX (3*3600)   // s, max. time to search for AOS
+
+typedef struct plan_point        // 9 floats, order used in plan_interp()
+{
+  float a,e;                     // azimuth (unwrapped), elevation (degr)
+  float x,y;                     // X/Y (degr)
+  float lon,lat;                 // sub-satellite point (degr, lon unwrapped)
+  float height;                  // m
+  float ax,ey;                   // rotor position (degr), see plan_solution()
+} PLAN_POINT;
+
+typedef struct pass_plan
+{
+  long t0;                       // time (s) of p[0]
+  int n;                         // nr. of points; 0: no plan
+  long t_retry;                  // no pass found: time to scan again
+  float slew_s;                  // slew time park -> AOS direction (s); 0: unknown
+  boolean east_pass;             // elev./azim. rotor: east (or west) solution used
+  int flip;                      //   from p[flip] the other one (>=n: no flip)
+  int keyhole;                   //   azimuth interpolated this nr. of points each side
+  float err_max;                 //   max. pointing error there (degr)
+  float rate_ax,rate_ey;         // peak rate needed by the pass (degr/s)
+  float vmax_ax,vmax_ey;         // max. rate of the rotors (degr/s); 0: unknown
+  boolean fits;                  // azimuth stays in rotor range
+  PLAN_POINT p[PLAN_SIZE];
+} PASS_PLAN;
+
+// catalogue and pass schedule, see scheduler.cpp
+#define CAT_SIZE 8               // max. nr. of satellites in catalogue
+#define SCHED_SIZE 48            // max. nr. of scheduled passes
+#define SCHED_HOURS 24           // predicted period (h)
+#define SCHED_RENEW (6*3600)     // s, make new schedule after this
+#define SCHED_MIN_ELEV 5.        // degr, skip lower passes
+#define SCHED_GAP 60             // s, min. time between 2 passes (slewing)
+
+typedef struct cat_entry
+{
+  KEPLER kepler;                 // with SGP4 constants
+  int prio;                      // higher wins; <=0: empty
+} CAT_ENTRY;
+
+typedef struct sched_pass
+{
+  int sat;                       // index in catalogue
+  long aos,los;                  // s
+  float max_elev;                // degr
+} SCHED_PASS;
+
+typedef struct schedule
+{
+  long t0;                       // time of prediction; 0: none
+  int n;                         // nr. of passes
+  int loaded;                    // catalogue entry loaded for tracking; -1: none
+  SCHED_PASS p[SCHED_SIZE];      // sorted on AOS
+} SCHEDULE;
 
 #endif
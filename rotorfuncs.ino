@@ -10,10 +10,16 @@
  * public functions:
  *   float to_degr(ROTOR *rot)
  *   long from_degr(ROTOR *rot)
+ *   float pulse_rate(ROTOR *rot)
+ *   float pos_estimate(ROTOR *rot)
  *   void convert_eastwest(GOTO_VAL *gv)
  *   run_motor_soft(ROTOR *rot,int speed)
  *   int run_motor_hard(ROTOR *rot,int speed)
  *   int rotor_goto(ROTOR *rot,float val)
+ *   int rotor_track(ROTOR *rot,float val,float vel)
+ *   float rotors_slew(ROTOR *AX_rot,ROTOR *EY_rot,float ax,float ey)
+ *   void rotors_track(ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv)
+ *   void set_motion(ROTOR *rot,int motion)
  *   void reset_to_pos(ROTOR *rot,long pos)
  *   void run_to_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_pos,float ey_pos,boolean relative)
  *   void run_to_endswitch(ROTOR *AX_rot, ROTOR *EY_rot,int speed)
@@ -72,6 +78,132 @@ float to_degr(ROTOR *rot)
   return step2degr(rot,rot->rotated);
 }
 
+/*********************************************************************
+ * Rate (degr/s) from the pulse timestamps of the ISR, see pos_handler():
+ * pulses in the last PLS_WINDOW_US, same direction, consecutive counts.
+ * If no pulse came for longer than the last period the rotor slows
+ * down: rate at most 1 pulse per time since the last pulse.
+ * Lock-free: read again if the ISR added a pulse meanwhile.
+ *********************************************************************/
+#define PLS_WINDOW_US 250000     // max. time span for the rate
+#define PLS_STOP_US 2000000      // no pulse for this time: stopped
+float pulse_rate(ROTOR *rot)
+{
+  unsigned long h,t0,t1,now;
+  long c0,c1,dc;
+  int k;
+  if (!rot) return 0.;
+  do
+  {
+    h=__atomic_load_n(&rot->pls_head,__ATOMIC_ACQUIRE);
+    if (h<2) return 0.;
+    now=micros();
+    t1=rot->pls_t[(h-1)&(PLS_RING-1)];
+    c1=rot->pls_cnt[(h-1)&(PLS_RING-1)];
+    dc=c1-rot->pls_cnt[(h-2)&(PLS_RING-1)];
+    t0=t1;
+    c0=c1;
+    for (k=2; (k<PLS_RING) && (k<=(int)h); k++)
+    {
+      unsigned long t=rot->pls_t[(h-k)&(PLS_RING-1)];
+      long c=rot->pls_cnt[(h-k)&(PLS_RING-1)];
+      if ((c0-c!=dc) || (t1-t>PLS_WINDOW_US)) break;
+      t0=t;
+      c0=c;
+    }
+  } while (__atomic_load_n(&rot->pls_head,__ATOMIC_ACQUIRE)!=h);
+
+  if (((dc!=1) && (dc!=-1)) || (now-t1>PLS_STOP_US)) return 0.;
+  if (c0==c1)                  // 1 pulse in window
+  {
+    t0=t1-PLS_WINDOW_US;
+    c0=c1-dc;
+  }
+  if (now-t1>(t1-t0)/(unsigned long)((c1-c0)*dc))  // slowing down
+  {
+    t0=t1-(now-t1);
+    c0=c1-dc;
+  }
+  return step2degr(rot,c1-c0)*1e6/(float)(t1-t0);
+}
+
+/*********************************************************************
+ * Position (degr) with sub-pulse resolution, alpha-beta filter:
+ *   - at each pulse edge (ISR ring, see pos_handler()) the position is
+ *     exactly known: edge between count c-1 and c is at c (pulses);
+ *     prediction x+v*dt is corrected with ALPHA, rate with BETA;
+ *   - between edges: extrapolated from the last edge, but never past
+ *     the next edge (that would have given a pulse), and with at most
+ *     the rate bound of pulse_rate() (rotor slows down or stops);
+ *   - commanded speed: motor off or reversing, then only coasting for
+ *     POS_EST_COAST, not the full extrapolation.
+ * x in [rotated, rotated+1) pulses; returned shifted by half a pulse,
+ * so on average it equals to_degr() (calibration offsets stay valid).
+ * 'rotated' set otherwise (calibration, stepper): restart.
+ *********************************************************************/
+#define POS_EST_ALPHA 0.5
+#define POS_EST_BETA 0.2
+#define POS_EST_COAST 0.1        // s, rotor runs on after motor off
+float pos_estimate(ROTOR *rot)
+{
+  unsigned long h,n,t;
+  long c,dc;
+  float x,v,dt,vmax;
+  if (!rot) return 0.;
+  h=__atomic_load_n(&rot->pls_head,__ATOMIC_ACQUIRE);
+  if (h-rot->est_n>=PLS_RING) rot->est_n=h-(PLS_RING-1);  // missed: oldest in ring
+  for (n=rot->est_n; n!=h; n++)
+  {
+    t=rot->pls_t[n&(PLS_RING-1)];
+    c=rot->pls_cnt[n&(PLS_RING-1)];
+    dc=c-rot->est_cnt;
+    x=(float)(dc<0? c+1 : c);              // edge position
+    dt=(t-rot->est_t)*1e-6;
+    if (((dc!=1) && (dc!=-1)) || (dt<=0.) || (dt>PLS_STOP_US*1e-6))  // restart here
+    {
+      rot->est_x=x;
+      rot->est_v=0.;
+    }
+    else
+    {
+      float r=x-(rot->est_x+rot->est_v*dt);
+      rot->est_x+=rot->est_v*dt+POS_EST_ALPHA*r;
+      rot->est_v+=POS_EST_BETA*r/dt;
+      if (SIGN(rot->est_v)!=SIGN(dc)) rot->est_v=0.;  // reversal
+    }
+    rot->est_t=t;
+    rot->est_cnt=c;
+  }
+  rot->est_n=h;
+
+  c=rot->rotated;
+  if (c!=rot->est_cnt)                     // set without pulse
+  {
+    rot->est_cnt=c;
+    rot->est_x=c+0.5;
+    rot->est_v=0.;
+    rot->est_t=micros();
+  }
+
+  // extrapolate, within the current pulse interval
+  v=rot->est_v;
+  dt=(micros()-rot->est_t)*1e-6;
+  if (dt>0.)
+  {
+    vmax=1./dt;                            // no pulse for dt: slower than this
+    if (v>vmax) v=vmax;
+    if (v<-vmax) v=-vmax;
+  }
+  if ((!rot->speed) || (SIGN(rot->speed)!=SIGN(v)))
+  {
+    if (dt>POS_EST_COAST) dt=POS_EST_COAST;  // motor off/reversing: only coasts
+  }
+  x=rot->est_x+v*dt;
+  if (x<c) x=c;
+  if (x>c+0.999) x=c+0.999;
+  return step2degr(rot,1)*(x-0.5);         // on average as to_degr(): calibration
+}
+
 // calc. steps from degrees for 'rot'
 static long degr2step(ROTOR *rot,float degr)
 {
@@ -92,6 +224,71 @@ long from_degr(ROTOR *rot)
   return degr2step(rot,rot->degr);
 }
 
+#if USE_SCURVE
+/*********************************************************************
+ * Time (s) since the previous step of the motion profile of 'rot'.
+ * Restarts the profile at position 'degr', rate 'vel' (degr/s) after
+ * other control (prof.valid false) or a gap.
+ *********************************************************************/
+static float prof_dt(ROTOR *rot,float degr,float vel)
+{
+  unsigned long t=micros();
+  float dt=(t-rot->prof.t_us)*1e-6;
+  rot->prof.t_us=t;
+  if ((!rot->prof.valid) || (dt>0.1))
+  {
+    sc_reset(&rot->prof,degr,vel);
+    dt=0.;
+  }
+  return dt;
+}
+
+#if MOTORTYPE == MOT_STEPPER
+// actual position of stepper in degr (its own count, as follow_prof())
+static float step_degr(ROTOR *rot)
+{
+  float degr=CMDP(rot,currentPosition())*360./rot->steps_degr;
+  #if SWAP_DIR
+    degr*=-1;
+  #endif
+  return degr;
+}
+
+// actual rate of stepper in degr/s
+static float step_rate(ROTOR *rot)
+{
+  float vel=CMDP(rot,speed())*360./rot->steps_degr;
+  #if SWAP_DIR
+    vel*=-1;
+  #endif
+  return vel;
+}
+
+// steps follow the profile setpoints
+static void follow_prof(ROTOR *rot)
+{
+  float step=rot->prof.pos*rot->steps_degr/360.;
+  float sps=rot->prof.vel*rot->steps_degr/360.;
+  #if SWAP_DIR
+    step*=-1;
+    sps*=-1;
+  #endif
+  CMDP(rot,follow(step,sps));
+}
+#endif
+
+// start of the profile: its setpoint, else actual position (as prof_dt())
+static float prof_start(ROTOR *rot)
+{
+  if (rot->prof.valid) return rot->prof.pos;
+  #if MOTORTYPE == MOT_STEPPER
+    return step_degr(rot);
+  #else
+    return to_degr(rot);
+  #endif
+}
+#endif
+
 #if defined(USE_EASTWEST) && USE_EASTWEST
 /*********************************************************************
  * For elevation/azimut, where azimut rotor cannot rotate 360 (400) degrees:
@@ -129,7 +326,10 @@ void convert_eastwest(GOTO_VAL *gv)
 }
 #endif
 
+#define NWRUNEND                   // run_to_endswitch() without prepare_speed()
+
 #if MOTORTYPE == MOT_STEPPER
+#if (!USE_SCURVE) || (!defined(NWRUNEND))
 static void moveto(ROTOR *rot)
 {
   long step;
@@ -138,6 +338,7 @@ static void moveto(ROTOR *rot)
   step=degr2step(rot,rot->req_degr);
   CMDP(rot,moveTo(step)); // do requested
 }
+#endif
 
 static boolean end_of_rot(ROTOR *rot,int speed)
 {
@@ -164,7 +365,7 @@ static int rotor_speed(ROTOR *rot,float deg)
   float adg=fabs(deg);
   if (!rot) return 0;
 
-  if (adg<=D_DEGR_STOP)
+  if (adg<=rot->deadband)
   {
     speed=0;
   }
@@ -194,6 +395,68 @@ static int rotor_speed(ROTOR *rot,float deg)
   return speed;
 }
 
+/*********************************************************************
+ * PID with feed-forward of rate 'vel' (requested or profile rate).
+ * For DC motors, replaces rotor_speed()+accellerate().
+ * Within deadband: only feed-forward and integrator, or stop if no rate.
+ * Anti-windup: integrator frozen if output saturates in error direction,
+ *   and contribution limited to PID_IMAX.
+ * input: deg = difference current and requested angle in degrees
+ * return: speed in percents, minspeed...maxspeed or 0
+ *********************************************************************/
+static int rotor_speed_pid(ROTOR *rot,float deg,float vel)
+{
+  unsigned long t;
+  float dt,err,u,imax;
+  int speed;
+  if (!rot) return 0;
+
+  t=micros();
+  dt=(t-rot->pid_t)*1e-6;
+  rot->pid_t=t;
+  if (dt>0.1)                  // first step after other control: restart
+  {
+    dt=0.;
+    rot->pid_int=0.;
+  }
+
+  err=deg;
+  if (fabs(deg)<=rot->deadband)
+  {
+    if (!vel)                  // at position
+    {
+      rot->pid_int=0.;
+      return 0;
+    }
+    err=0.;                    // tracking: no correction within deadband
+  }
+
+  // D on rate error: measured pulse rate, not differences of coarse positions
+  u=rot->kff*vel + rot->kp*err + rot->ki*rot->pid_int + rot->kd*(vel-rot->vel);
+
+  if ((fabs(u)<rot->maxspeed) || (SIGN(u)!=SIGN(err)))
+  {
+    rot->pid_int+=err*dt;
+    if (rot->ki)
+    {
+      imax=PID_IMAX/rot->ki;
+      if (rot->pid_int > imax) rot->pid_int=imax;
+      if (rot->pid_int <-imax) rot->pid_int=-imax;
+    }
+  }
+
+  // motor doesn't turn below PID_MINSPEED: map 0...maxspeed to PID_MINSPEED...maxspeed
+  if (fabs(u)<0.5) return 0;
+  if (fabs(u)>rot->maxspeed) u=rot->maxspeed*SIGN(u);
+  speed=PID_MINSPEED+(int)(fabs(u)*(rot->maxspeed-PID_MINSPEED)/rot->maxspeed+0.5);
+
+  if (u<0) speed*=-1;
+  #if SWAP_DIR
+    speed*=-1;
+  #endif
+  return speed;
+}
+
 // accelerate motor
 // ospeed follows ispeed in small steps
 // uaccel: accleration up, daccel: acceleration down; 0=no acceleration
@@ -282,15 +545,34 @@ static void set_speed(ROTOR *rot,int speed)
 }
 
 // Set direction of motor
-static void set_dir(ROTOR *rot,boolean dir)
+// A reversal first stops the motor for REVERSE_MS, without quadrature
+// also until it has coasted to within REVERSE_COAST of rest (rate at
+// the stop falls as exp(-t/ROTOR_TAU); no pulses yet when just started:
+// rate of the speed at most), without blocking;
+// rot->dir keeps the old direction meanwhile, so pulses of the
+// slowing-down motor are counted right.
+// return: true if motor may run in 'dir', false: keep it stopped
+#define REVERSE_MS 10
+#define REVERSE_COAST 0.05       // pulses still to coast
+static boolean set_dir(ROTOR *rot,boolean dir)
 {
-  boolean din;
-  if (!rot) return;
+  float coast;
+  if (!rot) return false;
   if (dir!=rot->dir)
   {
-    set_speed(rot,0);
-    delay(10);
+    if (!rot->reversing)
+    {
+      coast=MAX(fabs(pulse_rate(rot)),abs(rot->speed)/PID_KFF)*ROTOR_TAU*rot->steps_degr/360.;  // pulses to rest
+      set_speed(rot,0);
+      rot->reversing=true;
+      rot->t_reverse=millis();
+      rot->reverse_ms=REVERSE_MS;
+      if ((rot->pin_plsb<0) && (coast>REVERSE_COAST))
+        rot->reverse_ms=MAX(REVERSE_MS,(unsigned long)(1000.*ROTOR_TAU*log(coast/REVERSE_COAST)));
+    }
+    if (millis()-rot->t_reverse < rot->reverse_ms) return false;
   }
+  rot->reversing=false;
   rot->dir=dir;
 
   digitalWrite(rot->pin_dir, rot->dir);
@@ -298,17 +580,22 @@ static void set_dir(ROTOR *rot,boolean dir)
   {
     digitalWrite(rot->pin_din, (rot->dir? LOW : HIGH));
   }
+  return true;
 }
 
 #endif
 
 
-#if MOTORTYPE == MOT_STEPPER
+#if (MOTORTYPE == MOT_STEPPER) && (!USE_SCURVE)
 static int set_temp_maxspeed(ROTOR *rot,int speed)
 {
   int maxspeed,new_speed;
-  maxspeed=CMDP(rot,maxSpeed());
-  new_speed=maxspeed*(float)speed/100.;
+  #if USE_STEPGEN
+    maxspeed=rot->motorspeed;        // steps later, from timer: no restore
+  #else
+    maxspeed=CMDP(rot,maxSpeed());
+  #endif
+  new_speed=maxspeed*(float)abs(speed)/100.;
   CMDP(rot,setMaxSpeed(new_speed));              // set speed to new according to 'speed'
   return maxspeed;
 }
@@ -330,22 +617,39 @@ int run_motor_soft(ROTOR *rot,int speed)
       CMDP(rot,setSpeed(0));            // force internally saved speed to 0
       CMDP(rot,stop());                 // force stop
       speed=0;                          //
+      #if USE_SCURVE
+        rot->prof.valid=false;
+      #endif
     }
     else
     {
+    #if USE_SCURVE                      // jerk-limited to 'speed' % of max. rate
+      sc_speed(&rot->prof,rot->prof.vmax*speed/100.,prof_dt(rot,step_degr(rot),step_rate(rot)));
+      follow_prof(rot);
+    #else
       int step;
       int maxspeed=set_temp_maxspeed(rot, speed);                  // set temp. maxspeed
       // set step 360 degrees from current pos. to accelerate
       step=CMDP(rot,currentPosition()+(rot->steps_degr*SIGN(speed))); 
       CMDP(rot,moveTo(step));                    // move accelerated to endpoint
       CMDP(rot,run());                           // run with accel. 
-      CMDP(rot,setMaxSpeed(maxspeed));           // restore maxspeed
+      #if !USE_STEPGEN
+        CMDP(rot,setMaxSpeed(maxspeed));         // restore maxspeed
+      #endif
+    #endif
     }
     rot->rotated=CMDP(rot,currentPosition());
   #else
+    #if USE_SCURVE
+      rot->prof.valid=false;
+    #endif
     speed=accellerate(rot,speed,1,1);
-    if (speed)
-      set_dir(rot,speed > 0? HIGH : LOW);
+    if ((speed) && (!set_dir(rot,speed > 0? HIGH : LOW)))
+    {
+      set_speed(rot,0);                    // reversing: still busy,
+      rot->speed=0;                        // ramp from rest after it
+      return speed;
+    }
     set_speed(rot,abs(speed));
   #endif
   rot->speed=speed;
@@ -358,6 +662,9 @@ int run_motor_hard(ROTOR *rot,int speed)
   if (!rot) return 0;
 
   // set speed and run (without accelleration)
+  #if USE_SCURVE
+    rot->prof.valid=false;             // goto starts again from here
+  #endif
   #if MOTORTYPE == MOT_STEPPER
     if (end_of_rot(rot,speed))
     {
@@ -368,15 +675,20 @@ int run_motor_hard(ROTOR *rot,int speed)
     else
     {
       float nspeed;
-      nspeed=CMDP(rot,maxSpeed())*(float)speed/100.;
+      #if USE_STEPGEN
+        nspeed=rot->motorspeed*(float)speed/100.;
+      #else
+        nspeed=CMDP(rot,maxSpeed())*(float)speed/100.;
+      #endif
       CMDP(rot,setSpeed(nspeed));
       CMDP(rot,runSpeed());
     }
     rot->rotated=CMDP(rot,currentPosition());
   #else
-    if (speed)
-      set_dir(rot,speed > 0? HIGH : LOW);
-    set_speed(rot,abs(speed));
+    if ((speed) && (!set_dir(rot,speed > 0? HIGH : LOW)))
+      set_speed(rot,0);                    // reversing: still busy
+    else
+      set_speed(rot,abs(speed));
   #endif
   rot->speed=speed;
   return speed;
@@ -384,7 +696,10 @@ int run_motor_hard(ROTOR *rot,int speed)
 
 
 // soft speed control (accel.)
-// For DC motors accel. is defined by:
+// With USE_SCURVE: jerk-limited profile to the target (scurve.cpp);
+//   DC, MOTION_PID: profile is PID setpoint and feed-forward,
+//   stepper: steps follow the profile (StepGen::follow()).
+// Else, for DC motors accel. is defined by:
 //   stop: #degr. to run: diff_degr
 //   start: accellerate()
 // For stepper: this is built-in
@@ -399,6 +714,9 @@ static int run_motor_soft_dd(ROTOR *rot)
 
   diff_degr=rot->req_degr - rot->degr;
   rot->err_degr=diff_degr;
+  #if MOTORTYPE != MOT_STEPPER
+    rot->vel=pulse_rate(rot);
+  #endif
 
 
   #if MOTORTYPE == MOT_STEPPER
@@ -421,17 +739,46 @@ static int run_motor_soft_dd(ROTOR *rot)
     }
     else
     {
+    #if USE_SCURVE
+      sc_goto(&rot->prof,rot->req_degr,rot->req_vel,prof_dt(rot,step_degr(rot),step_rate(rot)));
+      follow_prof(rot);
+      speed=degr2step(rot,rot->req_degr)-CMDP(rot,currentPosition()); // to detect if ready
+      if ((!speed) && (CMDP(rot,run()))) speed=1;      // still settling
+    #else
+      #if USE_STEPGEN
+        CMDP(rot,setMaxSpeed(rot->motorspeed));        // after run_motor_soft()
+      #endif
       moveto(rot);
       CMDP(rot,run());                                 // run with accel. 
       speed=CMDP(rot,distanceToGo());                // to detect if ready, not actual speed...
+    #endif
     }
     rot->rotated=CMDP(rot,currentPosition());
   #else
-    speed=rotor_speed(rot,diff_degr);
-    speed=accellerate(rot,speed,1,0); // werkt veel te traag, grote overshoot!
-    if (speed)
-      set_dir(rot,speed > 0? HIGH : LOW);
-    set_speed(rot,abs(speed));
+    if (rot->motion==MOTION_PID)
+    {
+      #if USE_SCURVE                       // to profile setpoint
+        float ff;
+        sc_goto(&rot->prof,rot->req_degr,rot->req_vel,prof_dt(rot,rot->degr,rot->vel));
+        ff=rot->prof.vel+PID_TFF*rot->prof.acc;
+        if (ff*rot->prof.vel<0.) ff=0.;    // braking beyond coasting: no reversal, coast
+        speed=rotor_speed_pid(rot,rot->prof.pos-rot->degr,ff);
+      #else
+        speed=rotor_speed_pid(rot,diff_degr,rot->req_vel);
+      #endif
+    }
+    else
+    {
+      #if USE_SCURVE
+        rot->prof.valid=false;
+      #endif
+      speed=rotor_speed(rot,diff_degr);
+      speed=accellerate(rot,speed,1,0); // werkt veel te traag, grote overshoot!
+    }
+    if ((speed) && (!set_dir(rot,speed > 0? HIGH : LOW)))
+      set_speed(rot,0);                    // reversing: still busy
+    else
+      set_speed(rot,abs(speed));
     rot->speed=speed;
   #endif
 
@@ -447,21 +794,32 @@ static int run_motor_soft_dd(ROTOR *rot)
  *********************************************************************/
 int rotor_goto(ROTOR *rot,float val)
 {
-  float rot_degr;      // current pos. rotor in decdegrees
-  float req_degr;      // requested pos. rotor in decdegrees
-  float diff_degr;
+  return rotor_track(rot,val,0.);
+}
+
+/*********************************************************************
+ * As rotor_goto(), with requested rate 'vel' (degr/s) of 'val'.
+ * With MOTION_PID 'vel' is used as feed-forward.
+ *********************************************************************/
+int rotor_track(ROTOR *rot,float val,float vel)
+{
   int speed;
   if (!rot) return 0;
 
   rot->req_degr=val;                      // requested degrees
-  rot->degr=to_degr(rot);
+  rot->req_vel=vel;                       // requested rate
+  #if USE_POS_EST
+    rot->degr=pos_estimate(rot);
+  #else
+    rot->degr=to_degr(rot);
+  #endif
 //printf("req=%f  act=%f\n",rot->req_degr,rot->degr);
   #if ROTORTYPE==ROTORTYPE_AE
     #if FULLRANGE_AZIM == false     // range azimut=0...+180
       if (rot->req_degr>270) rot->req_degr-=360;
     #else                           // range azimut=0...360
-      if ((rot->rot_degr > 270) && (rot->req_degr+rot->round*360 < 90)) rot->round++;
-      if ((rot->req_degr > 270) && (rot->rot_degr+rot->round*360 < 90)) rot->round--;
+      if ((rot->degr > 270) && (rot->req_degr+rot->round*360 < 90)) rot->round++;
+      if ((rot->req_degr > 270) && (rot->degr+rot->round*360 < 90)) rot->round--;
       rot->req_degr+=rot->round*360;
     #endif
   #endif
@@ -471,6 +829,89 @@ int rotor_goto(ROTOR *rot,float val)
 }
 
 
+/*********************************************************************
+ * Coordinated slew of both rotors to 'ax', 'ey' (rest to rest): the
+ * rotor that would arrive first slows down (sc_sync()), so both arrive
+ * together, in the time of the slowest rotor. Used by rotor_goto()
+ * after this; tracking restores the own limits.
+ * return: expected slew time (s); 0 if no motion profile
+ *********************************************************************/
+float rotors_slew(ROTOR *AX_rot,ROTOR *EY_rot,float ax,float ey)
+{
+  #if USE_SCURVE
+    float dax,dey;
+    if ((!AX_rot) || (!EY_rot))
+    {
+      if (AX_rot) sc_scale(&AX_rot->prof,1.);
+      if (EY_rot) sc_scale(&EY_rot->prof,1.);
+      return 0.;
+    }
+    #if ROTORTYPE==ROTORTYPE_AE && FULLRANGE_AZIM == false
+      if (ax>270) ax-=360;                // as rotor_track()
+    #endif
+    dax=ax-prof_start(AX_rot);
+    dey=ey-prof_start(EY_rot);
+    return sc_sync(&AX_rot->prof,&EY_rot->prof,dax,dey);
+  #else
+    return 0.;
+  #endif
+}
+
+/*********************************************************************
+ * Both rotors to position 'gv', e.g. from calc_pos().
+ * With MOTION_PID the position is extrapolated with the rate
+ * vax, vey from the time it was calculated (max. TRACK_EXTRAP_MS).
+ *********************************************************************/
+#define TRACK_EXTRAP_MS 2000
+void rotors_track(ROTOR *AX_rot,ROTOR *EY_rot,GOTO_VAL *gv)
+{
+  static float slew_ax=-999.,slew_ey=-999.;       // target of coordinated slew
+  float dt=0.;
+  if ((gv->vax) || (gv->vey))
+  {
+    dt=(millis()-gv->t_ms)*0.001;
+    if (dt>TRACK_EXTRAP_MS*0.001) dt=TRACK_EXTRAP_MS*0.001;
+    if (slew_ax!=-999.)                           // tracking: own limits
+    {
+      rotors_slew(AX_rot,NULL,0.,0.);
+      rotors_slew(NULL,EY_rot,0.,0.);
+      slew_ax=slew_ey=-999.;
+    }
+  }
+  else if ((gv->ax!=slew_ax) || (gv->ey!=slew_ey))  // new fixed position
+  {
+    rotors_slew(AX_rot,EY_rot,gv->ax,gv->ey);
+    slew_ax=gv->ax;
+    slew_ey=gv->ey;
+  }
+  if ((AX_rot) && (AX_rot->motion==MOTION_PID))
+    rotor_track(AX_rot,gv->ax+gv->vax*dt,gv->vax);
+  else
+    rotor_goto(AX_rot,gv->ax);
+  if ((EY_rot) && (EY_rot->motion==MOTION_PID))
+    rotor_track(EY_rot,gv->ey+gv->vey*dt,gv->vey);
+  else
+    rotor_goto(EY_rot,gv->ey);
+}
+
+// set motion control; deadband to default of 'motion'
+void set_motion(ROTOR *rot,int motion)
+{
+  if (!rot) return;
+  rot->motion=motion;
+  rot->pid_t=0;
+  #if ((MOTORTYPE == MOT_DC_PWM) || (MOTORTYPE == MOT_DC_FIX))
+    rot->deadband=(motion==MOTION_PID? PID_DEADBAND : D_DEGR_STOP);
+    if ((!rot->kp) && (!rot->ki) && (!rot->kff))
+    {
+      rot->kp=PID_KP;
+      rot->ki=PID_KI;
+      rot->kd=PID_KD;
+      rot->kff=PID_KFF;
+    }
+  #endif
+}
+
 /*********************************************************************
  * calibration funcs
  *********************************************************************/
@@ -492,6 +933,9 @@ void reset_to_pos(ROTOR *rot,long step)
   #if MOTORTYPE == MOT_STEPPER
     CMDP(rot,setCurrentPosition(step));
   #endif
+  #if USE_SCURVE
+    rot->prof.valid=false;
+  #endif
 }
 
 #if MOTORTYPE != MOT_STEPPER
@@ -518,14 +962,11 @@ void run_to_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_pos,float ey_pos,boolean r
 {
   int xbusy=0;
   int ybusy=0;
-  long ax_run_err,ey_run_err;
-  float ax_err,ey_err;
-  unsigned long ax_start_time,ey_start_time;
-  ax_start_time=millis();
-  ey_start_time=millis();
-
-  ax_run_err=0; ey_run_err=0;
-  ax_err=0; ey_err=0;
+  #if MOTORTYPE != MOT_STEPPER
+    unsigned long ax_start_time,ey_start_time;
+    ax_start_time=millis();
+    ey_start_time=millis();
+  #endif
 
   if (relative)
   {
@@ -533,6 +974,7 @@ void run_to_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_pos,float ey_pos,boolean r
     ey_pos+=to_degr(EY_rot);
   }
 
+  rotors_slew(AX_rot,EY_rot,ax_pos,ey_pos);
   do
   {
     xbusy=rotor_goto(AX_rot,ax_pos);
@@ -544,12 +986,15 @@ void run_to_pos(ROTOR *AX_rot, ROTOR *EY_rot,float ax_pos,float ey_pos,boolean r
 
   run_motor_hard(AX_rot,0);
   run_motor_hard(EY_rot,0);
+  rotors_slew(AX_rot,NULL,0.,0.);              // own limits again
+  rotors_slew(NULL,EY_rot,0.,0.);
 
   if (!xbusy) set_status(AX_rot,cal_ready);
   if (!ybusy) set_status(EY_rot,cal_ready);
 }
 
 #define RUN_ENDSW_MAX -365.
+#ifndef NWRUNEND
 static int prepare_speed(ROTOR *rot,int speed)
 {
   int new_speed,maxspeed;
@@ -586,30 +1031,26 @@ static void restore_speed(ROTOR *rot,int speed,int pre_cnt)
 //      set_status(EY_rot,cal_end_stop);
   #else
     if (rot->rotated) rot->cal_status=cal_got_pulses;
-    if (pre_cnt==rot->rotated); rot->cal_status=cal_end_stop;
+    if (pre_cnt==rot->rotated) rot->cal_status=cal_end_stop;
 
 //    if (pre_cnt==rot->rotated) set_status(rot,cal_end_stop);
   #endif
 }
+#endif
 
-#define NWRUNEND
 void run_to_endswitch(ROTOR *AX_rot, ROTOR *EY_rot,int speed)
 {
   int busy=0;
-  int ax_maxspeed,ey_maxspeed;
+#if MOTORTYPE != MOT_STEPPER
   int a,b;
-
   unsigned long ax_start_time,ey_start_time;
-
-#ifdef NWRUNEND
-#else
+#endif
+#ifndef NWRUNEND
+  int ax_maxspeed,ey_maxspeed;
   ax_maxspeed=prepare_speed(AX_rot,speed);
   ey_maxspeed=prepare_speed(EY_rot,speed);
 #endif
 
-  ax_start_time=millis();
-  ey_start_time=millis();
-
 #if MOTORTYPE == MOT_STEPPER
   do
   {
@@ -622,6 +1063,8 @@ void run_to_endswitch(ROTOR *AX_rot, ROTOR *EY_rot,int speed)
 #endif
   } while (busy);
 #else
+  ax_start_time=millis();
+  ey_start_time=millis();
   do
   {
 #ifdef NWRUNEND
@@ -0,0 +1,214 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Pass scheduler: catalogue of satellites
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * The catalogue holds up to CAT_SIZE satellites (keplers with SGP4
+ * constants ready) with a priority. The schedule predicts all passes
+ * of all satellites for the next SCHED_HOURS; overlapping passes are
+ * resolved by priority (then max. elevation): the loser is dropped.
+ * calc_pos_sched() loads the satellite of the current/next pass into
+ * 'kepler' and tracks it, so the controller runs without PC.
+ *
+ * public functions:
+ *   void sched_reset(SCHEDULE *s)
+ *   int sched_make(SCHEDULE *s,CAT_ENTRY *cat,EPOINT *refpos,long t)
+ *   int sched_next(SCHEDULE *s,long t)
+ *   boolean calc_pos_sched(GOTO_VAL *gv,SCHEDULE *s,CAT_ENTRY *cat,
+ *                          KEPLER *kepler,PASS_PLAN *plan,EPOINT *refpos)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+#include <time.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef ROTOR_AX_STOP
+  #define ROTOR_AX_STOP 90
+#endif
+#ifndef ROTOR_EY_STOP
+  #define ROTOR_EY_STOP 90
+#endif
+
+#ifndef PREPOS_LEAD
+  #define PREPOS_LEAD 0
+#endif
+
+#define MAX_CAND (CAT_SIZE*16)   // candidate passes (~15 per sat. per day)
+
+/*********************************************************************
+ * Passes of 1 satellite with AOS between t0 and t1,
+ *   max. elevation >= SCHED_MIN_ELEV
+ * A pass in progress at t0 gets aos=t0.
+ * return: nr. of passes added to p
+ *********************************************************************/
+static int find_passes(KEPLER *kepler,EPOINT *refpos,long t0,long t1,int sat,SCHED_PASS *p,int maxp)
+{
+  PASS pass;
+  double t=t0;
+  int n=0;
+
+  while ((n<maxp) && (find_next_pass(kepler,refpos,t,t1,&pass)))
+  {
+    t=pass.los+1.;
+    if (pass.max_elev<SCHED_MIN_ELEV) continue;
+    p[n].sat=sat;
+    p[n].aos=MAX((long)ceil(pass.aos),t0);
+    p[n].los=(long)pass.los;
+    p[n].max_elev=pass.max_elev;
+    n++;
+  }
+  return n;
+}
+
+// true if 'a' overlaps 'b', including time to slew between them
+static boolean overlap(SCHED_PASS *a,SCHED_PASS *b)
+{
+  return ((a->aos < b->los+SCHED_GAP) && (b->aos < a->los+SCHED_GAP));
+}
+
+void sched_reset(SCHEDULE *s)
+{
+  s->t0=0;
+  s->n=0;
+  s->loaded=-1;
+}
+
+/*********************************************************************
+ * Predict passes of all catalogue entries from 't' for SCHED_HOURS.
+ * Candidates are taken in order of priority (then max. elevation);
+ *   one that overlaps an accepted pass is dropped.
+ * Result in s->p[], sorted on AOS.
+ * return: nr. of scheduled passes
+ *********************************************************************/
+int sched_make(SCHEDULE *s,CAT_ENTRY *cat,EPOINT *refpos,long t)
+{
+  static SCHED_PASS cand[MAX_CAND];
+  int ncand=0;
+  int i,j,k;
+
+  s->n=0;
+  s->t0=t;
+  for (i=0; i<CAT_SIZE; i++)
+  {
+    if (cat[i].prio<=0) continue;
+    ncand+=find_passes(&cat[i].kepler,refpos,t,t+SCHED_HOURS*3600L,i,cand+ncand,MAX_CAND-ncand);
+  }
+
+  while (ncand)
+  {
+    // best remaining candidate
+    k=0;
+    for (i=1; i<ncand; i++)
+    {
+      int pi=cat[cand[i].sat].prio,pk=cat[cand[k].sat].prio;
+      if ((pi>pk) || ((pi==pk) && (cand[i].max_elev>cand[k].max_elev))) k=i;
+    }
+    for (j=0; j<s->n; j++)
+      if (overlap(&cand[k],&s->p[j])) break;
+    if ((j==s->n) && (s->n<SCHED_SIZE))
+    {
+      // insert sorted on AOS
+      for (j=s->n; (j>0) && (s->p[j-1].aos>cand[k].aos); j--) s->p[j]=s->p[j-1];
+      s->p[j]=cand[k];
+      s->n++;
+    }
+    cand[k]=cand[--ncand];
+  }
+  return s->n;
+}
+
+// index of current or next pass at time 't'; -1: none
+int sched_next(SCHEDULE *s,long t)
+{
+  int i;
+  for (i=0; i<s->n; i++)
+    if (s->p[i].los>t) return i;
+  return -1;
+}
+
+// rotors to park position
+static boolean park(GOTO_VAL *gv)
+{
+  gv->ax=ROTOR_AX_STOP;
+  gv->ey=ROTOR_EY_STOP;
+  gv->vax=0.;
+  gv->vey=0.;
+  return false;
+}
+
+/*********************************************************************
+ * As calc_pos_plan(), but for the satellite of the schedule:
+ *   - (re)make schedule if none, or older than SCHED_RENEW (not during a pass)
+ *   - load satellite of current/next pass into 'kepler'
+ *   - track it from AOS until LOS, pre-positioning before it (PREPOS_LEAD,
+ *     or with pass plan plan_lead(), the same as calc_pos_plan()), else park
+ * Making the schedule takes < 100 SGP4 calls per pass (find_next_pass());
+ *   the control task keeps running meanwhile.
+ *********************************************************************/
+boolean calc_pos_sched(GOTO_VAL *gv,SCHEDULE *s,CAT_ENTRY *cat,
+                       KEPLER *kepler,PASS_PLAN *plan,EPOINT *refpos)
+{
+  time_t t;
+  SCHED_PASS *p;
+  int i;
+
+  time(&t);
+  i=sched_next(s,t);
+  if ((!s->t0) || (t<s->t0) ||                                 // new, or time set back
+      ((t>=s->t0+SCHED_RENEW) && ((i<0) || (t<s->p[i].aos))))  // old, and not in a pass
+  {
+    sched_make(s,cat,refpos,t);
+  }
+
+  if ((i=sched_next(s,t))<0) return park(gv);
+  p=&s->p[i];
+  if (s->loaded!=p->sat)
+  {
+    *kepler=cat[p->sat].kepler;
+    plan_reset(plan);
+    s->loaded=p->sat;
+  }
+  #if USE_PASSPLAN
+    // plan of this pass before AOS: its slew time sets the lead, as prepos()
+    if ((t<p->aos) && (((!plan->n) && (t>=plan->t_retry)) ||
+                       ((plan->n) && ((plan->t0<p->aos-PLAN_STEP) || (plan->t0>p->los)))))
+      plan_pass(plan,kepler,refpos,p->aos-PLAN_STEP);
+    if (plan->n)
+    {
+      if (t<plan->t0-plan_lead(plan)) return park(gv);
+    }
+    else
+    {
+      if (t<p->aos-PREPOS_LEAD) return park(gv);
+    }
+    return calc_pos_plan(gv,plan,kepler,refpos);  // pre-positioning or pass
+  #else
+    if (t<p->aos-PREPOS_LEAD) return park(gv);   // else pre-positioning
+    return calc_pos(gv,kepler,refpos);
+  #endif
+}
@@ -0,0 +1,226 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Jerk-limited motion profile
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * Setpoints (position, rate, acceleration) per axis that follow the
+ * requested position with limited rate, acceleration and jerk, for DC
+ * (PID setpoint, see run_motor_soft_dd()) and stepper motors alike.
+ * Computed online, one step per control period, so a moving target
+ * (satellite) or a new target halfway a slew is followed without
+ * planning again.
+ *
+ * Each step a wanted rate (relative to the moving target) follows from
+ * the distance to go: the highest rate from which a jerk-limited stop
+ * ends at the target, proportional close to it, max. vmax. The
+ * acceleration moves towards the one that gives this rate, within
+ * amax and at most jmax per s. So the acceleration is continuous:
+ * an S-shaped rate ramp instead of the steps of accellerate().
+ *
+ * Coordinated slew (sc_sync()): the time of a move from rest to rest
+ * follows in closed form from the limits (sc_move_time()). The axis
+ * that would arrive first gets all its limits scaled down (sc_scale()),
+ * so both axes arrive together, in the time of the slowest one, which
+ * is still the shortest possible. Scaling all limits by k scales the
+ * whole profile by k: same shape on both axes.
+ *
+ * public functions:
+ *   void sc_set_limits(SCURVE *p,float vmax,float amax,float jmax)
+ *   void sc_reset(SCURVE *p,float pos,float vel)
+ *   void sc_goto(SCURVE *p,float target,float target_vel,float dt)
+ *   void sc_speed(SCURVE *p,float vel,float dt)
+ *   void sc_scale(SCURVE *p,float k)
+ *   float sc_move_time(SCURVE *p,float d)
+ *   float sc_sync(SCURVE *ax,SCURVE *ey,float dax,float dey)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "rotorctrl.h"
+#include <math.h>
+
+#if USE_SCURVE
+#define SC_LOCK_DEGR 0.01        // at target within this: lock on it
+#define SC_LOCK_VEL 0.01         //   and this rate difference
+#define SC_TAU 0.5               // rate loop time constant, * amax/jmax
+#define SC_KP 4.                 // position loop: time constant * SC_TAU
+#define SC_MARGIN 0.8            // of the rate that can just stop
+#define SC_SCALE_MIN 0.01        // sc_sync(): min. scale of limits
+
+void sc_set_limits(SCURVE *p,float vmax,float amax,float jmax)
+{
+  p->vmax=fabs(vmax);
+  p->amax=fabs(amax);
+  p->jmax=fabs(jmax);
+  p->scale=1.;
+}
+
+// limits of sc_goto() to 'k' times those set (0<k<=1), see sc_sync()
+void sc_scale(SCURVE *p,float k)
+{
+  p->scale=(k<SC_SCALE_MIN? SC_SCALE_MIN : k>1.? 1. : k);
+}
+
+// start from position 'pos' at rate 'vel'
+void sc_reset(SCURVE *p,float pos,float vel)
+{
+  p->pos=pos;
+  p->vel=(fabs(vel)>p->vmax? p->vmax*SIGN(vel) : vel);
+  p->acc=0.;
+  p->valid=true;
+}
+
+// acceleration to 'a_want' with max. jerk, then integrate 'dt' s; limits * 'k'
+static void sc_step(SCURVE *p,float a_want,float dt,float k)
+{
+  float da=a_want-p->acc,v0=p->vel;
+  float jdt=p->jmax*k*dt,amax=p->amax*k;
+  if (da>jdt) da=jdt;
+  if (da<-jdt) da=-jdt;
+  p->acc+=da;
+  if (p->acc>amax) p->acc=amax;
+  if (p->acc<-amax) p->acc=-amax;
+  p->vel+=p->acc*dt;
+  p->pos+=(v0+p->vel)*dt/2.;
+}
+
+/*********************************************************************
+ * Max. rate from which the jerk-limited stop distance is 'e' (a=0):
+ * triangle v*sqrt(v/J) below v=A^2/J, else v^2/(2A)+v*A/(2J).
+ *********************************************************************/
+static float stop_rate(SCURVE *p,float e)
+{
+  float a=p->amax*p->scale,j=p->jmax*p->scale;
+  if (e<=a*a*a/(j*j)) return cbrt(e*e*j);
+  return -a*a/(2.*j)+sqrt(a*a*a*a/(4.*j*j)+2.*a*e);
+}
+
+/*********************************************************************
+ * One step of 'dt' s towards 'target', which moves at 'target_vel'.
+ *********************************************************************/
+void sc_goto(SCURVE *p,float target,float target_vel,float dt)
+{
+  float e,v,vw,tau,vmax=p->vmax*p->scale;
+  if (dt<=0.) return;
+  e=target-p->pos;
+  v=p->vel-target_vel;                     // relative to target
+  if ((fabs(e)<SC_LOCK_DEGR) && (fabs(v)<SC_LOCK_VEL) && (fabs(p->acc)<=p->jmax*p->scale*dt))
+  {
+    p->pos=target+target_vel*dt;
+    p->vel=target_vel;
+    p->acc=0.;
+    return;
+  }
+
+  // wanted rate: can still stop at the target; near it: proportional,
+  // slower than the rate loop, so no overshoot
+  tau=SC_TAU*p->amax/p->jmax;
+  vw=SC_MARGIN*stop_rate(p,fabs(e));
+  if (vw>fabs(e)/(SC_KP*tau)) vw=fabs(e)/(SC_KP*tau);
+  vw=vw*SIGN(e)+target_vel;
+  if (fabs(vw)>vmax) vw=vmax*SIGN(vw);
+  sc_step(p,(vw-p->vel)/tau,dt,p->scale);
+}
+
+/*********************************************************************
+ * One step of 'dt' s to rate 'vel' (manual control, calibration runs).
+ *********************************************************************/
+void sc_speed(SCURVE *p,float vel,float dt)
+{
+  float dv,a;
+  int s;
+  if (dt<=0.) return;
+  if (fabs(vel)>p->vmax) vel=p->vmax*SIGN(vel);
+  dv=vel-p->vel;
+  if ((fabs(dv)<SC_LOCK_VEL) && (fabs(p->acc)<=p->jmax*dt))
+  {
+    p->pos+=(p->vel+vel)*dt/2.;
+    p->vel=vel;
+    p->acc=0.;
+    return;
+  }
+  s=SIGN(dv);
+  a=p->acc*s;
+  // release acceleration in time to arrive at 'vel' with a=0
+  sc_step(p,(a>0. && a*a/(2.*p->jmax)>=fabs(dv)? 0. : p->amax*s),dt,1.);
+}
+
+/*********************************************************************
+ * Time (s) of a move of 'd' degr from rest to rest with the limits set
+ * (not scaled); rate ramps take v/A+A/J, or 2*sqrt(v/J) if A isn't
+ * reached. Short moves don't reach vmax: peak rate from the distance.
+ *********************************************************************/
+float sc_move_time(SCURVE *p,float d)
+{
+  float v=p->vmax,a=p->amax,j=p->jmax,t_ramp;
+  d=fabs(d);
+  if (d<=0.) return 0.;
+  t_ramp=(v*j>=a*a? v/a+a/j : 2.*sqrt(v/j));
+  if (d>=v*t_ramp) return 2.*t_ramp+(d-v*t_ramp)/v;   // ramps: v*t_ramp/2 each
+
+  v=cbrt(d*d*j/4.);                                   // peak rate, A not reached
+  if (v*j<a*a) return 4.*sqrt(v/j);
+  v=a/2.*(-a/j+sqrt(a*a/(j*j)+4.*d/a));
+  return 2.*(v/a+a/j);
+}
+
+/*********************************************************************
+ * Time (s) of a move of 'd' with the limits scaled by 'k':
+ * the profile scales with k, so as 'd/k' with the limits set.
+ *********************************************************************/
+static float scaled_time(SCURVE *p,float d,float k)
+{
+  return sc_move_time(p,d/k);
+}
+
+/*********************************************************************
+ * Coordinated move of 2 axes over 'dax', 'dey' degr from rest:
+ * the slowest axis keeps its limits, the other is scaled (bisection)
+ * to arrive at the same time.
+ * return: time of the move (s)
+ *********************************************************************/
+float sc_sync(SCURVE *ax,SCURVE *ey,float dax,float dey)
+{
+  float tax=sc_move_time(ax,dax),tey=sc_move_time(ey,dey);
+  float t=(tax>tey? tax : tey),lo=SC_SCALE_MIN,hi=1.,k;
+  SCURVE *p=(tax<tey? ax : ey);
+  float d=(tax<tey? dax : dey);
+  int i;
+
+  sc_scale(ax,1.);
+  sc_scale(ey,1.);
+  if (fabs(d)<SC_LOCK_DEGR) return t;       // nothing to do on this axis
+  if (scaled_time(p,d,lo)<=t) k=lo;
+  else
+  {
+    for (i=0; i<20; i++)                     // time falls with k
+    {
+      k=(lo+hi)/2.;
+      if (scaled_time(p,d,k)>t) lo=k; else hi=k;
+    }
+    k=hi;
+  }
+  sc_scale(p,k);
+  return t;
+}
+#endif
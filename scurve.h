@@ -0,0 +1,38 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   jerk-limited (S-curve) motion profile per axis, see scurve.cpp
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#ifndef SCURVE_HDR
+#define SCURVE_HDR
+
+typedef struct scurve
+{
+  float vmax;                    // limits: degr/s
+  float amax;                    //   degr/s^2
+  float jmax;                    //   degr/s^3
+  float scale;                   // sc_goto() limits * this (coordinated slew)
+  float pos;                     // setpoint: degr
+  float vel;                     //   degr/s
+  float acc;                     //   degr/s^2
+  unsigned long t_us;            // micros() of last step
+  boolean valid;                 // false: restart from actual position
+} SCURVE;
+
+void sc_set_limits(SCURVE *p,float vmax,float amax,float jmax);
+void sc_reset(SCURVE *p,float pos,float vel);
+void sc_goto(SCURVE *p,float target,float target_vel,float dt);
+void sc_speed(SCURVE *p,float vel,float dt);
+void sc_scale(SCURVE *p,float k);
+float sc_move_time(SCURVE *p,float d);
+float sc_sync(SCURVE *ax,SCURVE *ey,float dax,float dey);
+
+#endif
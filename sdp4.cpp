@@ -0,0 +1,108 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * SDP4: deep-space objects (period >= 225 min)
+ * Project: rotordrive
+ * Author: R. Alblas
+ * Content:
+ *   void DLL_FUNC SDP4_init()
+ *   int DLL_FUNC SDP4()
+ *   int DLL_FUNC select_ephemeris()
+ *
+ * As SGP4(), with the lunar-solar and resonance terms of deep.cpp;
+ * the deep_arg_t goes in params from params[10] on (N_SDP4_PARAMS).
+ * Short periodics with the perturbed inclination (Dundee).
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/* Copyright (C) 2018, Project Pluto
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301, USA. */
+
+#include <math.h>
+#include <string.h>
+#include "norad.h"
+#include "norad_in.h"
+
+#define c1           params[2]
+#define c4           params[3]
+#define xnodcf       params[4]
+#define t2cof        params[5]
+#define deep_arg_p   ((deep_arg_t *)( params + 10))
+#define ECC_EPS      1.e-6     /* as SGP4() */
+
+void DLL_FUNC SDP4_init( double *params, const tle_t *tle)
+{
+   init_t init;
+   deep_arg_t *deep_arg = deep_arg_p;
+
+   sxpx_common_init( params, tle, &init, deep_arg);
+   deep_arg->sing = sin( tle->omegao);
+   deep_arg->cosg = cos( tle->omegao);
+   Deep_dpinit( tle, deep_arg);
+}
+
+int DLL_FUNC SDP4( const double tsince, const tle_t *tle, const double *params,
+                                                    double *pos, double *vel)
+{
+   deep_arg_t deep_arg;
+   double a, tempa, tempe, templ, tsq, xl;
+
+   memcpy( &deep_arg, deep_arg_p, sizeof( deep_arg_t));
+   /* Update for secular gravity and atmospheric drag */
+   deep_arg.xll = tle->xmo + deep_arg.xmdot * tsince;
+   deep_arg.omgadf = tle->omegao + deep_arg.omgdot * tsince;
+   tsq = tsince * tsince;
+   deep_arg.xnode = tle->xnodeo + deep_arg.xnodot * tsince + xnodcf * tsq;
+   tempa = 1. - c1 * tsince;
+   tempe = tle->bstar * c4 * tsince;
+   templ = t2cof * tsq;
+   deep_arg.xn = deep_arg.xnodp;
+
+   /* Update for deep-space secular effects */
+   deep_arg.t = tsince;
+   Deep_dpsec( tle, &deep_arg);
+   if( deep_arg.xn <= 0.)
+      return( SXPX_ERR_NEGATIVE_XN);
+   a = pow( xke / deep_arg.xn, two_thirds) * tempa * tempa;
+   deep_arg.em -= tempe;
+   if( deep_arg.em < ECC_EPS)
+      deep_arg.em = ECC_EPS;
+   deep_arg.xll += deep_arg.xnodp * templ;
+
+   /* Update for deep-space periodic effects */
+   Deep_dpper( tle, &deep_arg);
+   xl = deep_arg.xll + deep_arg.omgadf + deep_arg.xnode;
+   if( tempa < 0.)       /* force negative a,  to indicate error condition */
+      a = -a;
+   return( sxpx_posn_vel( deep_arg.xnode, a, deep_arg.em,
+                  cos( deep_arg.xinc), sin( deep_arg.xinc), deep_arg.xinc,
+                  deep_arg.omgadf, xl, pos, vel));
+} /*SDP4*/
+
+/* 1: deep space (SDP4),  0: near earth (SGP4),  -1: invalid elements */
+int DLL_FUNC select_ephemeris( const tle_t *tle)
+{
+   deep_arg_t deep_arg;
+
+   if( tle->xno <= 0. || tle->eo >= 1. || tle->eo < 0.)
+      return( -1);
+   sxpall_common_init( tle, &deep_arg);
+         /* period of 225 minutes or more: 6.4 revolutions/day or less */
+   return( twopi / (deep_arg.xnodp * minutes_per_day) >= 1. / 6.4 ? 1 : 0);
+}
@@ -42,6 +42,8 @@
 /**************************************************
  *  'Public' functions:
  * int calc_sgp4_const(KEPLER *kepler,boolean from_degrees)
+ * int load_tle(KEPLER *kepler,const char *name,const char *line1,const char *line2)
+ * int sat_posn(double tsince,KEPLER *kepler,double *pos,double *vel)
  * double calceleazim_v2(struct tm cur_tm,int ms,EPOINT *pos_subsat,EPOINT *pos_sat,EPOINT *refpos,DIRECTION *satdir)
  * //void calcposrel_v2(KEPLER *kepler,EPOINT *pos_sat,EPOINT *pos_earth,EPOINT *pos_rel)
  * void calc_sat_earth_v2(struct tm *cur_tm,int cur_ms, // time
@@ -49,22 +51,30 @@
  *                  EPOINT *pos_earth,            // pos. earth (rotation), may be NULL
  *                  EPOINT *pos_sat,              // pos. satellite, may be NULL
  *                  EPOINT *pos_subsat)           // sub-satellite position w.r.t. earth
+ * double gmst_jd(double jd)
+ * OBSERVER *observer(EPOINT *refpos)
+ *
+ * GMST and the observer terms are cached: ThetaG_JD() once per
+ * GMST_SPAN, in between GMST goes with the sidereal rate from there;
+ * the observer position and its horizon frame (earth-fixed) only
+ * change with refpos. So a look angle is one rotation over GMST, the
+ * horizon frame, atan2 and asin.
  **************************************************/
 #include "norad.h"
 #include "norad_in.h"
 #include "rotorctrl.h"
 #include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
 #include <math.h>
-
-#define J2000 2451545.5
-#define J1900 (J2000 - 36525. - 1.)
-#define YEAR1970 25568. // 365.25*70 + 0.5
-#define UNIX2JD(t) (((double)(t)/86400.)+J1900+YEAR1970)
+#include <stdio.h>
+#include <string.h>
 
 #define MINUTES_PER_DAY 1440.
 #define MINUTES_PER_DAY_SQUARED (MINUTES_PER_DAY * MINUTES_PER_DAY)
 #define MINUTES_PER_DAY_CUBED (MINUTES_PER_DAY * MINUTES_PER_DAY_SQUARED)
 #define AE 1.0
+#define GMST_RATE (twopi*1.00273790934)   // radians per day (UT)
+#define GMST_SPAN 1.                      // days from cached epoch, else ThetaG_JD() again
 
 long mktime_ntz(struct tm *tm);
 
@@ -100,12 +110,64 @@ int calc_sgp4_const(KEPLER *kepler,boolean from_degrees)
     kepler->perigee    =D2R(kepler->d_perigee);
     kepler->anomaly    =D2R(kepler->d_anomaly);
   }
-  kepler2tle(kepler, &kepler->tle);
-  SGP4_init(kepler->sgp4_params, &kepler->tle);
+  if (!kepler->from_tle) kepler2tle(kepler, &kepler->tle);
+  kepler->deep=(select_ephemeris(&kepler->tle)==1);
+  if (kepler->deep)
+    SDP4_init(kepler->sgp4_params, &kepler->tle);
+  else
+    SGP4_init(kepler->sgp4_params, &kepler->tle);
+  sgp4f_init(kepler);
 
   return 1;
 }
 
+/*********************************************************************
+ * Keplers from a two-line element set 'line1', 'line2' (parse_elements())
+ *   and name 'name' (NULL or empty: catalogue nr.); constants calculated.
+ * The fields are filled for download_keplers, the tle itself is used
+ *   (from_tle): the float fields can't hold epoch and motion exactly.
+ * return: as parse_elements(); 'kepler' only changed if 0
+ *********************************************************************/
+int load_tle(KEPLER *kepler,const char *name,const char *line1,const char *line2)
+{
+  tle_t tle;
+  double day;
+  int ret,year;
+
+  if ((ret=parse_elements(line1,line2,&tle))) return ret;
+  if (select_ephemeris(&tle)<0) return -1;
+  kepler->tle=tle;
+  if ((name) && (*name))
+    strncpy(kepler->name,name,sizeof(kepler->name)-1);
+  else
+    snprintf(kepler->name,sizeof(kepler->name),"%d",tle.norad_number);
+  kepler->name[sizeof(kepler->name)-1]=0;
+  year=(int)((tle.epoch-J1900)/365.25);           // from 1900, as kepler2tle()
+  day=tle.epoch-J1900-(year*365+(year-1)/4);
+  if (day<1.) { year--; day=tle.epoch-J1900-(year*365+(year-1)/4); }
+  kepler->epoch_year=year;
+  kepler->epoch_day=day;
+  kepler->decay_rate=tle.xndt2o*MINUTES_PER_DAY_SQUARED/(2*PI);
+  kepler->bstar=tle.bstar/AE;
+  kepler->inclination=tle.xincl;   kepler->d_inclination=R2D(tle.xincl);
+  kepler->raan=tle.xnodeo;         kepler->d_raan=R2D(tle.xnodeo);
+  kepler->eccentricity=tle.eo;
+  kepler->perigee=tle.omegao;      kepler->d_perigee=R2D(tle.omegao);
+  kepler->anomaly=tle.xmo;         kepler->d_anomaly=R2D(tle.xmo);
+  kepler->motion=tle.xno*MINUTES_PER_DAY/(2*PI);
+  kepler->from_tle=true;
+  calc_sgp4_const(kepler,false);
+  return 0;
+}
+
+// position, velocity (km, km/min; vel may be NULL) 'tsince' minutes from epoch: SGP4 or SDP4
+int sat_posn(double tsince,KEPLER *kepler,double *pos,double *vel)
+{
+  if (kepler->deep)
+    return SDP4(tsince, &kepler->tle, kepler->sgp4_params, pos, vel);
+  return SGP4(tsince, &kepler->tle, kepler->sgp4_params, pos, vel);
+}
+
 static double Modulus(double arg1,double arg2)
 {
   double modu,Modulus;
@@ -119,7 +181,7 @@ static double Modulus(double arg1,double arg2)
 
 #define Frac(n) ((n)-(int)(n))
 // Reference:  The 1992 Astronomical Almanac, page B6. 
-static double ThetaG_JD(double jd)
+double ThetaG_JD(double jd)
 {
   double UT,TU,GMST;
   UT   = Frac(jd + 0.5);
@@ -130,13 +192,26 @@ static double ThetaG_JD(double jd)
   return twopi * GMST/86400.0;
 }
 
+static double gmst_jd0,gmst0;    // epoch of gmst_jd()
+
+// GMST (radians, not reduced) at 'jd', incremental from cached epoch
+double gmst_jd(double jd)
+{
+  if ((!gmst_jd0) || (fabs(jd-gmst_jd0)>GMST_SPAN))
+  {
+    gmst_jd0=jd;
+    gmst0=ThetaG_JD(jd);
+  }
+  return gmst0+(jd-gmst_jd0)*GMST_RATE;
+}
+
 static void calcposearth_v2(struct tm *cur_tm, int ms, EPOINT *pos_earth)
 {
   double theta,jd;
   if (!pos_earth) return;
 
   jd=UNIX2JD(mktime_ntz(cur_tm)+((float)ms/1000.));
-  theta = Modulus(ThetaG_JD(jd),twopi);
+  theta = Modulus(gmst_jd(jd),twopi);
   pos_earth->lon=theta-PI/2.;
   pos_earth->lat=0.;
 }
@@ -170,7 +245,7 @@ static EPOINT pos_rel(double xs,double ys,double zs,double jd)
   x=xs/d;
   y=ys/d;
   z=zs/d;
-  theta = Modulus(ThetaG_JD(jd),twopi);
+  theta = Modulus(gmst_jd(jd),twopi);
   pos.lon=-1.*(atan2(x,y)+theta-PI/2.); 
   if (pos.lon<-1*PI) pos.lon+=2.*PI;
   if (pos.lon>+1*PI) pos.lon-=2.*PI;
@@ -188,7 +263,7 @@ void calc_sat_earth_v2(struct tm *cur_tm,int cur_ms, // time
   double tsince=(jd-kepler->tle.epoch)*24.*60.; // minutes
   double pos[3];
   double vel[3];
-  SGP4(tsince, &kepler->tle,  kepler->sgp4_params,pos, vel);
+  sat_posn(tsince, kepler, pos, vel);
 
   *pos_subsat=pos_rel(pos[0],pos[1],pos[2],jd);
   if (pos_sat)
@@ -201,67 +276,67 @@ void calc_sat_earth_v2(struct tm *cur_tm,int cur_ms, // time
 }
 
 
-// Reference:  The 1992 Astronomical Almanac, page K11. 
-static double Calculate_User_Pos(double lat,double lon,double alt,double time,
-                        double *x,double *y, double *z)
+static OBSERVER obs;            // observer()
+
+/*********************************************************************
+ * Observer context of 'refpos', made again only if refpos changed.
+ * Position (as Calculate_User_Pos()) and horizon frame are earth-fixed,
+ * for GMST=0: the observer at theta=lon.
+ * Reference:  The 1992 Astronomical Almanac, page K11.
+ *********************************************************************/
+OBSERVER *observer(EPOINT *refpos)
 {
   const double re = earth_radius_in_km;
-  double theta;
+  double sinlat,coslat,sinlon,coslon,C,S;
+  int i,j;
 
+  if ((obs.valid) && (obs.lat==refpos->lat) && (obs.lon==refpos->lon) && (obs.alt==refpos->alt))
+    return &obs;
+  obs.lat=refpos->lat;
+  obs.lon=refpos->lon;
+  obs.alt=refpos->alt;
+  sinlat=sin(obs.lat); coslat=cos(obs.lat);
+  sinlon=sin(obs.lon); coslon=cos(obs.lon);
 #ifdef GEEN_CORR
-  double r;
-  theta = Modulus(ThetaG_JD(time) + lon,twopi);
-  r = (re + alt)*cos(lat);
-  *x = r*cos(theta);
-  *y = r*sin(theta);
-  *z = (re + alt)*sin(lat);
+  C=S=1.;
 #else
-  double phi=lat;
-  double f=1./298.26;
-//  double phia=atan((1-f)*(1-f)*tan(phi));
-  double C=1./sqrt(1+f*(f-2)*sin(phi)*sin(phi));
-  double S=(1-f)*(1-f)*C;
-  theta = Modulus(ThetaG_JD(time) + lon,twopi);
-  *x=(re + alt)*C*cos(phi)*cos(theta);
-  *y=(re + alt)*C*cos(phi)*sin(theta);
-  *z=(re + alt)*S*sin(phi);
+  {
+    double f=1./298.26;
+    C=1./sqrt(1+f*(f-2)*sinlat*sinlat);
+    S=(1-f)*(1-f)*C;
+  }
 #endif
-  return theta;
+  obs.pos[0]=(re + obs.alt)*C*coslat*coslon;
+  obs.pos[1]=(re + obs.alt)*C*coslat*sinlon;
+  obs.pos[2]=(re + obs.alt)*S*sinlat;
+  obs.rot[0][0]=sinlat*coslon; obs.rot[0][1]=sinlat*sinlon; obs.rot[0][2]=-coslat;  // south
+  obs.rot[1][0]=-sinlon;       obs.rot[1][1]=coslon;        obs.rot[1][2]=0.;       // east
+  obs.rot[2][0]=coslat*coslon; obs.rot[2][1]=coslat*sinlon; obs.rot[2][2]=sinlat;   // zenith
+  for (i=0; i<3; i++)
+  {
+    obs.pos_f[i]=obs.pos[i];
+    for (j=0; j<3; j++) obs.rot_f[i][j]=obs.rot[i][j];
+  }
+  obs.valid=true;
+  return &obs;
 }
 
-static void Calculate_Look(double xs,double ys,double zs,double lat,double lon,
-                    double alt,double time,
+// look angles of satellite 'xs', 'ys', 'zs' (km, inertial) from 'o' at 'gmst'
+static void Calculate_Look(double xs,double ys,double zs,OBSERVER *o,double gmst,
                     double *az,double *el)
 {
-  double xo,yo,zo;
-  double rx,ry,rz,rg;
-  double top_s,top_e,top_z;
-  double theta;
+  double sg=sin(gmst),cg=cos(gmst);
+  double r[3],top[3];
+  int i;
+
+  r[0] = cg*xs + sg*ys - o->pos[0];         // earth-fixed
+  r[1] = -sg*xs + cg*ys - o->pos[1];
+  r[2] = zs - o->pos[2];
+  for (i=0; i<3; i++)
+    top[i]=o->rot[i][0]*r[0] + o->rot[i][1]*r[1] + o->rot[i][2]*r[2];
 
-  Calculate_User_Pos(lat,lon,alt,time,&xo,&yo,&zo);
-  theta = Modulus(ThetaG_JD(time) + lon,twopi);
-  rx = xs - xo;
-  ry = ys - yo;
-  rz = zs - zo;
-  top_s = sin(lat)* cos(theta)*rx
-         + sin(lat)* sin(theta)*ry
-         - cos(lat)*rz;
-  top_e = - sin(theta)*rx
-         + cos(theta)*ry;
-  top_z = cos(lat)* cos(theta)*rx
-         + cos(lat)* sin(theta)*ry
-         + sin(lat)*rz;
-/*
-  *az = atan(-1. * top_e/top_s);
-
-  if (top_s > 0) 
-    *az = *az + PI;
-  if (az < 0) 
-    *az = *az + twopi;
-*/
-  *az = atan2(-1. * top_e,top_s) + PI;
-  rg = sqrt(rx*rx + ry*ry + rz*rz);
-  *el = asin(top_z/(rg));
+  *az = atan2(-1. * top[1],top[0]) + PI;
+  *el = asin(top[2]/sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]));
 }
 
 
@@ -269,7 +344,7 @@ double calceleazim_v2(struct tm cur_tm,int ms,EPOINT *pos_subsat,EPOINT *pos_sat
 {
   double jd=UNIX2JD(mktime_ntz(&cur_tm)+((float)ms/1000.));
   double az,el,height;
-  Calculate_Look(pos_sat->x,pos_sat->y,pos_sat->z,refpos->lat,refpos->lon,refpos->alt,jd,&az,&el);
+  Calculate_Look(pos_sat->x,pos_sat->y,pos_sat->z,observer(refpos),gmst_jd(jd),&az,&el);
   satdir->azim=az;
   satdir->elev=el;
   height=1000.*sqrt(pos_sat->x*pos_sat->x+pos_sat->y*pos_sat->y+pos_sat->z*pos_sat->z)-Rearth;
@@ -0,0 +1,386 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * SGP4 for many epochs or many satellites in one call
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * Same model as SGP4() (sgp4.cpp), for tables and scans
+ * that need thousands of positions (host/ground station; the ESP32
+ * tracks with the float path, see sgp4f.cpp).
+ * All steps go in loops over a block of samples, split around the
+ * trig calls, so the compiler can vectorise the polynomial parts: the
+ * secular and drag terms, then the position as sxpx_posn_vel(), with
+ * the Kepler solve iterated for the whole block. Without fast-math
+ * the results are those of SGP4() to the bit; the host build uses
+ * -ffast-math here (vectorised sin/cos), within 1e-8 km.
+ *
+ * SGP4_batch(): one satellite at 'n' times.
+ * SGP4_soa(): all satellites of an SGP4_SOA at one time; the
+ *   constants are stored per parameter (structure of arrays). The
+ *   "simple" satellites (perigee < 220 km) get zero coefficients for
+ *   the dropped terms, so the loop has no branches.
+ * Positions in km, 3 per sample (x,y,z); no velocity.
+ * Near-earth (SGP4) only; deep-space objects: SDP4() per call.
+ *
+ * public functions:
+ *   int SGP4_batch(const double *params,const tle_t *tle,const double *tsince,int n,double *pos)
+ *   void sgp4_soa_init(SGP4_SOA *s,double *buf,int nmax)
+ *   int sgp4_soa_add(SGP4_SOA *s,const double *params,const tle_t *tle)
+ *   int SGP4_soa(SGP4_SOA *s,double jd,double *pos)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "norad.h"
+#include "norad_in.h"
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+#include <math.h>
+#include <string.h>
+
+// SGP4 params, see sgp4.cpp and common.cpp
+#define p_c1         params[2]
+#define p_c4         params[3]
+#define p_xnodcf     params[4]
+#define p_t2cof      params[5]
+#define p_aodp       params[10]
+#define p_cosio      params[11]
+#define p_sinio      params[12]
+#define p_omgdot     params[13]
+#define p_xmdot      params[14]
+#define p_xnodot     params[15]
+#define p_xnodp      params[16]
+#define p_c5         params[17]
+#define p_d2         params[18]
+#define p_d3         params[19]
+#define p_d4         params[20]
+#define p_delmo      params[21]
+#define p_eta        params[22]
+#define p_omgcof     params[23]
+#define p_sinmo      params[24]
+#define p_t3cof      params[25]
+#define p_t4cof      params[26]
+#define p_t5cof      params[27]
+#define p_xmcof      params[28]
+#define simple_flag *((int *)( params + 29))
+
+#define ECC_EPS      1.e-6        // as SGP4()
+#define SGP4_BLOCK   64           // samples per block (on stack)
+#define MAX_KEPLER_ITER 10        // as sxpx_posn_vel()
+#define NR_EPS       1e-12
+#define ECC_PARABOLIC 1.e-6       // elsq above 1-this: error
+
+/*********************************************************************
+ * Position of 'nb' samples from the elements, as sxpx_posn_vel()
+ * (no velocity), one loop per step over the block: the Kepler solve
+ * iterates until all samples are converged, converged ones are kept.
+ * xnode,a,ecc,omega,xl: elements; cosio,sinio,xincl: per sample
+ * pos: 3 per sample (km), 0 on error
+ * return: nr. of samples with error or warning
+ *********************************************************************/
+static int posn_block(int nb,const double *xnode,const double *a,const double *ecc,
+                      const double *omega,const double *xl,
+                      const double *cosio,const double *sinio,const double *xincl,
+                      double *pos)
+{
+  double axn[SGP4_BLOCK],ayn[SGP4_BLOCK],capu[SGP4_BLOCK],epw[SGP4_BLOCK];
+  double sinE[SGP4_BLOCK],cosE[SGP4_BLOCK],ecosE[SGP4_BLOCK],esinE[SGP4_BLOCK];
+  int conv[SGP4_BLOCK];
+  int i,it,todo,nerr=0;
+
+  // long period periodics
+  for (i=0; i<nb; i++)
+  {
+    double temp=1/(a[i]*(1.-ecc[i]*ecc[i]));
+    double xlcof=.125*a3ovk2*sinio[i]*(3+5*cosio[i])/(1.+cosio[i]);
+    double aycof=0.25*a3ovk2*sinio[i];
+    axn[i]=ecc[i]*cos(omega[i]);
+    ayn[i]=ecc[i]*sin(omega[i])+temp*aycof;
+    capu[i]=fmod(xl[i]+temp*xlcof*axn[i]-xnode[i],twopi);
+    if (capu[i]>pi) capu[i]-=twopi; else if (capu[i]<-pi) capu[i]+=twopi;
+    epw[i]=capu[i];
+    conv[i]=0;
+  }
+
+  // Kepler's equation
+  for (it=0,todo=nb; (todo) && (it<MAX_KEPLER_ITER); it++)
+  {
+    for (i=0; i<nb; i++)
+    {
+      sinE[i]=sin(epw[i]);
+      cosE[i]=cos(epw[i]);
+    }
+    for (todo=i=0; i<nb; i++)
+    {
+      double f,fdot,d;
+      if (conv[i]) continue;
+      ecosE[i]=axn[i]*cosE[i]+ayn[i]*sinE[i];
+      esinE[i]=axn[i]*sinE[i]-ayn[i]*cosE[i];
+      f=capu[i]-epw[i]+esinE[i];
+      if (fabs(f)<NR_EPS) { conv[i]=1; continue; }
+      fdot=1.-ecosE[i];
+      d=f/fdot;
+      if (!it)
+      {
+        double dmax=1.25*fabs(ecc[i]);
+        if (d>dmax) d=dmax;
+        else if (d<-dmax) d=-dmax;
+        else d=f/(fdot+0.5*esinE[i]*d);
+      }
+      else d=f/(fdot+0.5*esinE[i]*d);
+      epw[i]+=d;
+      todo++;
+    }
+  }
+
+  // short period, orientation, position
+  for (i=0; i<nb; i++)
+  {
+    double elsq=axn[i]*axn[i]+ayn[i]*ayn[i];
+    double temp=1-elsq,pl=a[i]*temp,r=a[i]*(1-ecosE[i]),temp1,temp2,betal;
+    double sinu,cosu,u,sin2u,cos2u,rk,uk,xnodek,xinck;
+    double sinuk,cosuk,sinik,cosik,sinnok,cosnok;
+    double cosio2=cosio[i]*cosio[i];
+    temp2=a[i]/r;
+    betal=sqrt(temp);
+    temp=esinE[i]/(1+betal);
+    cosu=temp2*(cosE[i]-axn[i]+ayn[i]*temp);
+    sinu=temp2*(sinE[i]-ayn[i]-axn[i]*temp);
+    u=atan2(sinu,cosu);
+    sin2u=2*sinu*cosu;
+    cos2u=2*cosu*cosu-1;
+    temp1=ck2/pl;
+    temp2=temp1/pl;
+    rk=r*(1-1.5*temp2*betal*(3.0*cosio2-1.0))+0.5*temp1*(1.0-cosio2)*cos2u;
+    uk=u-0.25*temp2*(7.0*cosio2-1.0)*sin2u;
+    xnodek=xnode[i]+1.5*temp2*cosio[i]*sin2u;
+    xinck=xincl[i]+1.5*temp2*cosio[i]*sinio[i]*cos2u;
+    sinuk=sin(uk); cosuk=cos(uk);
+    sinik=sin(xinck); cosik=cos(xinck);
+    sinnok=sin(xnodek); cosnok=cos(xnodek);
+    pos[3*i+0]=rk*(-sinnok*cosik*sinuk+cosnok*cosuk)*earth_radius_in_km;
+    pos[3*i+1]=rk*(cosnok*cosik*sinuk+sinnok*cosuk)*earth_radius_in_km;
+    pos[3*i+2]=rk*(sinik*sinuk)*earth_radius_in_km;
+  }
+
+  // errors and warnings, as sxpx_posn_vel()
+  for (i=0; i<nb; i++)
+  {
+    double elsq=axn[i]*axn[i]+ayn[i]*ayn[i];
+    if ((a[i]<0.) || (elsq>1.-ECC_PARABOLIC) || (!conv[i]))
+    {
+      pos[3*i]=pos[3*i+1]=pos[3*i+2]=0.;
+      nerr++;
+    }
+    else if ((a[i]*(1.-ecc[i])<1.) || (a[i]*(1.+ecc[i])<1.)) nerr++;
+  }
+  return nerr;
+}
+
+/*********************************************************************
+ * Satellite 'params', 'tle' at 'n' times 'tsince' (minutes from epoch)
+ * pos: 3*n km
+ * return: nr. of samples for which SGP4() would return an error or
+ *   warning (position 0 for errors, as SGP4());
+ *   -1 if deep space (select_ephemeris(), params of SDP4): all 0
+ *********************************************************************/
+int SGP4_batch(const double *params,const tle_t *tle,const double *tsince,int n,double *pos)
+{
+  double xmdf[SGP4_BLOCK],omega[SGP4_BLOCK],xnode[SGP4_BLOCK],xmp[SGP4_BLOCK];
+  double tempa[SGP4_BLOCK],tempe[SGP4_BLOCK],templ[SGP4_BLOCK],delm[SGP4_BLOCK];
+  double cosio[SGP4_BLOCK],sinio[SGP4_BLOCK],xincl[SGP4_BLOCK];
+  const int simple=simple_flag;
+  int i0,nb,i,nerr=0;
+
+  if (select_ephemeris(tle))
+  {
+    memset(pos,0,3*n*sizeof(double));
+    return -1;
+  }
+
+  for (i=0; i<SGP4_BLOCK; i++)
+  {
+    cosio[i]=p_cosio;
+    sinio[i]=p_sinio;
+    xincl[i]=tle->xincl;
+  }
+
+  for (i0=0; i0<n; i0+=SGP4_BLOCK)
+  {
+    const double *ts=tsince+i0;
+    nb=(n-i0<SGP4_BLOCK? n-i0 : SGP4_BLOCK);
+
+    // secular gravity and drag
+    for (i=0; i<nb; i++)
+    {
+      double t=ts[i],tsq=t*t;
+      xmdf[i]=tle->xmo+p_xmdot*t;
+      omega[i]=tle->omegao+p_omgdot*t;
+      xnode[i]=tle->xnodeo+p_xnodot*t+p_xnodcf*tsq;
+      xmp[i]=xmdf[i];
+      tempa[i]=1-p_c1*t;
+      tempe[i]=tle->bstar*p_c4*t;
+      templ[i]=p_t2cof*tsq;
+    }
+    if (!simple)
+    {
+      for (i=0; i<nb; i++) delm[i]=1.+p_eta*cos(xmdf[i]);
+      for (i=0; i<nb; i++)
+      {
+        double t=ts[i],tsq=t*t,tcube=tsq*t,tfour=t*tcube,temp;
+        temp=p_omgcof*t+p_xmcof*(delm[i]*delm[i]*delm[i]-p_delmo);
+        xmp[i]=xmdf[i]+temp;
+        omega[i]=omega[i]-temp;
+        tempa[i]=tempa[i]-p_d2*tsq-p_d3*tcube-p_d4*tfour;
+        templ[i]=templ[i]+p_t3cof*tcube+tfour*(p_t4cof+t*p_t5cof);
+      }
+      for (i=0; i<nb; i++) tempe[i]+=tle->bstar*p_c5*(sin(xmp[i])-p_sinmo);
+    }
+
+    // elements (a in tempa, e in tempe, xl in templ), then position
+    for (i=0; i<nb; i++)
+    {
+      double a=p_aodp*tempa[i]*tempa[i],e=tle->eo-tempe[i];
+      templ[i]=xmp[i]+omega[i]+xnode[i]+p_xnodp*templ[i];
+      tempe[i]=(e<ECC_EPS? ECC_EPS : e);
+      tempa[i]=(tempa[i]<0.? -a : a);        // negative a: error, as SGP4()
+    }
+    nerr+=posn_block(nb,xnode,tempa,tempe,omega,templ,cosio,sinio,xincl,pos+3*i0);
+  }
+  return nerr;
+}
+
+/*********************************************************************
+ * SoA storage for max. 'nmax' satellites in 'buf' (SGP4_SOA_NPAR*nmax
+ * doubles, from the caller).
+ *********************************************************************/
+void sgp4_soa_init(SGP4_SOA *s,double *buf,int nmax)
+{
+  double **par[SGP4_SOA_NPAR]=
+  {
+    &s->epoch,&s->xmo,&s->xmdot,&s->omegao,&s->omgdot,&s->xnodeo,&s->xnodot,
+    &s->xnodcf,&s->c1,&s->c4b,&s->c5b,&s->t2cof,&s->t3cof,&s->t4cof,&s->t5cof,
+    &s->d2,&s->d3,&s->d4,&s->omgcof,&s->xmcof,&s->eta,&s->delmo,&s->sinmo,
+    &s->eo,&s->aodp,&s->xnodp,&s->cosio,&s->sinio,&s->xincl
+  };
+  int i;
+  for (i=0; i<SGP4_SOA_NPAR; i++) *par[i]=buf+i*nmax;
+  s->n=0;
+  s->nmax=nmax;
+}
+
+/*********************************************************************
+ * Add satellite 'params' (from SGP4_init()), 'tle'.
+ * return: its index, -1 if full or deep space (select_ephemeris())
+ *********************************************************************/
+int sgp4_soa_add(SGP4_SOA *s,const double *params,const tle_t *tle)
+{
+  int i=s->n,full=!simple_flag;
+  if (i>=s->nmax) return -1;
+  if (select_ephemeris(tle)) return -1;
+  s->epoch[i] =tle->epoch;
+  s->xmo[i]   =tle->xmo;
+  s->xmdot[i] =p_xmdot;
+  s->omegao[i]=tle->omegao;
+  s->omgdot[i]=p_omgdot;
+  s->xnodeo[i]=tle->xnodeo;
+  s->xnodot[i]=p_xnodot;
+  s->xnodcf[i]=p_xnodcf;
+  s->c1[i]    =p_c1;
+  s->c4b[i]   =tle->bstar*p_c4;
+  s->t2cof[i] =p_t2cof;
+  s->eo[i]    =tle->eo;
+  s->aodp[i]  =p_aodp;
+  s->xnodp[i] =p_xnodp;
+  s->cosio[i] =p_cosio;
+  s->sinio[i] =p_sinio;
+  s->xincl[i] =tle->xincl;
+
+  // terms dropped for "simple" satellites: 0, see SGP4()
+  s->c5b[i]   =(full? tle->bstar*p_c5 : 0.);
+  s->t3cof[i] =(full? p_t3cof : 0.);
+  s->t4cof[i] =(full? p_t4cof : 0.);
+  s->t5cof[i] =(full? p_t5cof : 0.);
+  s->d2[i]    =(full? p_d2 : 0.);
+  s->d3[i]    =(full? p_d3 : 0.);
+  s->d4[i]    =(full? p_d4 : 0.);
+  s->omgcof[i]=(full? p_omgcof : 0.);
+  s->xmcof[i] =(full? p_xmcof : 0.);
+  s->eta[i]   =(full? p_eta : 0.);
+  s->delmo[i] =(full? p_delmo : 1.);
+  s->sinmo[i] =(full? p_sinmo : 0.);
+  s->n++;
+  return i;
+}
+
+/*********************************************************************
+ * All satellites of 's' at Julian day 'jd'
+ * pos: 3*s->n km
+ * return: nr. of satellites with error or warning, see SGP4_batch()
+ *********************************************************************/
+int SGP4_soa(SGP4_SOA *s,double jd,double *pos)
+{
+  double xmdf[SGP4_BLOCK],omega[SGP4_BLOCK],xnode[SGP4_BLOCK],xmp[SGP4_BLOCK];
+  double tempa[SGP4_BLOCK],tempe[SGP4_BLOCK],templ[SGP4_BLOCK],ts[SGP4_BLOCK];
+  int i0,nb,i,j,nerr=0;
+
+  for (i0=0; i0<s->n; i0+=SGP4_BLOCK)
+  {
+    nb=(s->n-i0<SGP4_BLOCK? s->n-i0 : SGP4_BLOCK);
+
+    // secular gravity and drag; 'simple' satellites: extra terms are 0
+    for (i=0; i<nb; i++)
+    {
+      j=i0+i;
+      ts[i]=(jd-s->epoch[j])*minutes_per_day;
+      xmdf[i]=s->xmo[j]+s->xmdot[j]*ts[i];
+    }
+    for (i=0; i<nb; i++) xmp[i]=1.+s->eta[i0+i]*cos(xmdf[i]);
+    for (i=0; i<nb; i++)
+    {
+      double t=ts[i],tsq=t*t,tcube=tsq*t,tfour=t*tcube,temp;
+      j=i0+i;
+      temp=s->omgcof[j]*t+s->xmcof[j]*(xmp[i]*xmp[i]*xmp[i]-s->delmo[j]);
+      xmp[i]=xmdf[i]+temp;
+      omega[i]=s->omegao[j]+s->omgdot[j]*t-temp;
+      xnode[i]=s->xnodeo[j]+s->xnodot[j]*t+s->xnodcf[j]*tsq;
+      tempa[i]=1-s->c1[j]*t-s->d2[j]*tsq-s->d3[j]*tcube-s->d4[j]*tfour;
+      tempe[i]=s->c4b[j]*t;
+      templ[i]=s->t2cof[j]*tsq+s->t3cof[j]*tcube+tfour*(s->t4cof[j]+t*s->t5cof[j]);
+    }
+    for (i=0; i<nb; i++) tempe[i]+=s->c5b[i0+i]*(sin(xmp[i])-s->sinmo[i0+i]);
+
+    for (i=0; i<nb; i++)
+    {
+      double a,e;
+      j=i0+i;
+      a=s->aodp[j]*tempa[i]*tempa[i];
+      e=s->eo[j]-tempe[i];
+      templ[i]=xmp[i]+omega[i]+xnode[i]+s->xnodp[j]*templ[i];
+      tempe[i]=(e<ECC_EPS? ECC_EPS : e);
+      tempa[i]=(tempa[i]<0.? -a : a);
+    }
+    nerr+=posn_block(nb,xnode,tempa,tempe,omega,templ,s->cosio+i0,s->sinio+i0,s->xincl+i0,pos+3*i0);
+  }
+  return nerr;
+}
@@ -0,0 +1,322 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * SGP4 and look angles in single precision
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * The ESP32 FPU only does float; double (sin, cos, atan2...) is
+ * emulated and slow. This is SGP4() + sxpx_posn_vel() (no velocity)
+ * + Calculate_Look() in float, with one fused sin/cos per angle.
+ * Kept in double, because float can't hold them:
+ *   JD, tsince and GMST, and the secular terms of the mean anomaly,
+ *   node and perigee (up to 1000's of radians); these are reduced
+ *   to -pi...pi before going to float.
+ * Error against the double path: see host/bench_sgp4.cpp.
+ * Deep-space objects (SDP4) are rare and slow anyway: double.
+ *
+ * public functions:
+ *   void sgp4f_init(KEPLER *kepler)
+ *   double calc_sat_f(double t,KEPLER *kepler,EPOINT *refpos,DIR *satdir,EPOINT *pos_subsat)
+ *   void sincos_f(float x,float *s,float *c)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include "norad.h"
+#include "norad_in.h"
+#include "rotorctrl.h"
+#include "rotorctrl_sgp4.h"
+#include "keplerfuncs.h"
+#include <math.h>
+
+// SGP4 params, see sgp4.cpp and common.cpp
+#define p_c1         params[2]
+#define p_c4         params[3]
+#define p_xnodcf     params[4]
+#define p_t2cof      params[5]
+#define p_aodp       params[10]
+#define p_cosio      params[11]
+#define p_sinio      params[12]
+#define p_omgdot     params[13]
+#define p_xmdot      params[14]
+#define p_xnodot     params[15]
+#define p_xnodp      params[16]
+#define p_c5         params[17]
+#define p_d2         params[18]
+#define p_d3         params[19]
+#define p_d4         params[20]
+#define p_delmo      params[21]
+#define p_eta        params[22]
+#define p_omgcof     params[23]
+#define p_sinmo      params[24]
+#define p_t3cof      params[25]
+#define p_t4cof      params[26]
+#define p_t5cof      params[27]
+#define p_xmcof      params[28]
+#define simple_flag *((int *)( params + 29))
+
+#define ECC_EPS      1.e-6
+#define KEPLER_EPS   2.e-6        // float: ~10 * FLT_EPSILON
+#define MAX_KEPLER_ITER 10
+
+#define PI_F    3.14159265f
+#define PI2_F   1.57079633f
+// pi/2 split in 2 parts (Cody-Waite): x-k*pi/2 exact for |k| < 2^12
+#define PI2_HI  1.5703125f
+#define PI2_LO  4.83826794897e-4f
+
+/*********************************************************************
+ * sin and cos together, float, |x| up to ~1000.
+ * Reduction to -pi/4...pi/4, then minimax polynomials;
+ *   error < 2e-7 (about 1 float ulp).
+ *********************************************************************/
+void sincos_f(float x,float *s,float *c)
+{
+  float r,r2,ps,pc;
+  int k;
+  k=(int)floorf(x*(1.f/PI2_F)+0.5f);
+  r=(x-k*PI2_HI)-k*PI2_LO;
+  r2=r*r;
+  ps=r+r*r2*(-1.6666654611e-1f+r2*(8.3321608736e-3f+r2*(-1.9515295891e-4f)));
+  pc=1.f+r2*(-0.5f+r2*(4.166664568298827e-2f+r2*(-1.388731625493765e-3f+r2*2.443315711809948e-5f)));
+  switch (k&3)
+  {
+    case 0: *s= ps; *c= pc; break;
+    case 1: *s= pc; *c=-ps; break;
+    case 2: *s=-ps; *c=-pc; break;
+    case 3: *s=-pc; *c= ps; break;
+  }
+}
+
+// reduce to -pi...pi in double, then float
+static float reduce_f(double x)
+{
+  x=fmod(x,twopi);
+  if (x> pi) x-=twopi;
+  if (x<-pi) x+=twopi;
+  return (float)x;
+}
+
+// float copies of the SGP4 constants; call after SGP4_init()
+// (not for SDP4: deep-space objects go in double, see calc_sat_f())
+void sgp4f_init(KEPLER *kepler)
+{
+  SGP4F *f=&kepler->sgp4f;
+  const double *params=kepler->sgp4_params;
+  const tle_t *tle=&kepler->tle;
+  float cosio=p_cosio;
+  if (kepler->deep) return;
+  f->c1=p_c1;        f->c4=p_c4;        f->c5=p_c5;
+  f->d2=p_d2;        f->d3=p_d3;        f->d4=p_d4;
+  f->t2cof=p_t2cof;  f->t3cof=p_t3cof;  f->t4cof=p_t4cof;  f->t5cof=p_t5cof;
+  f->xnodcf=p_xnodcf;f->omgcof=p_omgcof;f->xmcof=p_xmcof;
+  f->delmo=p_delmo;  f->sinmo=p_sinmo;  f->eta=p_eta;
+  f->aodp=p_aodp;    f->xnodp=p_xnodp;
+  f->cosio=cosio;    f->sinio=p_sinio;  f->xincl=tle->xincl;
+  f->eo=tle->eo;     f->bstar=tle->bstar;
+  f->simple=simple_flag;
+  f->xlcof=.125*a3ovk2*p_sinio*(3+5*p_cosio)/(1.+p_cosio);
+  f->aycof=0.25*a3ovk2*p_sinio;
+  f->x3thm1=3.f*cosio*cosio-1.f;
+  f->x7thm1=7.f*cosio*cosio-1.f;
+  f->sinio2=1.f-cosio*cosio;
+}
+
+/*********************************************************************
+ * SGP4 position (earth radii) in float, as SGP4() + sxpx_posn_vel()
+ * return: 0 or SXPX_ERR_...
+ *********************************************************************/
+static int sgp4_f(double tsince,KEPLER *kepler,float *pos)
+{
+  const SGP4F *f=&kepler->sgp4f;
+  const double *params=kepler->sgp4_params;
+  const tle_t *tle=&kepler->tle;
+  float ts=tsince,tsq=ts*ts;
+  float xmdf,omgadf,xnoddf,omega,xmp,xnode;
+  float tempa,tempe,templ,a,e,xl;
+  float s,c;
+
+  // secular gravity and drag: large angles in double
+  xmdf  =reduce_f(tle->xmo   +p_xmdot *tsince);
+  omgadf=reduce_f(tle->omegao+p_omgdot*tsince);
+  xnoddf=reduce_f(tle->xnodeo+p_xnodot*tsince);
+  omega=omgadf;
+  xmp=xmdf;
+  xnode=xnoddf+f->xnodcf*tsq;
+  tempa=1.f-f->c1*ts;
+  tempe=f->bstar*f->c4*ts;
+  templ=f->t2cof*tsq;
+  if (!f->simple)
+  {
+    float delm,tcube,tfour;
+    sincos_f(xmdf,&s,&c);
+    delm=1.f+f->eta*c;
+    delm=f->xmcof*(delm*delm*delm-f->delmo);
+    xmp=xmdf+f->omgcof*ts+delm;
+    omega=omgadf-f->omgcof*ts-delm;
+    tcube=tsq*ts;
+    tfour=ts*tcube;
+    tempa=tempa-f->d2*tsq-f->d3*tcube-f->d4*tfour;
+    sincos_f(xmp,&s,&c);
+    tempe=tempe+f->bstar*f->c5*(s-f->sinmo);
+    templ=templ+f->t3cof*tcube+tfour*(f->t4cof+ts*f->t5cof);
+  }
+  a=f->aodp*tempa*tempa;
+  e=f->eo-tempe;
+  if (e<ECC_EPS) e=ECC_EPS;
+  xl=xmp+omega+xnode+f->xnodp*templ;
+  if (tempa<0.f) return SXPX_ERR_NEGATIVE_MAJOR_AXIS;
+
+  // long period periodics
+  {
+    float axn,ayn,temp,elsq,capu,epw;
+    float sinepw,cosepw,ecose,esine;
+    float pl,r,betal,sinu,cosu,u,sin2u,cos2u,temp1,temp2;
+    float rk,uk,xnodek,xinck;
+    float sinuk,cosuk,sinik,cosik,sinnok,cosnok;
+    int i;
+
+    sincos_f(omega,&s,&c);
+    axn=e*c;
+    temp=1.f/(a*(1.f-e*e));
+    ayn=e*s+temp*f->aycof;
+    elsq=axn*axn+ayn*ayn;
+    if (elsq>1.f-1.e-6f) return SXPX_ERR_NEARLY_PARABOLIC;
+    capu=xl+temp*f->xlcof*axn-xnode;
+    capu=reduce_f(capu);
+
+    // Kepler's equation
+    epw=capu;
+    for (i=0; i<MAX_KEPLER_ITER; i++)
+    {
+      float fk,fdot,delta;
+      sincos_f(epw,&sinepw,&cosepw);
+      ecose=axn*cosepw+ayn*sinepw;
+      esine=axn*sinepw-ayn*cosepw;
+      fk=capu-epw+esine;
+      if (fabsf(fk)<KEPLER_EPS) break;
+      fdot=1.f-ecose;
+      delta=fk/fdot;
+      if (!i)
+      {
+        float maxd=1.25f*fabsf(e);
+        if (delta> maxd) delta= maxd;
+        else if (delta<-maxd) delta=-maxd;
+        else delta=fk/(fdot+0.5f*esine*delta);
+      }
+      else
+      {
+        delta=fk/(fdot+0.5f*esine*delta);
+      }
+      epw+=delta;
+    }
+    if (i==MAX_KEPLER_ITER) return SXPX_ERR_CONVERGENCE_FAIL;
+
+    // short period preliminary quantities
+    temp=1.f-elsq;
+    pl=a*temp;
+    r=a*(1.f-ecose);
+    temp2=a/r;
+    betal=sqrtf(temp);
+    temp=esine/(1.f+betal);
+    cosu=temp2*(cosepw-axn+ayn*temp);
+    sinu=temp2*(sinepw-ayn-axn*temp);
+    u=atan2f(sinu,cosu);
+    sin2u=2.f*sinu*cosu;
+    cos2u=2.f*cosu*cosu-1.f;
+    temp1=(float)ck2/pl;
+    temp2=temp1/pl;
+
+    // short periodics
+    rk=r*(1.f-1.5f*temp2*betal*f->x3thm1)+0.5f*temp1*f->sinio2*cos2u;
+    uk=u-0.25f*temp2*f->x7thm1*sin2u;
+    xnodek=xnode+1.5f*temp2*f->cosio*sin2u;
+    xinck=f->xincl+1.5f*temp2*f->cosio*f->sinio*cos2u;
+
+    // orientation
+    sincos_f(uk,&sinuk,&cosuk);
+    sincos_f(xinck,&sinik,&cosik);
+    sincos_f(xnodek,&sinnok,&cosnok);
+    pos[0]=rk*(-sinnok*cosik*sinuk+cosnok*cosuk);
+    pos[1]=rk*( cosnok*cosik*sinuk+sinnok*cosuk);
+    pos[2]=rk*sinik*sinuk;
+  }
+  return 0;
+}
+
+/*********************************************************************
+ * Direction of satellite seen from 'refpos' at unix time 't' (s),
+ *   float version of calc_sat_earth_v2() + calceleazim_v2().
+ * satdir: azim, elev (radians); x, y not set (see elevazim2xy())
+ * pos_subsat: lon, lat (radians), may be NULL
+ * return: height (m)
+ *********************************************************************/
+double calc_sat_f(double t,KEPLER *kepler,EPOINT *refpos,DIR *satdir,EPOINT *pos_subsat)
+{
+  const float re=earth_radius_in_km;
+  double jd=UNIX2JD(t);
+  double tsince=(jd-kepler->tle.epoch)*minutes_per_day;
+  OBSERVER *o=observer(refpos);
+  float pos[3],r[3],top[3],d,rg;
+  float sg,cg;
+  double gmst;
+  int i,err;
+
+  if (kepler->deep)                         // SDP4: rare, in double
+  {
+    double pd[3];
+    err=sat_posn(tsince,kepler,pd,NULL);
+    for (i=0; i<3; i++) pos[i]=pd[i];       // km
+  }
+  else
+  {
+    err=sgp4_f(tsince,kepler,pos);
+    pos[0]*=re; pos[1]*=re; pos[2]*=re;     // km
+  }
+  if ((err) && (err!=SXPX_WARN_ORBIT_WITHIN_EARTH) && (err!=SXPX_WARN_PERIGEE_WITHIN_EARTH))
+  {
+    satdir->azim=0.;
+    satdir->elev=-PI_F/2.f;
+    return 0.;
+  }
+  d=sqrtf(pos[0]*pos[0]+pos[1]*pos[1]+pos[2]*pos[2]);
+  gmst=gmst_jd(jd);
+
+  if (pos_subsat)
+  {
+    pos_subsat->lon=reduce_f(PI/2.-(atan2f(pos[0],pos[1])+gmst));
+    pos_subsat->lat=asinf(pos[2]/d);
+  }
+
+  // look angles, as Calculate_Look(): satellite earth-fixed, then
+  // relative to the observer in its horizon frame (see observer())
+  sincos_f(reduce_f(gmst),&sg,&cg);
+  r[0]=cg*pos[0]+sg*pos[1]-o->pos_f[0];
+  r[1]=-sg*pos[0]+cg*pos[1]-o->pos_f[1];
+  r[2]=pos[2]-o->pos_f[2];
+  for (i=0; i<3; i++)
+    top[i]=o->rot_f[i][0]*r[0]+o->rot_f[i][1]*r[1]+o->rot_f[i][2]*r[2];
+  rg=sqrtf(top[0]*top[0]+top[1]*top[1]);              // horizontal range
+  satdir->azim=atan2f(-top[1],top[0])+PI_F;
+  satdir->elev=atan2f(top[2],rg);                     // asinf(): bad near zenith
+  return 1000.*d-Rearth;
+}
@@ -0,0 +1,343 @@
+/**************************************************
+ * RCSId: $Id$
+ *
+ * Step pulse generator for stepper motors
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * Replaces the polled AccelStepper::run(): all steps are made in one
+ * periodic timer interrupt (STEPGEN_TICK_US), for both motors. loop()
+ * and the control task only set targets (moveTo()) or a speed
+ * (setSpeed()/runSpeed()); a late or blocked loop() no longer slows
+ * down or stalls the motors.
+ *
+ * Per tick: a phase accumulator (DDA) gives a step when it overflows,
+ *   so the step times are exact to 1 tick, without jitter from the
+ *   calling code. Step pulse is 1 tick high; max. rate is 1 step per
+ *   2 ticks.
+ * Every STEPGEN_PROFILE_US: trapezoidal speed profile: speed up by
+ *   the acceleration until max. speed, slow down when the distance to
+ *   go is within the stop distance v^2/(2a). The direction pin only
+ *   changes at speed 0, >= 1 profile period before the next step.
+ *   follow(): no own profile; the caller gives position and speed
+ *   setpoints (S-curve, see scurve.cpp), the speed is corrected by the
+ *   position error with time constant STEPGEN_FOLLOW_US.
+ *
+ * The interrupt uses integer math only (no float, no division).
+ *
+ * public functions:
+ *   class StepGen: AccelStepper calls used by rotorfuncs.ino
+ *   void stepgen_start(void)
+ *
+ * History:
+ * $Log$
+ *
+ **************************************************/
+/*******************************************************************
+ * Copyright (C) 2020 R. Alblas.
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ ********************************************************************/
+#include <Arduino.h>
+#include "rotorctrl.h"
+#include <math.h>
+
+#if USE_STEPGEN
+#define SG_PROFILE_TICKS (STEPGEN_PROFILE_US/STEPGEN_TICK_US)
+#define SG_TICK_S (STEPGEN_TICK_US*1e-6)
+#define SG_ONE ((double)(1ULL<<(32+SG_VSHIFT)))
+#define SG_ACC_MIN (1ULL<<16)
+#define SG_FOLLOW_K ((1ULL<<32)/(STEPGEN_FOLLOW_US/STEPGEN_TICK_US))
+#define SG_FOLLOW_MAX ((1L<<31)/(long)SG_FOLLOW_K)
+
+StepGen *StepGen::motor[STEPGEN_MAX];
+int StepGen::nr_motors;
+
+static portMUX_TYPE sg_mux=portMUX_INITIALIZER_UNLOCKED;
+static uint32_t sg_ticks;        // ticks till next profile update
+static hw_timer_t *sg_timer;
+
+StepGen::StepGen(int interface,int pin_step,int pin_dir)
+{
+  this->pin_step=pin_step;
+  this->pin_dir=pin_dir;
+  dir=1;
+  acc=SG_ACC_MIN;                          // see setAcceleration()
+  sd_k=((uint64_t)SG_PROFILE_TICKS<<47)/SG_ACC_MIN;
+  if (nr_motors<STEPGEN_MAX) motor[nr_motors++]=this;
+}
+
+// steps/s to profile speed
+static uint64_t sps_to_vel(float sps)
+{
+  double v=fabs(sps)*SG_TICK_S;
+  if (v>0.5) v=0.5;
+  return (uint64_t)(v*SG_ONE);
+}
+
+void StepGen::setMaxSpeed(float speed)
+{
+  portENTER_CRITICAL(&sg_mux);
+  max_sps=fabs(speed);
+  vmax=sps_to_vel(speed);
+  portEXIT_CRITICAL(&sg_mux);
+}
+
+float StepGen::maxSpeed(void)
+{
+  return max_sps;
+}
+
+void StepGen::setAcceleration(float accel)
+{
+  uint64_t a=(uint64_t)(fabs(accel)*SG_TICK_S*STEPGEN_PROFILE_US*1e-6*SG_ONE);
+  if (a<SG_ACC_MIN) a=SG_ACC_MIN;
+  portENTER_CRITICAL(&sg_mux);
+  acc=a;
+  sd_k=((uint64_t)SG_PROFILE_TICKS<<47)/a;
+  vmin=sps_to_vel(sqrt(fabs(accel)));      // as 1st step of AccelStepper
+  portEXIT_CRITICAL(&sg_mux);
+}
+
+void StepGen::moveTo(long pos)
+{
+  portENTER_CRITICAL(&sg_mux);
+  target=pos;
+  run_speed=false;
+  following=false;
+  portEXIT_CRITICAL(&sg_mux);
+}
+
+// constant speed for runSpeed(), steps/s
+void StepGen::setSpeed(float speed)
+{
+  double v=speed*SG_TICK_S;
+  if (v>0.5) v=0.5;
+  if (v<-0.5) v=-0.5;
+  spd_req=(long)(v*4294967296.);
+}
+
+// actual speed, steps/s
+float StepGen::speed(void)
+{
+  return dir*(float)inc/(SG_TICK_S*4294967296.);
+}
+
+// stop as fast as possible, with deceleration
+void StepGen::stop(void)
+{
+  portENTER_CRITICAL(&sg_mux);
+  target=pos+dir*stop_dist();
+  run_speed=false;
+  following=false;
+  portEXIT_CRITICAL(&sg_mux);
+}
+
+// nothing to do: steps come from the timer; true if still moving
+bool StepGen::run(void)
+{
+  return (inc) || (target!=pos);
+}
+
+bool StepGen::runSpeed(void)
+{
+  run_speed=true;
+  following=false;
+  return (spd_req!=0);
+}
+
+long StepGen::currentPosition(void)
+{
+  return pos;
+}
+
+long StepGen::distanceToGo(void)
+{
+  return target-pos;
+}
+
+// also stops the motor (as AccelStepper)
+void StepGen::setCurrentPosition(long pos)
+{
+  portENTER_CRITICAL(&sg_mux);
+  this->pos=target=pos;
+  vel=0;
+  inc=0;
+  stop_at_target=false;
+  following=false;
+  portEXIT_CRITICAL(&sg_mux);
+}
+
+// follow setpoint: position 'pos' (steps) moving at 'speed' (steps/s)
+void StepGen::follow(float pos,float speed)
+{
+  double v=speed*SG_TICK_S;
+  if (v>0.5) v=0.5;
+  if (v<-0.5) v=-0.5;
+  portENTER_CRITICAL(&sg_mux);
+  target=lround(pos);
+  target_fx=lround(pos*256.);
+  spd_req=(long)(v*4294967296.);
+  run_speed=false;
+  following=true;
+  portEXIT_CRITICAL(&sg_mux);
+}
+
+/*********************************************************************
+ * Steps needed to stop from the current speed: v^2/(2a).
+ * Speed in 1/65536 steps/tick; sd_k from setAcceleration().
+ *********************************************************************/
+long IRAM_ATTR StepGen::stop_dist(void)
+{
+  uint32_t v16=(uint32_t)(vel>>(16+SG_VSHIFT));
+  return (long)((((v16*v16)>>8)*sd_k)>>24);
+}
+
+// speed profile; every STEPGEN_PROFILE_US
+void IRAM_ATTR StepGen::profile(void)
+{
+  long d;
+  int ndir;
+  if (run_speed)                           // constant speed, no ramp
+  {
+    ndir=(spd_req<0? -1 : 1);
+    if ((spd_req) && (ndir!=dir))
+    {
+      dir=ndir;
+      digitalWrite(pin_dir,(dir>0? HIGH : LOW));
+    }
+    inc=(uint32_t)labs(spd_req);
+    vel=(uint64_t)inc<<SG_VSHIFT;
+    stop_at_target=false;
+    return;
+  }
+
+  if (following)                           // speed + position correction
+  {
+    int64_t v;
+    d=target_fx-pos*256;
+    if (d>SG_FOLLOW_MAX*256) d=SG_FOLLOW_MAX*256;
+    if (d<-SG_FOLLOW_MAX*256) d=-SG_FOLLOW_MAX*256;
+    v=(int64_t)spd_req+(((int64_t)d*(int64_t)SG_FOLLOW_K)>>8);
+    if (v>(1LL<<31)) v=1LL<<31;
+    if (v<-(1LL<<31)) v=-(1LL<<31);
+    ndir=(v<0? -1 : 1);
+    if ((v) && (ndir!=dir))                // stop; then direction, then steps
+    {
+      if (!inc)
+      {
+        dir=ndir;
+        digitalWrite(pin_dir,(dir>0? HIGH : LOW));
+      }
+      inc=0;
+    }
+    else
+    {
+      inc=(uint32_t)(v<0? -v : v);
+    }
+    vel=(uint64_t)inc<<SG_VSHIFT;
+    stop_at_target=false;
+    if (inc>max_inc) max_inc=inc;
+    return;
+  }
+
+  d=target-pos;
+  if (!vel)
+  {
+    if (!d) return;
+    ndir=(d>0? 1 : -1);
+    if (ndir!=dir)                         // first direction, then steps
+    {
+      dir=ndir;
+      digitalWrite(pin_dir,(dir>0? HIGH : LOW));
+      return;
+    }
+  }
+  if ((d*dir<=0) || (vel>vmax))            // overshoot, other dir. or lower max.
+  {
+    vel=(vel>acc? vel-acc : 0);
+  }
+  else if (d*dir<=stop_dist()+1)           // ramp down
+  {
+    vel=(vel>vmin+acc? vel-acc : vmin);    // min. speed: reach target
+    stop_at_target=true;
+  }
+  else if (vel<vmax)                       // ramp up
+  {
+    vel=(vel? vel+acc : vmin);
+    if (vel>vmax) vel=vmax;
+    stop_at_target=false;
+  }
+  inc=(uint32_t)(vel>>SG_VSHIFT);
+  if (inc>max_inc) max_inc=inc;
+}
+
+// one timer tick
+void IRAM_ATTR StepGen::tick(void)
+{
+  uint32_t p;
+  if (step_high)
+  {
+    digitalWrite(pin_step,LOW);
+    step_high=false;
+  }
+  p=phase+inc;
+  if (p<phase)                             // overflow: step
+  {
+    pos+=dir;
+    digitalWrite(pin_step,HIGH);
+    step_high=true;
+    nr_steps++;
+    if ((stop_at_target) && (pos==target))
+    {
+      vel=0;
+      inc=0;
+      p=0;
+      stop_at_target=false;
+    }
+  }
+  phase=p;
+}
+
+void IRAM_ATTR StepGen::tick_all(void)
+{
+  int i;
+  portENTER_CRITICAL_ISR(&sg_mux);
+  if (!sg_ticks--)
+  {
+    sg_ticks=SG_PROFILE_TICKS-1;
+    for (i=0; i<nr_motors; i++) motor[i]->profile();
+  }
+  for (i=0; i<nr_motors; i++) motor[i]->tick();
+  portEXIT_CRITICAL_ISR(&sg_mux);
+}
+
+// start step timer; call once in setup()
+void stepgen_start(void)
+{
+  int i;
+  if (sg_timer) return;
+  for (i=0; i<StepGen::nr_motors; i++)
+  {
+    pinMode(StepGen::motor[i]->pin_step,OUTPUT);
+    pinMode(StepGen::motor[i]->pin_dir,OUTPUT);
+    digitalWrite(StepGen::motor[i]->pin_dir,HIGH);
+  }
+  sg_timer=timerBegin(STEPGEN_TIMER,80,true);            // 80 MHz/80: 1 us
+  timerAttachInterrupt(sg_timer,&StepGen::tick_all,true);
+  timerAlarmWrite(sg_timer,STEPGEN_TICK_US,true);
+  timerAlarmEnable(sg_timer);
+}
+#endif
@@ -0,0 +1,76 @@
+/*******************************************************************
+ * RCSId: $Id$
+ *
+ * Project: rotordrive
+ * Author: R. Alblas
+ *
+ * content: header:
+ *   step pulses for stepper motors from a timer interrupt, see stepgen.cpp
+ *
+ * History:
+ * $Log$
+ *
+ *******************************************************************/
+#ifndef STEPGEN_HDR
+#define STEPGEN_HDR
+#include <stdint.h>
+
+#define STEPGEN_MAX 2            // nr. of motors (AX, EY)
+#define SG_VSHIFT 16             // velocity: steps/tick << (32+SG_VSHIFT)
+
+// Same calls as AccelStepper (DRIVER interface: step + direction pin),
+// as far as used by rotorfuncs.ino. Positions and speeds in steps.
+class StepGen
+{
+ public:
+  StepGen(int interface,int pin_step,int pin_dir);
+  void setMaxSpeed(float speed);
+  float maxSpeed(void);
+  void setAcceleration(float accel);
+  void moveTo(long pos);
+  void setSpeed(float speed);
+  float speed(void);
+  void stop(void);
+  bool run(void);
+  bool runSpeed(void);
+  long currentPosition(void);
+  long distanceToGo(void);
+  void setCurrentPosition(long pos);
+  void follow(float pos,float speed);  // not AccelStepper: setpoints, see stepgen.cpp
+
+  // timer interrupt, all motors
+  static void tick_all(void);
+  static StepGen *motor[STEPGEN_MAX];
+  static int nr_motors;
+
+  int pin_step,pin_dir;
+  unsigned long nr_steps;        // steps given
+  unsigned long max_inc;         // highest step rate reached (phase inc.)
+
+ private:
+  void tick(void);
+  void profile(void);
+  long stop_dist(void);
+
+  float max_sps;                 // as set by setMaxSpeed()
+  volatile long pos;             // current position (steps)
+  volatile long target;          // moveTo()
+  volatile long spd_req;         // setSpeed(): phase inc./tick, signed
+  volatile bool run_speed;       // runSpeed(): constant speed, no profile
+  volatile bool following;       // follow(): setpoint from caller, no profile
+  volatile long target_fx;       // follow(): position, 1/256 steps
+  volatile int dir;              // +1, -1
+  volatile uint32_t inc;         // phase increment per tick
+  uint64_t vel;                  // profile speed, see SG_VSHIFT
+  uint64_t vmax;
+  uint64_t acc;                  // speed change per profile update
+  uint64_t vmin;                 // start/end speed
+  uint64_t sd_k;                 // stop distance factor
+  uint32_t phase;
+  bool step_high;
+  bool stop_at_target;           // last part of ramp down
+};
+
+void stepgen_start(void);
+
+#endif